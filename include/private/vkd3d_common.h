@@ -81,6 +81,15 @@ static inline bool vkd3d_bitmask_is_contiguous(unsigned int mask)
     return vkd3d_popcount(mask) == j;
 }
 
+static inline void vkd3d_prefetch(const void *address)
+{
+#ifdef HAVE_BUILTIN_PREFETCH
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
 /* Undefined for x == 0. */
 static inline unsigned int vkd3d_log2i(unsigned int x)
 {
@@ -160,6 +169,32 @@ static inline LONG InterlockedDecrement(LONG volatile *x)
 # else
 #  error "InterlockedDecrement() not implemented for this platform"
 # endif
+
+# if HAVE_SYNC_VAL_COMPARE_AND_SWAP
+static inline LONG InterlockedCompareExchange(LONG volatile *x, LONG xchg, LONG cmp)
+{
+    return __sync_val_compare_and_swap(x, cmp, xchg);
+}
+
+static inline void *InterlockedCompareExchangePointer(void * volatile *x, void *xchg, void *cmp)
+{
+    return __sync_val_compare_and_swap(x, cmp, xchg);
+}
+
+static inline void *InterlockedExchangePointer(void * volatile *x, void *value)
+{
+    void *old;
+
+    do
+    {
+        old = *x;
+    } while (__sync_val_compare_and_swap(x, old, value) != old);
+
+    return old;
+}
+# else
+#  error "InterlockedCompareExchange() not implemented for this platform"
+# endif
 #endif  /* _WIN32 */
 
 #if HAVE_SYNC_ADD_AND_FETCH
@@ -144,6 +144,102 @@ struct vkd3d_image_resource_create_info
     D3D12_RESOURCE_STATES present_state;
 };
 
+/* vkd3d_queue_timestamp flags */
+#define VKD3D_QUEUE_TIMESTAMP_CALIBRATED 0x00000001
+
+/* Available since 1.2. */
+struct vkd3d_queue_timestamp
+{
+    uint64_t submission_index;
+    unsigned int command_list_count;
+    unsigned int flags;
+
+    /* CLOCK_MONOTONIC, in nanoseconds. */
+    uint64_t cpu_submit_time;
+    /* In nanoseconds. CLOCK_MONOTONIC when VKD3D_QUEUE_TIMESTAMP_CALIBRATED
+     * is set, the GPU time domain otherwise. */
+    uint64_t gpu_begin_time;
+    uint64_t gpu_end_time;
+};
+
+/* Available since 1.2. */
+struct vkd3d_memory_statistics
+{
+    /* Memory chunks used to suballocate committed resources. */
+    uint64_t chunk_count;
+    uint64_t chunk_size;
+    uint64_t suballocation_count;
+    /* Bytes reserved in chunks, and bytes actually requested by resources.
+     * The difference is lost to internal fragmentation. */
+    uint64_t suballocated_size;
+    uint64_t requested_size;
+    uint64_t largest_free_block_size;
+
+    /* Committed resources which own their VkDeviceMemory. */
+    uint64_t dedicated_allocation_count;
+    uint64_t dedicated_allocation_size;
+};
+
+/* Available since 1.2. */
+enum vkd3d_memory_segment_group
+{
+    VKD3D_MEMORY_SEGMENT_GROUP_LOCAL = 0,
+    VKD3D_MEMORY_SEGMENT_GROUP_NON_LOCAL = 1,
+};
+
+/* Available since 1.2. Similar to DXGI_QUERY_VIDEO_MEMORY_INFO. */
+struct vkd3d_video_memory_info
+{
+    uint64_t budget;
+    /* Memory of evicted heaps and committed resources is not included. */
+    uint64_t current_usage;
+    uint64_t evicted_size;
+};
+
+/* Available since 1.2. */
+enum vkd3d_object_pool_type
+{
+    VKD3D_OBJECT_POOL_RESOURCE = 0,
+    VKD3D_OBJECT_POOL_VIEW = 1,
+};
+
+/* Available since 1.2. */
+struct vkd3d_object_pool_statistics
+{
+    uint64_t object_size;
+    uint64_t slab_count;
+    /* Objects in use, and freed objects kept for reuse. */
+    uint64_t allocated_count;
+    uint64_t free_count;
+};
+
+/* Available since 1.2. */
+struct vkd3d_sampler_cache_statistics
+{
+    /* Distinct Vulkan samplers currently alive. */
+    uint64_t sampler_count;
+    uint64_t hit_count;
+    uint64_t miss_count;
+};
+
+/* Available since 1.2. */
+struct vkd3d_view_cache_statistics
+{
+    /* Distinct Vulkan views currently cached for the resource. */
+    uint64_t view_count;
+    uint64_t hit_count;
+    uint64_t miss_count;
+    /* Views dropped because no descriptor referenced them anymore. */
+    uint64_t purged_count;
+};
+
+/* Available since 1.2. */
+struct vkd3d_upload_allocation
+{
+    D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+    void *cpu_address;
+};
+
 #ifndef VKD3D_NO_PROTOTYPES
 
 HRESULT vkd3d_create_instance(const struct vkd3d_instance_create_info *create_info,
@@ -184,6 +280,43 @@ HRESULT vkd3d_serialize_versioned_root_signature(const D3D12_VERSIONED_ROOT_SIGN
 HRESULT vkd3d_create_versioned_root_signature_deserializer(const void *data, SIZE_T data_size,
         REFIID iid, void **deserializer);
 
+/* Waits for the completed value of "fence" to reach "value" without using an
+ * event. Returns S_FALSE if "timeout_ns" expires first. */
+HRESULT vkd3d_wait_for_fence_value(ID3D12Fence *fence, uint64_t value, uint64_t timeout_ns);
+
+/* Returns up to "count" completed ExecuteCommandLists() batches, oldest
+ * first. Batches are only recorded with VKD3D_CONFIG=queue_profiling. */
+unsigned int vkd3d_drain_queue_timestamps(ID3D12CommandQueue *queue,
+        struct vkd3d_queue_timestamp *timestamps, unsigned int count);
+
+/* Returns usage statistics of the memory backing committed resources. */
+void vkd3d_get_memory_statistics(ID3D12Device *device, struct vkd3d_memory_statistics *statistics);
+
+/* Allocates transient upload heap memory from a ring owned by "queue",
+ * e.g. for root constant buffer views. The memory may be reused once
+ * "fence" reaches "fence_value". An "alignment" of 0 means 256 bytes. */
+HRESULT vkd3d_allocate_upload_memory(ID3D12CommandQueue *queue, uint64_t size, uint64_t alignment,
+        ID3D12Fence *fence, uint64_t fence_value, struct vkd3d_upload_allocation *allocation);
+
+/* Returns the memory budget and usage of "device", using VK_EXT_memory_budget
+ * when available. The local segment group consists of device local memory. */
+HRESULT vkd3d_query_video_memory_info(ID3D12Device *device, enum vkd3d_memory_segment_group segment_group,
+        struct vkd3d_video_memory_info *info);
+
+/* Returns usage statistics of the pools used for resource and view objects. */
+HRESULT vkd3d_get_object_pool_statistics(ID3D12Device *device, enum vkd3d_object_pool_type type,
+        struct vkd3d_object_pool_statistics *statistics);
+
+/* Returns statistics of the cache which shares Vulkan samplers between
+ * sampler descriptors and static samplers with identical state. */
+HRESULT vkd3d_get_sampler_cache_statistics(ID3D12Device *device,
+        struct vkd3d_sampler_cache_statistics *statistics);
+
+/* Returns statistics of the cache which shares Vulkan views of "resource"
+ * between descriptors with identical view descs. */
+HRESULT vkd3d_get_view_cache_statistics(ID3D12Resource *resource,
+        struct vkd3d_view_cache_statistics *statistics);
+
 #endif  /* VKD3D_NO_PROTOTYPES */
 
 /*
@@ -227,6 +360,29 @@ typedef HRESULT (*PFN_vkd3d_serialize_versioned_root_signature)(const D3D12_VERS
 typedef HRESULT (*PFN_vkd3d_create_versioned_root_signature_deserializer)(const void *data, SIZE_T data_size,
         REFIID iid, void **deserializer);
 
+typedef HRESULT (*PFN_vkd3d_wait_for_fence_value)(ID3D12Fence *fence, uint64_t value, uint64_t timeout_ns);
+
+typedef unsigned int (*PFN_vkd3d_drain_queue_timestamps)(ID3D12CommandQueue *queue,
+        struct vkd3d_queue_timestamp *timestamps, unsigned int count);
+
+typedef void (*PFN_vkd3d_get_memory_statistics)(ID3D12Device *device,
+        struct vkd3d_memory_statistics *statistics);
+
+typedef HRESULT (*PFN_vkd3d_allocate_upload_memory)(ID3D12CommandQueue *queue, uint64_t size,
+        uint64_t alignment, ID3D12Fence *fence, uint64_t fence_value, struct vkd3d_upload_allocation *allocation);
+
+typedef HRESULT (*PFN_vkd3d_query_video_memory_info)(ID3D12Device *device,
+        enum vkd3d_memory_segment_group segment_group, struct vkd3d_video_memory_info *info);
+
+typedef HRESULT (*PFN_vkd3d_get_object_pool_statistics)(ID3D12Device *device,
+        enum vkd3d_object_pool_type type, struct vkd3d_object_pool_statistics *statistics);
+
+typedef HRESULT (*PFN_vkd3d_get_sampler_cache_statistics)(ID3D12Device *device,
+        struct vkd3d_sampler_cache_statistics *statistics);
+
+typedef HRESULT (*PFN_vkd3d_get_view_cache_statistics)(ID3D12Resource *resource,
+        struct vkd3d_view_cache_statistics *statistics);
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
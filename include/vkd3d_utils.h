@@ -48,6 +48,20 @@ HRESULT WINAPI D3D12CreateVersionedRootSignatureDeserializer(const void *data,
 HRESULT WINAPI D3D12SerializeVersionedRootSignature(const D3D12_VERSIONED_ROOT_SIGNATURE_DESC *desc,
         ID3DBlob **blob, ID3DBlob **error_blob);
 
+/* 1.3 */
+#define VKD3D_MAXIMUM_WAIT_OBJECTS 64
+
+/* Returns VKD3D_WAIT_OBJECT_0, VKD3D_WAIT_TIMEOUT or VKD3D_WAIT_FAILED. When
+ * "wait_all" is FALSE, the index of the acquired event is returned in
+ * "signaled_index". */
+unsigned int vkd3d_wait_events(unsigned int count, const HANDLE *events, BOOL wait_all,
+        unsigned int milliseconds, unsigned int *signaled_index);
+
+/* The file descriptor of a pollable event becomes readable when the event is
+ * signaled. It is owned by the event and must not be read from directly. */
+HANDLE vkd3d_create_pollable_event(void);
+int vkd3d_get_event_fd(HANDLE event);
+
 #ifdef __cplusplus
 }
 #endif  /* __cplusplus */
@@ -113,40 +113,148 @@ HRESULT WINAPI D3D12SerializeVersionedRootSignature(const D3D12_VERSIONED_ROOT_S
 }
 
 /* Events */
-HANDLE vkd3d_create_event(void)
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+# define VKD3D_EVENT_CLOCK CLOCK_MONOTONIC
+#else
+# define VKD3D_EVENT_CLOCK CLOCK_REALTIME
+#endif
+
+static int vkd3d_cond_init(pthread_cond_t *cond)
 {
-    struct vkd3d_event *event;
+#ifdef HAVE_PTHREAD_CONDATTR_SETCLOCK
+    pthread_condattr_t attr;
     int rc;
 
-    TRACE(".\n");
+    if ((rc = pthread_condattr_init(&attr)))
+        return rc;
+    if (!(rc = pthread_condattr_setclock(&attr, VKD3D_EVENT_CLOCK)))
+        rc = pthread_cond_init(cond, &attr);
+    pthread_condattr_destroy(&attr);
+    return rc;
+#else
+    return pthread_cond_init(cond, NULL);
+#endif
+}
+
+/* Returns NULL for infinite waits. */
+static const struct timespec *vkd3d_get_wait_deadline(struct timespec *deadline, unsigned int milliseconds)
+{
+    if (milliseconds == VKD3D_INFINITE)
+        return NULL;
+
+    clock_gettime(VKD3D_EVENT_CLOCK, deadline);
+    deadline->tv_sec += milliseconds / 1000;
+    deadline->tv_nsec += (milliseconds % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000)
+    {
+        deadline->tv_nsec -= 1000000000;
+        ++deadline->tv_sec;
+    }
+
+    return deadline;
+}
+
+static int vkd3d_cond_wait(pthread_cond_t *cond, pthread_mutex_t *mutex, const struct timespec *deadline)
+{
+    if (!deadline)
+        return pthread_cond_wait(cond, mutex);
+    return pthread_cond_timedwait(cond, mutex, deadline);
+}
+
+static HANDLE vkd3d_event_create(bool pollable)
+{
+    struct vkd3d_event *event;
+    int rc;
 
     if (!(event = vkd3d_malloc(sizeof(*event))))
         return NULL;
 
-    if ((rc = pthread_mutex_init(&event->mutex, NULL)))
+    event->fd = -1;
+    if (pollable)
     {
-        ERR("Failed to initialize mutex, error %d.\n", rc);
+#ifdef HAVE_SYS_EVENTFD_H
+        if ((event->fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) < 0)
+        {
+            ERR("Failed to create eventfd, errno %d.\n", errno);
+            vkd3d_free(event);
+            return NULL;
+        }
+#else
+        FIXME("Pollable events are not supported on this platform.\n");
         vkd3d_free(event);
         return NULL;
+#endif
+    }
+
+    if ((rc = pthread_mutex_init(&event->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        goto fail;
     }
-    if ((rc = pthread_cond_init(&event->cond, NULL)))
+    if ((rc = vkd3d_cond_init(&event->cond)))
     {
         ERR("Failed to initialize condition variable, error %d.\n", rc);
         pthread_mutex_destroy(&event->mutex);
-        vkd3d_free(event);
-        return NULL;
+        goto fail;
     }
 
+    list_init(&event->waiters);
     event->is_signaled = false;
 
     TRACE("Created event %p.\n", event);
 
     return event;
+
+fail:
+    if (event->fd != -1)
+        close(event->fd);
+    vkd3d_free(event);
+    return NULL;
+}
+
+HANDLE vkd3d_create_event(void)
+{
+    TRACE(".\n");
+
+    return vkd3d_event_create(false);
+}
+
+HANDLE vkd3d_create_pollable_event(void)
+{
+    TRACE(".\n");
+
+    return vkd3d_event_create(true);
+}
+
+int vkd3d_get_event_fd(HANDLE event)
+{
+    struct vkd3d_event *impl = event;
+
+    TRACE("event %p.\n", event);
+
+    return impl->fd;
+}
+
+static void vkd3d_event_reset_locked(struct vkd3d_event *event)
+{
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t value;
+#endif
+
+    event->is_signaled = false;
+
+#ifdef HAVE_SYS_EVENTFD_H
+    if (event->fd != -1 && read(event->fd, &value, sizeof(value)) < 0 && errno != EAGAIN)
+        ERR("Failed to reset eventfd, errno %d.\n", errno);
+#endif
 }
 
 unsigned int vkd3d_wait_event(HANDLE event, unsigned int milliseconds)
 {
+    const struct timespec *deadline = NULL;
     struct vkd3d_event *impl = event;
+    struct timespec timeout;
+    unsigned int ret;
     int rc;
 
     TRACE("event %p, milliseconds %u.\n", event, milliseconds);
@@ -157,39 +265,225 @@ unsigned int vkd3d_wait_event(HANDLE event, unsigned int milliseconds)
         return VKD3D_WAIT_FAILED;
     }
 
-    if (impl->is_signaled || !milliseconds)
+    if (!impl->is_signaled && milliseconds)
     {
-        bool is_signaled = impl->is_signaled;
-        impl->is_signaled = false;
-        pthread_mutex_unlock(&impl->mutex);
-        return is_signaled ? VKD3D_WAIT_OBJECT_0 : VKD3D_WAIT_TIMEOUT;
-    }
+        deadline = vkd3d_get_wait_deadline(&timeout, milliseconds);
 
-    if (milliseconds == VKD3D_INFINITE)
-    {
         do
         {
-            if ((rc = pthread_cond_wait(&impl->cond, &impl->mutex)))
+            if ((rc = vkd3d_cond_wait(&impl->cond, &impl->mutex, deadline)) == ETIMEDOUT)
+                break;
+            if (rc)
             {
                 ERR("Failed to wait on condition variable, error %d.\n", rc);
                 pthread_mutex_unlock(&impl->mutex);
                 return VKD3D_WAIT_FAILED;
             }
         } while (!impl->is_signaled);
+    }
 
-        impl->is_signaled = false;
-        pthread_mutex_unlock(&impl->mutex);
-        return VKD3D_WAIT_OBJECT_0;
+    if (impl->is_signaled)
+    {
+        vkd3d_event_reset_locked(impl);
+        ret = VKD3D_WAIT_OBJECT_0;
+    }
+    else
+    {
+        ret = VKD3D_WAIT_TIMEOUT;
     }
 
     pthread_mutex_unlock(&impl->mutex);
-    FIXME("Timed wait not implemented yet.\n");
-    return VKD3D_WAIT_FAILED;
+    return ret;
+}
+
+struct vkd3d_event_waiter
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned int signal_count;
+};
+
+struct vkd3d_event_wait_block
+{
+    struct list entry;
+    struct vkd3d_event_waiter *waiter;
+};
+
+static int vkd3d_event_compare(const void *a, const void *b)
+{
+    uintptr_t event_a = (uintptr_t)*(struct vkd3d_event * const *)a;
+    uintptr_t event_b = (uintptr_t)*(struct vkd3d_event * const *)b;
+
+    return event_a < event_b ? -1 : event_a > event_b;
+}
+
+static bool vkd3d_event_try_acquire_any(struct vkd3d_event * const *events,
+        unsigned int count, unsigned int *signaled_index)
+{
+    unsigned int i;
+    bool ret;
+
+    for (i = 0; i < count; ++i)
+    {
+        pthread_mutex_lock(&events[i]->mutex);
+        if ((ret = events[i]->is_signaled))
+            vkd3d_event_reset_locked(events[i]);
+        pthread_mutex_unlock(&events[i]->mutex);
+
+        if (ret)
+        {
+            if (signaled_index)
+                *signaled_index = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/* The events must be sorted by address, in order to lock them in a
+ * consistent order. */
+static bool vkd3d_event_try_acquire_all(struct vkd3d_event * const *events, unsigned int count)
+{
+    unsigned int i;
+    bool ret = true;
+
+    for (i = 0; i < count; ++i)
+    {
+        pthread_mutex_lock(&events[i]->mutex);
+        ret &= events[i]->is_signaled;
+    }
+
+    for (i = count; i--;)
+    {
+        if (ret)
+            vkd3d_event_reset_locked(events[i]);
+        pthread_mutex_unlock(&events[i]->mutex);
+    }
+
+    return ret;
+}
+
+unsigned int vkd3d_wait_events(unsigned int count, const HANDLE *events, BOOL wait_all,
+        unsigned int milliseconds, unsigned int *signaled_index)
+{
+    struct vkd3d_event_wait_block blocks[VKD3D_MAXIMUM_WAIT_OBJECTS];
+    struct vkd3d_event *impls[VKD3D_MAXIMUM_WAIT_OBJECTS];
+    const struct timespec *deadline;
+    struct vkd3d_event_waiter waiter;
+    unsigned int i, signal_count;
+    struct timespec timeout;
+    unsigned int ret;
+    bool acquired;
+    int rc;
+
+    TRACE("count %u, events %p, wait_all %#x, milliseconds %u, signaled_index %p.\n",
+            count, events, wait_all, milliseconds, signaled_index);
+
+    if (!count || count > VKD3D_MAXIMUM_WAIT_OBJECTS)
+    {
+        WARN("Invalid event count %u.\n", count);
+        return VKD3D_WAIT_FAILED;
+    }
+
+    memcpy(impls, events, count * sizeof(*impls));
+    if (wait_all)
+    {
+        qsort(impls, count, sizeof(*impls), vkd3d_event_compare);
+        for (i = 1; i < count; ++i)
+        {
+            if (impls[i] == impls[i - 1])
+            {
+                WARN("Duplicate event %p.\n", impls[i]);
+                return VKD3D_WAIT_FAILED;
+            }
+        }
+    }
+
+    if ((rc = pthread_mutex_init(&waiter.mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return VKD3D_WAIT_FAILED;
+    }
+    if ((rc = vkd3d_cond_init(&waiter.cond)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        pthread_mutex_destroy(&waiter.mutex);
+        return VKD3D_WAIT_FAILED;
+    }
+    waiter.signal_count = 0;
+
+    for (i = 0; i < count; ++i)
+    {
+        blocks[i].waiter = &waiter;
+        pthread_mutex_lock(&impls[i]->mutex);
+        list_add_tail(&impls[i]->waiters, &blocks[i].entry);
+        pthread_mutex_unlock(&impls[i]->mutex);
+    }
+
+    deadline = milliseconds ? vkd3d_get_wait_deadline(&timeout, milliseconds) : NULL;
+
+    for (;;)
+    {
+        pthread_mutex_lock(&waiter.mutex);
+        signal_count = waiter.signal_count;
+        pthread_mutex_unlock(&waiter.mutex);
+
+        if (wait_all)
+            acquired = vkd3d_event_try_acquire_all(impls, count);
+        else
+            acquired = vkd3d_event_try_acquire_any(impls, count, signaled_index);
+
+        if (acquired)
+        {
+            ret = VKD3D_WAIT_OBJECT_0;
+            break;
+        }
+
+        if (!milliseconds || rc == ETIMEDOUT)
+        {
+            ret = VKD3D_WAIT_TIMEOUT;
+            break;
+        }
+
+        /* An event signaled after the acquire attempt above bumps the
+         * signal count, so it can't be missed here. */
+        pthread_mutex_lock(&waiter.mutex);
+        while (waiter.signal_count == signal_count)
+        {
+            if ((rc = vkd3d_cond_wait(&waiter.cond, &waiter.mutex, deadline)))
+                break;
+        }
+        pthread_mutex_unlock(&waiter.mutex);
+
+        if (rc && rc != ETIMEDOUT)
+        {
+            ERR("Failed to wait on condition variable, error %d.\n", rc);
+            ret = VKD3D_WAIT_FAILED;
+            break;
+        }
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        pthread_mutex_lock(&impls[i]->mutex);
+        list_remove(&blocks[i].entry);
+        pthread_mutex_unlock(&impls[i]->mutex);
+    }
+
+    pthread_cond_destroy(&waiter.cond);
+    pthread_mutex_destroy(&waiter.mutex);
+
+    return ret;
 }
 
 HRESULT vkd3d_signal_event(HANDLE event)
 {
     struct vkd3d_event *impl = event;
+    struct vkd3d_event_wait_block *block;
+#ifdef HAVE_SYS_EVENTFD_H
+    uint64_t value = 1;
+#endif
     int rc;
 
     TRACE("event %p.\n", event);
@@ -199,8 +493,23 @@ HRESULT vkd3d_signal_event(HANDLE event)
         ERR("Failed to lock mutex, error %d.\n", rc);
         return E_FAIL;
     }
+
+#ifdef HAVE_SYS_EVENTFD_H
+    if (!impl->is_signaled && impl->fd != -1 && write(impl->fd, &value, sizeof(value)) < 0)
+        ERR("Failed to signal eventfd, errno %d.\n", errno);
+#endif
+
     impl->is_signaled = true;
     pthread_cond_signal(&impl->cond);
+
+    LIST_FOR_EACH_ENTRY(block, &impl->waiters, struct vkd3d_event_wait_block, entry)
+    {
+        pthread_mutex_lock(&block->waiter->mutex);
+        ++block->waiter->signal_count;
+        pthread_cond_signal(&block->waiter->cond);
+        pthread_mutex_unlock(&block->waiter->mutex);
+    }
+
     pthread_mutex_unlock(&impl->mutex);
 
     return S_OK;
@@ -217,5 +526,7 @@ void vkd3d_destroy_event(HANDLE event)
         ERR("Failed to destroy mutex, error %d.\n", rc);
     if ((rc = pthread_cond_destroy(&impl->cond)))
         ERR("Failed to destroy condition variable, error %d.\n", rc);
+    if (impl->fd != -1)
+        close(impl->fd);
     vkd3d_free(impl);
 }
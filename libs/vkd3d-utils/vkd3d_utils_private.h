@@ -23,16 +23,27 @@
 #define NONAMELESSUNION
 #define VK_NO_PROTOTYPES
 
+#include <errno.h>
 #include <pthread.h>
+#include <time.h>
+#include <unistd.h>
 #include <vkd3d.h>
 
 #include "vkd3d_memory.h"
+#include "list.h"
 #include <vkd3d_utils.h>
 
+#ifdef HAVE_SYS_EVENTFD_H
+# include <sys/eventfd.h>
+#endif
+
 struct vkd3d_event
 {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
+    /* Multi-object waits, see vkd3d_wait_events(). */
+    struct list waiters;
+    int fd;
     BOOL is_signaled;
 };
 
@@ -19,6 +19,14 @@
 
 #include "vkd3d_private.h"
 
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_LINUX_FUTEX_H
+# include <linux/futex.h>
+# include <sys/syscall.h>
+#endif
+
 static HRESULT d3d12_fence_signal(struct d3d12_fence *fence, uint64_t value, VkFence vk_fence);
 
 HRESULT vkd3d_queue_create(struct d3d12_device *device,
@@ -538,6 +546,15 @@ HRESULT vkd3d_fence_worker_stop(struct vkd3d_fence_worker *worker,
     return S_OK;
 }
 
+/* Returns the index of the lowest set bit in "mask", and clears it. */
+static unsigned int vkd3d_bitmask_iter64(uint64_t *mask)
+{
+    uint64_t bit = *mask & (~*mask + 1);
+
+    *mask &= ~bit;
+    return (uint32_t)bit ? vkd3d_log2i((uint32_t)bit) : 32 + vkd3d_log2i((uint32_t)(bit >> 32));
+}
+
 static const struct d3d12_root_parameter *root_signature_get_parameter(
         const struct d3d12_root_signature *root_signature, unsigned int index)
 {
@@ -801,11 +818,94 @@ static HRESULT d3d12_fence_add_vk_semaphore(struct d3d12_fence *fence,
     return hr;
 }
 
+/* Waiting events are kept in a binary min-heap ordered by value, so that
+ * signaling a fence only has to visit the events it actually completes. */
+static bool d3d12_fence_push_event_locked(struct d3d12_fence *fence, uint64_t value, HANDLE event)
+{
+    struct vkd3d_waiting_event *events;
+    size_t i, parent;
+
+    if (!vkd3d_array_reserve((void **)&fence->events, &fence->events_size,
+            fence->event_count + 1, sizeof(*fence->events)))
+        return false;
+
+    events = fence->events;
+    for (i = fence->event_count++; i; i = parent)
+    {
+        parent = (i - 1) / 2;
+        if (events[parent].value <= value)
+            break;
+        events[i] = events[parent];
+    }
+    events[i].value = value;
+    events[i].event = event;
+
+    return true;
+}
+
+/* Subtrees of the heap rooted above "value" can't contain it, so only the
+ * part of the heap which is due by "value" is searched. */
+static bool d3d12_fence_find_event_locked(const struct d3d12_fence *fence, size_t i,
+        uint64_t value, HANDLE event)
+{
+    const struct vkd3d_waiting_event *current;
+
+    if (i >= fence->event_count)
+        return false;
+
+    current = &fence->events[i];
+    if (current->value > value)
+        return false;
+    if (current->value == value && current->event == event)
+        return true;
+
+    return d3d12_fence_find_event_locked(fence, 2 * i + 1, value, event)
+            || d3d12_fence_find_event_locked(fence, 2 * i + 2, value, event);
+}
+
+static void d3d12_fence_pop_event_locked(struct d3d12_fence *fence)
+{
+    struct vkd3d_waiting_event *events = fence->events;
+    struct vkd3d_waiting_event last;
+    size_t i, child, count;
+
+    assert(fence->event_count);
+
+    count = --fence->event_count;
+    last = events[count];
+
+    for (i = 0; (child = 2 * i + 1) < count; i = child)
+    {
+        if (child + 1 < count && events[child + 1].value < events[child].value)
+            ++child;
+        if (last.value <= events[child].value)
+            break;
+        events[i] = events[child];
+    }
+    events[i] = last;
+}
+
+static void d3d12_fence_wake_cpu_waiters_locked(struct d3d12_fence *fence)
+{
+    /* A waiter increments the waiter count before reading the fence value,
+     * so either it sees the new value or we see the waiter. */
+    if (!atomic_add_fetch(&fence->cpu_waiter_count, 0))
+        return;
+
+#ifdef HAVE_LINUX_FUTEX_H
+    InterlockedIncrement(&fence->futex_sequence);
+    if (syscall(SYS_futex, &fence->futex_sequence, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0) < 0)
+        ERR("Failed to wake futex waiters, errno %d.\n", errno);
+#else
+    pthread_cond_broadcast(&fence->cond);
+#endif
+}
+
 static HRESULT d3d12_fence_signal(struct d3d12_fence *fence, uint64_t value, VkFence vk_fence)
 {
     struct d3d12_device *device = fence->device;
     struct vkd3d_signaled_semaphore *current;
-    unsigned int i, j;
+    unsigned int i;
     int rc;
 
     if ((rc = pthread_mutex_lock(&fence->mutex)))
@@ -814,24 +914,14 @@ static HRESULT d3d12_fence_signal(struct d3d12_fence *fence, uint64_t value, VkF
         return hresult_from_errno(rc);
     }
 
-    fence->value = value;
+    vkd3d_atomic_uint64_store(&fence->value, value);
+    d3d12_fence_wake_cpu_waiters_locked(fence);
 
-    for (i = 0, j = 0; i < fence->event_count; ++i)
+    while (fence->event_count && fence->events[0].value <= value)
     {
-        struct vkd3d_waiting_event *current = &fence->events[i];
-
-        if (current->value <= value)
-        {
-            fence->device->signal_event(current->event);
-        }
-        else
-        {
-            if (i != j)
-                fence->events[j] = *current;
-            ++j;
-        }
+        fence->device->signal_event(fence->events[0].event);
+        d3d12_fence_pop_event_locked(fence);
     }
-    fence->event_count = j;
 
     if (vk_fence)
     {
@@ -913,6 +1003,9 @@ static ULONG STDMETHODCALLTYPE d3d12_fence_Release(ID3D12Fence *iface)
         d3d12_fence_destroy_vk_objects(fence);
 
         vkd3d_free(fence->events);
+#ifndef HAVE_LINUX_FUTEX_H
+        pthread_cond_destroy(&fence->cond);
+#endif
         if ((rc = pthread_mutex_destroy(&fence->mutex)))
             ERR("Failed to destroy mutex, error %d.\n", rc);
         vkd3d_free(fence);
@@ -976,26 +1069,16 @@ static HRESULT STDMETHODCALLTYPE d3d12_fence_GetDevice(ID3D12Fence *iface, REFII
 static UINT64 STDMETHODCALLTYPE d3d12_fence_GetCompletedValue(ID3D12Fence *iface)
 {
     struct d3d12_fence *fence = impl_from_ID3D12Fence(iface);
-    uint64_t completed_value;
-    int rc;
 
     TRACE("iface %p.\n", iface);
 
-    if ((rc = pthread_mutex_lock(&fence->mutex)))
-    {
-        ERR("Failed to lock mutex, error %d.\n", rc);
-        return 0;
-    }
-    completed_value = fence->value;
-    pthread_mutex_unlock(&fence->mutex);
-    return completed_value;
+    return vkd3d_atomic_uint64_load(&fence->value);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_fence_SetEventOnCompletion(ID3D12Fence *iface,
         UINT64 value, HANDLE event)
 {
     struct d3d12_fence *fence = impl_from_ID3D12Fence(iface);
-    unsigned int i;
     int rc;
 
     TRACE("iface %p, value %#"PRIx64", event %p.\n", iface, value, event);
@@ -1013,30 +1096,20 @@ static HRESULT STDMETHODCALLTYPE d3d12_fence_SetEventOnCompletion(ID3D12Fence *i
         return S_OK;
     }
 
-    for (i = 0; i < fence->event_count; ++i)
+    if (d3d12_fence_find_event_locked(fence, 0, value, event))
     {
-        struct vkd3d_waiting_event *current = &fence->events[i];
-        if (current->value == value && current->event == event)
-        {
-            WARN("Event completion for (%p, %#"PRIx64") is already in the list.\n",
-                    event, value);
-            pthread_mutex_unlock(&fence->mutex);
-            return S_OK;
-        }
+        WARN("Event completion for (%p, %#"PRIx64") is already in the list.\n", event, value);
+        pthread_mutex_unlock(&fence->mutex);
+        return S_OK;
     }
 
-    if (!vkd3d_array_reserve((void **)&fence->events, &fence->events_size,
-            fence->event_count + 1, sizeof(*fence->events)))
+    if (!d3d12_fence_push_event_locked(fence, value, event))
     {
         WARN("Failed to add event.\n");
         pthread_mutex_unlock(&fence->mutex);
         return E_OUTOFMEMORY;
     }
 
-    fence->events[fence->event_count].value = value;
-    fence->events[fence->event_count].event = event;
-    ++fence->event_count;
-
     pthread_mutex_unlock(&fence->mutex);
     return S_OK;
 }
@@ -1050,6 +1123,121 @@ static HRESULT STDMETHODCALLTYPE d3d12_fence_Signal(ID3D12Fence *iface, UINT64 v
     return d3d12_fence_signal(fence, value, VK_NULL_HANDLE);
 }
 
+#ifdef HAVE_LINUX_FUTEX_H
+static bool vkd3d_get_remaining_timeout(const struct timespec *deadline, clockid_t clock,
+        struct timespec *timeout)
+{
+    struct timespec now;
+
+    clock_gettime(clock, &now);
+    if (now.tv_sec > deadline->tv_sec
+            || (now.tv_sec == deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec))
+        return false;
+
+    timeout->tv_sec = deadline->tv_sec - now.tv_sec;
+    if ((timeout->tv_nsec = deadline->tv_nsec - now.tv_nsec) < 0)
+    {
+        timeout->tv_nsec += 1000000000;
+        --timeout->tv_sec;
+    }
+
+    return true;
+}
+#endif
+
+/* Sleeps until the completed value of the fence reaches "value", without
+ * going through an event. Returns S_FALSE if the timeout expires. */
+HRESULT d3d12_fence_wait_for_value(struct d3d12_fence *fence, uint64_t value, uint64_t timeout_ns)
+{
+#ifdef HAVE_LINUX_FUTEX_H
+    const clockid_t clock = CLOCK_MONOTONIC;
+    struct timespec timeout;
+    LONG sequence;
+#else
+    const clockid_t clock = CLOCK_REALTIME;
+    int rc;
+#endif
+    struct timespec deadline;
+    HRESULT hr = S_OK;
+
+    TRACE("fence %p, value %#"PRIx64", timeout %"PRIu64".\n", fence, value, timeout_ns);
+
+    if (vkd3d_atomic_uint64_load(&fence->value) >= value)
+        return S_OK;
+    if (!timeout_ns)
+        return S_FALSE;
+
+    if (timeout_ns != ~(uint64_t)0)
+    {
+        clock_gettime(clock, &deadline);
+        deadline.tv_sec += timeout_ns / 1000000000;
+        if ((deadline.tv_nsec += timeout_ns % 1000000000) >= 1000000000)
+        {
+            deadline.tv_nsec -= 1000000000;
+            ++deadline.tv_sec;
+        }
+    }
+
+    InterlockedIncrement(&fence->cpu_waiter_count);
+
+#ifdef HAVE_LINUX_FUTEX_H
+    for (;;)
+    {
+        sequence = atomic_add_fetch(&fence->futex_sequence, 0);
+        if (vkd3d_atomic_uint64_load(&fence->value) >= value)
+            break;
+
+        if (timeout_ns != ~(uint64_t)0 && !vkd3d_get_remaining_timeout(&deadline, clock, &timeout))
+        {
+            hr = S_FALSE;
+            break;
+        }
+
+        if (syscall(SYS_futex, &fence->futex_sequence, FUTEX_WAIT_PRIVATE, sequence,
+                timeout_ns != ~(uint64_t)0 ? &timeout : NULL, NULL, 0) < 0
+                && errno != EAGAIN && errno != EINTR && errno != ETIMEDOUT)
+        {
+            ERR("Failed to wait on futex, errno %d.\n", errno);
+            hr = E_FAIL;
+            break;
+        }
+    }
+#else
+    if ((rc = pthread_mutex_lock(&fence->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        InterlockedDecrement(&fence->cpu_waiter_count);
+        return hresult_from_errno(rc);
+    }
+
+    while (fence->value < value)
+    {
+        if (timeout_ns == ~(uint64_t)0)
+            rc = pthread_cond_wait(&fence->cond, &fence->mutex);
+        else
+            rc = pthread_cond_timedwait(&fence->cond, &fence->mutex, &deadline);
+
+        if (rc == ETIMEDOUT)
+        {
+            hr = fence->value < value ? S_FALSE : S_OK;
+            break;
+        }
+        if (rc)
+        {
+            ERR("Failed to wait on condition variable, error %d.\n", rc);
+            hr = hresult_from_errno(rc);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&fence->mutex);
+#endif
+
+    InterlockedDecrement(&fence->cpu_waiter_count);
+
+    return hr;
+}
+
 static const struct ID3D12FenceVtbl d3d12_fence_vtbl =
 {
     /* IUnknown methods */
@@ -1094,6 +1282,18 @@ static HRESULT d3d12_fence_init(struct d3d12_fence *fence, struct d3d12_device *
         return hresult_from_errno(rc);
     }
 
+    fence->cpu_waiter_count = 0;
+#ifdef HAVE_LINUX_FUTEX_H
+    fence->futex_sequence = 0;
+#else
+    if ((rc = pthread_cond_init(&fence->cond, NULL)))
+    {
+        ERR("Failed to initialize condition variable, error %d.\n", rc);
+        pthread_mutex_destroy(&fence->mutex);
+        return hresult_from_errno(rc);
+    }
+#endif
+
     if (flags)
         FIXME("Ignoring flags %#x.\n", flags);
 
@@ -1110,6 +1310,9 @@ static HRESULT d3d12_fence_init(struct d3d12_fence *fence, struct d3d12_device *
 
     if (FAILED(hr = vkd3d_private_store_init(&fence->private_store)))
     {
+#ifndef HAVE_LINUX_FUTEX_H
+        pthread_cond_destroy(&fence->cond);
+#endif
         pthread_mutex_destroy(&fence->mutex);
         return hr;
     }
@@ -1123,11 +1326,16 @@ HRESULT d3d12_fence_create(struct d3d12_device *device,
         uint64_t initial_value, D3D12_FENCE_FLAGS flags, struct d3d12_fence **fence)
 {
     struct d3d12_fence *object;
+    HRESULT hr;
 
     if (!(object = vkd3d_malloc(sizeof(*object))))
         return E_OUTOFMEMORY;
 
-    d3d12_fence_init(object, device, initial_value, flags);
+    if (FAILED(hr = d3d12_fence_init(object, device, initial_value, flags)))
+    {
+        vkd3d_free(object);
+        return hr;
+    }
 
     TRACE("Created fence %p.\n", object);
 
@@ -1312,6 +1520,18 @@ static bool d3d12_command_allocator_add_transfer_buffer(struct d3d12_command_all
     return true;
 }
 
+static bool d3d12_command_allocator_add_scratch_buffer(struct d3d12_command_allocator *allocator,
+        const struct vkd3d_scratch_buffer *buffer)
+{
+    if (!vkd3d_array_reserve((void **)&allocator->scratch_buffers, &allocator->scratch_buffers_size,
+            allocator->scratch_buffer_count + 1, sizeof(*allocator->scratch_buffers)))
+        return false;
+
+    allocator->scratch_buffers[allocator->scratch_buffer_count++] = *buffer;
+
+    return true;
+}
+
 static VkDescriptorPool d3d12_command_allocator_allocate_descriptor_pool(
         struct d3d12_command_allocator *allocator)
 {
@@ -1420,114 +1640,364 @@ static void vkd3d_buffer_destroy(struct vkd3d_buffer *buffer, struct d3d12_devic
     VK_CALL(vkDestroyBuffer(device->vk_device, buffer->vk_buffer, NULL));
 }
 
-static void d3d12_command_allocator_free_resources(struct d3d12_command_allocator *allocator,
-        bool keep_reusable_resources)
+static HRESULT vkd3d_create_transfer_buffer(struct d3d12_device *device,
+        VkDeviceSize size, struct vkd3d_buffer *buffer)
 {
-    struct d3d12_device *device = allocator->device;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    unsigned int i, j;
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_RESOURCE_DESC buffer_desc;
+    HRESULT hr;
 
-    allocator->vk_descriptor_pool = VK_NULL_HANDLE;
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
 
-    if (keep_reusable_resources)
-    {
-        if (vkd3d_array_reserve((void **)&allocator->free_descriptor_pools,
-                &allocator->free_descriptor_pools_size,
-                allocator->free_descriptor_pool_count + allocator->descriptor_pool_count,
-                sizeof(*allocator->free_descriptor_pools)))
-        {
-            for (i = 0, j = allocator->free_descriptor_pool_count; i < allocator->descriptor_pool_count; ++i, ++j)
-            {
-                VK_CALL(vkResetDescriptorPool(device->vk_device, allocator->descriptor_pools[i], 0));
-                allocator->free_descriptor_pools[j] = allocator->descriptor_pools[i];
-            }
-            allocator->free_descriptor_pool_count += allocator->descriptor_pool_count;
-            allocator->descriptor_pool_count = 0;
-        }
-    }
-    else
-    {
-        for (i = 0; i < allocator->free_descriptor_pool_count; ++i)
-        {
-            VK_CALL(vkDestroyDescriptorPool(device->vk_device, allocator->free_descriptor_pools[i], NULL));
-        }
-        allocator->free_descriptor_pool_count = 0;
-    }
+    buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    buffer_desc.Alignment = 0;
+    buffer_desc.Width = size;
+    buffer_desc.Height = 1;
+    buffer_desc.DepthOrArraySize = 1;
+    buffer_desc.MipLevels = 1;
+    buffer_desc.Format = DXGI_FORMAT_UNKNOWN;
+    buffer_desc.SampleDesc.Count = 1;
+    buffer_desc.SampleDesc.Quality = 0;
+    buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    buffer_desc.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
 
-    for (i = 0; i < allocator->transfer_buffer_count; ++i)
+    if (FAILED(hr = vkd3d_create_buffer(device, &heap_properties, D3D12_HEAP_FLAG_NONE,
+            &buffer_desc, &buffer->vk_buffer)))
+        return hr;
+    if (FAILED(hr = vkd3d_allocate_buffer_memory(device, buffer->vk_buffer,
+            &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer->vk_memory, NULL, NULL)))
     {
-        vkd3d_buffer_destroy(&allocator->transfer_buffers[i], device);
+        VK_CALL(vkDestroyBuffer(device->vk_device, buffer->vk_buffer, NULL));
+        return hr;
     }
-    allocator->transfer_buffer_count = 0;
 
-    for (i = 0; i < allocator->buffer_view_count; ++i)
-    {
-        VK_CALL(vkDestroyBufferView(device->vk_device, allocator->buffer_views[i], NULL));
-    }
-    allocator->buffer_view_count = 0;
+    return S_OK;
+}
 
-    for (i = 0; i < allocator->view_count; ++i)
-    {
-        vkd3d_view_decref(allocator->views[i], device);
-    }
-    allocator->view_count = 0;
+#define VKD3D_STAGING_RING_SIZE 0x1000000
 
-    for (i = 0; i < allocator->descriptor_pool_count; ++i)
-    {
-        VK_CALL(vkDestroyDescriptorPool(device->vk_device, allocator->descriptor_pools[i], NULL));
-    }
-    allocator->descriptor_pool_count = 0;
+HRESULT vkd3d_staging_ring_init(struct vkd3d_staging_ring *ring)
+{
+    int rc;
 
-    for (i = 0; i < allocator->framebuffer_count; ++i)
-    {
-        VK_CALL(vkDestroyFramebuffer(device->vk_device, allocator->framebuffers[i], NULL));
-    }
-    allocator->framebuffer_count = 0;
+    memset(ring, 0, sizeof(*ring));
+    ring->next_serial = 1;
 
-    for (i = 0; i < allocator->pass_count; ++i)
+    if ((rc = pthread_mutex_init(&ring->mutex, NULL)))
     {
-        VK_CALL(vkDestroyRenderPass(device->vk_device, allocator->passes[i], NULL));
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
     }
-    allocator->pass_count = 0;
-}
 
-/* ID3D12CommandAllocator */
-static inline struct d3d12_command_allocator *impl_from_ID3D12CommandAllocator(ID3D12CommandAllocator *iface)
-{
-    return CONTAINING_RECORD(iface, struct d3d12_command_allocator, ID3D12CommandAllocator_iface);
+    return S_OK;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_command_allocator_QueryInterface(ID3D12CommandAllocator *iface,
-        REFIID riid, void **object)
+void vkd3d_staging_ring_cleanup(struct vkd3d_staging_ring *ring, struct d3d12_device *device)
 {
-    TRACE("iface %p, riid %s, object %p.\n", iface, debugstr_guid(riid), object);
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    size_t i;
 
-    if (IsEqualGUID(riid, &IID_ID3D12CommandAllocator)
-            || IsEqualGUID(riid, &IID_ID3D12Pageable)
-            || IsEqualGUID(riid, &IID_ID3D12DeviceChild)
-            || IsEqualGUID(riid, &IID_ID3D12Object)
-            || IsEqualGUID(riid, &IID_IUnknown))
+    if (ring->region_count)
+        ERR("Staging ring still has %zu regions.\n", ring->region_count);
+
+    for (i = 0; i < ring->submission_count; ++i)
     {
-        ID3D12CommandAllocator_AddRef(iface);
-        *object = iface;
-        return S_OK;
+        VK_CALL(vkWaitForFences(device->vk_device, 1, &ring->submissions[i].vk_fence, VK_TRUE, UINT64_MAX));
+        VK_CALL(vkDestroyFence(device->vk_device, ring->submissions[i].vk_fence, NULL));
     }
+    for (i = 0; i < ring->free_fence_count; ++i)
+        VK_CALL(vkDestroyFence(device->vk_device, ring->free_fences[i], NULL));
 
-    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(riid));
+    if (ring->buffer.vk_buffer)
+        vkd3d_buffer_destroy(&ring->buffer, device);
+    vkd3d_free(ring->regions);
+    vkd3d_free(ring->submissions);
+    vkd3d_free(ring->free_fences);
 
-    *object = NULL;
-    return E_NOINTERFACE;
+    pthread_mutex_destroy(&ring->mutex);
 }
 
-static ULONG STDMETHODCALLTYPE d3d12_command_allocator_AddRef(ID3D12CommandAllocator *iface)
+/* Retires completed submissions, and moves the tail past the oldest regions
+ * which are released by their command list and no longer used by the GPU. */
+static void vkd3d_staging_ring_update_locked(struct vkd3d_staging_ring *ring, struct d3d12_device *device)
 {
-    struct d3d12_command_allocator *allocator = impl_from_ID3D12CommandAllocator(iface);
-    ULONG refcount = InterlockedIncrement(&allocator->refcount);
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_staging_region *region;
+    uint64_t min_pending_serial;
+    size_t i, j;
 
-    TRACE("%p increasing refcount to %u.\n", allocator, refcount);
+    min_pending_serial = ring->next_serial;
+    for (i = 0, j = 0; i < ring->submission_count; ++i)
+    {
+        const struct vkd3d_staging_submission *submission = &ring->submissions[i];
 
-    return refcount;
-}
+        /* Submissions on different queues may complete out of order. */
+        if (VK_CALL(vkGetFenceStatus(device->vk_device, submission->vk_fence)) == VK_SUCCESS)
+        {
+            if (VK_CALL(vkResetFences(device->vk_device, 1, &submission->vk_fence)) >= 0
+                    && vkd3d_array_reserve((void **)&ring->free_fences, &ring->free_fences_size,
+                    ring->free_fence_count + 1, sizeof(*ring->free_fences)))
+                ring->free_fences[ring->free_fence_count++] = submission->vk_fence;
+            else
+                VK_CALL(vkDestroyFence(device->vk_device, submission->vk_fence, NULL));
+            continue;
+        }
+
+        min_pending_serial = min(min_pending_serial, submission->serial);
+        ring->submissions[j++] = *submission;
+    }
+    ring->submission_count = j;
+
+    while (ring->region_count && (region = &ring->regions[ring->region_start])->released
+            && region->serial < min_pending_serial)
+    {
+        ++ring->region_start;
+        --ring->region_count;
+        ++ring->first_id;
+    }
+
+    if (ring->region_count)
+    {
+        ring->tail = ring->regions[ring->region_start].offset;
+    }
+    else
+    {
+        ring->region_start = 0;
+        ring->head = ring->tail = 0;
+    }
+}
+
+/* The ring buffer is created on first use. Allocations which don't fit
+ * return false, and callers fall back to a dedicated transfer buffer. */
+static bool vkd3d_staging_ring_allocate(struct vkd3d_staging_ring *ring, struct d3d12_device *device,
+        VkDeviceSize size, VkDeviceSize alignment, VkBuffer *vk_buffer, VkDeviceSize *offset, uint64_t *id)
+{
+    struct vkd3d_staging_region *region;
+    VkDeviceSize start;
+    bool ret = false;
+    int rc;
+
+    if (!size || size > VKD3D_STAGING_RING_SIZE / 2)
+        return false;
+
+    if ((rc = pthread_mutex_lock(&ring->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return false;
+    }
+
+    if (!ring->buffer.vk_buffer)
+    {
+        if (FAILED(vkd3d_create_transfer_buffer(device, VKD3D_STAGING_RING_SIZE, &ring->buffer)))
+        {
+            ring->buffer.vk_buffer = VK_NULL_HANDLE;
+            goto done;
+        }
+        ring->size = VKD3D_STAGING_RING_SIZE;
+    }
+
+    vkd3d_staging_ring_update_locked(ring, device);
+
+    /* The ring is never allowed to become completely full, so that
+     * "head == tail" always means that it is empty. The alignment isn't
+     * necessarily a power of two. */
+    start = (ring->head + alignment - 1) / alignment * alignment;
+    if (!ring->region_count)
+    {
+        start = 0;
+    }
+    else if (ring->head >= ring->tail)
+    {
+        if (start + size > ring->size)
+        {
+            if (size >= ring->tail)
+                goto done;
+            start = 0;
+        }
+    }
+    else if (start + size >= ring->tail)
+    {
+        goto done;
+    }
+
+    if (ring->region_start && ring->region_start >= ring->region_count)
+    {
+        memmove(ring->regions, &ring->regions[ring->region_start], ring->region_count * sizeof(*ring->regions));
+        ring->region_start = 0;
+    }
+    if (!vkd3d_array_reserve((void **)&ring->regions, &ring->regions_size,
+            ring->region_start + ring->region_count + 1, sizeof(*ring->regions)))
+        goto done;
+
+    region = &ring->regions[ring->region_start + ring->region_count];
+    region->offset = start;
+    region->end = start + size;
+    region->serial = 0;
+    region->released = false;
+    *id = ring->first_id + ring->region_count;
+    ++ring->region_count;
+
+    ring->head = region->end;
+
+    *vk_buffer = ring->buffer.vk_buffer;
+    *offset = start;
+    ret = true;
+
+done:
+    pthread_mutex_unlock(&ring->mutex);
+    return ret;
+}
+
+static struct vkd3d_staging_region *vkd3d_staging_ring_get_region_locked(struct vkd3d_staging_ring *ring,
+        uint64_t id)
+{
+    /* Regions stay in the ring until they are released. */
+    assert(id - ring->first_id < ring->region_count);
+    return &ring->regions[ring->region_start + id - ring->first_id];
+}
+
+/* Called by a command list when it is reset or destroyed, after which the
+ * regions are reused as soon as the GPU is done with them. */
+static void vkd3d_staging_ring_release(struct vkd3d_staging_ring *ring, struct d3d12_device *device,
+        const uint64_t *ids, size_t count)
+{
+    size_t i;
+    int rc;
+
+    if (!count)
+        return;
+
+    if ((rc = pthread_mutex_lock(&ring->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    for (i = 0; i < count; ++i)
+        vkd3d_staging_ring_get_region_locked(ring, ids[i])->released = true;
+
+    vkd3d_staging_ring_update_locked(ring, device);
+
+    pthread_mutex_unlock(&ring->mutex);
+}
+
+static void d3d12_command_allocator_free_resources(struct d3d12_command_allocator *allocator,
+        bool keep_reusable_resources)
+{
+    struct d3d12_device *device = allocator->device;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    unsigned int i, j;
+
+    allocator->vk_descriptor_pool = VK_NULL_HANDLE;
+
+    if (keep_reusable_resources)
+    {
+        if (vkd3d_array_reserve((void **)&allocator->free_descriptor_pools,
+                &allocator->free_descriptor_pools_size,
+                allocator->free_descriptor_pool_count + allocator->descriptor_pool_count,
+                sizeof(*allocator->free_descriptor_pools)))
+        {
+            for (i = 0, j = allocator->free_descriptor_pool_count; i < allocator->descriptor_pool_count; ++i, ++j)
+            {
+                VK_CALL(vkResetDescriptorPool(device->vk_device, allocator->descriptor_pools[i], 0));
+                allocator->free_descriptor_pools[j] = allocator->descriptor_pools[i];
+            }
+            allocator->free_descriptor_pool_count += allocator->descriptor_pool_count;
+            allocator->descriptor_pool_count = 0;
+        }
+    }
+    else
+    {
+        for (i = 0; i < allocator->free_descriptor_pool_count; ++i)
+        {
+            VK_CALL(vkDestroyDescriptorPool(device->vk_device, allocator->free_descriptor_pools[i], NULL));
+        }
+        allocator->free_descriptor_pool_count = 0;
+    }
+
+    for (i = 0; i < allocator->transfer_buffer_count; ++i)
+    {
+        vkd3d_buffer_destroy(&allocator->transfer_buffers[i], device);
+    }
+    allocator->transfer_buffer_count = 0;
+
+    for (i = 0; i < allocator->scratch_buffer_count; ++i)
+    {
+        VK_CALL(vkDestroyBuffer(device->vk_device, allocator->scratch_buffers[i].vk_buffer, NULL));
+        vkd3d_free_memory(device, &allocator->scratch_buffers[i].allocation);
+    }
+    allocator->scratch_buffer_count = 0;
+
+    for (i = 0; i < allocator->buffer_view_count; ++i)
+    {
+        VK_CALL(vkDestroyBufferView(device->vk_device, allocator->buffer_views[i], NULL));
+    }
+    allocator->buffer_view_count = 0;
+
+    for (i = 0; i < allocator->view_count; ++i)
+    {
+        vkd3d_view_decref(allocator->views[i], device);
+    }
+    allocator->view_count = 0;
+
+    for (i = 0; i < allocator->descriptor_pool_count; ++i)
+    {
+        VK_CALL(vkDestroyDescriptorPool(device->vk_device, allocator->descriptor_pools[i], NULL));
+    }
+    allocator->descriptor_pool_count = 0;
+
+    for (i = 0; i < allocator->framebuffer_count; ++i)
+    {
+        VK_CALL(vkDestroyFramebuffer(device->vk_device, allocator->framebuffers[i], NULL));
+    }
+    allocator->framebuffer_count = 0;
+
+    for (i = 0; i < allocator->pass_count; ++i)
+    {
+        VK_CALL(vkDestroyRenderPass(device->vk_device, allocator->passes[i], NULL));
+    }
+    allocator->pass_count = 0;
+}
+
+/* ID3D12CommandAllocator */
+static inline struct d3d12_command_allocator *impl_from_ID3D12CommandAllocator(ID3D12CommandAllocator *iface)
+{
+    return CONTAINING_RECORD(iface, struct d3d12_command_allocator, ID3D12CommandAllocator_iface);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_allocator_QueryInterface(ID3D12CommandAllocator *iface,
+        REFIID riid, void **object)
+{
+    TRACE("iface %p, riid %s, object %p.\n", iface, debugstr_guid(riid), object);
+
+    if (IsEqualGUID(riid, &IID_ID3D12CommandAllocator)
+            || IsEqualGUID(riid, &IID_ID3D12Pageable)
+            || IsEqualGUID(riid, &IID_ID3D12DeviceChild)
+            || IsEqualGUID(riid, &IID_ID3D12Object)
+            || IsEqualGUID(riid, &IID_IUnknown))
+    {
+        ID3D12CommandAllocator_AddRef(iface);
+        *object = iface;
+        return S_OK;
+    }
+
+    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(riid));
+
+    *object = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE d3d12_command_allocator_AddRef(ID3D12CommandAllocator *iface)
+{
+    struct d3d12_command_allocator *allocator = impl_from_ID3D12CommandAllocator(iface);
+    ULONG refcount = InterlockedIncrement(&allocator->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", allocator, refcount);
+
+    return refcount;
+}
 
 static ULONG STDMETHODCALLTYPE d3d12_command_allocator_Release(ID3D12CommandAllocator *iface)
 {
@@ -1548,6 +2018,7 @@ static ULONG STDMETHODCALLTYPE d3d12_command_allocator_Release(ID3D12CommandAllo
 
         d3d12_command_allocator_free_resources(allocator, false);
         vkd3d_free(allocator->transfer_buffers);
+        vkd3d_free(allocator->scratch_buffers);
         vkd3d_free(allocator->buffer_views);
         vkd3d_free(allocator->views);
         vkd3d_free(allocator->descriptor_pools);
@@ -1767,6 +2238,10 @@ static HRESULT d3d12_command_allocator_init(struct d3d12_command_allocator *allo
     allocator->transfer_buffers_size = 0;
     allocator->transfer_buffer_count = 0;
 
+    allocator->scratch_buffers = NULL;
+    allocator->scratch_buffers_size = 0;
+    allocator->scratch_buffer_count = 0;
+
     allocator->command_buffers = NULL;
     allocator->command_buffers_size = 0;
     allocator->command_buffer_count = 0;
@@ -1822,6 +2297,144 @@ static void d3d12_command_list_invalidate_current_pipeline(struct d3d12_command_
     list->current_pipeline = VK_NULL_HANDLE;
 }
 
+#define VKD3D_PREDICATE_BUFFER_SIZE 0x10000
+
+/* Predicate buffers are suballocated, so recording predicated commands doesn't
+ * allocate device memory per buffer. Upload heap buffers are persistently
+ * mapped, and are used for the arguments of emulated predicated commands. */
+static bool d3d12_command_list_allocate_predicate_memory(struct d3d12_command_list *list,
+        struct vkd3d_predicate_buffer *predicate_buffer, D3D12_HEAP_TYPE heap_type, VkDeviceSize size,
+        VkBuffer *vk_buffer, VkDeviceSize *offset, void **data)
+{
+    struct d3d12_device *device = list->device;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    D3D12_HEAP_PROPERTIES heap_properties;
+    struct vkd3d_scratch_buffer buffer;
+    D3D12_RESOURCE_DESC buffer_desc;
+    VkDeviceSize alignment;
+    void *mapped_data;
+
+    alignment = max(device->vk_info.device_limits.minTexelBufferOffsetAlignment, 16);
+
+    if (!predicate_buffer->vk_buffer || align(predicate_buffer->offset, alignment) + size > predicate_buffer->size)
+    {
+        memset(&heap_properties, 0, sizeof(heap_properties));
+        heap_properties.Type = heap_type;
+
+        buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        buffer_desc.Alignment = 0;
+        buffer_desc.Width = VKD3D_PREDICATE_BUFFER_SIZE;
+        buffer_desc.Height = 1;
+        buffer_desc.DepthOrArraySize = 1;
+        buffer_desc.MipLevels = 1;
+        buffer_desc.Format = DXGI_FORMAT_UNKNOWN;
+        buffer_desc.SampleDesc.Count = 1;
+        buffer_desc.SampleDesc.Quality = 0;
+        buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        /* Latched predicate values are read through uniform texel buffer
+         * views when predication is emulated. */
+        buffer_desc.Flags = heap_type == D3D12_HEAP_TYPE_UPLOAD
+                ? D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS : D3D12_RESOURCE_FLAG_NONE;
+
+        if (FAILED(vkd3d_create_buffer(device, &heap_properties, D3D12_HEAP_FLAG_NONE,
+                &buffer_desc, &buffer.vk_buffer)))
+            return false;
+        mapped_data = NULL;
+        if (FAILED(vkd3d_suballocate_buffer_memory(device, buffer.vk_buffer, &heap_properties,
+                &buffer.allocation, heap_type == D3D12_HEAP_TYPE_UPLOAD ? &mapped_data : NULL)))
+        {
+            VK_CALL(vkDestroyBuffer(device->vk_device, buffer.vk_buffer, NULL));
+            return false;
+        }
+
+        if (!d3d12_command_allocator_add_scratch_buffer(list->allocator, &buffer))
+        {
+            ERR("Failed to add scratch buffer.\n");
+            VK_CALL(vkDestroyBuffer(device->vk_device, buffer.vk_buffer, NULL));
+            vkd3d_free_memory(device, &buffer.allocation);
+            return false;
+        }
+
+        predicate_buffer->vk_buffer = buffer.vk_buffer;
+        predicate_buffer->data = mapped_data;
+        predicate_buffer->offset = 0;
+        predicate_buffer->size = buffer_desc.Width;
+    }
+
+    predicate_buffer->offset = align(predicate_buffer->offset, alignment);
+    *vk_buffer = predicate_buffer->vk_buffer;
+    *offset = predicate_buffer->offset;
+    if (data)
+        *data = predicate_buffer->data + predicate_buffer->offset;
+    predicate_buffer->offset += size;
+
+    return true;
+}
+
+/* Direct3D latches the predicate value in SetPredication(), while Vulkan
+ * implementations may read it whenever conditional rendering is begun. Copy
+ * the value, so that conditional rendering can be restarted freely. This
+ * needs to happen outside of render pass instances. When predication is
+ * emulated, the copy is what the resolve shader reads, so application
+ * buffers don't need uniform texel buffer usage. */
+static void d3d12_command_list_latch_predicate(struct d3d12_command_list *list)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    VkPipelineStageFlags dst_stage_mask;
+    VkBufferCopy buffer_copy;
+    VkMemoryBarrier vk_barrier;
+    VkDeviceSize offset;
+    VkBuffer vk_buffer;
+
+    if (list->predicate.is_latched)
+        return;
+
+    if (!d3d12_command_list_allocate_predicate_memory(list, &list->predicate_latches,
+            D3D12_HEAP_TYPE_DEFAULT, sizeof(uint64_t), &vk_buffer, &offset, NULL))
+    {
+        WARN("Failed to allocate predicate memory.\n");
+        return;
+    }
+
+    buffer_copy.srcOffset = list->predicate.offset;
+    buffer_copy.dstOffset = offset;
+    buffer_copy.size = sizeof(uint64_t);
+    VK_CALL(vkCmdCopyBuffer(list->vk_command_buffer, list->predicate.vk_buffer, vk_buffer, 1, &buffer_copy));
+
+    vk_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    vk_barrier.pNext = NULL;
+    vk_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    if (list->device->vk_info.EXT_conditional_rendering)
+    {
+        vk_barrier.dstAccessMask = VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
+        dst_stage_mask = VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT;
+    }
+    else
+    {
+        vk_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        dst_stage_mask = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    }
+    VK_CALL(vkCmdPipelineBarrier(list->vk_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+            dst_stage_mask, 0, 1, &vk_barrier, 0, NULL, 0, NULL));
+
+    list->predicate.vk_buffer = vk_buffer;
+    list->predicate.offset = offset;
+    list->predicate.is_latched = true;
+}
+
+static void d3d12_command_list_begin_conditional_rendering(struct d3d12_command_list *list)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    VkConditionalRenderingBeginInfoEXT cond_info;
+
+    cond_info.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
+    cond_info.pNext = NULL;
+    cond_info.buffer = list->predicate.vk_buffer;
+    cond_info.offset = list->predicate.offset;
+    cond_info.flags = list->predicate.flags;
+    VK_CALL(vkCmdBeginConditionalRenderingEXT(list->vk_command_buffer, &cond_info));
+}
+
 static void d3d12_command_list_end_current_render_pass(struct d3d12_command_list *list)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
@@ -1833,7 +2446,18 @@ static void d3d12_command_list_end_current_render_pass(struct d3d12_command_list
     }
 
     if (list->current_render_pass)
+    {
+        /* Conditional rendering is begun inside the render pass instance, and
+         * has to be ended inside it. Resume it outside of the render pass. */
+        if (list->is_predicated)
+            VK_CALL(vkCmdEndConditionalRenderingEXT(list->vk_command_buffer));
         VK_CALL(vkCmdEndRenderPass(list->vk_command_buffer));
+        if (list->is_predicated)
+        {
+            d3d12_command_list_latch_predicate(list);
+            d3d12_command_list_begin_conditional_rendering(list);
+        }
+    }
 
     list->current_render_pass = VK_NULL_HANDLE;
 
@@ -2064,8 +2688,15 @@ static bool vk_barrier_parameters_from_d3d12_resource_state(unsigned int state,
         *stage_flags |= VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
         if (vk_info->EXT_conditional_rendering)
         {
-            *access_mask |= VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT;
-            *stage_flags |= VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT;
+            /* Predicates are latched with a copy. */
+            *access_mask |= VK_ACCESS_CONDITIONAL_RENDERING_READ_BIT_EXT | VK_ACCESS_TRANSFER_READ_BIT;
+            *stage_flags |= VK_PIPELINE_STAGE_CONDITIONAL_RENDERING_BIT_EXT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
+        else if (queue_shader_stages & VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT)
+        {
+            /* Predicates are resolved in a compute shader. */
+            *access_mask |= VK_ACCESS_SHADER_READ_BIT;
+            *stage_flags |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
         }
         state &= ~D3D12_RESOURCE_STATE_INDIRECT_ARGUMENT;
     }
@@ -2137,12 +2768,13 @@ static void d3d12_command_list_transition_resource_to_initial_state(struct d3d12
 static void d3d12_command_list_track_resource_usage(struct d3d12_command_list *list,
         struct d3d12_resource *resource)
 {
-    if (resource->flags & VKD3D_RESOURCE_INITIAL_STATE_TRANSITION)
+    if ((resource->flags & VKD3D_RESOURCE_INITIAL_STATE_TRANSITION)
+            && (vkd3d_atomic_uint_clear_bits(&resource->flags, VKD3D_RESOURCE_INITIAL_STATE_TRANSITION)
+            & VKD3D_RESOURCE_INITIAL_STATE_TRANSITION))
     {
         d3d12_command_list_end_current_render_pass(list);
 
         d3d12_command_list_transition_resource_to_initial_state(list, resource);
-        resource->flags &= ~VKD3D_RESOURCE_INITIAL_STATE_TRANSITION;
     }
 }
 
@@ -2196,6 +2828,10 @@ static ULONG STDMETHODCALLTYPE d3d12_command_list_Release(ID3D12GraphicsCommandL
         if (list->allocator)
             d3d12_command_allocator_free_command_buffer(list->allocator, list);
 
+        vkd3d_staging_ring_release(&device->staging_ring, device,
+                list->staging_regions, list->staging_region_count);
+        vkd3d_free(list->staging_regions);
+
         vkd3d_free(list);
 
         d3d12_device_release(device);
@@ -2324,6 +2960,9 @@ static void d3d12_command_list_reset_state(struct d3d12_command_list *list,
     list->xfb_enabled = false;
 
     list->is_predicated = false;
+    memset(&list->predicate, 0, sizeof(list->predicate));
+    memset(&list->predicate_latches, 0, sizeof(list->predicate_latches));
+    memset(&list->predicate_args, 0, sizeof(list->predicate_args));
 
     list->current_framebuffer = VK_NULL_HANDLE;
     list->current_pipeline = VK_NULL_HANDLE;
@@ -2365,6 +3004,9 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_list_Reset(ID3D12GraphicsCommandL
     if (SUCCEEDED(hr = d3d12_command_allocator_allocate_command_buffer(allocator_impl, list)))
     {
         list->allocator = allocator_impl;
+        vkd3d_staging_ring_release(&list->device->staging_ring, list->device,
+                list->staging_regions, list->staging_region_count);
+        list->staging_region_count = 0;
         d3d12_command_list_reset_state(list, initial_pipeline_state);
     }
 
@@ -2540,18 +3182,22 @@ static void d3d12_command_list_prepare_descriptors(struct d3d12_command_list *li
     bindings->in_use = false;
 
     bindings->descriptor_table_dirty_mask |= bindings->descriptor_table_active_mask & root_signature->descriptor_table_mask;
-    bindings->push_descriptor_dirty_mask |= bindings->push_descriptor_active_mask & root_signature->push_descriptor_mask;
+    if (!list->device->vk_info.KHR_push_descriptor)
+        bindings->push_descriptor_dirty_mask |= bindings->push_descriptor_active_mask & root_signature->push_descriptor_mask;
 }
 
 static bool vk_write_descriptor_set_from_d3d12_desc(VkWriteDescriptorSet *vk_descriptor_write,
-        VkDescriptorImageInfo *vk_image_info, const struct d3d12_desc *descriptor,
-        uint32_t descriptor_range_magic, VkDescriptorSet vk_descriptor_set,
+        VkDescriptorImageInfo *vk_image_info, VkDescriptorBufferInfo *vk_buffer_info,
+        const struct d3d12_desc *descriptor, uint32_t descriptor_range_magic, VkDescriptorSet vk_descriptor_set,
         uint32_t vk_binding, unsigned int index)
 {
-    const struct vkd3d_view *view = descriptor->u.view;
+    uintptr_t tagged_view = descriptor->tagged_view;
+    const struct vkd3d_view *view;
+    uint32_t magic;
 
-    if (descriptor->magic != descriptor_range_magic)
+    if ((magic = vkd3d_descriptor_magic_from_tagged_view(tagged_view)) != descriptor_range_magic)
         return false;
+    view = vkd3d_view_from_tagged_view(tagged_view);
 
     vk_descriptor_write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
     vk_descriptor_write->pNext = NULL;
@@ -2559,15 +3205,16 @@ static bool vk_write_descriptor_set_from_d3d12_desc(VkWriteDescriptorSet *vk_des
     vk_descriptor_write->dstBinding = vk_binding + index;
     vk_descriptor_write->dstArrayElement = 0;
     vk_descriptor_write->descriptorCount = 1;
-    vk_descriptor_write->descriptorType = descriptor->vk_descriptor_type;
     vk_descriptor_write->pImageInfo = NULL;
     vk_descriptor_write->pBufferInfo = NULL;
     vk_descriptor_write->pTexelBufferView = NULL;
 
-    switch (descriptor->magic)
+    switch (magic)
     {
         case VKD3D_DESCRIPTOR_MAGIC_CBV:
-            vk_descriptor_write->pBufferInfo = &descriptor->u.vk_cbv_info;
+            vk_descriptor_write->descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            *vk_buffer_info = descriptor->vk_cbv_info;
+            vk_descriptor_write->pBufferInfo = vk_buffer_info;
             break;
 
         case VKD3D_DESCRIPTOR_MAGIC_SRV:
@@ -2575,20 +3222,22 @@ static bool vk_write_descriptor_set_from_d3d12_desc(VkWriteDescriptorSet *vk_des
             /* We use separate bindings for buffer and texture SRVs/UAVs.
              * See d3d12_root_signature_init(). */
             vk_descriptor_write->dstBinding = vk_binding + 2 * index;
-            if (descriptor->vk_descriptor_type != VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
-                    && descriptor->vk_descriptor_type != VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
+            if (view->type != VKD3D_VIEW_TYPE_BUFFER)
                 ++vk_descriptor_write->dstBinding;
 
-            if (descriptor->vk_descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
-                    || descriptor->vk_descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
+            if (view->type == VKD3D_VIEW_TYPE_BUFFER)
             {
+                vk_descriptor_write->descriptorType = magic == VKD3D_DESCRIPTOR_MAGIC_SRV
+                        ? VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
                 vk_descriptor_write->pTexelBufferView = &view->u.vk_buffer_view;
             }
             else
             {
+                vk_descriptor_write->descriptorType = magic == VKD3D_DESCRIPTOR_MAGIC_SRV
+                        ? VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
                 vk_image_info->sampler = VK_NULL_HANDLE;
                 vk_image_info->imageView = view->u.vk_image_view;
-                vk_image_info->imageLayout = descriptor->magic == VKD3D_DESCRIPTOR_MAGIC_SRV
+                vk_image_info->imageLayout = magic == VKD3D_DESCRIPTOR_MAGIC_SRV
                         ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
 
                 vk_descriptor_write->pImageInfo = vk_image_info;
@@ -2596,6 +3245,7 @@ static bool vk_write_descriptor_set_from_d3d12_desc(VkWriteDescriptorSet *vk_des
             break;
 
         case VKD3D_DESCRIPTOR_MAGIC_SAMPLER:
+            vk_descriptor_write->descriptorType = VK_DESCRIPTOR_TYPE_SAMPLER;
             vk_image_info->sampler = view->u.vk_sampler;
             vk_image_info->imageView = VK_NULL_HANDLE;
             vk_image_info->imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -2604,77 +3254,73 @@ static bool vk_write_descriptor_set_from_d3d12_desc(VkWriteDescriptorSet *vk_des
             break;
 
         default:
-            ERR("Invalid descriptor %#x.\n", descriptor->magic);
+            ERR("Invalid descriptor %#x.\n", magic);
             return false;
     }
 
     return true;
 }
 
+struct vkd3d_descriptor_write_batch
+{
+    VkWriteDescriptorSet writes[24];
+    VkDescriptorImageInfo image_infos[24];
+    VkDescriptorBufferInfo buffer_infos[24];
+    unsigned int count;
+};
+
+static void d3d12_command_list_flush_descriptor_writes(struct d3d12_command_list *list,
+        struct vkd3d_descriptor_write_batch *batch)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+
+    if (!batch->count)
+        return;
+
+    VK_CALL(vkUpdateDescriptorSets(list->device->vk_device, batch->count, batch->writes, 0, NULL));
+    batch->count = 0;
+}
+
 static void d3d12_command_list_update_descriptor_table(struct d3d12_command_list *list,
-        VkPipelineBindPoint bind_point, unsigned int index, struct d3d12_desc *base_descriptor)
+        VkPipelineBindPoint bind_point, const struct d3d12_root_descriptor_table *descriptor_table,
+        const struct d3d12_desc *base_descriptor, struct vkd3d_descriptor_write_batch *batch)
 {
     struct vkd3d_pipeline_bindings *bindings = &list->pipeline_bindings[bind_point];
-    struct VkWriteDescriptorSet descriptor_writes[24], *current_descriptor_write;
     const struct d3d12_root_signature *root_signature = bindings->root_signature;
-    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
-    struct VkDescriptorImageInfo image_infos[24], *current_image_info;
-    const struct d3d12_root_descriptor_table *descriptor_table;
-    const struct d3d12_root_descriptor_table_range *range;
-    VkDevice vk_device = list->device->vk_device;
-    unsigned int i, j, descriptor_count;
-    struct d3d12_desc *descriptor;
+    const struct vkd3d_descriptor_binding_op *op, *end;
+    const struct d3d12_desc *descriptor;
+    VkBufferView vk_counter_view;
+    unsigned int j, register_idx;
 
-    descriptor_table = root_signature_get_descriptor_table(root_signature, index);
-
-    descriptor = base_descriptor;
-    descriptor_count = 0;
-    current_descriptor_write = descriptor_writes;
-    current_image_info = image_infos;
-    for (i = 0; i < descriptor_table->range_count; ++i)
+    op = &root_signature->binding_ops[descriptor_table->first_op];
+    end = op + descriptor_table->op_count;
+    for (; op < end; ++op)
     {
-        range = &descriptor_table->ranges[i];
+        descriptor = base_descriptor + op->heap_offset;
 
-        if (range->offset != D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND)
+        /* Track UAV counters. */
+        for (j = 0; j < op->uav_counter_count; ++j)
         {
-            descriptor = base_descriptor + range->offset;
+            register_idx = op->base_register_idx + j;
+            vk_counter_view = d3d12_desc_get_magic(&descriptor[j]) == VKD3D_DESCRIPTOR_MAGIC_UAV
+                    ? d3d12_desc_get_view(&descriptor[j])->vk_counter_view : VK_NULL_HANDLE;
+            if (bindings->vk_uav_counter_views[register_idx] != vk_counter_view)
+                bindings->uav_counter_dirty_mask |= 1u << register_idx;
+            bindings->vk_uav_counter_views[register_idx] = vk_counter_view;
         }
 
-        for (j = 0; j < range->descriptor_count; ++j, ++descriptor)
+        for (j = 0; j < op->descriptor_count; ++j)
         {
-            unsigned int register_idx = range->base_register_idx + j;
+            if (!vk_write_descriptor_set_from_d3d12_desc(&batch->writes[batch->count],
+                    &batch->image_infos[batch->count], &batch->buffer_infos[batch->count],
+                    &descriptor[j], op->descriptor_magic,
+                    bindings->descriptor_set, op->binding, j))
+                continue;
 
-            /* Track UAV counters. */
-            if (range->descriptor_magic == VKD3D_DESCRIPTOR_MAGIC_UAV
-                    && register_idx < ARRAY_SIZE(bindings->vk_uav_counter_views))
-            {
-                VkBufferView vk_counter_view = descriptor->magic == VKD3D_DESCRIPTOR_MAGIC_UAV
-                        ? descriptor->u.view->vk_counter_view : VK_NULL_HANDLE;
-                if (bindings->vk_uav_counter_views[register_idx] != vk_counter_view)
-                    bindings->uav_counter_dirty_mask |= 1u << register_idx;
-                bindings->vk_uav_counter_views[register_idx] = vk_counter_view;
-            }
-
-            if (!vk_write_descriptor_set_from_d3d12_desc(current_descriptor_write,
-                    current_image_info, descriptor, range->descriptor_magic,
-                    bindings->descriptor_set, range->binding, j))
-                continue;
-
-            ++descriptor_count;
-            ++current_descriptor_write;
-            ++current_image_info;
-
-            if (descriptor_count == ARRAY_SIZE(descriptor_writes))
-            {
-                VK_CALL(vkUpdateDescriptorSets(vk_device, descriptor_count, descriptor_writes, 0, NULL));
-                descriptor_count = 0;
-                current_descriptor_write = descriptor_writes;
-                current_image_info = image_infos;
-            }
+            if (++batch->count == ARRAY_SIZE(batch->writes))
+                d3d12_command_list_flush_descriptor_writes(list, batch);
         }
     }
-
-    VK_CALL(vkUpdateDescriptorSets(vk_device, descriptor_count, descriptor_writes, 0, NULL));
 }
 
 static bool vk_write_descriptor_set_from_root_descriptor(VkWriteDescriptorSet *vk_descriptor_write,
@@ -2727,11 +3373,14 @@ static void d3d12_command_list_update_push_descriptors(struct d3d12_command_list
     struct d3d12_device *device = list->device;
     VkDescriptorBufferInfo *vk_buffer_info;
     unsigned int i, descriptor_count;
+    VkDescriptorSet vk_descriptor_set;
     VkBufferView *vk_buffer_view;
 
     if (!bindings->push_descriptor_dirty_mask)
         return;
 
+    vk_descriptor_set = device->vk_info.KHR_push_descriptor ? VK_NULL_HANDLE : bindings->descriptor_set;
+
     descriptor_count = vkd3d_popcount(bindings->push_descriptor_dirty_mask);
 
     if (!(descriptor_writes = vkd3d_calloc(descriptor_count, sizeof(*descriptor_writes))))
@@ -2756,7 +3405,7 @@ static void d3d12_command_list_update_push_descriptors(struct d3d12_command_list
             vk_buffer_info = current_buffer_info;
             vk_buffer_info->buffer = push_descriptor->u.cbv.vk_buffer;
             vk_buffer_info->offset = push_descriptor->u.cbv.offset;
-            vk_buffer_info->range = VK_WHOLE_SIZE;
+            vk_buffer_info->range = push_descriptor->u.cbv.range;
         }
         else
         {
@@ -2765,7 +3414,7 @@ static void d3d12_command_list_update_push_descriptors(struct d3d12_command_list
         }
 
         if (!vk_write_descriptor_set_from_root_descriptor(current_descriptor_write,
-                root_parameter, bindings->descriptor_set, vk_buffer_view, vk_buffer_info))
+                root_parameter, vk_descriptor_set, vk_buffer_view, vk_buffer_info))
             continue;
 
         ++descriptor_count;
@@ -2773,7 +3422,11 @@ static void d3d12_command_list_update_push_descriptors(struct d3d12_command_list
         ++current_buffer_info;
     }
 
-    VK_CALL(vkUpdateDescriptorSets(device->vk_device, descriptor_count, descriptor_writes, 0, NULL));
+    if (!device->vk_info.KHR_push_descriptor)
+        VK_CALL(vkUpdateDescriptorSets(device->vk_device, descriptor_count, descriptor_writes, 0, NULL));
+    else if (descriptor_count)
+        VK_CALL(vkCmdPushDescriptorSetKHR(list->vk_command_buffer, bind_point,
+                root_signature->vk_pipeline_layout, 0, descriptor_count, descriptor_writes));
     bindings->push_descriptor_dirty_mask = 0;
 
 done:
@@ -2830,31 +3483,77 @@ static void d3d12_command_list_update_uav_counter_descriptors(struct d3d12_comma
     bindings->uav_counter_dirty_mask = 0;
 }
 
+static void d3d12_command_list_update_root_constants(struct d3d12_command_list *list,
+        VkPipelineBindPoint bind_point)
+{
+    struct vkd3d_pipeline_bindings *bindings = &list->pipeline_bindings[bind_point];
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    const struct d3d12_root_signature *rs = bindings->root_signature;
+    const VkPushConstantRange *range;
+    uint32_t begin, end;
+    unsigned int i;
+
+    if (bindings->root_constant_dirty_begin >= bindings->root_constant_dirty_end)
+        return;
+
+    /* Ranges with different stage flags cannot be updated by a single
+     * vkCmdPushConstants() call, but root signatures have at most one range
+     * per shader visibility, and usually only one. */
+    for (i = 0; i < rs->push_constant_range_count; ++i)
+    {
+        range = &rs->push_constant_ranges[i];
+        begin = max(range->offset, bindings->root_constant_dirty_begin);
+        end = min(range->offset + range->size, bindings->root_constant_dirty_end);
+        if (begin >= end)
+            continue;
+
+        VK_CALL(vkCmdPushConstants(list->vk_command_buffer, rs->vk_pipeline_layout, range->stageFlags,
+                begin, end - begin, (const uint8_t *)bindings->root_constants + begin));
+    }
+
+    bindings->root_constant_dirty_begin = 0;
+    bindings->root_constant_dirty_end = 0;
+}
+
 static void d3d12_command_list_update_descriptors(struct d3d12_command_list *list,
         VkPipelineBindPoint bind_point)
 {
     struct vkd3d_pipeline_bindings *bindings = &list->pipeline_bindings[bind_point];
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
     const struct d3d12_root_signature *rs = bindings->root_signature;
+    struct vkd3d_descriptor_write_batch batch;
     struct d3d12_desc *base_descriptor;
     unsigned int i;
+    uint64_t mask;
+
+    if (!rs)
+        return;
+
+    d3d12_command_list_update_root_constants(list, bind_point);
+
+    /* Root descriptors live in their own push descriptor set, and are not
+     * affected by descriptor set allocation. */
+    if (list->device->vk_info.KHR_push_descriptor)
+        d3d12_command_list_update_push_descriptors(list, bind_point);
 
-    if (!rs || !rs->vk_set_layout)
+    if (!rs->vk_set_layout)
         return;
 
     if (bindings->descriptor_table_dirty_mask || bindings->push_descriptor_dirty_mask)
         d3d12_command_list_prepare_descriptors(list, bind_point);
 
-    for (i = 0; i < ARRAY_SIZE(bindings->descriptor_tables); ++i)
+    batch.count = 0;
+    mask = bindings->descriptor_table_dirty_mask;
+    while (mask)
     {
-        if (bindings->descriptor_table_dirty_mask & ((uint64_t)1 << i))
-        {
-            if ((base_descriptor = d3d12_desc_from_gpu_handle(bindings->descriptor_tables[i])))
-                d3d12_command_list_update_descriptor_table(list, bind_point, i, base_descriptor);
-            else
-                WARN("Descriptor table %u is not set.\n", i);
-        }
+        i = vkd3d_bitmask_iter64(&mask);
+        if ((base_descriptor = d3d12_desc_from_gpu_handle(bindings->descriptor_tables[i])))
+            d3d12_command_list_update_descriptor_table(list, bind_point,
+                    root_signature_get_descriptor_table(rs, i), base_descriptor, &batch);
+        else
+            WARN("Descriptor table %u is not set.\n", i);
     }
+    d3d12_command_list_flush_descriptor_writes(list, &batch);
     bindings->descriptor_table_dirty_mask = 0;
 
     d3d12_command_list_update_push_descriptors(list, bind_point);
@@ -2905,7 +3604,14 @@ static bool d3d12_command_list_begin_render_pass(struct d3d12_command_list *list
             &begin_desc.renderArea.extent.width, &begin_desc.renderArea.extent.height, NULL);
     begin_desc.clearValueCount = 0;
     begin_desc.pClearValues = NULL;
+    /* Conditional rendering begun outside of a render pass instance cannot be
+     * ended inside it, so restart it in the render pass. This allows
+     * SetPredication() to be called without ending the render pass. */
+    if (list->is_predicated)
+        VK_CALL(vkCmdEndConditionalRenderingEXT(list->vk_command_buffer));
     VK_CALL(vkCmdBeginRenderPass(list->vk_command_buffer, &begin_desc, VK_SUBPASS_CONTENTS_INLINE));
+    if (list->is_predicated)
+        d3d12_command_list_begin_conditional_rendering(list);
 
     list->current_render_pass = vk_render_pass;
 
@@ -2949,6 +3655,212 @@ static void d3d12_command_list_check_index_buffer_strip_cut_value(struct d3d12_c
     }
 }
 
+/* Without VK_EXT_conditional_rendering, predicates are resolved by a compute
+ * shader into a draw count of 0 or 1, which is consumed by indirect count
+ * draws. Predicated dispatches are turned into indirect dispatches, with the
+ * arguments zeroed by the same shader. */
+#define VKD3D_PREDICATE_RESOLVE_ARGS_SIZE (16 * sizeof(uint32_t))
+#define VKD3D_PREDICATE_RESOLVE_OUTPUT_OFFSET (8 * sizeof(uint32_t))
+
+static bool d3d12_command_list_add_predicate_view(struct d3d12_command_list *list,
+        VkBuffer vk_buffer, VkDeviceSize offset, VkDeviceSize range, VkBufferView *vk_view)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+
+    if (!vkd3d_create_raw_vk_buffer_view(list->device, vk_buffer, offset, range, vk_view))
+        return false;
+
+    if (!d3d12_command_allocator_add_buffer_view(list->allocator, *vk_view))
+    {
+        ERR("Failed to add buffer view.\n");
+        VK_CALL(vkDestroyBufferView(list->device->vk_device, *vk_view, NULL));
+        return false;
+    }
+
+    return true;
+}
+
+/* Internal compute dispatches use a pipeline layout which is not compatible
+ * with root signature layouts, and disturb every compute binding. Re-record
+ * the compute state the application had bound, so that it doesn't depend on
+ * state being flushed again before the next dispatch. Bindings which are
+ * still dirty are left for d3d12_command_list_update_descriptors(). */
+static void d3d12_command_list_restore_compute_state(struct d3d12_command_list *list)
+{
+    struct vkd3d_pipeline_bindings *bindings = &list->pipeline_bindings[VK_PIPELINE_BIND_POINT_COMPUTE];
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    const struct d3d12_root_signature *rs = bindings->root_signature;
+    bool uav_counters_bound = false;
+
+    if (list->state && d3d12_pipeline_state_is_compute(list->state))
+    {
+        VK_CALL(vkCmdBindPipeline(list->vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                list->state->u.compute.vk_pipeline));
+        uav_counters_bound = bindings->in_use
+                && !(list->state->uav_counter_mask & bindings->uav_counter_dirty_mask);
+    }
+
+    bindings->uav_counter_dirty_mask = ~(uint8_t)0;
+    if (!rs)
+        return;
+
+    bindings->root_constant_dirty_begin = 0;
+    bindings->root_constant_dirty_end = sizeof(bindings->root_constants);
+    d3d12_command_list_update_root_constants(list, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    if (list->device->vk_info.KHR_push_descriptor)
+    {
+        bindings->push_descriptor_dirty_mask |= bindings->push_descriptor_active_mask & rs->push_descriptor_mask;
+        d3d12_command_list_update_push_descriptors(list, VK_PIPELINE_BIND_POINT_COMPUTE);
+    }
+
+    if (bindings->descriptor_set && bindings->in_use)
+    {
+        VK_CALL(vkCmdBindDescriptorSets(list->vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                rs->vk_pipeline_layout, rs->main_set, 1, &bindings->descriptor_set, 0, NULL));
+    }
+
+    /* UAV counters are bound using the layout of the current pipeline state. */
+    if (uav_counters_bound)
+        d3d12_command_list_update_uav_counter_descriptors(list, VK_PIPELINE_BIND_POINT_COMPUTE);
+}
+
+/* Multiplies "input" by the draw count of the predicate stored at
+ * "src_offset", and returns the location of the result. */
+static bool d3d12_command_list_resolve_predicate(struct d3d12_command_list *list,
+        VkBuffer src_buffer, VkDeviceSize src_offset, bool invert, const uint32_t input[3],
+        VkBuffer *vk_buffer, VkDeviceSize *offset)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    const struct vkd3d_predicate_ops *ops = &list->device->predicate_ops;
+    VkDeviceSize args_offset, src_view_offset, texel_alignment;
+    VkWriteDescriptorSet descriptor_writes[2];
+    VkDescriptorSet vk_descriptor_set;
+    VkMemoryBarrier vk_barrier;
+    VkBufferView vk_views[2];
+    VkBuffer args_buffer;
+    uint32_t *args;
+    unsigned int i;
+
+    if (!d3d12_command_list_allocate_predicate_memory(list, &list->predicate_args, D3D12_HEAP_TYPE_UPLOAD,
+            VKD3D_PREDICATE_RESOLVE_ARGS_SIZE, &args_buffer, &args_offset, (void **)&args))
+        return false;
+
+    texel_alignment = list->device->vk_info.device_limits.minTexelBufferOffsetAlignment;
+    src_view_offset = src_offset & ~(texel_alignment - 1);
+
+    args[0] = (src_offset - src_view_offset) / sizeof(uint32_t);
+    args[1] = invert;
+    memcpy(&args[2], input, 3 * sizeof(*input));
+
+    if (!d3d12_command_list_add_predicate_view(list, src_buffer, src_view_offset,
+            src_offset - src_view_offset + sizeof(uint64_t), &vk_views[0]))
+        return false;
+    if (!d3d12_command_list_add_predicate_view(list, args_buffer, args_offset,
+            VKD3D_PREDICATE_RESOLVE_ARGS_SIZE, &vk_views[1]))
+        return false;
+
+    if (!(vk_descriptor_set = d3d12_command_allocator_allocate_descriptor_set(list->allocator,
+            ops->vk_set_layout)))
+        return false;
+
+    for (i = 0; i < ARRAY_SIZE(descriptor_writes); ++i)
+    {
+        descriptor_writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_writes[i].pNext = NULL;
+        descriptor_writes[i].dstSet = vk_descriptor_set;
+        descriptor_writes[i].dstBinding = i;
+        descriptor_writes[i].dstArrayElement = 0;
+        descriptor_writes[i].descriptorCount = 1;
+        descriptor_writes[i].descriptorType = i ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER
+                : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+        descriptor_writes[i].pImageInfo = NULL;
+        descriptor_writes[i].pBufferInfo = NULL;
+        descriptor_writes[i].pTexelBufferView = &vk_views[i];
+    }
+    VK_CALL(vkUpdateDescriptorSets(list->device->vk_device, ARRAY_SIZE(descriptor_writes),
+            descriptor_writes, 0, NULL));
+
+    VK_CALL(vkCmdBindPipeline(list->vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            ops->vk_resolve_pipeline));
+    VK_CALL(vkCmdBindDescriptorSets(list->vk_command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+            ops->vk_pipeline_layout, 0, 1, &vk_descriptor_set, 0, NULL));
+    VK_CALL(vkCmdDispatch(list->vk_command_buffer, 1, 1, 1));
+
+    vk_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    vk_barrier.pNext = NULL;
+    vk_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    vk_barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+    VK_CALL(vkCmdPipelineBarrier(list->vk_command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            1, &vk_barrier, 0, NULL, 0, NULL));
+
+    d3d12_command_list_restore_compute_state(list);
+
+    *vk_buffer = args_buffer;
+    *offset = args_offset + VKD3D_PREDICATE_RESOLVE_OUTPUT_OFFSET;
+
+    return true;
+}
+
+static bool d3d12_command_list_emulate_predicated_draw(struct d3d12_command_list *list,
+        const void *draw_args, size_t size, bool indexed)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    VkDeviceSize offset;
+    VkBuffer vk_buffer;
+    void *data;
+
+    if (!list->predicate.vk_count_buffer)
+        return false;
+
+    if (!list->device->vk_info.KHR_draw_indirect_count)
+    {
+        FIXME_ONCE("Predicated draws are not supported without VK_KHR_draw_indirect_count.\n");
+        return false;
+    }
+
+    if (!d3d12_command_list_allocate_predicate_memory(list, &list->predicate_args, D3D12_HEAP_TYPE_UPLOAD,
+            size, &vk_buffer, &offset, &data))
+        return false;
+    memcpy(data, draw_args, size);
+
+    if (indexed)
+    {
+        VK_CALL(vkCmdDrawIndexedIndirectCountKHR(list->vk_command_buffer, vk_buffer, offset,
+                list->predicate.vk_count_buffer, list->predicate.count_offset, 1, size));
+    }
+    else
+    {
+        VK_CALL(vkCmdDrawIndirectCountKHR(list->vk_command_buffer, vk_buffer, offset,
+                list->predicate.vk_count_buffer, list->predicate.count_offset, 1, size));
+    }
+
+    return true;
+}
+
+static bool d3d12_command_list_emulate_predicated_dispatch(struct d3d12_command_list *list,
+        unsigned int x, unsigned int y, unsigned int z)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    const uint32_t input[] = {x, y, z};
+    VkDeviceSize offset;
+    VkBuffer vk_buffer;
+
+    if (!list->predicate.vk_count_buffer)
+        return false;
+
+    if (!d3d12_command_list_resolve_predicate(list, list->predicate.vk_count_buffer,
+            list->predicate.count_offset, false, input, &vk_buffer, &offset))
+        return false;
+
+    d3d12_command_list_update_descriptors(list, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+    VK_CALL(vkCmdDispatchIndirect(list->vk_command_buffer, vk_buffer, offset));
+
+    return true;
+}
+
 static void STDMETHODCALLTYPE d3d12_command_list_DrawInstanced(ID3D12GraphicsCommandList1 *iface,
         UINT vertex_count_per_instance, UINT instance_count, UINT start_vertex_location,
         UINT start_instance_location)
@@ -2969,6 +3881,15 @@ static void STDMETHODCALLTYPE d3d12_command_list_DrawInstanced(ID3D12GraphicsCom
         return;
     }
 
+    if (list->predicate.vk_count_buffer)
+    {
+        const VkDrawIndirectCommand args = {vertex_count_per_instance,
+                instance_count, start_vertex_location, start_instance_location};
+
+        if (d3d12_command_list_emulate_predicated_draw(list, &args, sizeof(args), false))
+            return;
+    }
+
     VK_CALL(vkCmdDraw(list->vk_command_buffer, vertex_count_per_instance,
             instance_count, start_vertex_location, start_instance_location));
 }
@@ -2995,6 +3916,15 @@ static void STDMETHODCALLTYPE d3d12_command_list_DrawIndexedInstanced(ID3D12Grap
 
     d3d12_command_list_check_index_buffer_strip_cut_value(list);
 
+    if (list->predicate.vk_count_buffer)
+    {
+        const VkDrawIndexedIndirectCommand args = {index_count_per_instance,
+                instance_count, start_vertex_location, base_vertex_location, start_instance_location};
+
+        if (d3d12_command_list_emulate_predicated_draw(list, &args, sizeof(args), true))
+            return;
+    }
+
     VK_CALL(vkCmdDrawIndexed(list->vk_command_buffer, index_count_per_instance,
             instance_count, start_vertex_location, base_vertex_location, start_instance_location));
 }
@@ -3017,6 +3947,9 @@ static void STDMETHODCALLTYPE d3d12_command_list_Dispatch(ID3D12GraphicsCommandL
 
     d3d12_command_list_end_current_render_pass(list);
 
+    if (d3d12_command_list_emulate_predicated_dispatch(list, x, y, z))
+        return;
+
     d3d12_command_list_update_descriptors(list, VK_PIPELINE_BIND_POINT_COMPUTE);
 
     VK_CALL(vkCmdDispatch(list->vk_command_buffer, x, y, z));
@@ -3171,47 +4104,39 @@ static void vk_image_copy_from_d3d12(VkImageCopy *image_copy,
     }
 }
 
+/* Transfer memory is taken from the device staging ring when possible, and
+ * is reused once the command list is reset or destroyed, and its submissions
+ * are complete. */
 static HRESULT d3d12_command_list_allocate_transfer_buffer(struct d3d12_command_list *list,
-        VkDeviceSize size, struct vkd3d_buffer *buffer)
+        VkDeviceSize size, VkDeviceSize alignment, VkBuffer *vk_buffer, VkDeviceSize *offset)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    struct d3d12_command_allocator *allocator = list->allocator;
     struct d3d12_device *device = list->device;
-    D3D12_HEAP_PROPERTIES heap_properties;
-    D3D12_RESOURCE_DESC buffer_desc;
+    struct vkd3d_buffer buffer;
+    uint64_t id;
     HRESULT hr;
 
-    memset(&heap_properties, 0, sizeof(heap_properties));
-    heap_properties.Type = D3D12_HEAP_TYPE_DEFAULT;
-
-    buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-    buffer_desc.Alignment = 0;
-    buffer_desc.Width = size;
-    buffer_desc.Height = 1;
-    buffer_desc.DepthOrArraySize = 1;
-    buffer_desc.MipLevels = 1;
-    buffer_desc.Format = DXGI_FORMAT_UNKNOWN;
-    buffer_desc.SampleDesc.Count = 1;
-    buffer_desc.SampleDesc.Quality = 0;
-    buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-    buffer_desc.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
-
-    if (FAILED(hr = vkd3d_create_buffer(device, &heap_properties, D3D12_HEAP_FLAG_NONE,
-            &buffer_desc, &buffer->vk_buffer)))
-        return hr;
-    if (FAILED(hr = vkd3d_allocate_buffer_memory(device, buffer->vk_buffer,
-            &heap_properties, D3D12_HEAP_FLAG_NONE, &buffer->vk_memory, NULL, NULL)))
+    if (vkd3d_array_reserve((void **)&list->staging_regions, &list->staging_regions_size,
+            list->staging_region_count + 1, sizeof(*list->staging_regions))
+            && vkd3d_staging_ring_allocate(&device->staging_ring, device, size, alignment, vk_buffer, offset, &id))
     {
-        VK_CALL(vkDestroyBuffer(device->vk_device, buffer->vk_buffer, NULL));
-        return hr;
+        list->staging_regions[list->staging_region_count++] = id;
+        return S_OK;
     }
 
-    if (!d3d12_command_allocator_add_transfer_buffer(list->allocator, buffer))
+    if (FAILED(hr = vkd3d_create_transfer_buffer(device, size, &buffer)))
+        return hr;
+
+    if (!d3d12_command_allocator_add_transfer_buffer(allocator, &buffer))
     {
         ERR("Failed to add transfer buffer.\n");
-        vkd3d_buffer_destroy(buffer, device);
+        vkd3d_buffer_destroy(&buffer, device);
         return E_OUTOFMEMORY;
     }
 
+    *vk_buffer = buffer.vk_buffer;
+    *offset = 0;
+
     return S_OK;
 }
 
@@ -3230,10 +4155,10 @@ static void d3d12_command_list_copy_incompatible_texture_region(struct d3d12_com
     const D3D12_RESOURCE_DESC *dst_desc = &dst_resource->desc;
     const D3D12_RESOURCE_DESC *src_desc = &src_resource->desc;
     unsigned int dst_miplevel_idx, src_miplevel_idx;
-    struct vkd3d_buffer transfer_buffer;
+    VkDeviceSize buffer_size, buffer_offset;
     VkBufferImageCopy buffer_image_copy;
     VkBufferMemoryBarrier vk_barrier;
-    VkDeviceSize buffer_size;
+    VkBuffer vk_buffer;
     HRESULT hr;
 
     WARN("Copying incompatible texture formats %#x, %#x -> %#x, %#x.\n",
@@ -3246,7 +4171,6 @@ static void d3d12_command_list_copy_incompatible_texture_region(struct d3d12_com
     assert(!vkd3d_format_is_compressed(src_format));
     assert(dst_format->byte_count == src_format->byte_count);
 
-    buffer_image_copy.bufferOffset = 0;
     buffer_image_copy.bufferRowLength = 0;
     buffer_image_copy.bufferImageHeight = 0;
     vk_image_subresource_layers_from_d3d12(&buffer_image_copy.imageSubresource,
@@ -3259,15 +4183,18 @@ static void d3d12_command_list_copy_incompatible_texture_region(struct d3d12_com
 
     buffer_size = src_format->byte_count * buffer_image_copy.imageExtent.width *
             buffer_image_copy.imageExtent.height * buffer_image_copy.imageExtent.depth;
-    if (FAILED(hr = d3d12_command_list_allocate_transfer_buffer(list, buffer_size, &transfer_buffer)))
+    /* Buffer offsets need to be a multiple of both 4 and the texel size. */
+    if (FAILED(hr = d3d12_command_list_allocate_transfer_buffer(list, buffer_size,
+            4 * src_format->byte_count, &vk_buffer, &buffer_offset)))
     {
         ERR("Failed to allocate transfer buffer, hr %#x.\n", hr);
         return;
     }
+    buffer_image_copy.bufferOffset = buffer_offset;
 
     VK_CALL(vkCmdCopyImageToBuffer(list->vk_command_buffer,
             src_resource->u.vk_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-            transfer_buffer.vk_buffer, 1, &buffer_image_copy));
+            vk_buffer, 1, &buffer_image_copy));
 
     vk_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
     vk_barrier.pNext = NULL;
@@ -3275,9 +4202,9 @@ static void d3d12_command_list_copy_incompatible_texture_region(struct d3d12_com
     vk_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
     vk_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
     vk_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    vk_barrier.buffer = transfer_buffer.vk_buffer;
-    vk_barrier.offset = 0;
-    vk_barrier.size = VK_WHOLE_SIZE;
+    vk_barrier.buffer = vk_buffer;
+    vk_barrier.offset = buffer_offset;
+    vk_barrier.size = buffer_size;
     VK_CALL(vkCmdPipelineBarrier(list->vk_command_buffer,
             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
             0, NULL, 1, &vk_barrier, 0, NULL));
@@ -3294,7 +4221,7 @@ static void d3d12_command_list_copy_incompatible_texture_region(struct d3d12_com
             d3d12_resource_desc_get_depth(dst_desc, dst_miplevel_idx));
 
     VK_CALL(vkCmdCopyBufferToImage(list->vk_command_buffer,
-            transfer_buffer.vk_buffer, dst_resource->u.vk_image,
+            vk_buffer, dst_resource->u.vk_image,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &buffer_image_copy));
 }
 
@@ -3517,10 +4444,134 @@ static void STDMETHODCALLTYPE d3d12_command_list_CopyTiles(ID3D12GraphicsCommand
         const D3D12_TILE_REGION_SIZE *tile_region_size, ID3D12Resource *buffer, UINT64 buffer_offset,
         D3D12_TILE_COPY_FLAGS flags)
 {
-    FIXME("iface %p, tiled_resource %p, tile_region_start_coordinate %p, tile_region_size %p, "
-            "buffer %p, buffer_offset %#"PRIx64", flags %#x stub!\n",
+    struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList1(iface);
+    struct d3d12_resource *tiled_resource_impl, *buffer_impl;
+    const struct vkd3d_vk_device_procs *vk_procs;
+    VkBufferImageCopy *image_copies = NULL;
+    VkBufferCopy *buffer_copies = NULL;
+    unsigned int tile_count, copy_count, i;
+    const struct d3d12_sparse_tile *tile;
+    const D3D12_TILE_SHAPE *tile_shape;
+    VkDeviceSize tile_buffer_offset;
+    bool to_buffer, packed_mips;
+    uint32_t tile_index;
+
+    TRACE("iface %p, tiled_resource %p, tile_region_start_coordinate %p, tile_region_size %p, "
+            "buffer %p, buffer_offset %#"PRIx64", flags %#x.\n",
             iface, tiled_resource, tile_region_start_coordinate, tile_region_size,
             buffer, buffer_offset, flags);
+
+    vk_procs = &list->device->vk_procs;
+
+    tiled_resource_impl = unsafe_impl_from_ID3D12Resource(tiled_resource);
+    buffer_impl = unsafe_impl_from_ID3D12Resource(buffer);
+
+    if (!d3d12_resource_is_buffer(buffer_impl))
+    {
+        WARN("Resource %p is not a buffer.\n", buffer);
+        return;
+    }
+
+    if (!(tiled_resource_impl->flags & VKD3D_RESOURCE_SPARSE))
+    {
+        WARN("Resource %p is not a reserved resource.\n", tiled_resource);
+        return;
+    }
+
+    to_buffer = flags & D3D12_TILE_COPY_FLAG_SWIZZLED_TILED_RESOURCE_TO_LINEAR_BUFFER;
+    if (to_buffer == !!(flags & D3D12_TILE_COPY_FLAG_LINEAR_BUFFER_TO_SWIZZLED_TILED_RESOURCE))
+    {
+        WARN("Invalid copy flags %#x.\n", flags);
+        return;
+    }
+
+    d3d12_command_list_track_resource_usage(list, tiled_resource_impl);
+    d3d12_command_list_track_resource_usage(list, buffer_impl);
+
+    d3d12_command_list_end_current_render_pass(list);
+
+    tile_count = vkd3d_tile_region_get_tile_count(tile_region_size);
+    tile_shape = &tiled_resource_impl->sparse.tile_shape;
+
+    if (d3d12_resource_is_buffer(tiled_resource_impl))
+    {
+        if (!(buffer_copies = vkd3d_calloc(tile_count, sizeof(*buffer_copies))))
+        {
+            ERR("Failed to allocate buffer copies.\n");
+            return;
+        }
+    }
+    else if (!(image_copies = vkd3d_calloc(tile_count, sizeof(*image_copies))))
+    {
+        ERR("Failed to allocate image copies.\n");
+        return;
+    }
+
+    packed_mips = false;
+    for (i = 0, copy_count = 0; i < tile_count; ++i)
+    {
+        if (!vkd3d_tile_region_get_tile_index(tiled_resource_impl, tile_region_start_coordinate,
+                tile_region_size, i, &tile_index))
+        {
+            WARN("Invalid tile region.\n");
+            break;
+        }
+
+        tile = &tiled_resource_impl->sparse.tiles[tile_index];
+        tile_buffer_offset = buffer_offset + buffer_impl->heap_offset
+                + (VkDeviceSize)i * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+
+        if (buffer_copies)
+        {
+            buffer_copies[copy_count].srcOffset = to_buffer ? tile->u.buffer.offset : tile_buffer_offset;
+            buffer_copies[copy_count].dstOffset = to_buffer ? tile_buffer_offset : tile->u.buffer.offset;
+            buffer_copies[copy_count].size = tile->u.buffer.length;
+            ++copy_count;
+        }
+        else if (tile->opaque)
+        {
+            /* The layout of packed mips is implementation defined. */
+            packed_mips = true;
+        }
+        else
+        {
+            image_copies[copy_count].bufferOffset = tile_buffer_offset;
+            image_copies[copy_count].bufferRowLength = tile_shape->WidthInTexels;
+            image_copies[copy_count].bufferImageHeight = tile_shape->HeightInTexels;
+            image_copies[copy_count].imageSubresource.aspectMask = tile->u.image.subresource.aspectMask;
+            image_copies[copy_count].imageSubresource.mipLevel = tile->u.image.subresource.mipLevel;
+            image_copies[copy_count].imageSubresource.baseArrayLayer = tile->u.image.subresource.arrayLayer;
+            image_copies[copy_count].imageSubresource.layerCount = 1;
+            image_copies[copy_count].imageOffset = tile->u.image.offset;
+            image_copies[copy_count].imageExtent = tile->u.image.extent;
+            ++copy_count;
+        }
+    }
+
+    if (packed_mips)
+        FIXME("Ignoring packed mip tiles of resource %p.\n", tiled_resource);
+
+    if (copy_count && buffer_copies)
+    {
+        if (to_buffer)
+            VK_CALL(vkCmdCopyBuffer(list->vk_command_buffer, tiled_resource_impl->u.vk_buffer,
+                    buffer_impl->u.vk_buffer, copy_count, buffer_copies));
+        else
+            VK_CALL(vkCmdCopyBuffer(list->vk_command_buffer, buffer_impl->u.vk_buffer,
+                    tiled_resource_impl->u.vk_buffer, copy_count, buffer_copies));
+    }
+    else if (copy_count)
+    {
+        if (to_buffer)
+            VK_CALL(vkCmdCopyImageToBuffer(list->vk_command_buffer, tiled_resource_impl->u.vk_image,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer_impl->u.vk_buffer, copy_count, image_copies));
+        else
+            VK_CALL(vkCmdCopyBufferToImage(list->vk_command_buffer, buffer_impl->u.vk_buffer,
+                    tiled_resource_impl->u.vk_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, copy_count, image_copies));
+    }
+
+    vkd3d_free(buffer_copies);
+    vkd3d_free(image_copies);
 }
 
 static void STDMETHODCALLTYPE d3d12_command_list_ResolveSubresource(ID3D12GraphicsCommandList1 *iface,
@@ -4067,6 +5118,13 @@ static void d3d12_command_list_set_descriptor_table(struct d3d12_command_list *l
     assert(root_signature_get_descriptor_table(root_signature, index));
 
     assert(index < ARRAY_SIZE(bindings->descriptor_tables));
+
+    /* Descriptors of static tables can't change while the table is set, so
+     * setting the same table again doesn't require a new descriptor set. */
+    if ((root_signature->static_descriptor_table_mask & bindings->descriptor_table_active_mask & ((uint64_t)1 << index))
+            && bindings->descriptor_tables[index].ptr == base_descriptor.ptr)
+        return;
+
     bindings->descriptor_tables[index] = base_descriptor;
     bindings->descriptor_table_dirty_mask |= (uint64_t)1 << index;
     bindings->descriptor_table_active_mask |= (uint64_t)1 << index;
@@ -4100,13 +5158,28 @@ static void d3d12_command_list_set_root_constants(struct d3d12_command_list *lis
         VkPipelineBindPoint bind_point, unsigned int index, unsigned int offset,
         unsigned int count, const void *data)
 {
-    const struct d3d12_root_signature *root_signature = list->pipeline_bindings[bind_point].root_signature;
-    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
+    struct vkd3d_pipeline_bindings *bindings = &list->pipeline_bindings[bind_point];
+    const struct d3d12_root_signature *root_signature = bindings->root_signature;
     const struct d3d12_root_constant *c;
+    uint32_t begin, end;
 
     c = root_signature_get_32bit_constants(root_signature, index);
-    VK_CALL(vkCmdPushConstants(list->vk_command_buffer, root_signature->vk_pipeline_layout,
-            c->stage_flags, c->offset + offset * sizeof(uint32_t), count * sizeof(uint32_t), data));
+    begin = c->offset + offset * sizeof(uint32_t);
+    end = begin + count * sizeof(uint32_t);
+    assert(end <= sizeof(bindings->root_constants));
+
+    memcpy((uint8_t *)bindings->root_constants + begin, data, end - begin);
+
+    if (bindings->root_constant_dirty_begin < bindings->root_constant_dirty_end)
+    {
+        bindings->root_constant_dirty_begin = min(bindings->root_constant_dirty_begin, begin);
+        bindings->root_constant_dirty_end = max(bindings->root_constant_dirty_end, end);
+    }
+    else
+    {
+        bindings->root_constant_dirty_begin = begin;
+        bindings->root_constant_dirty_end = end;
+    }
 }
 
 static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRoot32BitConstant(ID3D12GraphicsCommandList1 *iface,
@@ -4162,42 +5235,25 @@ static void d3d12_command_list_set_root_cbv(struct d3d12_command_list *list,
 {
     struct vkd3d_pipeline_bindings *bindings = &list->pipeline_bindings[bind_point];
     const struct d3d12_root_signature *root_signature = bindings->root_signature;
-    const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
     const struct vkd3d_vulkan_info *vk_info = &list->device->vk_info;
     const struct d3d12_root_parameter *root_parameter;
-    struct VkWriteDescriptorSet descriptor_write;
-    struct VkDescriptorBufferInfo buffer_info;
+    struct vkd3d_push_descriptor *push_descriptor;
     struct d3d12_resource *resource;
 
     root_parameter = root_signature_get_root_descriptor(root_signature, index);
     assert(root_parameter->parameter_type == D3D12_ROOT_PARAMETER_TYPE_CBV);
 
-    resource = vkd3d_gpu_va_allocator_dereference(&list->device->gpu_va_allocator, gpu_address);
-    buffer_info.buffer = resource->u.vk_buffer;
-    buffer_info.offset = gpu_address - resource->gpu_address;
-    buffer_info.range = resource->desc.Width - buffer_info.offset;
-    buffer_info.range = min(buffer_info.range, vk_info->device_limits.maxUniformBufferRange);
+    assert(index < ARRAY_SIZE(bindings->push_descriptors));
+    push_descriptor = &bindings->push_descriptors[index];
 
-    if (vk_info->KHR_push_descriptor)
-    {
-        vk_write_descriptor_set_from_root_descriptor(&descriptor_write,
-                root_parameter, VK_NULL_HANDLE, NULL, &buffer_info);
-        VK_CALL(vkCmdPushDescriptorSetKHR(list->vk_command_buffer, bind_point,
-                root_signature->vk_pipeline_layout, 0, 1, &descriptor_write));
-    }
-    else
-    {
-        d3d12_command_list_prepare_descriptors(list, bind_point);
-        vk_write_descriptor_set_from_root_descriptor(&descriptor_write,
-                root_parameter, bindings->descriptor_set, NULL, &buffer_info);
-        VK_CALL(vkUpdateDescriptorSets(list->device->vk_device, 1, &descriptor_write, 0, NULL));
+    resource = vkd3d_gpu_va_allocator_dereference(&list->device->gpu_va_allocator, gpu_address);
+    push_descriptor->u.cbv.vk_buffer = resource->u.vk_buffer;
+    push_descriptor->u.cbv.offset = gpu_address - resource->gpu_address;
+    push_descriptor->u.cbv.range = min(resource->desc.Width - push_descriptor->u.cbv.offset,
+            vk_info->device_limits.maxUniformBufferRange);
 
-        assert(index < ARRAY_SIZE(bindings->push_descriptors));
-        bindings->push_descriptors[index].u.cbv.vk_buffer = buffer_info.buffer;
-        bindings->push_descriptors[index].u.cbv.offset = buffer_info.offset;
-        bindings->push_descriptor_dirty_mask |= 1u << index;
-        bindings->push_descriptor_active_mask |= 1u << index;
-    }
+    bindings->push_descriptor_dirty_mask |= 1u << index;
+    bindings->push_descriptor_active_mask |= 1u << index;
 }
 
 static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRootConstantBufferView(
@@ -4228,9 +5284,7 @@ static void d3d12_command_list_set_root_descriptor(struct d3d12_command_list *li
     struct vkd3d_pipeline_bindings *bindings = &list->pipeline_bindings[bind_point];
     const struct d3d12_root_signature *root_signature = bindings->root_signature;
     const struct vkd3d_vk_device_procs *vk_procs = &list->device->vk_procs;
-    const struct vkd3d_vulkan_info *vk_info = &list->device->vk_info;
     const struct d3d12_root_parameter *root_parameter;
-    struct VkWriteDescriptorSet descriptor_write;
     VkDevice vk_device = list->device->vk_device;
     VkBufferView vk_buffer_view;
 
@@ -4251,25 +5305,10 @@ static void d3d12_command_list_set_root_descriptor(struct d3d12_command_list *li
         return;
     }
 
-    if (vk_info->KHR_push_descriptor)
-    {
-        vk_write_descriptor_set_from_root_descriptor(&descriptor_write,
-                root_parameter, VK_NULL_HANDLE, &vk_buffer_view, NULL);
-        VK_CALL(vkCmdPushDescriptorSetKHR(list->vk_command_buffer, bind_point,
-                root_signature->vk_pipeline_layout, 0, 1, &descriptor_write));
-    }
-    else
-    {
-        d3d12_command_list_prepare_descriptors(list, bind_point);
-        vk_write_descriptor_set_from_root_descriptor(&descriptor_write,
-                root_parameter, bindings->descriptor_set, &vk_buffer_view,  NULL);
-        VK_CALL(vkUpdateDescriptorSets(list->device->vk_device, 1, &descriptor_write, 0, NULL));
-
-        assert(index < ARRAY_SIZE(bindings->push_descriptors));
-        bindings->push_descriptors[index].u.vk_buffer_view = vk_buffer_view;
-        bindings->push_descriptor_dirty_mask |= 1u << index;
-        bindings->push_descriptor_active_mask |= 1u << index;
-    }
+    assert(index < ARRAY_SIZE(bindings->push_descriptors));
+    bindings->push_descriptors[index].u.vk_buffer_view = vk_buffer_view;
+    bindings->push_descriptor_dirty_mask |= 1u << index;
+    bindings->push_descriptor_active_mask |= 1u << index;
 }
 
 static void STDMETHODCALLTYPE d3d12_command_list_SetComputeRootShaderResourceView(
@@ -4794,6 +5833,7 @@ static void STDMETHODCALLTYPE d3d12_command_list_ClearUnorderedAccessViewUint(ID
     struct d3d12_resource *resource_impl;
     VkBufferMemoryBarrier buffer_barrier;
     VkImageMemoryBarrier image_barrier;
+    const struct vkd3d_view *view;
     VkPipelineStageFlags stage_mask;
     VkImageSubresourceRange range;
     VkClearColorValue color;
@@ -4817,18 +5857,24 @@ static void STDMETHODCALLTYPE d3d12_command_list_ClearUnorderedAccessViewUint(ID
     d3d12_command_list_end_current_render_pass(list);
 
     cpu_descriptor = d3d12_desc_from_cpu_handle(cpu_handle);
-
+    if (d3d12_desc_get_magic(cpu_descriptor) != VKD3D_DESCRIPTOR_MAGIC_UAV)
+    {
+        WARN("Invalid UAV descriptor %p.\n", cpu_descriptor);
+        return;
+    }
+    view = d3d12_desc_get_view(cpu_descriptor);
+
     if (d3d12_resource_is_buffer(resource_impl))
     {
-        if (!cpu_descriptor->uav.buffer.size)
+        if (!view->info.buffer.size)
         {
             FIXME("Not supported for UAV descriptor %p.\n", cpu_descriptor);
             return;
         }
 
-        /* Offset from heap with placed buffers is already applied in CPU descriptor. */
+        /* Offset from heap with placed buffers is already applied in the view. */
         VK_CALL(vkCmdFillBuffer(list->vk_command_buffer, resource_impl->u.vk_buffer,
-                cpu_descriptor->uav.buffer.offset, cpu_descriptor->uav.buffer.size, values[0]));
+                view->info.buffer.offset, view->info.buffer.size, values[0]));
 
         buffer_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
         buffer_barrier.pNext = NULL;
@@ -4836,8 +5882,8 @@ static void STDMETHODCALLTYPE d3d12_command_list_ClearUnorderedAccessViewUint(ID
         buffer_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         buffer_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         buffer_barrier.buffer = resource_impl->u.vk_buffer;
-        buffer_barrier.offset = cpu_descriptor->uav.buffer.offset;
-        buffer_barrier.size = cpu_descriptor->uav.buffer.size;
+        buffer_barrier.offset = view->info.buffer.offset;
+        buffer_barrier.size = view->info.buffer.size;
 
         vk_barrier_parameters_from_d3d12_resource_state(D3D12_RESOURCE_STATE_UNORDERED_ACCESS, 0,
                 resource_impl, list->vk_queue_flags, vk_info, &buffer_barrier.dstAccessMask, &stage_mask, NULL);
@@ -4853,11 +5899,11 @@ static void STDMETHODCALLTYPE d3d12_command_list_ClearUnorderedAccessViewUint(ID
         color.uint32[2] = values[2];
         color.uint32[3] = values[3];
 
-        range.aspectMask = cpu_descriptor->uav.texture.vk_aspect_mask;
-        range.baseMipLevel = cpu_descriptor->uav.texture.miplevel_idx;
+        range.aspectMask = view->info.texture.vk_aspect_mask;
+        range.baseMipLevel = view->info.texture.miplevel_idx;
         range.levelCount = 1;
-        range.baseArrayLayer = cpu_descriptor->uav.texture.layer_idx;
-        range.layerCount = cpu_descriptor->uav.texture.layer_count;
+        range.baseArrayLayer = view->info.texture.layer_idx;
+        range.layerCount = view->info.texture.layer_count;
 
         VK_CALL(vkCmdClearColorImage(list->vk_command_buffer,
                 resource_impl->u.vk_image, VK_IMAGE_LAYOUT_GENERAL, &color, 1, &range));
@@ -5065,25 +6111,16 @@ static void STDMETHODCALLTYPE d3d12_command_list_SetPredication(ID3D12GraphicsCo
     struct d3d12_resource *resource = unsafe_impl_from_ID3D12Resource(buffer);
     const struct vkd3d_vulkan_info *vk_info = &list->device->vk_info;
     const struct vkd3d_vk_device_procs *vk_procs;
+    static const uint32_t draw_count[] = {1, 0, 0};
+    VkConditionalRenderingFlagsEXT flags;
 
     TRACE("iface %p, buffer %p, aligned_buffer_offset %#"PRIx64", operation %#x.\n",
             iface, buffer, aligned_buffer_offset, operation);
 
-    if (!vk_info->EXT_conditional_rendering)
-    {
-        FIXME("Vulkan conditional rendering extension not present. Conditional rendering not supported.\n");
-        return;
-    }
-
     vk_procs = &list->device->vk_procs;
 
-    /* FIXME: Add support for conditional rendering in render passes. */
-    d3d12_command_list_end_current_render_pass(list);
-
     if (resource)
     {
-        VkConditionalRenderingBeginInfoEXT cond_info;
-
         if (aligned_buffer_offset & (sizeof(uint64_t) - 1))
         {
             WARN("Unaligned predicate argument buffer offset %#"PRIx64".\n", aligned_buffer_offset);
@@ -5096,21 +6133,14 @@ static void STDMETHODCALLTYPE d3d12_command_list_SetPredication(ID3D12GraphicsCo
             return;
         }
 
-        FIXME_ONCE("Predication doesn't support clear and copy commands, "
-                "and predication values are treated as 32-bit values.\n");
-
-        cond_info.sType = VK_STRUCTURE_TYPE_CONDITIONAL_RENDERING_BEGIN_INFO_EXT;
-        cond_info.pNext = NULL;
-        cond_info.buffer = resource->u.vk_buffer;
-        cond_info.offset = aligned_buffer_offset;
         switch (operation)
         {
             case D3D12_PREDICATION_OP_EQUAL_ZERO:
-                cond_info.flags = 0;
+                flags = 0;
                 break;
 
             case D3D12_PREDICATION_OP_NOT_EQUAL_ZERO:
-                cond_info.flags = VK_CONDITIONAL_RENDERING_INVERTED_BIT_EXT;
+                flags = VK_CONDITIONAL_RENDERING_INVERTED_BIT_EXT;
                 break;
 
             default:
@@ -5118,15 +6148,53 @@ static void STDMETHODCALLTYPE d3d12_command_list_SetPredication(ID3D12GraphicsCo
                 return;
         }
 
+        FIXME_ONCE("Predication doesn't support clear and copy commands.\n");
+    }
+
+    if (vk_info->EXT_conditional_rendering)
+    {
+        /* Conditional rendering may be begun and ended either inside or
+         * outside of a render pass instance, as long as both happen in the
+         * same one, so there is no need to end the current render pass. */
         if (list->is_predicated)
             VK_CALL(vkCmdEndConditionalRenderingEXT(list->vk_command_buffer));
-        VK_CALL(vkCmdBeginConditionalRenderingEXT(list->vk_command_buffer, &cond_info));
-        list->is_predicated = true;
+        list->is_predicated = false;
+
+        if (resource)
+        {
+            FIXME_ONCE("Predication values are treated as 32-bit values.\n");
+
+            list->predicate.vk_buffer = resource->u.vk_buffer;
+            list->predicate.offset = aligned_buffer_offset;
+            list->predicate.flags = flags;
+            list->predicate.is_latched = false;
+            /* Inside a render pass, the predicate is latched when the render pass ends. */
+            if (!list->current_render_pass)
+                d3d12_command_list_latch_predicate(list);
+            d3d12_command_list_begin_conditional_rendering(list);
+            list->is_predicated = true;
+        }
+        return;
     }
-    else if (list->is_predicated)
+
+    list->predicate.vk_count_buffer = VK_NULL_HANDLE;
+    if (!resource)
+        return;
+
+    /* Resolve the predicate on the GPU. Direct3D latches the predicate value
+     * here, so the draw count is resolved once instead of per command. */
+    d3d12_command_list_end_current_render_pass(list);
+    list->predicate.vk_buffer = resource->u.vk_buffer;
+    list->predicate.offset = aligned_buffer_offset;
+    list->predicate.is_latched = false;
+    d3d12_command_list_latch_predicate(list);
+    if (!list->predicate.is_latched || !d3d12_command_list_resolve_predicate(list,
+            list->predicate.vk_buffer, list->predicate.offset,
+            flags & VK_CONDITIONAL_RENDERING_INVERTED_BIT_EXT, draw_count,
+            &list->predicate.vk_count_buffer, &list->predicate.count_offset))
     {
-        VK_CALL(vkCmdEndConditionalRenderingEXT(list->vk_command_buffer));
-        list->is_predicated = false;
+        ERR("Failed to resolve predicate.\n");
+        list->predicate.vk_count_buffer = VK_NULL_HANDLE;
     }
 }
 
@@ -5161,6 +6229,8 @@ static void STDMETHODCALLTYPE d3d12_command_list_ExecuteIndirect(ID3D12GraphicsC
     struct d3d12_command_list *list = impl_from_ID3D12GraphicsCommandList1(iface);
     const D3D12_COMMAND_SIGNATURE_DESC *signature_desc;
     const struct vkd3d_vk_device_procs *vk_procs;
+    VkDeviceSize count_offset;
+    VkBuffer vk_count_buffer;
     unsigned int i;
 
     TRACE("iface %p, command_signature %p, max_command_count %u, arg_buffer %p, "
@@ -5177,6 +6247,38 @@ static void STDMETHODCALLTYPE d3d12_command_list_ExecuteIndirect(ID3D12GraphicsC
     }
 
     signature_desc = &sig_impl->desc;
+
+    vk_count_buffer = count_impl ? count_impl->u.vk_buffer : VK_NULL_HANDLE;
+    count_offset = count_buffer_offset;
+    if (list->predicate.vk_count_buffer)
+    {
+        const uint32_t input[] = {max_command_count, 0, 0};
+
+        /* Indirect draws are predicated by resolving the predicate into a
+         * draw count. There is no such count for indirect dispatches, and
+         * application count buffers would have to be combined with it. */
+        if (count_buffer || !signature_desc->NumArgumentDescs || signature_desc->pArgumentDescs[
+                signature_desc->NumArgumentDescs - 1].Type == D3D12_INDIRECT_ARGUMENT_TYPE_DISPATCH)
+        {
+            FIXME_ONCE("Predicated indirect dispatches and count buffers are not supported "
+                    "without VK_EXT_conditional_rendering.\n");
+        }
+        else if (!list->device->vk_info.KHR_draw_indirect_count)
+        {
+            FIXME_ONCE("Predicated draws are not supported without VK_KHR_draw_indirect_count.\n");
+        }
+        else
+        {
+            d3d12_command_list_end_current_render_pass(list);
+            if (!d3d12_command_list_resolve_predicate(list, list->predicate.vk_count_buffer,
+                    list->predicate.count_offset, false, input, &vk_count_buffer, &count_offset))
+            {
+                ERR("Failed to resolve predicate.\n");
+                vk_count_buffer = VK_NULL_HANDLE;
+            }
+        }
+    }
+
     for (i = 0; i < signature_desc->NumArgumentDescs; ++i)
     {
         const D3D12_INDIRECT_ARGUMENT_DESC *arg_desc = &signature_desc->pArgumentDescs[i];
@@ -5190,10 +6292,10 @@ static void STDMETHODCALLTYPE d3d12_command_list_ExecuteIndirect(ID3D12GraphicsC
                     break;
                 }
 
-                if (count_buffer)
+                if (vk_count_buffer)
                 {
                     VK_CALL(vkCmdDrawIndirectCountKHR(list->vk_command_buffer, arg_impl->u.vk_buffer,
-                            arg_buffer_offset, count_impl->u.vk_buffer, count_buffer_offset,
+                            arg_buffer_offset, vk_count_buffer, count_offset,
                             max_command_count, signature_desc->ByteStride));
                 }
                 else
@@ -5212,10 +6314,10 @@ static void STDMETHODCALLTYPE d3d12_command_list_ExecuteIndirect(ID3D12GraphicsC
 
                 d3d12_command_list_check_index_buffer_strip_cut_value(list);
 
-                if (count_buffer)
+                if (vk_count_buffer)
                 {
                     VK_CALL(vkCmdDrawIndexedIndirectCountKHR(list->vk_command_buffer, arg_impl->u.vk_buffer,
-                            arg_buffer_offset, count_impl->u.vk_buffer, count_buffer_offset,
+                            arg_buffer_offset, vk_count_buffer, count_offset,
                             max_command_count, signature_desc->ByteStride));
                 }
                 else
@@ -5409,6 +6511,10 @@ static HRESULT d3d12_command_list_init(struct d3d12_command_list *list, struct d
 
     list->allocator = allocator;
 
+    list->staging_regions = NULL;
+    list->staging_regions_size = 0;
+    list->staging_region_count = 0;
+
     if (SUCCEEDED(hr = d3d12_command_allocator_allocate_command_buffer(allocator, list)))
     {
         d3d12_command_list_reset_state(list, initial_pipeline_state);
@@ -5461,216 +6567,1574 @@ HRESULT d3d12_command_list_create(struct d3d12_device *device,
     return S_OK;
 }
 
-/* ID3D12CommandQueue */
-static inline struct d3d12_command_queue *impl_from_ID3D12CommandQueue(ID3D12CommandQueue *iface)
+/* Queue profiling */
+static uint64_t vkd3d_get_monotonic_time(void)
 {
-    return CONTAINING_RECORD(iface, struct d3d12_command_queue, ID3D12CommandQueue_iface);
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_command_queue_QueryInterface(ID3D12CommandQueue *iface,
-        REFIID riid, void **object)
+static HRESULT vkd3d_get_calibrated_timestamps(struct d3d12_device *device,
+        uint64_t *gpu_timestamp, uint64_t *cpu_timestamp)
 {
-    TRACE("iface %p, riid %s, object %p.\n", iface, debugstr_guid(riid), object);
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkCalibratedTimestampInfoEXT infos[2];
+    uint64_t timestamps[2], max_deviation;
+    VkResult vr;
 
-    if (IsEqualGUID(riid, &IID_ID3D12CommandQueue)
-            || IsEqualGUID(riid, &IID_ID3D12Pageable)
-            || IsEqualGUID(riid, &IID_ID3D12DeviceChild)
-            || IsEqualGUID(riid, &IID_ID3D12Object)
-            || IsEqualGUID(riid, &IID_IUnknown))
-    {
-        ID3D12CommandQueue_AddRef(iface);
-        *object = iface;
-        return S_OK;
-    }
+    if (!device->vk_info.EXT_calibrated_timestamps)
+        return E_NOTIMPL;
 
-    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(riid));
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[0].pNext = NULL;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[1].pNext = NULL;
+    infos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
 
-    *object = NULL;
-    return E_NOINTERFACE;
-}
+    if ((vr = VK_CALL(vkGetCalibratedTimestampsEXT(device->vk_device,
+            ARRAY_SIZE(infos), infos, timestamps, &max_deviation))) < 0)
+    {
+        WARN("Failed to get calibrated timestamps, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
 
-static ULONG STDMETHODCALLTYPE d3d12_command_queue_AddRef(ID3D12CommandQueue *iface)
-{
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
-    ULONG refcount = InterlockedIncrement(&command_queue->refcount);
+    TRACE("GPU timestamp %#"PRIx64", CPU timestamp %#"PRIx64", max deviation %"PRIu64"ns.\n",
+            timestamps[0], timestamps[1], max_deviation);
 
-    TRACE("%p increasing refcount to %u.\n", command_queue, refcount);
+    *gpu_timestamp = timestamps[0];
+    *cpu_timestamp = timestamps[1];
 
-    return refcount;
+    return S_OK;
 }
 
-static ULONG STDMETHODCALLTYPE d3d12_command_queue_Release(ID3D12CommandQueue *iface)
+void vkd3d_profile_trace_init(struct vkd3d_profile_trace *trace, const struct vkd3d_instance *instance)
 {
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
-    ULONG refcount = InterlockedDecrement(&command_queue->refcount);
+    const char *filename;
+    int rc;
 
-    TRACE("%p decreasing refcount to %u.\n", command_queue, refcount);
+    trace->file = NULL;
+    trace->empty = true;
 
-    if (!refcount)
+    if (!(instance->config_flags & VKD3D_CONFIG_FLAG_QUEUE_PROFILING))
+        return;
+    if (!(filename = getenv("VKD3D_PROFILE_TRACE")) || !*filename)
+        return;
+
+    if ((rc = pthread_mutex_init(&trace->mutex, NULL)))
     {
-        struct d3d12_device *device = command_queue->device;
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return;
+    }
 
-        vkd3d_private_store_destroy(&command_queue->private_store);
+    if (!(trace->file = fopen(filename, "w")))
+    {
+        ERR("Failed to open profile trace file %s, errno %d.\n", debugstr_a(filename), errno);
+        pthread_mutex_destroy(&trace->mutex);
+        return;
+    }
 
-        vkd3d_free(command_queue);
+    TRACE("Writing queue profile trace to %s.\n", debugstr_a(filename));
+    fputs("[\n", trace->file);
+}
 
-        d3d12_device_release(device);
-    }
+void vkd3d_profile_trace_cleanup(struct vkd3d_profile_trace *trace)
+{
+    if (!trace->file)
+        return;
 
-    return refcount;
+    fputs("\n]\n", trace->file);
+    fclose(trace->file);
+    pthread_mutex_destroy(&trace->mutex);
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_command_queue_GetPrivateData(ID3D12CommandQueue *iface,
-        REFGUID guid, UINT *data_size, void *data)
+static void vkd3d_profile_trace_write_event(struct vkd3d_profile_trace *trace, const char *format, ...)
 {
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    va_list args;
+    int rc;
 
-    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+    if (!trace->file)
+        return;
 
-    return vkd3d_get_private_data(&command_queue->private_store, guid, data_size, data);
+    if ((rc = pthread_mutex_lock(&trace->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    if (!trace->empty)
+        fputs(",\n", trace->file);
+    trace->empty = false;
+
+    va_start(args, format);
+    vfprintf(trace->file, format, args);
+    va_end(args);
+
+    pthread_mutex_unlock(&trace->mutex);
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_command_queue_SetPrivateData(ID3D12CommandQueue *iface,
-        REFGUID guid, UINT data_size, const void *data)
+/* Chrome traces use microseconds. */
+#define VKD3D_TRACE_TIME_FMT "%"PRIu64".%03u"
+#define VKD3D_TRACE_TIME_ARGS(t) (t) / 1000, (unsigned int)((t) % 1000)
+
+static void vkd3d_queue_profiler_trace_timestamp(const struct vkd3d_queue_profiler *profiler,
+        struct d3d12_device *device, const struct vkd3d_queue_timestamp *timestamp)
 {
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    uint64_t duration = timestamp->gpu_end_time - timestamp->gpu_begin_time;
 
-    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+    if (timestamp->gpu_end_time < timestamp->gpu_begin_time)
+        duration = 0;
 
-    return vkd3d_set_private_data(&command_queue->private_store, guid, data_size, data);
+    vkd3d_profile_trace_write_event(&device->profile_trace,
+            "{\"name\": \"ExecuteCommandLists\", \"cat\": \"gpu\", \"ph\": \"X\", \"pid\": %d, \"tid\": %u, "
+            "\"ts\": "VKD3D_TRACE_TIME_FMT", \"dur\": "VKD3D_TRACE_TIME_FMT", \"args\": {\"submission\": %"PRIu64", "
+            "\"command_lists\": %u, \"cpu_submit_ts\": "VKD3D_TRACE_TIME_FMT", \"calibrated\": %s}}",
+            (int)getpid(), profiler->id, VKD3D_TRACE_TIME_ARGS(timestamp->gpu_begin_time),
+            VKD3D_TRACE_TIME_ARGS(duration), timestamp->submission_index, timestamp->command_list_count,
+            VKD3D_TRACE_TIME_ARGS(timestamp->cpu_submit_time),
+            timestamp->flags & VKD3D_QUEUE_TIMESTAMP_CALIBRATED ? "true" : "false");
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_command_queue_SetPrivateDataInterface(ID3D12CommandQueue *iface,
-        REFGUID guid, const IUnknown *data)
+static uint64_t vkd3d_queue_profiler_convert_timestamp(const struct vkd3d_queue_profiler *profiler,
+        const struct vkd3d_queue_profiler_slot *slot, uint64_t gpu_timestamp)
 {
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    uint64_t delta;
 
-    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
+    if (!(slot->timestamp.flags & VKD3D_QUEUE_TIMESTAMP_CALIBRATED))
+        return (uint64_t)((gpu_timestamp & profiler->timestamp_mask) * profiler->timestamp_period);
 
-    return vkd3d_set_private_data_interface(&command_queue->private_store, guid, data);
+    delta = (gpu_timestamp - slot->calibration_gpu_timestamp) & profiler->timestamp_mask;
+    return slot->calibration_cpu_timestamp + (uint64_t)(delta * profiler->timestamp_period);
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_command_queue_SetName(ID3D12CommandQueue *iface, const WCHAR *name)
+/* Reads back the timestamps of the slot if its batch has completed. */
+static bool vkd3d_queue_profiler_collect_slot_locked(struct vkd3d_queue_profiler *profiler,
+        struct d3d12_device *device, unsigned int slot_index, bool wait)
 {
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
-    VkQueue vk_queue;
-    HRESULT hr;
+    struct vkd3d_queue_profiler_slot *slot = &profiler->slots[slot_index];
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    uint64_t timestamps[2];
+    VkResult vr;
 
-    TRACE("iface %p, name %s.\n", iface, debugstr_w(name, command_queue->device->wchar_size));
+    if (slot->ready)
+        return true;
 
-    if (!(vk_queue = vkd3d_queue_acquire(command_queue->vkd3d_queue)))
+    if (wait)
+        vr = VK_CALL(vkWaitForFences(device->vk_device, 1, &slot->vk_fence, VK_TRUE, UINT64_MAX));
+    else
+        vr = VK_CALL(vkGetFenceStatus(device->vk_device, slot->vk_fence));
+    if (vr == VK_NOT_READY)
+        return false;
+
+    if (vr >= 0 && (vr = VK_CALL(vkGetQueryPoolResults(device->vk_device, profiler->vk_query_pool,
+            2 * slot_index, 2, sizeof(timestamps), timestamps, sizeof(*timestamps), VK_QUERY_RESULT_64_BIT))) >= 0)
     {
-        ERR("Failed to acquire queue %p.\n", command_queue->vkd3d_queue);
-        return E_FAIL;
+        slot->timestamp.gpu_begin_time = vkd3d_queue_profiler_convert_timestamp(profiler, slot, timestamps[0]);
+        slot->timestamp.gpu_end_time = vkd3d_queue_profiler_convert_timestamp(profiler, slot, timestamps[1]);
+    }
+    else
+    {
+        ERR("Failed to read back timestamps for submission %"PRIu64", vr %d.\n",
+                slot->timestamp.submission_index, vr);
+        slot->timestamp.gpu_begin_time = 0;
+        slot->timestamp.gpu_end_time = 0;
     }
 
-    hr = vkd3d_set_vk_object_name(command_queue->device, (uint64_t)(uintptr_t)vk_queue,
-            VK_DEBUG_REPORT_OBJECT_TYPE_QUEUE_EXT, name);
-    vkd3d_queue_release(command_queue->vkd3d_queue);
-    return hr;
+    slot->ready = true;
+    vkd3d_queue_profiler_trace_timestamp(profiler, device, &slot->timestamp);
+
+    return true;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_command_queue_GetDevice(ID3D12CommandQueue *iface, REFIID iid, void **device)
+static void vkd3d_queue_profiler_destroy(struct vkd3d_queue_profiler *profiler, struct d3d12_device *device)
 {
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    unsigned int i;
 
-    TRACE("iface %p, iid %s, device %p.\n", iface, debugstr_guid(iid), device);
+    for (i = 0; i < profiler->slot_count; ++i)
+        vkd3d_queue_profiler_collect_slot_locked(profiler, device,
+                (profiler->first_slot + i) % VKD3D_QUEUE_PROFILER_SLOT_COUNT, true);
 
-    return d3d12_device_query_interface(command_queue->device, iid, device);
-}
+    if (profiler->dropped_count)
+        WARN("Dropped %"PRIu64" undrained queue timestamps.\n", profiler->dropped_count);
 
-static void STDMETHODCALLTYPE d3d12_command_queue_UpdateTileMappings(ID3D12CommandQueue *iface,
-        ID3D12Resource *resource, UINT region_count,
-        const D3D12_TILED_RESOURCE_COORDINATE *region_start_coordinates,
-        const D3D12_TILE_REGION_SIZE *region_sizes,
-        UINT range_count,
-        const D3D12_TILE_RANGE_FLAGS *range_flags,
-        UINT *heap_range_offsets,
-        UINT *range_tile_counts,
-        D3D12_TILE_MAPPING_FLAGS flags)
-{
-    FIXME("iface %p, resource %p, region_count %u, region_start_coordinates %p, "
-            "region_sizes %p, range_count %u, range_flags %p, heap_range_offsets %p, "
-            "range_tile_counts %p, flags %#x stub!\n",
-            iface, resource, region_count, region_start_coordinates, region_sizes, range_count,
-            range_flags, heap_range_offsets, range_tile_counts, flags);
+    for (i = 0; i < VKD3D_QUEUE_PROFILER_SLOT_COUNT; ++i)
+        VK_CALL(vkDestroyFence(device->vk_device, profiler->slots[i].vk_fence, NULL));
+    VK_CALL(vkDestroyQueryPool(device->vk_device, profiler->vk_query_pool, NULL));
+    VK_CALL(vkDestroyCommandPool(device->vk_device, profiler->vk_command_pool, NULL));
+
+    pthread_mutex_destroy(&profiler->mutex);
+    vkd3d_free(profiler);
 }
 
-static void STDMETHODCALLTYPE d3d12_command_queue_CopyTileMappings(ID3D12CommandQueue *iface,
-        ID3D12Resource *dst_resource,
-        const D3D12_TILED_RESOURCE_COORDINATE *dst_region_start_coordinate,
-        ID3D12Resource *src_resource,
-        const D3D12_TILED_RESOURCE_COORDINATE *src_region_start_coordinate,
-        const D3D12_TILE_REGION_SIZE *region_size,
-        D3D12_TILE_MAPPING_FLAGS flags)
+static VkResult vkd3d_queue_profiler_record_slot(struct vkd3d_queue_profiler *profiler,
+        struct d3d12_device *device, unsigned int slot_index)
 {
-    FIXME("iface %p, dst_resource %p, dst_region_start_coordinate %p, "
-            "src_resource %p, src_region_start_coordinate %p, region_size %p, flags %#x stub!\n",
-            iface, dst_resource, dst_region_start_coordinate, src_resource,
-            src_region_start_coordinate, region_size, flags);
+    struct vkd3d_queue_profiler_slot *slot = &profiler->slots[slot_index];
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkCommandBufferAllocateInfo allocate_info;
+    VkCommandBufferBeginInfo begin_info;
+    VkFenceCreateInfo fence_info;
+    VkResult vr;
+
+    allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocate_info.pNext = NULL;
+    allocate_info.commandPool = profiler->vk_command_pool;
+    allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocate_info.commandBufferCount = ARRAY_SIZE(slot->vk_command_buffers);
+    if ((vr = VK_CALL(vkAllocateCommandBuffers(device->vk_device, &allocate_info, slot->vk_command_buffers))) < 0)
+        return vr;
+
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.pNext = NULL;
+    begin_info.flags = 0;
+    begin_info.pInheritanceInfo = NULL;
+
+    if ((vr = VK_CALL(vkBeginCommandBuffer(slot->vk_command_buffers[0], &begin_info))) < 0)
+        return vr;
+    VK_CALL(vkCmdResetQueryPool(slot->vk_command_buffers[0], profiler->vk_query_pool, 2 * slot_index, 2));
+    VK_CALL(vkCmdWriteTimestamp(slot->vk_command_buffers[0], VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            profiler->vk_query_pool, 2 * slot_index));
+    if ((vr = VK_CALL(vkEndCommandBuffer(slot->vk_command_buffers[0]))) < 0)
+        return vr;
+
+    if ((vr = VK_CALL(vkBeginCommandBuffer(slot->vk_command_buffers[1], &begin_info))) < 0)
+        return vr;
+    VK_CALL(vkCmdWriteTimestamp(slot->vk_command_buffers[1], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            profiler->vk_query_pool, 2 * slot_index + 1));
+    if ((vr = VK_CALL(vkEndCommandBuffer(slot->vk_command_buffers[1]))) < 0)
+        return vr;
+
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.pNext = NULL;
+    fence_info.flags = 0;
+    return VK_CALL(vkCreateFence(device->vk_device, &fence_info, NULL, &slot->vk_fence));
 }
 
-static void STDMETHODCALLTYPE d3d12_command_queue_ExecuteCommandLists(ID3D12CommandQueue *iface,
-        UINT command_list_count, ID3D12CommandList * const *command_lists)
+static HRESULT vkd3d_queue_profiler_create(struct d3d12_device *device,
+        const struct vkd3d_queue *queue, D3D12_COMMAND_LIST_TYPE type, struct vkd3d_queue_profiler **profiler)
 {
-    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
-    const struct vkd3d_vk_device_procs *vk_procs;
-    struct d3d12_command_list *cmd_list;
-    struct VkSubmitInfo submit_desc;
-    VkCommandBuffer *buffers;
-    VkQueue vk_queue;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    static const char * const type_names[] = {"Direct", "Bundle", "Compute", "Copy"};
+    VkCommandPoolCreateInfo command_pool_info;
+    VkQueryPoolCreateInfo query_pool_info;
+    struct vkd3d_queue_profiler *object;
+    static LONG next_profiler_id;
     unsigned int i;
     VkResult vr;
+    int rc;
 
-    TRACE("iface %p, command_list_count %u, command_lists %p.\n",
-            iface, command_list_count, command_lists);
+    if (!(object = vkd3d_calloc(1, sizeof(*object))))
+        return E_OUTOFMEMORY;
 
-    vk_procs = &command_queue->device->vk_procs;
+    if ((rc = pthread_mutex_init(&object->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        vkd3d_free(object);
+        return hresult_from_errno(rc);
+    }
+
+    object->id = InterlockedIncrement(&next_profiler_id);
+    object->timestamp_mask = queue->timestamp_bits >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << queue->timestamp_bits) - 1;
+    object->timestamp_period = device->vk_info.device_limits.timestampPeriod;
+    object->calibrated = SUCCEEDED(vkd3d_get_calibrated_timestamps(device,
+            &object->calibration_gpu_timestamp, &object->calibration_cpu_timestamp));
+    if (!object->calibrated)
+        WARN("Queue timestamps are not calibrated against CPU time.\n");
 
-    if (!(buffers = vkd3d_calloc(command_list_count, sizeof(*buffers))))
+    command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    command_pool_info.pNext = NULL;
+    command_pool_info.flags = 0;
+    command_pool_info.queueFamilyIndex = queue->vk_family_index;
+    if ((vr = VK_CALL(vkCreateCommandPool(device->vk_device, &command_pool_info, NULL,
+            &object->vk_command_pool))) < 0)
     {
-        ERR("Failed to allocate command buffer array.\n");
-        return;
+        WARN("Failed to create Vulkan command pool, vr %d.\n", vr);
+        goto fail;
     }
 
-    for (i = 0; i < command_list_count; ++i)
+    query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    query_pool_info.pNext = NULL;
+    query_pool_info.flags = 0;
+    query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    query_pool_info.queryCount = 2 * VKD3D_QUEUE_PROFILER_SLOT_COUNT;
+    query_pool_info.pipelineStatistics = 0;
+    if ((vr = VK_CALL(vkCreateQueryPool(device->vk_device, &query_pool_info, NULL,
+            &object->vk_query_pool))) < 0)
     {
-        cmd_list = unsafe_impl_from_ID3D12CommandList(command_lists[i]);
+        WARN("Failed to create Vulkan query pool, vr %d.\n", vr);
+        goto fail;
+    }
 
-        if (cmd_list->is_recording)
+    for (i = 0; i < VKD3D_QUEUE_PROFILER_SLOT_COUNT; ++i)
+    {
+        if ((vr = vkd3d_queue_profiler_record_slot(object, device, i)) < 0)
         {
-            d3d12_device_mark_as_removed(command_queue->device, DXGI_ERROR_INVALID_CALL,
-                    "Command list %p is in recording state.\n", command_lists[i]);
-            vkd3d_free(buffers);
-            return;
+            WARN("Failed to record timestamp command buffers, vr %d.\n", vr);
+            goto fail;
         }
-
-        buffers[i] = cmd_list->vk_command_buffer;
     }
 
-    submit_desc.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submit_desc.pNext = NULL;
-    submit_desc.waitSemaphoreCount = 0;
-    submit_desc.pWaitSemaphores = NULL;
-    submit_desc.pWaitDstStageMask = NULL;
-    submit_desc.commandBufferCount = command_list_count;
-    submit_desc.pCommandBuffers = buffers;
-    submit_desc.signalSemaphoreCount = 0;
-    submit_desc.pSignalSemaphores = NULL;
-
-    if (!(vk_queue = vkd3d_queue_acquire(command_queue->vkd3d_queue)))
-    {
-        ERR("Failed to acquire queue %p.\n", command_queue->vkd3d_queue);
-        vkd3d_free(buffers);
-        return;
-    }
+    vkd3d_profile_trace_write_event(&device->profile_trace,
+            "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %u, "
+            "\"args\": {\"name\": \"%s queue %u\"}}", (int)getpid(), object->id,
+            (unsigned int)type < ARRAY_SIZE(type_names) ? type_names[type] : "Unknown", object->id);
 
-    if ((vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_desc, VK_NULL_HANDLE))) < 0)
-        ERR("Failed to submit queue(s), vr %d.\n", vr);
+    TRACE("Created queue profiler %p, id %u.\n", object, object->id);
 
-    vkd3d_queue_release(command_queue->vkd3d_queue);
+    *profiler = object;
+    return S_OK;
 
-    vkd3d_free(buffers);
+fail:
+    vkd3d_queue_profiler_destroy(object, device);
+    return hresult_from_vk_result(vr);
+}
+
+/* In nanoseconds. */
+#define VKD3D_QUEUE_PROFILER_WAIT_TIMEOUT 10000000ull
+#define VKD3D_QUEUE_PROFILER_CALIBRATION_INTERVAL 100000000ull
+
+static void vkd3d_queue_profiler_retire_first_slot_locked(struct vkd3d_queue_profiler *profiler)
+{
+    profiler->first_slot = (profiler->first_slot + 1) % VKD3D_QUEUE_PROFILER_SLOT_COUNT;
+    --profiler->slot_count;
+    ++profiler->dropped_count;
+}
+
+/* Called with the Vulkan queue released when the ring is full. Retired
+ * batches are still written to the trace file, but can no longer be drained.
+ *
+ * The fence is waited for without holding the profiler mutex, so that other
+ * threads can keep submitting to the queue. Another thread may retire or
+ * even reuse the slot in the meantime, which is detected by its submission
+ * index. Since a reused fence may be reset while it is waited for, the wait
+ * uses a timeout and the ring is checked again afterwards. */
+static void vkd3d_queue_profiler_wait_for_slot(struct vkd3d_queue_profiler *profiler,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    uint64_t submission_index;
+    VkFence vk_fence;
+    VkResult vr;
+    int rc;
+
+    for (;;)
+    {
+        if ((rc = pthread_mutex_lock(&profiler->mutex)))
+        {
+            ERR("Failed to lock mutex, error %d.\n", rc);
+            return;
+        }
+
+        if (profiler->slot_count < VKD3D_QUEUE_PROFILER_SLOT_COUNT)
+            break;
+
+        if (vkd3d_queue_profiler_collect_slot_locked(profiler, device, profiler->first_slot, false))
+        {
+            vkd3d_queue_profiler_retire_first_slot_locked(profiler);
+            break;
+        }
+
+        vk_fence = profiler->slots[profiler->first_slot].vk_fence;
+        submission_index = profiler->slots[profiler->first_slot].timestamp.submission_index;
+
+        pthread_mutex_unlock(&profiler->mutex);
+
+        vr = VK_CALL(vkWaitForFences(device->vk_device, 1, &vk_fence, VK_TRUE, VKD3D_QUEUE_PROFILER_WAIT_TIMEOUT));
+        if (vr < 0)
+        {
+            ERR("Failed to wait for fence, vr %d.\n", vr);
+            return;
+        }
+
+        if ((rc = pthread_mutex_lock(&profiler->mutex)))
+        {
+            ERR("Failed to lock mutex, error %d.\n", rc);
+            return;
+        }
+
+        if (vr == VK_SUCCESS && profiler->slot_count == VKD3D_QUEUE_PROFILER_SLOT_COUNT
+                && profiler->slots[profiler->first_slot].timestamp.submission_index == submission_index
+                && vkd3d_queue_profiler_collect_slot_locked(profiler, device, profiler->first_slot, false))
+        {
+            vkd3d_queue_profiler_retire_first_slot_locked(profiler);
+            break;
+        }
+
+        pthread_mutex_unlock(&profiler->mutex);
+    }
+
+    pthread_mutex_unlock(&profiler->mutex);
+}
+
+static void vkd3d_queue_profiler_update_calibration_locked(struct vkd3d_queue_profiler *profiler,
+        struct d3d12_device *device, uint64_t cpu_time)
+{
+    uint64_t gpu_timestamp, cpu_timestamp;
+
+    if (!profiler->calibrated
+            || cpu_time - profiler->calibration_cpu_timestamp < VKD3D_QUEUE_PROFILER_CALIBRATION_INTERVAL)
+        return;
+
+    /* Keep the previous calibration on failure. */
+    if (SUCCEEDED(vkd3d_get_calibrated_timestamps(device, &gpu_timestamp, &cpu_timestamp)))
+    {
+        profiler->calibration_gpu_timestamp = gpu_timestamp;
+        profiler->calibration_cpu_timestamp = cpu_timestamp;
+    }
+}
+
+/* Called with the Vulkan queue acquired, which serializes submissions.
+ * Returns S_FALSE if the ring is full and its oldest batch is still pending;
+ * the caller must then release the queue, wait with
+ * vkd3d_queue_profiler_wait_for_slot() and try again. */
+static HRESULT vkd3d_queue_profiler_begin_batch(struct vkd3d_queue_profiler *profiler,
+        struct d3d12_device *device, unsigned int command_list_count,
+        VkCommandBuffer *begin_buffer, VkCommandBuffer *end_buffer, VkFence *vk_fence)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_queue_profiler_slot *slot;
+    unsigned int slot_index;
+    VkResult vr;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&profiler->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if (profiler->slot_count == VKD3D_QUEUE_PROFILER_SLOT_COUNT)
+    {
+        if (!vkd3d_queue_profiler_collect_slot_locked(profiler, device, profiler->first_slot, false))
+        {
+            pthread_mutex_unlock(&profiler->mutex);
+            return S_FALSE;
+        }
+        vkd3d_queue_profiler_retire_first_slot_locked(profiler);
+    }
+
+    slot_index = (profiler->first_slot + profiler->slot_count) % VKD3D_QUEUE_PROFILER_SLOT_COUNT;
+    slot = &profiler->slots[slot_index];
+
+    if ((vr = VK_CALL(vkResetFences(device->vk_device, 1, &slot->vk_fence))) < 0)
+    {
+        WARN("Failed to reset fence, vr %d.\n", vr);
+        pthread_mutex_unlock(&profiler->mutex);
+        return hresult_from_vk_result(vr);
+    }
+
+    slot->ready = false;
+    slot->timestamp.submission_index = profiler->submission_count++;
+    slot->timestamp.command_list_count = command_list_count;
+    slot->timestamp.flags = profiler->calibrated ? VKD3D_QUEUE_TIMESTAMP_CALIBRATED : 0;
+    slot->timestamp.cpu_submit_time = vkd3d_get_monotonic_time();
+    slot->timestamp.gpu_begin_time = 0;
+    slot->timestamp.gpu_end_time = 0;
+    vkd3d_queue_profiler_update_calibration_locked(profiler, device, slot->timestamp.cpu_submit_time);
+    slot->calibration_gpu_timestamp = profiler->calibration_gpu_timestamp;
+    slot->calibration_cpu_timestamp = profiler->calibration_cpu_timestamp;
+    ++profiler->slot_count;
+
+    *begin_buffer = slot->vk_command_buffers[0];
+    *end_buffer = slot->vk_command_buffers[1];
+    *vk_fence = slot->vk_fence;
+
+    pthread_mutex_unlock(&profiler->mutex);
+
+    return S_OK;
+}
+
+static void vkd3d_queue_profiler_abort_batch(struct vkd3d_queue_profiler *profiler)
+{
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&profiler->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    --profiler->slot_count;
+    --profiler->submission_count;
+
+    pthread_mutex_unlock(&profiler->mutex);
+}
+
+static unsigned int vkd3d_queue_profiler_drain(struct vkd3d_queue_profiler *profiler,
+        struct d3d12_device *device, struct vkd3d_queue_timestamp *timestamps, unsigned int count)
+{
+    unsigned int drained_count = 0;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&profiler->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return 0;
+    }
+
+    while (drained_count < count && profiler->slot_count)
+    {
+        if (!vkd3d_queue_profiler_collect_slot_locked(profiler, device, profiler->first_slot, false))
+            break;
+
+        timestamps[drained_count++] = profiler->slots[profiler->first_slot].timestamp;
+        profiler->first_slot = (profiler->first_slot + 1) % VKD3D_QUEUE_PROFILER_SLOT_COUNT;
+        --profiler->slot_count;
+    }
+
+    pthread_mutex_unlock(&profiler->mutex);
+
+    return drained_count;
+}
+
+/* ID3D12CommandQueue */
+static inline struct d3d12_command_queue *impl_from_ID3D12CommandQueue(ID3D12CommandQueue *iface)
+{
+    return CONTAINING_RECORD(iface, struct d3d12_command_queue, ID3D12CommandQueue_iface);
+}
+
+/* Upload rings */
+#define VKD3D_UPLOAD_BLOCK_SIZE 0x400000
+
+static HRESULT vkd3d_upload_ring_init(struct vkd3d_upload_ring *ring)
+{
+    int rc;
+
+    if ((rc = pthread_mutex_init(&ring->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    ring->current_block = NULL;
+    list_init(&ring->pending_blocks);
+    list_init(&ring->free_blocks);
+
+    return S_OK;
+}
+
+static void vkd3d_upload_block_release_fences(struct vkd3d_upload_block *block)
+{
+    size_t i;
+
+    for (i = 0; i < block->fence_count; ++i)
+        ID3D12Fence_Release(&block->fences[i].fence->ID3D12Fence_iface);
+    block->fence_count = 0;
+}
+
+static void vkd3d_upload_block_destroy(struct vkd3d_upload_block *block)
+{
+    vkd3d_upload_block_release_fences(block);
+    vkd3d_free(block->fences);
+    ID3D12Resource_Release(&block->resource->ID3D12Resource_iface);
+    vkd3d_free(block);
+}
+
+static void vkd3d_upload_ring_cleanup(struct vkd3d_upload_ring *ring)
+{
+    struct vkd3d_upload_block *block, *next;
+
+    if (ring->current_block)
+        vkd3d_upload_block_destroy(ring->current_block);
+
+    LIST_FOR_EACH_ENTRY_SAFE(block, next, &ring->pending_blocks, struct vkd3d_upload_block, entry)
+        vkd3d_upload_block_destroy(block);
+    LIST_FOR_EACH_ENTRY_SAFE(block, next, &ring->free_blocks, struct vkd3d_upload_block, entry)
+        vkd3d_upload_block_destroy(block);
+
+    pthread_mutex_destroy(&ring->mutex);
+}
+
+static HRESULT vkd3d_upload_block_create(struct d3d12_device *device,
+        uint64_t size, struct vkd3d_upload_block **block)
+{
+    D3D12_HEAP_PROPERTIES heap_properties;
+    struct vkd3d_upload_block *object;
+    struct d3d12_resource *resource;
+    D3D12_RESOURCE_DESC desc;
+    void *cpu_address;
+    HRESULT hr;
+
+    if (!(object = vkd3d_malloc(sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = D3D12_HEAP_TYPE_UPLOAD;
+
+    desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    desc.Alignment = 0;
+    desc.Width = size;
+    desc.Height = 1;
+    desc.DepthOrArraySize = 1;
+    desc.MipLevels = 1;
+    desc.Format = DXGI_FORMAT_UNKNOWN;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    desc.Flags = D3D12_RESOURCE_FLAG_NONE;
+
+    if (FAILED(hr = d3d12_committed_resource_create(device, &heap_properties, D3D12_HEAP_FLAG_NONE,
+            &desc, D3D12_RESOURCE_STATE_GENERIC_READ, NULL, &resource)))
+    {
+        vkd3d_free(object);
+        return hr;
+    }
+
+    /* Upload heaps stay mapped until they are destroyed. */
+    if (FAILED(hr = ID3D12Resource_Map(&resource->ID3D12Resource_iface, 0, NULL, &cpu_address)))
+    {
+        ID3D12Resource_Release(&resource->ID3D12Resource_iface);
+        vkd3d_free(object);
+        return hr;
+    }
+
+    object->resource = resource;
+    object->gpu_address = resource->gpu_address;
+    object->cpu_address = cpu_address;
+    object->size = size;
+    object->offset = 0;
+    object->fences = NULL;
+    object->fences_size = 0;
+    object->fence_count = 0;
+
+    TRACE("Created upload block %p, size %#"PRIx64".\n", object, size);
+
+    *block = object;
+    return S_OK;
+}
+
+static bool vkd3d_upload_block_is_complete(const struct vkd3d_upload_block *block)
+{
+    size_t i;
+
+    for (i = 0; i < block->fence_count; ++i)
+    {
+        if (vkd3d_atomic_uint64_load(&block->fences[i].fence->value) < block->fences[i].value)
+            return false;
+    }
+
+    return true;
+}
+
+static bool vkd3d_upload_block_add_fence(struct vkd3d_upload_block *block,
+        struct d3d12_fence *fence, uint64_t value)
+{
+    size_t i;
+
+    for (i = 0; i < block->fence_count; ++i)
+    {
+        if (block->fences[i].fence == fence)
+        {
+            block->fences[i].value = max(block->fences[i].value, value);
+            return true;
+        }
+    }
+
+    if (!vkd3d_array_reserve((void **)&block->fences, &block->fences_size,
+            block->fence_count + 1, sizeof(*block->fences)))
+        return false;
+
+    ID3D12Fence_AddRef(&fence->ID3D12Fence_iface);
+    block->fences[block->fence_count].fence = fence;
+    block->fences[block->fence_count].value = value;
+    ++block->fence_count;
+
+    return true;
+}
+
+/* Retires the current block, and finds or creates a block with at least
+ * "size" bytes available. */
+static HRESULT vkd3d_upload_ring_next_block(struct vkd3d_upload_ring *ring,
+        struct d3d12_device *device, uint64_t size)
+{
+    struct vkd3d_upload_block *block, *next;
+    HRESULT hr;
+
+    if ((block = ring->current_block))
+    {
+        list_add_tail(&ring->pending_blocks, &block->entry);
+        ring->current_block = NULL;
+    }
+
+    LIST_FOR_EACH_ENTRY_SAFE(block, next, &ring->pending_blocks, struct vkd3d_upload_block, entry)
+    {
+        if (!vkd3d_upload_block_is_complete(block))
+            continue;
+
+        vkd3d_upload_block_release_fences(block);
+        block->offset = 0;
+        list_remove(&block->entry);
+        list_add_tail(&ring->free_blocks, &block->entry);
+    }
+
+    LIST_FOR_EACH_ENTRY(block, &ring->free_blocks, struct vkd3d_upload_block, entry)
+    {
+        if (block->size >= size)
+        {
+            list_remove(&block->entry);
+            ring->current_block = block;
+            return S_OK;
+        }
+    }
+
+    size = max(size, VKD3D_UPLOAD_BLOCK_SIZE);
+    if (FAILED(hr = vkd3d_upload_block_create(device, size, &ring->current_block)))
+    {
+        ring->current_block = NULL;
+        return hr;
+    }
+
+    return S_OK;
+}
+
+HRESULT vkd3d_allocate_upload_memory(ID3D12CommandQueue *queue, uint64_t size, uint64_t alignment,
+        ID3D12Fence *fence, uint64_t fence_value, struct vkd3d_upload_allocation *allocation)
+{
+    struct d3d12_command_queue *d3d12_queue = impl_from_ID3D12CommandQueue(queue);
+    struct vkd3d_upload_ring *ring = &d3d12_queue->upload_ring;
+    struct vkd3d_upload_block *block;
+    uint64_t offset;
+    HRESULT hr;
+    int rc;
+
+    TRACE("queue %p, size %#"PRIx64", alignment %#"PRIx64", fence %p, fence_value %#"PRIx64", allocation %p.\n",
+            queue, size, alignment, fence, fence_value, allocation);
+
+    if (!alignment)
+        alignment = D3D12_CONSTANT_BUFFER_DATA_PLACEMENT_ALIGNMENT;
+    if (!size || !fence || (alignment & (alignment - 1))
+            || alignment > D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT)
+    {
+        WARN("Invalid size %#"PRIx64", alignment %#"PRIx64" or fence %p.\n", size, alignment, fence);
+        return E_INVALIDARG;
+    }
+
+    if ((rc = pthread_mutex_lock(&ring->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    block = ring->current_block;
+    if (!block || align(block->offset, alignment) + size > block->size)
+    {
+        /* Block addresses are 64 KiB aligned. */
+        if (FAILED(hr = vkd3d_upload_ring_next_block(ring, d3d12_queue->device,
+                align(size, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))))
+        {
+            pthread_mutex_unlock(&ring->mutex);
+            return hr;
+        }
+        block = ring->current_block;
+    }
+
+    if (!vkd3d_upload_block_add_fence(block, unsafe_impl_from_ID3D12Fence(fence), fence_value))
+    {
+        pthread_mutex_unlock(&ring->mutex);
+        return E_OUTOFMEMORY;
+    }
+
+    offset = align(block->offset, alignment);
+    block->offset = offset + size;
+
+    allocation->gpu_address = block->gpu_address + offset;
+    allocation->cpu_address = block->cpu_address + offset;
+
+    pthread_mutex_unlock(&ring->mutex);
+
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_queue_QueryInterface(ID3D12CommandQueue *iface,
+        REFIID riid, void **object)
+{
+    TRACE("iface %p, riid %s, object %p.\n", iface, debugstr_guid(riid), object);
+
+    if (IsEqualGUID(riid, &IID_ID3D12CommandQueue)
+            || IsEqualGUID(riid, &IID_ID3D12Pageable)
+            || IsEqualGUID(riid, &IID_ID3D12DeviceChild)
+            || IsEqualGUID(riid, &IID_ID3D12Object)
+            || IsEqualGUID(riid, &IID_IUnknown))
+    {
+        ID3D12CommandQueue_AddRef(iface);
+        *object = iface;
+        return S_OK;
+    }
+
+    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(riid));
+
+    *object = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE d3d12_command_queue_AddRef(ID3D12CommandQueue *iface)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    ULONG refcount = InterlockedIncrement(&command_queue->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", command_queue, refcount);
+
+    return refcount;
+}
+
+static ULONG STDMETHODCALLTYPE d3d12_command_queue_Release(ID3D12CommandQueue *iface)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    ULONG refcount = InterlockedDecrement(&command_queue->refcount);
+
+    TRACE("%p decreasing refcount to %u.\n", command_queue, refcount);
+
+    if (!refcount)
+    {
+        struct d3d12_device *device = command_queue->device;
+
+        if (command_queue->profiler)
+            vkd3d_queue_profiler_destroy(command_queue->profiler, device);
+
+        d3d12_command_queue_cleanup_sparse_semaphores(command_queue);
+        vkd3d_upload_ring_cleanup(&command_queue->upload_ring);
+        vkd3d_private_store_destroy(&command_queue->private_store);
+
+        vkd3d_free(command_queue);
+
+        d3d12_device_release(device);
+    }
+
+    return refcount;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_queue_GetPrivateData(ID3D12CommandQueue *iface,
+        REFGUID guid, UINT *data_size, void *data)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+
+    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return vkd3d_get_private_data(&command_queue->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_queue_SetPrivateData(ID3D12CommandQueue *iface,
+        REFGUID guid, UINT data_size, const void *data)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+
+    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return vkd3d_set_private_data(&command_queue->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_queue_SetPrivateDataInterface(ID3D12CommandQueue *iface,
+        REFGUID guid, const IUnknown *data)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+
+    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
+
+    return vkd3d_set_private_data_interface(&command_queue->private_store, guid, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_queue_SetName(ID3D12CommandQueue *iface, const WCHAR *name)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    VkQueue vk_queue;
+    HRESULT hr;
+
+    TRACE("iface %p, name %s.\n", iface, debugstr_w(name, command_queue->device->wchar_size));
+
+    if (!(vk_queue = vkd3d_queue_acquire(command_queue->vkd3d_queue)))
+    {
+        ERR("Failed to acquire queue %p.\n", command_queue->vkd3d_queue);
+        return E_FAIL;
+    }
+
+    hr = vkd3d_set_vk_object_name(command_queue->device, (uint64_t)(uintptr_t)vk_queue,
+            VK_DEBUG_REPORT_OBJECT_TYPE_QUEUE_EXT, name);
+    vkd3d_queue_release(command_queue->vkd3d_queue);
+    return hr;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_command_queue_GetDevice(ID3D12CommandQueue *iface, REFIID iid, void **device)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+
+    TRACE("iface %p, iid %s, device %p.\n", iface, debugstr_guid(iid), device);
+
+    return d3d12_device_query_interface(command_queue->device, iid, device);
+}
+
+struct vkd3d_sparse_binds
+{
+    VkSparseMemoryBind *opaque_binds;
+    size_t opaque_binds_size;
+    size_t opaque_bind_count;
+
+    VkSparseImageMemoryBind *image_binds;
+    size_t image_binds_size;
+    size_t image_bind_count;
+};
+
+static void vkd3d_sparse_binds_cleanup(struct vkd3d_sparse_binds *binds)
+{
+    vkd3d_free(binds->opaque_binds);
+    vkd3d_free(binds->image_binds);
+}
+
+/* Contiguous opaque binds are merged, so that mapping a range of buffer
+ * tiles to a range of heap tiles results in a single bind. */
+static bool vkd3d_sparse_binds_add(struct vkd3d_sparse_binds *binds, struct d3d12_sparse_tile *tile,
+        VkDeviceMemory vk_memory, VkDeviceSize vk_offset)
+{
+    VkSparseImageMemoryBind *image_bind;
+    VkSparseMemoryBind *opaque_bind;
+
+    if (!vk_memory)
+        vk_offset = 0;
+
+    tile->vk_memory = vk_memory;
+    tile->vk_offset = vk_offset;
+
+    if (tile->opaque)
+    {
+        if (binds->opaque_bind_count)
+        {
+            opaque_bind = &binds->opaque_binds[binds->opaque_bind_count - 1];
+            if (opaque_bind->resourceOffset + opaque_bind->size == tile->u.buffer.offset
+                    && opaque_bind->memory == vk_memory
+                    && (!vk_memory || opaque_bind->memoryOffset + opaque_bind->size == vk_offset))
+            {
+                opaque_bind->size += tile->u.buffer.length;
+                return true;
+            }
+        }
+
+        if (!vkd3d_array_reserve((void **)&binds->opaque_binds, &binds->opaque_binds_size,
+                binds->opaque_bind_count + 1, sizeof(*binds->opaque_binds)))
+            return false;
+
+        opaque_bind = &binds->opaque_binds[binds->opaque_bind_count++];
+        opaque_bind->resourceOffset = tile->u.buffer.offset;
+        opaque_bind->size = tile->u.buffer.length;
+        opaque_bind->memory = vk_memory;
+        opaque_bind->memoryOffset = vk_offset;
+        opaque_bind->flags = 0;
+    }
+    else
+    {
+        if (!vkd3d_array_reserve((void **)&binds->image_binds, &binds->image_binds_size,
+                binds->image_bind_count + 1, sizeof(*binds->image_binds)))
+            return false;
+
+        image_bind = &binds->image_binds[binds->image_bind_count++];
+        image_bind->subresource = tile->u.image.subresource;
+        image_bind->offset = tile->u.image.offset;
+        image_bind->extent = tile->u.image.extent;
+        image_bind->memory = vk_memory;
+        image_bind->memoryOffset = vk_offset;
+        image_bind->flags = 0;
+    }
+
+    return true;
+}
+
+static bool d3d12_command_queue_init_sparse_semaphores(struct d3d12_command_queue *command_queue)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &command_queue->device->vk_procs;
+    VkSemaphoreCreateInfo semaphore_info;
+    VkResult vr;
+
+    if (command_queue->vk_sparse_end_semaphore)
+        return true;
+
+    semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphore_info.pNext = NULL;
+    semaphore_info.flags = 0;
+
+    if (!command_queue->vk_sparse_begin_semaphore && (vr = VK_CALL(vkCreateSemaphore(command_queue->device->vk_device,
+            &semaphore_info, NULL, &command_queue->vk_sparse_begin_semaphore))) < 0)
+    {
+        WARN("Failed to create Vulkan semaphore, vr %d.\n", vr);
+        command_queue->vk_sparse_begin_semaphore = VK_NULL_HANDLE;
+        return false;
+    }
+
+    if ((vr = VK_CALL(vkCreateSemaphore(command_queue->device->vk_device,
+            &semaphore_info, NULL, &command_queue->vk_sparse_end_semaphore))) < 0)
+    {
+        WARN("Failed to create Vulkan semaphore, vr %d.\n", vr);
+        command_queue->vk_sparse_end_semaphore = VK_NULL_HANDLE;
+        return false;
+    }
+
+    return true;
+}
+
+static void d3d12_command_queue_cleanup_sparse_semaphores(struct d3d12_command_queue *command_queue)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &command_queue->device->vk_procs;
+    VkQueue vk_queue;
+
+    if (!command_queue->vk_sparse_begin_semaphore && !command_queue->vk_sparse_end_semaphore)
+        return;
+
+    /* The semaphores may still be used by pending binds. */
+    if ((vk_queue = vkd3d_queue_acquire(command_queue->vkd3d_queue)))
+    {
+        VK_CALL(vkQueueWaitIdle(vk_queue));
+        vkd3d_queue_release(command_queue->vkd3d_queue);
+    }
+
+    VK_CALL(vkDestroySemaphore(command_queue->device->vk_device, command_queue->vk_sparse_begin_semaphore, NULL));
+    VK_CALL(vkDestroySemaphore(command_queue->device->vk_device, command_queue->vk_sparse_end_semaphore, NULL));
+}
+
+/* All binds of a single UpdateTileMappings() or CopyTileMappings() call
+ * are submitted in one vkQueueBindSparse() call. */
+static void d3d12_command_queue_bind_sparse(struct d3d12_command_queue *command_queue,
+        struct d3d12_resource *resource, const struct vkd3d_sparse_binds *binds)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &command_queue->device->vk_procs;
+    VkSparseImageOpaqueMemoryBindInfo opaque_info;
+    VkSparseBufferMemoryBindInfo buffer_info;
+    VkSparseImageMemoryBindInfo image_info;
+    VkPipelineStageFlags wait_stage_mask;
+    VkBindSparseInfo bind_info;
+    VkSubmitInfo submit_info;
+    VkQueue vk_queue;
+    VkResult vr;
+
+    if (!binds->opaque_bind_count && !binds->image_bind_count)
+        return;
+
+    if (!(command_queue->vkd3d_queue->vk_queue_flags & VK_QUEUE_SPARSE_BINDING_BIT))
+    {
+        FIXME("Queue %p does not support sparse binding.\n", command_queue);
+        return;
+    }
+
+    memset(&bind_info, 0, sizeof(bind_info));
+    bind_info.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    bind_info.waitSemaphoreCount = 1;
+    bind_info.pWaitSemaphores = &command_queue->vk_sparse_begin_semaphore;
+    bind_info.signalSemaphoreCount = 1;
+    bind_info.pSignalSemaphores = &command_queue->vk_sparse_end_semaphore;
+
+    if (d3d12_resource_is_buffer(resource))
+    {
+        buffer_info.buffer = resource->u.vk_buffer;
+        buffer_info.bindCount = binds->opaque_bind_count;
+        buffer_info.pBinds = binds->opaque_binds;
+        bind_info.bufferBindCount = 1;
+        bind_info.pBufferBinds = &buffer_info;
+    }
+    else
+    {
+        if (binds->opaque_bind_count)
+        {
+            opaque_info.image = resource->u.vk_image;
+            opaque_info.bindCount = binds->opaque_bind_count;
+            opaque_info.pBinds = binds->opaque_binds;
+            bind_info.imageOpaqueBindCount = 1;
+            bind_info.pImageOpaqueBinds = &opaque_info;
+        }
+        if (binds->image_bind_count)
+        {
+            image_info.image = resource->u.vk_image;
+            image_info.bindCount = binds->image_bind_count;
+            image_info.pBinds = binds->image_binds;
+            bind_info.imageBindCount = 1;
+            bind_info.pImageBinds = &image_info;
+        }
+    }
+
+    if (!(vk_queue = vkd3d_queue_acquire(command_queue->vkd3d_queue)))
+    {
+        ERR("Failed to acquire queue %p.\n", command_queue->vkd3d_queue);
+        return;
+    }
+
+    if (!d3d12_command_queue_init_sparse_semaphores(command_queue))
+        goto done;
+
+    /* An empty batch orders the binds after all previously submitted work,
+     * and consumes the end semaphore of previous binds. */
+    wait_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = NULL;
+    submit_info.waitSemaphoreCount = command_queue->sparse_end_pending ? 1 : 0;
+    submit_info.pWaitSemaphores = &command_queue->vk_sparse_end_semaphore;
+    submit_info.pWaitDstStageMask = &wait_stage_mask;
+    submit_info.commandBufferCount = 0;
+    submit_info.pCommandBuffers = NULL;
+    submit_info.signalSemaphoreCount = 1;
+    submit_info.pSignalSemaphores = &command_queue->vk_sparse_begin_semaphore;
+
+    if ((vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_info, VK_NULL_HANDLE))) < 0)
+    {
+        ERR("Failed to submit, vr %d.\n", vr);
+        goto done;
+    }
+    command_queue->sparse_end_pending = false;
+
+    if ((vr = VK_CALL(vkQueueBindSparse(vk_queue, 1, &bind_info, VK_NULL_HANDLE))) < 0)
+    {
+        ERR("Failed to bind sparse memory, vr %d.\n", vr);
+        goto done;
+    }
+    command_queue->sparse_end_pending = true;
+
+done:
+    vkd3d_queue_release(command_queue->vkd3d_queue);
+}
+
+static unsigned int vkd3d_tile_region_get_tile_count(const D3D12_TILE_REGION_SIZE *size)
+{
+    return size->UseBox ? size->Width * size->Height * size->Depth : size->NumTiles;
+}
+
+static bool vkd3d_tile_region_get_tile_index(const struct d3d12_resource *resource,
+        const D3D12_TILED_RESOURCE_COORDINATE *start, const D3D12_TILE_REGION_SIZE *size,
+        unsigned int idx, uint32_t *tile_index)
+{
+    D3D12_TILED_RESOURCE_COORDINATE coordinate;
+    uint32_t start_index;
+
+    if (!size->UseBox)
+    {
+        if (!d3d12_resource_get_tile_index(resource, start, &start_index)
+                || idx >= resource->sparse.tile_count - start_index)
+            return false;
+
+        *tile_index = start_index + idx;
+        return true;
+    }
+
+    coordinate.X = start->X + idx % size->Width;
+    coordinate.Y = start->Y + (idx / size->Width) % size->Height;
+    coordinate.Z = start->Z + idx / (size->Width * size->Height);
+    coordinate.Subresource = start->Subresource;
+
+    return d3d12_resource_get_tile_index(resource, &coordinate, tile_index);
+}
+
+
+/* The first submission after a bind waits for it, so that subsequent work
+ * observes the new tile mappings. Must be called with the queue acquired. */
+static void d3d12_command_queue_wait_sparse_binds_locked(struct d3d12_command_queue *command_queue,
+        VkSubmitInfo *submit_info, const VkPipelineStageFlags *wait_stage_mask)
+{
+    if (!command_queue->sparse_end_pending)
+        return;
+
+    submit_info->waitSemaphoreCount = 1;
+    submit_info->pWaitSemaphores = &command_queue->vk_sparse_end_semaphore;
+    submit_info->pWaitDstStageMask = wait_stage_mask;
+}
+
+static void STDMETHODCALLTYPE d3d12_command_queue_UpdateTileMappings(ID3D12CommandQueue *iface,
+        ID3D12Resource *resource, UINT region_count,
+        const D3D12_TILED_RESOURCE_COORDINATE *region_start_coordinates,
+        const D3D12_TILE_REGION_SIZE *region_sizes,
+        ID3D12Heap *heap,
+        UINT range_count,
+        const D3D12_TILE_RANGE_FLAGS *range_flags,
+        const UINT *heap_range_offsets,
+        const UINT *range_tile_counts,
+        D3D12_TILE_MAPPING_FLAGS flags)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    static const D3D12_TILED_RESOURCE_COORDINATE default_coordinate;
+    unsigned int region_idx, region_tile_idx, range_idx, range_tile_idx, range_tile_count;
+    static const D3D12_TILE_REGION_SIZE single_tile = {1};
+    const D3D12_TILED_RESOURCE_COORDINATE *region_start;
+    const D3D12_TILE_REGION_SIZE *region_size = NULL;
+    struct d3d12_resource *resource_impl;
+    struct d3d12_heap *heap_impl = NULL;
+    D3D12_TILE_REGION_SIZE whole_resource;
+    struct vkd3d_sparse_binds binds;
+    D3D12_TILE_RANGE_FLAGS range_flag;
+    VkDeviceMemory vk_memory;
+    VkDeviceSize vk_offset;
+    uint32_t tile_index;
+
+    TRACE("iface %p, resource %p, region_count %u, region_start_coordinates %p, "
+            "region_sizes %p, heap %p, range_count %u, range_flags %p, heap_range_offsets %p, "
+            "range_tile_counts %p, flags %#x.\n",
+            iface, resource, region_count, region_start_coordinates, region_sizes, heap, range_count,
+            range_flags, heap_range_offsets, range_tile_counts, flags);
+
+    if (flags)
+        FIXME("Ignoring flags %#x.\n", flags);
+
+    resource_impl = unsafe_impl_from_ID3D12Resource(resource);
+    if (!(resource_impl->flags & VKD3D_RESOURCE_SPARSE))
+    {
+        WARN("Resource %p is not a reserved resource.\n", resource);
+        return;
+    }
+
+    if (heap)
+    {
+        heap_impl = unsafe_impl_from_ID3D12Heap(heap);
+        if (!(resource_impl->sparse.vk_memory_type_bits & (1u << heap_impl->vk_memory_type)))
+        {
+            FIXME("Memory type %u cannot be bound to resource %p (allowed types %#x).\n",
+                    heap_impl->vk_memory_type, resource_impl, resource_impl->sparse.vk_memory_type_bits);
+            return;
+        }
+    }
+
+    memset(&whole_resource, 0, sizeof(whole_resource));
+    whole_resource.NumTiles = resource_impl->sparse.tile_count;
+
+    memset(&binds, 0, sizeof(binds));
+    region_idx = 0;
+    region_tile_idx = 0;
+    region_start = NULL;
+
+    /* Tiles of all regions form a single sequence, which is consumed by
+     * the ranges in order. */
+    for (range_idx = 0; range_idx < range_count; ++range_idx)
+    {
+        range_flag = range_flags ? range_flags[range_idx] : D3D12_TILE_RANGE_FLAG_NONE;
+        range_tile_count = range_tile_counts ? range_tile_counts[range_idx] : ~0u;
+
+        for (range_tile_idx = 0; range_tile_idx < range_tile_count; ++range_tile_idx, ++region_tile_idx)
+        {
+            while (!region_size || region_tile_idx >= vkd3d_tile_region_get_tile_count(region_size))
+            {
+                if (region_size && ++region_idx >= region_count)
+                    goto submit;
+                if (!region_count)
+                    goto submit;
+
+                region_start = region_start_coordinates
+                        ? &region_start_coordinates[region_idx] : &default_coordinate;
+                if (region_sizes)
+                    region_size = &region_sizes[region_idx];
+                else
+                    region_size = region_start_coordinates ? &single_tile : &whole_resource;
+                region_tile_idx = 0;
+            }
+
+            if (!vkd3d_tile_region_get_tile_index(resource_impl, region_start, region_size,
+                    region_tile_idx, &tile_index))
+            {
+                WARN("Invalid tile region %u.\n", region_idx);
+                goto submit;
+            }
+
+            if (range_flag & D3D12_TILE_RANGE_FLAG_SKIP)
+                continue;
+
+            if (range_flag & D3D12_TILE_RANGE_FLAG_NULL)
+            {
+                vk_memory = VK_NULL_HANDLE;
+                vk_offset = 0;
+            }
+            else
+            {
+                if (!heap_impl || !heap_range_offsets)
+                {
+                    WARN("No heap range specified for range %u.\n", range_idx);
+                    goto submit;
+                }
+
+                vk_offset = heap_range_offsets[range_idx];
+                if (!(range_flag & D3D12_TILE_RANGE_FLAG_REUSE_SINGLE_TILE))
+                    vk_offset += range_tile_idx;
+                vk_offset *= D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+
+                if (vk_offset + D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES > heap_impl->desc.SizeInBytes)
+                {
+                    WARN("Heap offset %#"PRIx64" is out of range.\n", vk_offset);
+                    goto submit;
+                }
+
+                vk_memory = heap_impl->vk_memory;
+            }
+
+            if (!vkd3d_sparse_binds_add(&binds, &resource_impl->sparse.tiles[tile_index], vk_memory, vk_offset))
+            {
+                ERR("Failed to add sparse bind.\n");
+                goto submit;
+            }
+        }
+    }
+
+submit:
+    d3d12_command_queue_bind_sparse(command_queue, resource_impl, &binds);
+    vkd3d_sparse_binds_cleanup(&binds);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_queue_CopyTileMappings(ID3D12CommandQueue *iface,
+        ID3D12Resource *dst_resource,
+        const D3D12_TILED_RESOURCE_COORDINATE *dst_region_start_coordinate,
+        ID3D12Resource *src_resource,
+        const D3D12_TILED_RESOURCE_COORDINATE *src_region_start_coordinate,
+        const D3D12_TILE_REGION_SIZE *region_size,
+        D3D12_TILE_MAPPING_FLAGS flags)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    struct d3d12_resource *dst_resource_impl, *src_resource_impl;
+    unsigned int tile_count, i;
+    struct vkd3d_sparse_binds binds;
+    struct d3d12_sparse_tile *tiles;
+    uint32_t tile_index;
+
+    TRACE("iface %p, dst_resource %p, dst_region_start_coordinate %p, "
+            "src_resource %p, src_region_start_coordinate %p, region_size %p, flags %#x.\n",
+            iface, dst_resource, dst_region_start_coordinate, src_resource,
+            src_region_start_coordinate, region_size, flags);
+
+    if (flags)
+        FIXME("Ignoring flags %#x.\n", flags);
+
+    dst_resource_impl = unsafe_impl_from_ID3D12Resource(dst_resource);
+    src_resource_impl = unsafe_impl_from_ID3D12Resource(src_resource);
+    if (!(dst_resource_impl->flags & VKD3D_RESOURCE_SPARSE) || !(src_resource_impl->flags & VKD3D_RESOURCE_SPARSE))
+    {
+        WARN("Resources %p and %p must be reserved resources.\n", dst_resource, src_resource);
+        return;
+    }
+
+    tile_count = vkd3d_tile_region_get_tile_count(region_size);
+
+    /* The source and destination regions may overlap, so the source
+     * mappings are captured before any of them is changed. */
+    if (!(tiles = vkd3d_calloc(tile_count, sizeof(*tiles))))
+    {
+        ERR("Failed to allocate tile array.\n");
+        return;
+    }
+
+    for (i = 0; i < tile_count; ++i)
+    {
+        if (!vkd3d_tile_region_get_tile_index(src_resource_impl, src_region_start_coordinate,
+                region_size, i, &tile_index))
+        {
+            WARN("Invalid source tile region.\n");
+            tile_count = i;
+            break;
+        }
+        tiles[i] = src_resource_impl->sparse.tiles[tile_index];
+    }
+
+    memset(&binds, 0, sizeof(binds));
+    for (i = 0; i < tile_count; ++i)
+    {
+        if (!vkd3d_tile_region_get_tile_index(dst_resource_impl, dst_region_start_coordinate,
+                region_size, i, &tile_index))
+        {
+            WARN("Invalid destination tile region.\n");
+            break;
+        }
+
+        if (!vkd3d_sparse_binds_add(&binds, &dst_resource_impl->sparse.tiles[tile_index],
+                tiles[i].vk_memory, tiles[i].vk_offset))
+        {
+            ERR("Failed to add sparse bind.\n");
+            break;
+        }
+    }
+
+    d3d12_command_queue_bind_sparse(command_queue, dst_resource_impl, &binds);
+    vkd3d_sparse_binds_cleanup(&binds);
+    vkd3d_free(tiles);
+}
+
+/* Called with the Vulkan queue acquired, after command lists using the ring
+ * are submitted. An empty batch signals a fence once they are complete, and
+ * their regions are tagged with its serial. */
+static void vkd3d_staging_ring_add_submission(struct vkd3d_staging_ring *ring, struct d3d12_device *device,
+        VkQueue vk_queue, ID3D12CommandList * const *command_lists, unsigned int command_list_count)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_staging_submission *submission;
+    struct d3d12_command_list *list;
+    VkFenceCreateInfo fence_info;
+    VkSubmitInfo submit_info;
+    unsigned int i;
+    uint64_t serial;
+    VkFence vk_fence;
+    VkResult vr;
+    size_t j;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&ring->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    if (ring->free_fence_count)
+    {
+        vk_fence = ring->free_fences[--ring->free_fence_count];
+    }
+    else
+    {
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fence_info.pNext = NULL;
+        fence_info.flags = 0;
+        if ((vr = VK_CALL(vkCreateFence(device->vk_device, &fence_info, NULL, &vk_fence))) < 0)
+        {
+            WARN("Failed to create fence, vr %d.\n", vr);
+            vk_fence = VK_NULL_HANDLE;
+        }
+    }
+
+    if (vk_fence && !vkd3d_array_reserve((void **)&ring->submissions, &ring->submissions_size,
+            ring->submission_count + 1, sizeof(*ring->submissions)))
+    {
+        VK_CALL(vkDestroyFence(device->vk_device, vk_fence, NULL));
+        vk_fence = VK_NULL_HANDLE;
+    }
+
+    serial = ring->next_serial++;
+
+    if (vk_fence)
+    {
+        memset(&submit_info, 0, sizeof(submit_info));
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        if ((vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_info, vk_fence))) < 0)
+        {
+            WARN("Failed to submit fence, vr %d.\n", vr);
+            VK_CALL(vkDestroyFence(device->vk_device, vk_fence, NULL));
+            vk_fence = VK_NULL_HANDLE;
+        }
+    }
+
+    if (vk_fence)
+    {
+        submission = &ring->submissions[ring->submission_count++];
+        submission->vk_fence = vk_fence;
+        submission->serial = serial;
+    }
+    else
+    {
+        /* Without a fence, wait for the submitted command lists instead. */
+        VK_CALL(vkQueueWaitIdle(vk_queue));
+    }
+
+    for (i = 0; i < command_list_count; ++i)
+    {
+        list = unsafe_impl_from_ID3D12CommandList(command_lists[i]);
+        for (j = 0; j < list->staging_region_count; ++j)
+            vkd3d_staging_ring_get_region_locked(ring, list->staging_regions[j])->serial = serial;
+    }
+
+    pthread_mutex_unlock(&ring->mutex);
+}
+
+static void STDMETHODCALLTYPE d3d12_command_queue_ExecuteCommandLists(ID3D12CommandQueue *iface,
+        UINT command_list_count, ID3D12CommandList * const *command_lists)
+{
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    const struct vkd3d_vk_device_procs *vk_procs;
+    VkFence vk_fence = VK_NULL_HANDLE;
+    VkPipelineStageFlags wait_stage_mask;
+    struct d3d12_command_list *cmd_list;
+    bool uses_staging_ring = false;
+    struct VkSubmitInfo submit_desc;
+    bool profiled = false;
+    VkCommandBuffer *buffers;
+    VkQueue vk_queue;
+    unsigned int i;
+    VkResult vr;
+    HRESULT hr;
+
+    TRACE("iface %p, command_list_count %u, command_lists %p.\n",
+            iface, command_list_count, command_lists);
+
+    vk_procs = &command_queue->device->vk_procs;
+
+    /* The first and the last entry are reserved for profiling timestamps. */
+    if (!(buffers = vkd3d_calloc(command_list_count + 2, sizeof(*buffers))))
+    {
+        ERR("Failed to allocate command buffer array.\n");
+        return;
+    }
+
+    for (i = 0; i < command_list_count; ++i)
+    {
+        cmd_list = unsafe_impl_from_ID3D12CommandList(command_lists[i]);
+
+        if (cmd_list->is_recording)
+        {
+            d3d12_device_mark_as_removed(command_queue->device, DXGI_ERROR_INVALID_CALL,
+                    "Command list %p is in recording state.\n", command_lists[i]);
+            vkd3d_free(buffers);
+            return;
+        }
+
+        buffers[i + 1] = cmd_list->vk_command_buffer;
+        if (cmd_list->staging_region_count)
+            uses_staging_ring = true;
+    }
+
+    submit_desc.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_desc.pNext = NULL;
+    submit_desc.waitSemaphoreCount = 0;
+    submit_desc.pWaitSemaphores = NULL;
+    submit_desc.pWaitDstStageMask = NULL;
+    submit_desc.commandBufferCount = command_list_count;
+    submit_desc.pCommandBuffers = &buffers[1];
+    submit_desc.signalSemaphoreCount = 0;
+    submit_desc.pSignalSemaphores = NULL;
+
+    if (!(vk_queue = vkd3d_queue_acquire(command_queue->vkd3d_queue)))
+    {
+        ERR("Failed to acquire queue %p.\n", command_queue->vkd3d_queue);
+        vkd3d_free(buffers);
+        return;
+    }
+
+    if (command_queue->profiler)
+    {
+        /* Waiting for a slot must not block other submissions to the Vulkan queue. */
+        while ((hr = vkd3d_queue_profiler_begin_batch(command_queue->profiler, command_queue->device,
+                command_list_count, &buffers[0], &buffers[command_list_count + 1], &vk_fence)) == S_FALSE)
+        {
+            vkd3d_queue_release(command_queue->vkd3d_queue);
+            vkd3d_queue_profiler_wait_for_slot(command_queue->profiler, command_queue->device);
+            if (!(vk_queue = vkd3d_queue_acquire(command_queue->vkd3d_queue)))
+            {
+                ERR("Failed to acquire queue %p.\n", command_queue->vkd3d_queue);
+                vkd3d_free(buffers);
+                return;
+            }
+        }
+
+        if ((profiled = hr == S_OK))
+        {
+            submit_desc.commandBufferCount = command_list_count + 2;
+            submit_desc.pCommandBuffers = buffers;
+        }
+    }
+
+    wait_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    d3d12_command_queue_wait_sparse_binds_locked(command_queue, &submit_desc, &wait_stage_mask);
+
+    if ((vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_desc, vk_fence))) < 0)
+    {
+        ERR("Failed to submit queue(s), vr %d.\n", vr);
+        if (profiled)
+            vkd3d_queue_profiler_abort_batch(command_queue->profiler);
+    }
+    else
+    {
+        if (submit_desc.waitSemaphoreCount)
+            command_queue->sparse_end_pending = false;
+        if (uses_staging_ring)
+            vkd3d_staging_ring_add_submission(&command_queue->device->staging_ring, command_queue->device,
+                    vk_queue, command_lists, command_list_count);
+    }
+
+    vkd3d_queue_release(command_queue->vkd3d_queue);
+
+    vkd3d_free(buffers);
 }
 
 static void STDMETHODCALLTYPE d3d12_command_queue_SetMarker(ID3D12CommandQueue *iface,
@@ -5699,6 +8163,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_queue_Signal(ID3D12CommandQueue *
     const struct vkd3d_vk_device_procs *vk_procs;
     VkSemaphore vk_semaphore = VK_NULL_HANDLE;
     VkFence vk_fence = VK_NULL_HANDLE;
+    VkPipelineStageFlags wait_stage_mask;
     struct vkd3d_queue *vkd3d_queue;
     struct d3d12_device *device;
     struct d3d12_fence *fence;
@@ -5745,8 +8210,14 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_queue_Signal(ID3D12CommandQueue *
     submit_info.signalSemaphoreCount = vk_semaphore ? 1 : 0;
     submit_info.pSignalSemaphores = &vk_semaphore;
 
+    wait_stage_mask = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    d3d12_command_queue_wait_sparse_binds_locked(command_queue, &submit_info, &wait_stage_mask);
+
     if ((vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_info, vk_fence))) >= 0)
     {
+        if (submit_info.waitSemaphoreCount)
+            command_queue->sparse_end_pending = false;
+
         sequence_number = ++vkd3d_queue->submitted_sequence_number;
 
         /* We don't expect to overrun the 64-bit counter, but we handle it gracefully anyway. */
@@ -5922,10 +8393,31 @@ static HRESULT STDMETHODCALLTYPE d3d12_command_queue_GetTimestampFrequency(ID3D1
 static HRESULT STDMETHODCALLTYPE d3d12_command_queue_GetClockCalibration(ID3D12CommandQueue *iface,
         UINT64 *gpu_timestamp, UINT64 *cpu_timestamp)
 {
-    FIXME("iface %p, gpu_timestamp %p, cpu_timestamp %p stub!\n",
+    struct d3d12_command_queue *command_queue = impl_from_ID3D12CommandQueue(iface);
+    uint64_t gpu_time, cpu_time;
+    HRESULT hr;
+
+    TRACE("iface %p, gpu_timestamp %p, cpu_timestamp %p.\n",
             iface, gpu_timestamp, cpu_timestamp);
 
-    return E_NOTIMPL;
+    if (!command_queue->vkd3d_queue->timestamp_bits)
+    {
+        WARN("Timestamp queries not supported.\n");
+        return E_FAIL;
+    }
+
+    /* The CPU timestamp is CLOCK_MONOTONIC in nanoseconds. */
+    if (FAILED(hr = vkd3d_get_calibrated_timestamps(command_queue->device, &gpu_time, &cpu_time)))
+    {
+        if (hr == E_NOTIMPL)
+            FIXME("Clock calibration requires VK_EXT_calibrated_timestamps.\n");
+        return hr;
+    }
+
+    *gpu_timestamp = gpu_time;
+    *cpu_timestamp = cpu_time;
+
+    return S_OK;
 }
 
 static D3D12_COMMAND_QUEUE_DESC * STDMETHODCALLTYPE d3d12_command_queue_GetDesc(ID3D12CommandQueue *iface,
@@ -5984,6 +8476,10 @@ static HRESULT d3d12_command_queue_init(struct d3d12_command_queue *queue,
     queue->last_waited_fence = NULL;
     queue->last_waited_fence_value = 0;
 
+    queue->vk_sparse_begin_semaphore = VK_NULL_HANDLE;
+    queue->vk_sparse_end_semaphore = VK_NULL_HANDLE;
+    queue->sparse_end_pending = false;
+
     if (desc->Priority == D3D12_COMMAND_QUEUE_PRIORITY_GLOBAL_REALTIME)
     {
         FIXME("Global realtime priority is not implemented.\n");
@@ -5995,8 +8491,29 @@ static HRESULT d3d12_command_queue_init(struct d3d12_command_queue *queue,
     if (desc->Flags)
         FIXME("Ignoring flags %#x.\n", desc->Flags);
 
+    queue->profiler = NULL;
+    if (device->vkd3d_instance->config_flags & VKD3D_CONFIG_FLAG_QUEUE_PROFILING)
+    {
+        if (!queue->vkd3d_queue->timestamp_bits)
+            WARN("Timestamp queries not supported, not profiling queue.\n");
+        else if (FAILED(hr = vkd3d_queue_profiler_create(device, queue->vkd3d_queue, desc->Type, &queue->profiler)))
+            WARN("Failed to create queue profiler, hr %#x.\n", hr);
+    }
+
+    if (FAILED(hr = vkd3d_upload_ring_init(&queue->upload_ring)))
+    {
+        if (queue->profiler)
+            vkd3d_queue_profiler_destroy(queue->profiler, device);
+        return hr;
+    }
+
     if (FAILED(hr = vkd3d_private_store_init(&queue->private_store)))
+    {
+        vkd3d_upload_ring_cleanup(&queue->upload_ring);
+        if (queue->profiler)
+            vkd3d_queue_profiler_destroy(queue->profiler, device);
         return hr;
+    }
 
     d3d12_device_add_ref(queue->device = device);
 
@@ -6046,6 +8563,24 @@ void vkd3d_release_vk_queue(ID3D12CommandQueue *queue)
     return vkd3d_queue_release(d3d12_queue->vkd3d_queue);
 }
 
+unsigned int vkd3d_drain_queue_timestamps(ID3D12CommandQueue *queue,
+        struct vkd3d_queue_timestamp *timestamps, unsigned int count)
+{
+    struct d3d12_command_queue *d3d12_queue = impl_from_ID3D12CommandQueue(queue);
+
+    TRACE("queue %p, timestamps %p, count %u.\n", queue, timestamps, count);
+
+    if (!d3d12_queue->profiler)
+        return 0;
+
+    return vkd3d_queue_profiler_drain(d3d12_queue->profiler, d3d12_queue->device, timestamps, count);
+}
+
+HRESULT vkd3d_wait_for_fence_value(ID3D12Fence *fence, uint64_t value, uint64_t timeout_ns)
+{
+    return d3d12_fence_wait_for_value(unsafe_impl_from_ID3D12Fence(fence), value, timeout_ns);
+}
+
 /* ID3D12CommandSignature */
 static inline struct d3d12_command_signature *impl_from_ID3D12CommandSignature(ID3D12CommandSignature *iface)
 {
@@ -18,6 +18,8 @@
 
 #include "vkd3d_private.h"
 
+#include <sched.h>
+
 #ifdef HAVE_DLFCN_H
 #include <dlfcn.h>
 
@@ -128,10 +130,14 @@ static const struct vkd3d_optional_extension_info optional_device_extensions[] =
     VK_EXTENSION(KHR_MAINTENANCE3, KHR_maintenance3),
     VK_EXTENSION(KHR_PUSH_DESCRIPTOR, KHR_push_descriptor),
     /* EXT extensions */
+    VK_EXTENSION(EXT_CALIBRATED_TIMESTAMPS, EXT_calibrated_timestamps),
     VK_EXTENSION(EXT_CONDITIONAL_RENDERING, EXT_conditional_rendering),
     VK_EXTENSION(EXT_DEBUG_MARKER, EXT_debug_marker),
     VK_EXTENSION(EXT_DEPTH_CLIP_ENABLE, EXT_depth_clip_enable),
     VK_EXTENSION(EXT_DESCRIPTOR_INDEXING, EXT_descriptor_indexing),
+    VK_EXTENSION(EXT_MEMORY_BUDGET, EXT_memory_budget),
+    VK_EXTENSION(EXT_MEMORY_PRIORITY, EXT_memory_priority),
+    VK_EXTENSION(EXT_PAGEABLE_DEVICE_LOCAL_MEMORY, EXT_pageable_device_local_memory),
     VK_EXTENSION(EXT_SHADER_DEMOTE_TO_HELPER_INVOCATION, EXT_shader_demote_to_helper_invocation),
     VK_EXTENSION(EXT_TEXEL_BUFFER_ALIGNMENT, EXT_texel_buffer_alignment),
     VK_EXTENSION(EXT_TRANSFORM_FEEDBACK, EXT_transform_feedback),
@@ -428,6 +434,7 @@ static void vkd3d_init_debug_report(struct vkd3d_instance *instance)
 static const struct vkd3d_debug_option vkd3d_config_options[] =
 {
     {"vk_debug", VKD3D_CONFIG_FLAG_VULKAN_DEBUG}, /* enable Vulkan debug extensions */
+    {"queue_profiling", VKD3D_CONFIG_FLAG_QUEUE_PROFILING}, /* record GPU timestamps for submissions */
 };
 
 static uint64_t vkd3d_init_config_flags(void)
@@ -672,6 +679,8 @@ struct vkd3d_physical_device_info
     VkPhysicalDeviceDepthClipEnableFeaturesEXT depth_clip_features;
     VkPhysicalDeviceDescriptorIndexingFeaturesEXT descriptor_indexing_features;
     VkPhysicalDeviceShaderDemoteToHelperInvocationFeaturesEXT demote_features;
+    VkPhysicalDeviceMemoryPriorityFeaturesEXT memory_priority_features;
+    VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT pageable_features;
     VkPhysicalDeviceTexelBufferAlignmentFeaturesEXT texel_buffer_alignment_features;
     VkPhysicalDeviceTransformFeedbackFeaturesEXT xfb_features;
     VkPhysicalDeviceVertexAttributeDivisorFeaturesEXT vertex_divisor_features;
@@ -690,6 +699,8 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
     VkPhysicalDeviceVertexAttributeDivisorFeaturesEXT *vertex_divisor_features;
     VkPhysicalDeviceTexelBufferAlignmentFeaturesEXT *buffer_alignment_features;
     VkPhysicalDeviceShaderDemoteToHelperInvocationFeaturesEXT *demote_features;
+    VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT *pageable_features;
+    VkPhysicalDeviceMemoryPriorityFeaturesEXT *memory_priority_features;
     VkPhysicalDeviceDepthClipEnableFeaturesEXT *depth_clip_features;
     VkPhysicalDeviceMaintenance3Properties *maintenance3_properties;
     VkPhysicalDeviceTransformFeedbackPropertiesEXT *xfb_properties;
@@ -704,6 +715,8 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
     descriptor_indexing_properties = &info->descriptor_indexing_properties;
     maintenance3_properties = &info->maintenance3_properties;
     demote_features = &info->demote_features;
+    memory_priority_features = &info->memory_priority_features;
+    pageable_features = &info->pageable_features;
     buffer_alignment_features = &info->texel_buffer_alignment_features;
     buffer_alignment_properties = &info->texel_buffer_alignment_properties;
     vertex_divisor_features = &info->vertex_divisor_features;
@@ -721,6 +734,10 @@ static void vkd3d_physical_device_info_init(struct vkd3d_physical_device_info *i
     vk_prepend_struct(&info->features2, descriptor_indexing_features);
     demote_features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_DEMOTE_TO_HELPER_INVOCATION_FEATURES_EXT;
     vk_prepend_struct(&info->features2, demote_features);
+    memory_priority_features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PRIORITY_FEATURES_EXT;
+    vk_prepend_struct(&info->features2, memory_priority_features);
+    pageable_features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PAGEABLE_DEVICE_LOCAL_MEMORY_FEATURES_EXT;
+    vk_prepend_struct(&info->features2, pageable_features);
     buffer_alignment_features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TEXEL_BUFFER_ALIGNMENT_FEATURES_EXT;
     vk_prepend_struct(&info->features2, buffer_alignment_features);
     xfb_features->sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TRANSFORM_FEEDBACK_FEATURES_EXT;
@@ -1027,8 +1044,10 @@ static void vkd3d_trace_physical_device_features(const struct vkd3d_physical_dev
 {
     const VkPhysicalDeviceConditionalRenderingFeaturesEXT *conditional_rendering_features;
     const VkPhysicalDeviceShaderDemoteToHelperInvocationFeaturesEXT *demote_features;
+    const VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT *pageable_features;
     const VkPhysicalDeviceTexelBufferAlignmentFeaturesEXT *buffer_alignment_features;
     const VkPhysicalDeviceVertexAttributeDivisorFeaturesEXT *divisor_features;
+    const VkPhysicalDeviceMemoryPriorityFeaturesEXT *memory_priority_features;
     const VkPhysicalDeviceDescriptorIndexingFeaturesEXT *descriptor_indexing;
     const VkPhysicalDeviceDepthClipEnableFeaturesEXT *depth_clip_features;
     const VkPhysicalDeviceFeatures *features = &info->features2.features;
@@ -1150,6 +1169,14 @@ static void vkd3d_trace_physical_device_features(const struct vkd3d_physical_dev
     TRACE("  VkPhysicalDeviceShaderDemoteToHelperInvocationFeaturesEXT:\n");
     TRACE("    shaderDemoteToHelperInvocation: %#x.\n", demote_features->shaderDemoteToHelperInvocation);
 
+    memory_priority_features = &info->memory_priority_features;
+    TRACE("  VkPhysicalDeviceMemoryPriorityFeaturesEXT:\n");
+    TRACE("    memoryPriority: %#x.\n", memory_priority_features->memoryPriority);
+
+    pageable_features = &info->pageable_features;
+    TRACE("  VkPhysicalDevicePageableDeviceLocalMemoryFeaturesEXT:\n");
+    TRACE("    pageableDeviceLocalMemory: %#x.\n", pageable_features->pageableDeviceLocalMemory);
+
     buffer_alignment_features = &info->texel_buffer_alignment_features;
     TRACE("  VkPhysicalDeviceTexelBufferAlignmentFeaturesEXT:\n");
     TRACE("    texelBufferAlignment: %#x.\n", buffer_alignment_features->texelBufferAlignment);
@@ -1258,9 +1285,88 @@ static void vkd3d_init_feature_level(struct vkd3d_vulkan_info *vk_info,
     TRACE("Max feature level: %#x.\n", vk_info->max_feature_level);
 }
 
+static bool vkd3d_supports_calibrated_timestamps(struct d3d12_device *device)
+{
+    const struct vkd3d_vk_instance_procs *vk_procs = &device->vkd3d_instance->vk_procs;
+    bool device_domain = false, monotonic_domain = false;
+    VkPhysicalDevice physical_device = device->vk_physical_device;
+    VkTimeDomainEXT *time_domains;
+    uint32_t count, i;
+    VkResult vr;
+
+    if (!vk_procs->vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)
+        return false;
+
+    if ((vr = VK_CALL(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physical_device, &count, NULL))) < 0)
+    {
+        WARN("Failed to get calibrateable time domains, vr %d.\n", vr);
+        return false;
+    }
+
+    if (!(time_domains = vkd3d_calloc(count, sizeof(*time_domains))))
+        return false;
+
+    if ((vr = VK_CALL(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT(physical_device, &count, time_domains))) < 0)
+    {
+        WARN("Failed to get calibrateable time domains, vr %d.\n", vr);
+        vkd3d_free(time_domains);
+        return false;
+    }
+
+    for (i = 0; i < count; ++i)
+    {
+        if (time_domains[i] == VK_TIME_DOMAIN_DEVICE_EXT)
+            device_domain = true;
+        else if (time_domains[i] == VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT)
+            monotonic_domain = true;
+    }
+
+    vkd3d_free(time_domains);
+
+    if (!device_domain || !monotonic_domain)
+        WARN("Device or CLOCK_MONOTONIC time domain is not calibrateable.\n");
+
+    return device_domain && monotonic_domain;
+}
+
+enum vkd3d_queue_family
+{
+    VKD3D_QUEUE_FAMILY_DIRECT,
+    VKD3D_QUEUE_FAMILY_COMPUTE,
+    VKD3D_QUEUE_FAMILY_TRANSFER,
+
+    VKD3D_QUEUE_FAMILY_COUNT,
+};
+
+struct vkd3d_device_queue_info
+{
+    unsigned int family_index[VKD3D_QUEUE_FAMILY_COUNT];
+    VkQueueFamilyProperties vk_properties[VKD3D_QUEUE_FAMILY_COUNT];
+
+    unsigned int vk_family_count;
+    VkDeviceQueueCreateInfo vk_queue_create_info[VKD3D_QUEUE_FAMILY_COUNT];
+};
+
+static bool vkd3d_queue_families_support_sparse_binding(const struct vkd3d_device_queue_info *queue_info)
+{
+    unsigned int i;
+
+    for (i = 0; i < VKD3D_QUEUE_FAMILY_COUNT; ++i)
+    {
+        if (!(queue_info->vk_properties[i].queueFlags & VK_QUEUE_SPARSE_BINDING_BIT))
+        {
+            WARN("Queue family %u does not support sparse binding.\n", queue_info->family_index[i]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
 static HRESULT vkd3d_init_device_caps(struct d3d12_device *device,
         const struct vkd3d_device_create_info *create_info,
         struct vkd3d_physical_device_info *physical_device_info,
+        const struct vkd3d_device_queue_info *queue_info,
         uint32_t *device_extension_count, bool **user_extension_supported)
 {
     const struct vkd3d_vk_instance_procs *vk_procs = &device->vkd3d_instance->vk_procs;
@@ -1299,22 +1405,19 @@ static HRESULT vkd3d_init_device_caps(struct d3d12_device *device,
     /* SPV_KHR_16bit_storage */
     device->feature_options.MinPrecisionSupport = D3D12_SHADER_MIN_PRECISION_SUPPORT_NONE;
 
-    if (!features->sparseBinding)
+    /* Tile coordinates are only meaningful with the standard 64 KiB block shapes.
+     * Tile mappings may be updated on any command queue type. */
+    if (!features->sparseBinding || !features->sparseResidencyBuffer || !features->sparseResidencyImage2D
+            || !vulkan_info->sparse_properties.residencyStandard2DBlockShape
+            || !vkd3d_queue_families_support_sparse_binding(queue_info))
         device->feature_options.TiledResourcesTier = D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED;
     else if (!device->vk_info.sparse_properties.residencyNonResidentStrict)
         device->feature_options.TiledResourcesTier = D3D12_TILED_RESOURCES_TIER_1;
-    else if (!features->sparseResidencyImage3D)
+    else if (!features->sparseResidencyImage3D || !vulkan_info->sparse_properties.residencyStandard3DBlockShape)
         device->feature_options.TiledResourcesTier = D3D12_TILED_RESOURCES_TIER_2;
     else
         device->feature_options.TiledResourcesTier = D3D12_TILED_RESOURCES_TIER_3;
 
-    /* FIXME: Implement tiled resources. */
-    if (device->feature_options.TiledResourcesTier)
-    {
-        WARN("Tiled resources are not implemented yet.\n");
-        device->feature_options.TiledResourcesTier = D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED;
-    }
-
     if (device->vk_info.device_limits.maxPerStageDescriptorSamplers <= 16)
         device->feature_options.ResourceBindingTier = D3D12_RESOURCE_BINDING_TIER_1;
     else if (device->vk_info.device_limits.maxPerStageDescriptorUniformBuffers <= 14)
@@ -1378,6 +1481,8 @@ static HRESULT vkd3d_init_device_caps(struct d3d12_device *device,
             *user_extension_supported, vulkan_info, "device",
             device->vkd3d_instance->config_flags & VKD3D_CONFIG_FLAG_VULKAN_DEBUG);
 
+    if (vulkan_info->EXT_calibrated_timestamps && !vkd3d_supports_calibrated_timestamps(device))
+        vulkan_info->EXT_calibrated_timestamps = false;
     if (!physical_device_info->conditional_rendering_features.conditionalRendering)
         vulkan_info->EXT_conditional_rendering = false;
     if (!physical_device_info->depth_clip_features.depthClipEnable)
@@ -1386,6 +1491,13 @@ static HRESULT vkd3d_init_device_caps(struct d3d12_device *device,
         vulkan_info->EXT_shader_demote_to_helper_invocation = false;
     if (!physical_device_info->texel_buffer_alignment_features.texelBufferAlignment)
         vulkan_info->EXT_texel_buffer_alignment = false;
+    if (!vulkan_info->KHR_get_physical_device_properties2)
+        vulkan_info->EXT_memory_budget = false;
+    if (!physical_device_info->memory_priority_features.memoryPriority)
+        vulkan_info->EXT_memory_priority = false;
+    if (!vulkan_info->EXT_memory_priority
+            || !physical_device_info->pageable_features.pageableDeviceLocalMemory)
+        vulkan_info->EXT_pageable_device_local_memory = false;
 
     vulkan_info->texel_buffer_alignment_properties = physical_device_info->texel_buffer_alignment_properties;
 
@@ -1518,24 +1630,6 @@ static HRESULT vkd3d_select_physical_device(struct vkd3d_instance *instance,
 }
 
 /* Vulkan queues */
-enum vkd3d_queue_family
-{
-    VKD3D_QUEUE_FAMILY_DIRECT,
-    VKD3D_QUEUE_FAMILY_COMPUTE,
-    VKD3D_QUEUE_FAMILY_TRANSFER,
-
-    VKD3D_QUEUE_FAMILY_COUNT,
-};
-
-struct vkd3d_device_queue_info
-{
-    unsigned int family_index[VKD3D_QUEUE_FAMILY_COUNT];
-    VkQueueFamilyProperties vk_properties[VKD3D_QUEUE_FAMILY_COUNT];
-
-    unsigned int vk_family_count;
-    VkDeviceQueueCreateInfo vk_queue_create_info[VKD3D_QUEUE_FAMILY_COUNT];
-};
-
 static void d3d12_device_destroy_vkd3d_queues(struct d3d12_device *device)
 {
     if (device->direct_queue)
@@ -1724,7 +1818,7 @@ static HRESULT vkd3d_create_vk_device(struct d3d12_device *device,
     vkd3d_physical_device_info_init(&physical_device_info, device);
 
     if (FAILED(hr = vkd3d_init_device_caps(device, create_info, &physical_device_info,
-            &extension_count, &user_extension_supported)))
+            &device_queue_info, &extension_count, &user_extension_supported)))
         return hr;
 
     if (!(extensions = vkd3d_calloc(extension_count, sizeof(*extensions))))
@@ -1822,6 +1916,28 @@ static void d3d12_device_destroy_pipeline_cache(struct d3d12_device *device)
     pthread_mutex_destroy(&device->mutex);
 }
 
+static HRESULT d3d12_device_init_object_pools(struct d3d12_device *device)
+{
+    HRESULT hr;
+
+    if (FAILED(hr = vkd3d_object_pool_init(&device->resource_pool, sizeof(struct d3d12_resource))))
+        return hr;
+
+    if (FAILED(hr = vkd3d_object_pool_init(&device->view_pool, sizeof(struct vkd3d_view))))
+    {
+        vkd3d_object_pool_cleanup(&device->resource_pool);
+        return hr;
+    }
+
+    return S_OK;
+}
+
+static void d3d12_device_cleanup_object_pools(struct d3d12_device *device)
+{
+    vkd3d_object_pool_cleanup(&device->view_pool);
+    vkd3d_object_pool_cleanup(&device->resource_pool);
+}
+
 #define VKD3D_VA_FALLBACK_BASE      0x8000000000000000ull
 #define VKD3D_VA_SLAB_BASE          0x0000001000000000ull
 #define VKD3D_VA_SLAB_SIZE_SHIFT    32
@@ -1850,6 +1966,45 @@ static D3D12_GPU_VIRTUAL_ADDRESS vkd3d_gpu_va_allocator_allocate_slab(struct vkd
     return address;
 }
 
+static void vkd3d_gpu_va_allocator_begin_fallback_write(struct vkd3d_gpu_va_allocator *allocator)
+{
+    vkd3d_atomic_uint64_store(&allocator->fallback_sequence, allocator->fallback_sequence + 1);
+    __sync_synchronize();
+}
+
+static void vkd3d_gpu_va_allocator_end_fallback_write(struct vkd3d_gpu_va_allocator *allocator)
+{
+    __sync_synchronize();
+    vkd3d_atomic_uint64_store(&allocator->fallback_sequence, allocator->fallback_sequence + 1);
+}
+
+/* The array is replaced instead of reallocated, since readers may still be
+ * looking at the old one. Growth is geometric, so the arrays kept around
+ * take at most as much memory as the current one. */
+static bool vkd3d_gpu_va_allocator_reserve_fallback(struct vkd3d_gpu_va_allocator *allocator, size_t count)
+{
+    struct vkd3d_gpu_va_fallback_array *array = allocator->fallback_allocations, *new_array;
+    size_t new_size;
+
+    if (array && array->size >= count)
+        return true;
+
+    new_size = array ? array->size : 0;
+    new_size = max(new_size * 2, max(count, 16));
+    if (!(new_array = vkd3d_malloc(sizeof(*new_array) + new_size * sizeof(*new_array->allocations))))
+        return false;
+
+    new_array->previous = array;
+    new_array->size = new_size;
+    if (allocator->fallback_allocation_count)
+        memcpy(new_array->allocations, array->allocations,
+                allocator->fallback_allocation_count * sizeof(*new_array->allocations));
+
+    vkd3d_atomic_ptr_store((void **)&allocator->fallback_allocations, new_array);
+
+    return true;
+}
+
 static D3D12_GPU_VIRTUAL_ADDRESS vkd3d_gpu_va_allocator_allocate_fallback(struct vkd3d_gpu_va_allocator *allocator,
         size_t alignment, size_t aligned_size, void *ptr)
 {
@@ -1864,14 +2019,17 @@ static D3D12_GPU_VIRTUAL_ADDRESS vkd3d_gpu_va_allocator_allocate_fallback(struct
 
     base = (base + (alignment - 1)) & ~((D3D12_GPU_VIRTUAL_ADDRESS)alignment - 1);
 
-    if (!vkd3d_array_reserve((void **)&allocator->fallback_allocations, &allocator->fallback_allocations_size,
-            allocator->fallback_allocation_count + 1, sizeof(*allocator->fallback_allocations)))
+    if (!vkd3d_gpu_va_allocator_reserve_fallback(allocator, allocator->fallback_allocation_count + 1))
         return 0;
 
-    allocation = &allocator->fallback_allocations[allocator->fallback_allocation_count++];
+    /* Addresses only ever increase, so appending keeps the array sorted. */
+    vkd3d_gpu_va_allocator_begin_fallback_write(allocator);
+    allocation = &allocator->fallback_allocations->allocations[allocator->fallback_allocation_count];
     allocation->base = base;
     allocation->size = aligned_size;
     allocation->ptr = ptr;
+    vkd3d_atomic_size_store(&allocator->fallback_allocation_count, allocator->fallback_allocation_count + 1);
+    vkd3d_gpu_va_allocator_end_fallback_write(allocator);
 
     /* This pointer is bumped and never lowered on a free. However, this will
      * only fail once we have exhausted 63 bits of address space. */
@@ -1947,23 +2105,43 @@ static int vkd3d_gpu_va_allocation_compare(const void *k, const void *e)
     return 0;
 }
 
+/* Lock-less; the lookup is retried if a writer modified the allocations
+ * in the meantime. The array itself is never freed while the allocator is
+ * alive, and the count is clamped to its size, so the search always stays
+ * in bounds even if it reads inconsistent data. Writers hold the mutex only
+ * briefly, so a reader that races with one yields instead of spinning. */
 static void *vkd3d_gpu_va_allocator_dereference_fallback(struct vkd3d_gpu_va_allocator *allocator,
         D3D12_GPU_VIRTUAL_ADDRESS address)
 {
-    struct vkd3d_gpu_va_allocation *allocation;
+    const struct vkd3d_gpu_va_fallback_array *array;
+    const struct vkd3d_gpu_va_allocation *allocation;
+    uint64_t sequence;
+    size_t count;
+    void *ptr;
 
-    allocation = bsearch(&address, allocator->fallback_allocations, allocator->fallback_allocation_count,
-            sizeof(*allocation), vkd3d_gpu_va_allocation_compare);
+    for (;; sched_yield())
+    {
+        if ((sequence = vkd3d_atomic_uint64_load(&allocator->fallback_sequence)) & 1)
+            continue;
+
+        ptr = NULL;
+        if ((array = vkd3d_atomic_ptr_load((void **)&allocator->fallback_allocations)))
+        {
+            count = min(vkd3d_atomic_size_load(&allocator->fallback_allocation_count), array->size);
+            if ((allocation = bsearch(&address, array->allocations, count,
+                    sizeof(*allocation), vkd3d_gpu_va_allocation_compare)))
+                ptr = allocation->ptr;
+        }
 
-    return allocation ? allocation->ptr : NULL;
+        __sync_synchronize();
+        if (vkd3d_atomic_uint64_load(&allocator->fallback_sequence) == sequence)
+            return ptr;
+    }
 }
 
 void *vkd3d_gpu_va_allocator_dereference(struct vkd3d_gpu_va_allocator *allocator,
         D3D12_GPU_VIRTUAL_ADDRESS address)
 {
-    void *ret;
-    int rc;
-
     /* If we land in the non-fallback region, dereferencing VA is lock-less.
      * The base pointer is immutable, and the only way we can have a data race
      * is if some other thread is poking into the
@@ -1973,18 +2151,7 @@ void *vkd3d_gpu_va_allocator_dereference(struct vkd3d_gpu_va_allocator *allocato
     if (address < VKD3D_VA_FALLBACK_BASE)
         return vkd3d_gpu_va_allocator_dereference_slab(allocator, address);
 
-    /* Slow fallback. */
-    if ((rc = pthread_mutex_lock(&allocator->mutex)))
-    {
-        ERR("Failed to lock mutex, error %d.\n", rc);
-        return NULL;
-    }
-
-    ret = vkd3d_gpu_va_allocator_dereference_fallback(allocator, address);
-
-    pthread_mutex_unlock(&allocator->mutex);
-
-    return ret;
+    return vkd3d_gpu_va_allocator_dereference_fallback(allocator, address);
 }
 
 static void vkd3d_gpu_va_allocator_free_slab(struct vkd3d_gpu_va_allocator *allocator,
@@ -2014,10 +2181,17 @@ static void vkd3d_gpu_va_allocator_free_slab(struct vkd3d_gpu_va_allocator *allo
 static void vkd3d_gpu_va_allocator_free_fallback(struct vkd3d_gpu_va_allocator *allocator,
         D3D12_GPU_VIRTUAL_ADDRESS address)
 {
-    struct vkd3d_gpu_va_allocation *allocation;
+    struct vkd3d_gpu_va_allocation *allocations, *allocation;
     unsigned int index;
 
-    allocation = bsearch(&address, allocator->fallback_allocations, allocator->fallback_allocation_count,
+    if (!allocator->fallback_allocations)
+    {
+        ERR("Address %#"PRIx64" does not match any allocation.\n", address);
+        return;
+    }
+
+    allocations = allocator->fallback_allocations->allocations;
+    allocation = bsearch(&address, allocations, allocator->fallback_allocation_count,
             sizeof(*allocation), vkd3d_gpu_va_allocation_compare);
 
     if (!allocation || allocation->base != address)
@@ -2026,11 +2200,13 @@ static void vkd3d_gpu_va_allocator_free_fallback(struct vkd3d_gpu_va_allocator *
         return;
     }
 
-    index = allocation - allocator->fallback_allocations;
-    --allocator->fallback_allocation_count;
+    index = allocation - allocations;
+    vkd3d_gpu_va_allocator_begin_fallback_write(allocator);
+    vkd3d_atomic_size_store(&allocator->fallback_allocation_count, allocator->fallback_allocation_count - 1);
     if (index != allocator->fallback_allocation_count)
-        memmove(&allocator->fallback_allocations[index], &allocator->fallback_allocations[index + 1],
+        memmove(&allocations[index], &allocations[index + 1],
                 (allocator->fallback_allocation_count - index) * sizeof(*allocation));
+    vkd3d_gpu_va_allocator_end_fallback_write(allocator);
 }
 
 void vkd3d_gpu_va_allocator_free(struct vkd3d_gpu_va_allocator *allocator, D3D12_GPU_VIRTUAL_ADDRESS address)
@@ -2090,6 +2266,7 @@ static bool vkd3d_gpu_va_allocator_init(struct vkd3d_gpu_va_allocator *allocator
 
 static void vkd3d_gpu_va_allocator_cleanup(struct vkd3d_gpu_va_allocator *allocator)
 {
+    struct vkd3d_gpu_va_fallback_array *array;
     int rc;
 
     if ((rc = pthread_mutex_lock(&allocator->mutex)))
@@ -2098,7 +2275,11 @@ static void vkd3d_gpu_va_allocator_cleanup(struct vkd3d_gpu_va_allocator *alloca
         return;
     }
     vkd3d_free(allocator->slabs);
-    vkd3d_free(allocator->fallback_allocations);
+    while ((array = allocator->fallback_allocations))
+    {
+        allocator->fallback_allocations = array->previous;
+        vkd3d_free(array);
+    }
     pthread_mutex_unlock(&allocator->mutex);
     pthread_mutex_destroy(&allocator->mutex);
 }
@@ -2143,7 +2324,6 @@ static ULONG STDMETHODCALLTYPE d3d12_device_Release(ID3D12Device *iface)
 {
     struct d3d12_device *device = impl_from_ID3D12Device(iface);
     ULONG refcount = InterlockedDecrement(&device->refcount);
-    size_t i;
 
     TRACE("%p decreasing refcount to %u.\n", device, refcount);
 
@@ -2154,14 +2334,22 @@ static ULONG STDMETHODCALLTYPE d3d12_device_Release(ID3D12Device *iface)
         vkd3d_private_store_destroy(&device->private_store);
 
         vkd3d_cleanup_format_info(device);
+        vkd3d_descriptor_heap_map_cleanup(&device->descriptor_heap_map);
+        vkd3d_transfer_context_cleanup(&device->transfer_context, device);
+        vkd3d_staging_ring_cleanup(&device->staging_ring, device);
+        vkd3d_memory_allocator_cleanup(&device->memory_allocator, device);
+        vkd3d_predicate_ops_cleanup(&device->predicate_ops, device);
         vkd3d_destroy_null_resources(&device->null_resources, device);
+        vkd3d_residency_manager_cleanup(&device->residency_manager);
+        vkd3d_root_signature_cache_cleanup(&device->root_signature_cache);
+        vkd3d_sampler_cache_cleanup(&device->sampler_cache, device);
+        d3d12_device_cleanup_object_pools(device);
         vkd3d_gpu_va_allocator_cleanup(&device->gpu_va_allocator);
+        vkd3d_profile_trace_cleanup(&device->profile_trace);
         vkd3d_render_pass_cache_cleanup(&device->render_pass_cache, device);
         vkd3d_fence_worker_stop(&device->fence_worker, device);
         d3d12_device_destroy_pipeline_cache(device);
         d3d12_device_destroy_vkd3d_queues(device);
-        for (i = 0; i < ARRAY_SIZE(device->desc_mutex); ++i)
-            pthread_mutex_destroy(&device->desc_mutex[i]);
         VK_CALL(vkDestroyDevice(device->vk_device, NULL));
         if (device->parent)
             IUnknown_Release(device->parent);
@@ -2666,7 +2854,7 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_CheckFeatureSupport(ID3D12Device *
             }
 
             TRACE("Root signature requested %#x.\n", data->HighestVersion);
-            data->HighestVersion = min(data->HighestVersion, D3D_ROOT_SIGNATURE_VERSION_1_0);
+            data->HighestVersion = min(data->HighestVersion, D3D_ROOT_SIGNATURE_VERSION_1_1);
 
             TRACE("Root signature version %#x.\n", data->HighestVersion);
             return S_OK;
@@ -2822,7 +3010,7 @@ static void STDMETHODCALLTYPE d3d12_device_CopyDescriptors(ID3D12Device *iface,
 {
     struct d3d12_device *device = impl_from_ID3D12Device(iface);
     unsigned int dst_range_idx, dst_idx, src_range_idx, src_idx;
-    unsigned int dst_range_size, src_range_size;
+    unsigned int dst_range_size, src_range_size, count;
     const struct d3d12_desc *src;
     struct d3d12_desc *dst;
 
@@ -2851,8 +3039,10 @@ static void STDMETHODCALLTYPE d3d12_device_CopyDescriptors(ID3D12Device *iface,
         dst = d3d12_desc_from_cpu_handle(dst_descriptor_range_offsets[dst_range_idx]);
         src = d3d12_desc_from_cpu_handle(src_descriptor_range_offsets[src_range_idx]);
 
-        while (dst_idx < dst_range_size && src_idx < src_range_size)
-            d3d12_desc_copy(&dst[dst_idx++], &src[src_idx++], device);
+        count = min(dst_range_size - dst_idx, src_range_size - src_idx);
+        d3d12_desc_copy_range(&dst[dst_idx], &src[src_idx], count, device);
+        dst_idx += count;
+        src_idx += count;
 
         if (dst_idx >= dst_range_size)
         {
@@ -3103,19 +3293,21 @@ static HRESULT STDMETHODCALLTYPE d3d12_device_OpenSharedHandleByName(ID3D12Devic
 static HRESULT STDMETHODCALLTYPE d3d12_device_MakeResident(ID3D12Device *iface,
         UINT object_count, ID3D12Pageable * const *objects)
 {
-    FIXME_ONCE("iface %p, object_count %u, objects %p stub!\n",
-            iface, object_count, objects);
+    struct d3d12_device *device = impl_from_ID3D12Device(iface);
 
-    return S_OK;
+    TRACE("iface %p, object_count %u, objects %p.\n", iface, object_count, objects);
+
+    return vkd3d_residency_manager_make_resident(&device->residency_manager, device, object_count, objects);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_device_Evict(ID3D12Device *iface,
         UINT object_count, ID3D12Pageable * const *objects)
 {
-    FIXME_ONCE("iface %p, object_count %u, objects %p stub!\n",
-            iface, object_count, objects);
+    struct d3d12_device *device = impl_from_ID3D12Device(iface);
 
-    return S_OK;
+    TRACE("iface %p, object_count %u, objects %p.\n", iface, object_count, objects);
+
+    return vkd3d_residency_manager_evict(&device->residency_manager, device, object_count, objects);
 }
 
 static HRESULT STDMETHODCALLTYPE d3d12_device_CreateFence(ID3D12Device *iface,
@@ -3287,12 +3479,48 @@ static void STDMETHODCALLTYPE d3d12_device_GetResourceTiling(ID3D12Device *iface
         UINT *sub_resource_tiling_count, UINT first_sub_resource_tiling,
         D3D12_SUBRESOURCE_TILING *sub_resource_tilings)
 {
-    FIXME("iface %p, resource %p, total_tile_count %p, packed_mip_info %p, "
+    struct d3d12_resource *resource_impl = unsafe_impl_from_ID3D12Resource(resource);
+    const struct d3d12_sparse_info *sparse = &resource_impl->sparse;
+    unsigned int count;
+
+    TRACE("iface %p, resource %p, total_tile_count %p, packed_mip_info %p, "
             "standard_title_shape %p, sub_resource_tiling_count %p, "
-            "first_sub_resource_tiling %u, sub_resource_tilings %p stub!\n",
+            "first_sub_resource_tiling %u, sub_resource_tilings %p.\n",
             iface, resource, total_tile_count, packed_mip_info, standard_tile_shape,
             sub_resource_tiling_count, first_sub_resource_tiling,
             sub_resource_tilings);
+
+    if (!(resource_impl->flags & VKD3D_RESOURCE_SPARSE))
+    {
+        WARN("Resource %p is not a reserved resource.\n", resource);
+        if (total_tile_count)
+            *total_tile_count = 0;
+        if (packed_mip_info)
+            memset(packed_mip_info, 0, sizeof(*packed_mip_info));
+        if (standard_tile_shape)
+            memset(standard_tile_shape, 0, sizeof(*standard_tile_shape));
+        if (sub_resource_tiling_count)
+            *sub_resource_tiling_count = 0;
+        return;
+    }
+
+    if (total_tile_count)
+        *total_tile_count = sparse->tile_count;
+    if (packed_mip_info)
+        *packed_mip_info = sparse->packed_mips;
+    if (standard_tile_shape)
+        *standard_tile_shape = sparse->tile_shape;
+
+    if (sub_resource_tiling_count)
+    {
+        count = 0;
+        if (first_sub_resource_tiling < sparse->tiling_count)
+            count = min(*sub_resource_tiling_count, sparse->tiling_count - first_sub_resource_tiling);
+        if (count && sub_resource_tilings)
+            memcpy(sub_resource_tilings, &sparse->tilings[first_sub_resource_tiling],
+                    count * sizeof(*sub_resource_tilings));
+        *sub_resource_tiling_count = count;
+    }
 }
 
 static LUID * STDMETHODCALLTYPE d3d12_device_GetAdapterLuid(ID3D12Device *iface, LUID *luid)
@@ -3370,7 +3598,6 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
 {
     const struct vkd3d_vk_device_procs *vk_procs;
     HRESULT hr;
-    size_t i;
 
     device->ID3D12Device_iface.lpVtbl = &d3d12_device_vtbl;
     device->refcount = 1;
@@ -3400,20 +3627,63 @@ static HRESULT d3d12_device_init(struct d3d12_device *device,
     if (FAILED(hr = vkd3d_init_format_info(device)))
         goto out_stop_fence_worker;
 
-    if (FAILED(hr = vkd3d_init_null_resources(&device->null_resources, device)))
+    if (FAILED(hr = d3d12_device_init_object_pools(device)))
         goto out_cleanup_format_info;
 
+    if (FAILED(hr = vkd3d_sampler_cache_init(&device->sampler_cache)))
+        goto out_cleanup_object_pools;
+
+    if (FAILED(hr = vkd3d_root_signature_cache_init(&device->root_signature_cache)))
+        goto out_cleanup_sampler_cache;
+
+    if (FAILED(hr = vkd3d_residency_manager_init(&device->residency_manager)))
+        goto out_cleanup_root_signature_cache;
+
+    if (FAILED(hr = vkd3d_init_null_resources(&device->null_resources, device)))
+        goto out_cleanup_residency_manager;
+
+    if (FAILED(hr = vkd3d_predicate_ops_init(&device->predicate_ops, device)))
+        goto out_destroy_null_resources;
+
+    if (FAILED(hr = vkd3d_memory_allocator_init(&device->memory_allocator, device)))
+        goto out_cleanup_predicate_ops;
+
+    if (FAILED(hr = vkd3d_staging_ring_init(&device->staging_ring)))
+        goto out_cleanup_memory_allocator;
+
+    if (FAILED(hr = vkd3d_transfer_context_init(&device->transfer_context, device)))
+        goto out_cleanup_staging_ring;
+
+    if (FAILED(hr = vkd3d_descriptor_heap_map_init(&device->descriptor_heap_map)))
+        goto out_cleanup_transfer_context;
+
     vkd3d_render_pass_cache_init(&device->render_pass_cache);
     vkd3d_gpu_va_allocator_init(&device->gpu_va_allocator);
-
-    for (i = 0; i < ARRAY_SIZE(device->desc_mutex); ++i)
-        pthread_mutex_init(&device->desc_mutex[i], NULL);
+    vkd3d_profile_trace_init(&device->profile_trace, instance);
 
     if ((device->parent = create_info->parent))
         IUnknown_AddRef(device->parent);
 
     return S_OK;
 
+out_cleanup_transfer_context:
+    vkd3d_transfer_context_cleanup(&device->transfer_context, device);
+out_cleanup_staging_ring:
+    vkd3d_staging_ring_cleanup(&device->staging_ring, device);
+out_cleanup_memory_allocator:
+    vkd3d_memory_allocator_cleanup(&device->memory_allocator, device);
+out_cleanup_predicate_ops:
+    vkd3d_predicate_ops_cleanup(&device->predicate_ops, device);
+out_destroy_null_resources:
+    vkd3d_destroy_null_resources(&device->null_resources, device);
+out_cleanup_residency_manager:
+    vkd3d_residency_manager_cleanup(&device->residency_manager);
+out_cleanup_root_signature_cache:
+    vkd3d_root_signature_cache_cleanup(&device->root_signature_cache);
+out_cleanup_sampler_cache:
+    vkd3d_sampler_cache_cleanup(&device->sampler_cache, device);
+out_cleanup_object_pools:
+    d3d12_device_cleanup_object_pools(device);
 out_cleanup_format_info:
     vkd3d_cleanup_format_info(device);
 out_stop_fence_worker:
@@ -3527,6 +3797,67 @@ VkDevice vkd3d_get_vk_device(ID3D12Device *device)
     return d3d12_device->vk_device;
 }
 
+void vkd3d_get_memory_statistics(ID3D12Device *device, struct vkd3d_memory_statistics *statistics)
+{
+    struct d3d12_device *d3d12_device = impl_from_ID3D12Device(device);
+
+    TRACE("device %p, statistics %p.\n", device, statistics);
+
+    vkd3d_memory_allocator_get_statistics(&d3d12_device->memory_allocator, statistics);
+}
+
+HRESULT vkd3d_query_video_memory_info(ID3D12Device *device, enum vkd3d_memory_segment_group segment_group,
+        struct vkd3d_video_memory_info *info)
+{
+    struct d3d12_device *d3d12_device = impl_from_ID3D12Device(device);
+
+    TRACE("device %p, segment_group %#x, info %p.\n", device, segment_group, info);
+
+    if (segment_group != VKD3D_MEMORY_SEGMENT_GROUP_LOCAL && segment_group != VKD3D_MEMORY_SEGMENT_GROUP_NON_LOCAL)
+    {
+        WARN("Invalid segment group %#x.\n", segment_group);
+        return E_INVALIDARG;
+    }
+
+    vkd3d_residency_manager_get_video_memory_info(&d3d12_device->residency_manager,
+            d3d12_device, segment_group, info);
+
+    return S_OK;
+}
+
+HRESULT vkd3d_get_object_pool_statistics(ID3D12Device *device, enum vkd3d_object_pool_type type,
+        struct vkd3d_object_pool_statistics *statistics)
+{
+    struct d3d12_device *d3d12_device = impl_from_ID3D12Device(device);
+
+    TRACE("device %p, type %#x, statistics %p.\n", device, type, statistics);
+
+    switch (type)
+    {
+        case VKD3D_OBJECT_POOL_RESOURCE:
+            vkd3d_object_pool_get_statistics(&d3d12_device->resource_pool, statistics);
+            return S_OK;
+        case VKD3D_OBJECT_POOL_VIEW:
+            vkd3d_object_pool_get_statistics(&d3d12_device->view_pool, statistics);
+            return S_OK;
+        default:
+            WARN("Invalid pool type %#x.\n", type);
+            return E_INVALIDARG;
+    }
+}
+
+HRESULT vkd3d_get_sampler_cache_statistics(ID3D12Device *device,
+        struct vkd3d_sampler_cache_statistics *statistics)
+{
+    struct d3d12_device *d3d12_device = impl_from_ID3D12Device(device);
+
+    TRACE("device %p, statistics %p.\n", device, statistics);
+
+    vkd3d_sampler_cache_get_statistics(&d3d12_device->sampler_cache, statistics);
+
+    return S_OK;
+}
+
 VkPhysicalDevice vkd3d_get_vk_physical_device(ID3D12Device *device)
 {
     struct d3d12_device *d3d12_device = impl_from_ID3D12Device(device);
@@ -19,6 +19,10 @@
 
 #include "vkd3d_private.h"
 
+#ifndef _WIN32
+# include <sys/mman.h>
+#endif
+
 #define VKD3D_NULL_BUFFER_SIZE 16
 #define VKD3D_NULL_VIEW_FORMAT DXGI_FORMAT_R8G8B8A8_UNORM
 
@@ -43,8 +47,29 @@ static bool is_numa_device(struct d3d12_device *device)
     return false;
 }
 
+static bool vkd3d_select_system_memory_type(struct d3d12_device *device, uint32_t memory_type_mask,
+        unsigned int *type_index)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_info = &device->memory_properties;
+    unsigned int i;
+
+    for (i = 0; i < memory_info->memoryTypeCount; ++i)
+    {
+        if (!(memory_type_mask & (1u << i)))
+            continue;
+        if (!(memory_info->memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT))
+        {
+            *type_index = i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
 static HRESULT vkd3d_select_memory_type(struct d3d12_device *device, uint32_t memory_type_mask,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags, unsigned int *type_index)
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags, VkDeviceSize size,
+        unsigned int *type_index)
 {
     const VkPhysicalDeviceMemoryProperties *memory_info = &device->memory_properties;
     VkMemoryPropertyFlags flags[3];
@@ -110,6 +135,14 @@ static HRESULT vkd3d_select_memory_type(struct d3d12_device *device, uint32_t me
             if ((memory_info->memoryTypes[i].propertyFlags & preferred_flags) == preferred_flags)
             {
                 *type_index = i;
+
+                /* Default heaps don't need CPU access, and are demoted to
+                 * system memory instead of oversubscribing device memory. */
+                if (heap_properties->Type == D3D12_HEAP_TYPE_DEFAULT
+                        && vkd3d_residency_manager_is_over_budget(&device->residency_manager, device, i, size)
+                        && vkd3d_select_system_memory_type(device, memory_type_mask, type_index))
+                    WARN("Device memory budget exceeded, demoting memory type %u to %u.\n", i, *type_index);
+
                 return S_OK;
             }
         }
@@ -126,6 +159,7 @@ static HRESULT vkd3d_allocate_device_memory(struct d3d12_device *device,
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkMemoryAllocateInfo allocate_info;
+    unsigned int type_index;
     VkResult vr;
     HRESULT hr;
 
@@ -136,7 +170,7 @@ static HRESULT vkd3d_allocate_device_memory(struct d3d12_device *device,
     allocate_info.pNext = dedicated_allocate_info;
     allocate_info.allocationSize = memory_requirements->size;
     if (FAILED(hr = vkd3d_select_memory_type(device, memory_requirements->memoryTypeBits,
-            heap_properties, heap_flags, &allocate_info.memoryTypeIndex)))
+            heap_properties, heap_flags, memory_requirements->size, &allocate_info.memoryTypeIndex)))
     {
         if (hr != E_INVALIDARG)
             FIXME("Failed to find suitable memory type (allowed types %#x).\n", memory_requirements->memoryTypeBits);
@@ -146,7 +180,16 @@ static HRESULT vkd3d_allocate_device_memory(struct d3d12_device *device,
 
     TRACE("Allocating memory type %u.\n", allocate_info.memoryTypeIndex);
 
-    if ((vr = VK_CALL(vkAllocateMemory(device->vk_device, &allocate_info, NULL, vk_memory))) < 0)
+    vr = VK_CALL(vkAllocateMemory(device->vk_device, &allocate_info, NULL, vk_memory));
+    if (vr == VK_ERROR_OUT_OF_DEVICE_MEMORY && heap_properties->Type == D3D12_HEAP_TYPE_DEFAULT
+            && vkd3d_select_system_memory_type(device, memory_requirements->memoryTypeBits, &type_index)
+            && type_index != allocate_info.memoryTypeIndex)
+    {
+        WARN("Out of device memory, demoting memory type %u to %u.\n", allocate_info.memoryTypeIndex, type_index);
+        allocate_info.memoryTypeIndex = type_index;
+        vr = VK_CALL(vkAllocateMemory(device->vk_device, &allocate_info, NULL, vk_memory));
+    }
+    if (vr < 0)
     {
         WARN("Failed to allocate device memory, vr %d.\n", vr);
         *vk_memory = VK_NULL_HANDLE;
@@ -159,53 +202,103 @@ static HRESULT vkd3d_allocate_device_memory(struct d3d12_device *device,
     return S_OK;
 }
 
-HRESULT vkd3d_allocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_buffer,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
-        VkDeviceMemory *vk_memory, uint32_t *vk_memory_type, VkDeviceSize *vk_memory_size)
+static void vkd3d_get_buffer_memory_requirements(struct d3d12_device *device, VkBuffer vk_buffer,
+        VkMemoryRequirements *memory_requirements, VkMemoryDedicatedAllocateInfo *dedicated_info,
+        bool *dedicated)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkMemoryDedicatedAllocateInfo *dedicated_allocation = NULL;
     VkMemoryDedicatedRequirements dedicated_requirements;
-    VkMemoryDedicatedAllocateInfo dedicated_info;
     VkMemoryRequirements2 memory_requirements2;
-    VkMemoryRequirements *memory_requirements;
     VkBufferMemoryRequirementsInfo2 info;
-    VkResult vr;
-    HRESULT hr;
 
-    memory_requirements = &memory_requirements2.memoryRequirements;
+    *dedicated = false;
 
-    if (device->vk_info.KHR_dedicated_allocation)
+    if (!device->vk_info.KHR_dedicated_allocation)
     {
-        info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
-        info.pNext = NULL;
-        info.buffer = vk_buffer;
+        VK_CALL(vkGetBufferMemoryRequirements(device->vk_device, vk_buffer, memory_requirements));
+        return;
+    }
 
-        dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
-        dedicated_requirements.pNext = NULL;
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    info.pNext = NULL;
+    info.buffer = vk_buffer;
 
-        memory_requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
-        memory_requirements2.pNext = &dedicated_requirements;
+    dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    dedicated_requirements.pNext = NULL;
 
-        VK_CALL(vkGetBufferMemoryRequirements2KHR(device->vk_device, &info, &memory_requirements2));
+    memory_requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memory_requirements2.pNext = &dedicated_requirements;
 
-        if (dedicated_requirements.prefersDedicatedAllocation)
-        {
-            dedicated_allocation = &dedicated_info;
+    VK_CALL(vkGetBufferMemoryRequirements2KHR(device->vk_device, &info, &memory_requirements2));
 
-            dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
-            dedicated_info.pNext = NULL;
-            dedicated_info.image = VK_NULL_HANDLE;
-            dedicated_info.buffer = vk_buffer;
-        }
+    *memory_requirements = memory_requirements2.memoryRequirements;
+
+    if (dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation)
+    {
+        dedicated_info->sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicated_info->pNext = NULL;
+        dedicated_info->image = VK_NULL_HANDLE;
+        dedicated_info->buffer = vk_buffer;
+        *dedicated = true;
     }
-    else
+}
+
+static void vkd3d_get_image_memory_requirements(struct d3d12_device *device, VkImage vk_image,
+        VkMemoryRequirements *memory_requirements, VkMemoryDedicatedAllocateInfo *dedicated_info,
+        bool *dedicated)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkMemoryDedicatedRequirements dedicated_requirements;
+    VkMemoryRequirements2 memory_requirements2;
+    VkImageMemoryRequirementsInfo2 info;
+
+    *dedicated = false;
+
+    if (!device->vk_info.KHR_dedicated_allocation)
     {
-        VK_CALL(vkGetBufferMemoryRequirements(device->vk_device, vk_buffer, memory_requirements));
+        VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, memory_requirements));
+        return;
+    }
+
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    info.pNext = NULL;
+    info.image = vk_image;
+
+    dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    dedicated_requirements.pNext = NULL;
+
+    memory_requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memory_requirements2.pNext = &dedicated_requirements;
+
+    VK_CALL(vkGetImageMemoryRequirements2KHR(device->vk_device, &info, &memory_requirements2));
+
+    *memory_requirements = memory_requirements2.memoryRequirements;
+
+    if (dedicated_requirements.prefersDedicatedAllocation || dedicated_requirements.requiresDedicatedAllocation)
+    {
+        dedicated_info->sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+        dedicated_info->pNext = NULL;
+        dedicated_info->image = vk_image;
+        dedicated_info->buffer = VK_NULL_HANDLE;
+        *dedicated = true;
     }
+}
+
+HRESULT vkd3d_allocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_buffer,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        VkDeviceMemory *vk_memory, uint32_t *vk_memory_type, VkDeviceSize *vk_memory_size)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkMemoryDedicatedAllocateInfo dedicated_info;
+    VkMemoryRequirements memory_requirements;
+    bool dedicated;
+    VkResult vr;
+    HRESULT hr;
+
+    vkd3d_get_buffer_memory_requirements(device, vk_buffer, &memory_requirements, &dedicated_info, &dedicated);
 
     if (FAILED(hr = vkd3d_allocate_device_memory(device, heap_properties, heap_flags,
-            memory_requirements, dedicated_allocation, vk_memory, vk_memory_type)))
+            &memory_requirements, dedicated ? &dedicated_info : NULL, vk_memory, vk_memory_type)))
         return hr;
 
     if ((vr = VK_CALL(vkBindBufferMemory(device->vk_device, vk_buffer, *vk_memory, 0))) < 0)
@@ -216,7 +309,7 @@ HRESULT vkd3d_allocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_bu
     }
 
     if (vk_memory_size)
-        *vk_memory_size = memory_requirements->size;
+        *vk_memory_size = memory_requirements.size;
 
     return hresult_from_vk_result(vr);
 }
@@ -226,48 +319,16 @@ static HRESULT vkd3d_allocate_image_memory(struct d3d12_device *device, VkImage
         VkDeviceMemory *vk_memory, uint32_t *vk_memory_type, VkDeviceSize *vk_memory_size)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkMemoryDedicatedAllocateInfo *dedicated_allocation = NULL;
-    VkMemoryDedicatedRequirements dedicated_requirements;
     VkMemoryDedicatedAllocateInfo dedicated_info;
-    VkMemoryRequirements2 memory_requirements2;
-    VkMemoryRequirements *memory_requirements;
-    VkImageMemoryRequirementsInfo2 info;
+    VkMemoryRequirements memory_requirements;
+    bool dedicated;
     VkResult vr;
     HRESULT hr;
 
-    memory_requirements = &memory_requirements2.memoryRequirements;
-
-    if (device->vk_info.KHR_dedicated_allocation)
-    {
-        info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
-        info.pNext = NULL;
-        info.image = vk_image;
-
-        dedicated_requirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
-        dedicated_requirements.pNext = NULL;
-
-        memory_requirements2.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
-        memory_requirements2.pNext = &dedicated_requirements;
-
-        VK_CALL(vkGetImageMemoryRequirements2KHR(device->vk_device, &info, &memory_requirements2));
-
-        if (dedicated_requirements.prefersDedicatedAllocation)
-        {
-            dedicated_allocation = &dedicated_info;
-
-            dedicated_info.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
-            dedicated_info.pNext = NULL;
-            dedicated_info.image = vk_image;
-            dedicated_info.buffer = VK_NULL_HANDLE;
-        }
-    }
-    else
-    {
-        VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, memory_requirements));
-    }
+    vkd3d_get_image_memory_requirements(device, vk_image, &memory_requirements, &dedicated_info, &dedicated);
 
     if (FAILED(hr = vkd3d_allocate_device_memory(device, heap_properties, heap_flags,
-            memory_requirements, dedicated_allocation, vk_memory, vk_memory_type)))
+            &memory_requirements, dedicated ? &dedicated_info : NULL, vk_memory, vk_memory_type)))
         return hr;
 
     if ((vr = VK_CALL(vkBindImageMemory(device->vk_device, vk_image, *vk_memory, 0))) < 0)
@@ -279,1887 +340,3794 @@ static HRESULT vkd3d_allocate_image_memory(struct d3d12_device *device, VkImage
     }
 
     if (vk_memory_size)
-        *vk_memory_size = memory_requirements->size;
+        *vk_memory_size = memory_requirements.size;
 
     return S_OK;
 }
 
-/* ID3D12Heap */
-static inline struct d3d12_heap *impl_from_ID3D12Heap(ID3D12Heap *iface)
-{
-    return CONTAINING_RECORD(iface, struct d3d12_heap, ID3D12Heap_iface);
-}
+static void vkd3d_residency_manager_add_allocation(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, uint32_t vk_memory_type, VkDeviceSize size);
+static void vkd3d_residency_manager_remove_allocation(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, uint32_t vk_memory_type, VkDeviceSize size);
 
-static HRESULT STDMETHODCALLTYPE d3d12_heap_QueryInterface(ID3D12Heap *iface,
-        REFIID iid, void **object)
-{
-    TRACE("iface %p, iid %s, object %p.\n", iface, debugstr_guid(iid), object);
+/* Device memory suballocator
+ *
+ * Committed resources are suballocated from VkDeviceMemory chunks using a
+ * buddy allocator, in order to stay well below maxMemoryAllocationCount and
+ * to avoid a vkAllocateMemory() call per resource. Each chunk serves a single
+ * memory type, and either only linear resources (buffers and linear images)
+ * or only optimally tiled images, so that bufferImageGranularity never needs
+ * to be taken into account.
+ *
+ * The free blocks of a chunk are tracked in a complete binary tree stored as
+ * an array. Each node holds the largest free order in its subtree, biased by
+ * VKD3D_MEMORY_MIN_ORDER - 1, or 0 if the subtree is fully allocated. */
+#define VKD3D_MEMORY_CHUNK_ORDER             25 /* 32 MiB */
+#define VKD3D_MEMORY_MIN_ORDER               12 /* 4 KiB */
+#define VKD3D_MEMORY_MAX_SUBALLOCATION_ORDER (VKD3D_MEMORY_CHUNK_ORDER - 3)
+#define VKD3D_MEMORY_ORDER_COUNT             (VKD3D_MEMORY_CHUNK_ORDER - VKD3D_MEMORY_MIN_ORDER + 1)
 
-    if (IsEqualGUID(iid, &IID_ID3D12Heap)
-            || IsEqualGUID(iid, &IID_ID3D12Pageable)
-            || IsEqualGUID(iid, &IID_ID3D12DeviceChild)
-            || IsEqualGUID(iid, &IID_ID3D12Object)
-            || IsEqualGUID(iid, &IID_IUnknown))
-    {
-        ID3D12Heap_AddRef(iface);
-        *object = iface;
-        return S_OK;
-    }
+struct vkd3d_memory_chunk
+{
+    struct list entry;
 
-    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(iid));
+    VkDeviceMemory vk_memory;
+    uint32_t vk_memory_type;
+    bool linear;
+    void *map_ptr;
 
-    *object = NULL;
-    return E_NOINTERFACE;
-}
+    unsigned int allocation_count;
+    uint8_t tree[1u << VKD3D_MEMORY_ORDER_COUNT];
+};
 
-static ULONG STDMETHODCALLTYPE d3d12_heap_AddRef(ID3D12Heap *iface)
+static unsigned int vkd3d_memory_order_from_size(VkDeviceSize size)
 {
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
-    ULONG refcount = InterlockedIncrement(&heap->refcount);
+    unsigned int order = VKD3D_MEMORY_MIN_ORDER;
 
-    TRACE("%p increasing refcount to %u.\n", heap, refcount);
-
-    assert(!heap->is_private);
+    while (order <= VKD3D_MEMORY_CHUNK_ORDER && ((VkDeviceSize)1 << order) < size)
+        ++order;
 
-    return refcount;
+    return order;
 }
 
-static ULONG d3d12_resource_decref(struct d3d12_resource *resource);
+static inline VkDeviceSize vkd3d_memory_chunk_free_block_size(const struct vkd3d_memory_chunk *chunk)
+{
+    return chunk->tree[1] ? (VkDeviceSize)1 << (chunk->tree[1] + VKD3D_MEMORY_MIN_ORDER - 1) : 0;
+}
 
-static void d3d12_heap_destroy(struct d3d12_heap *heap)
+static HRESULT vkd3d_memory_chunk_create(struct d3d12_device *device, uint32_t vk_memory_type,
+        bool linear, struct vkd3d_memory_chunk **chunk)
 {
-    struct d3d12_device *device = heap->device;
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkMemoryAllocateInfo allocate_info;
+    struct vkd3d_memory_chunk *object;
+    unsigned int i, depth;
+    VkResult vr;
 
-    TRACE("Destroying heap %p.\n", heap);
+    if (!(object = vkd3d_malloc(sizeof(*object))))
+        return E_OUTOFMEMORY;
 
-    if (heap->buffer_resource)
-        d3d12_resource_decref(heap->buffer_resource);
+    allocate_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocate_info.pNext = NULL;
+    allocate_info.allocationSize = (VkDeviceSize)1 << VKD3D_MEMORY_CHUNK_ORDER;
+    allocate_info.memoryTypeIndex = vk_memory_type;
+    if ((vr = VK_CALL(vkAllocateMemory(device->vk_device, &allocate_info, NULL, &object->vk_memory))) < 0)
+    {
+        WARN("Failed to allocate memory chunk, vr %d.\n", vr);
+        vkd3d_free(object);
+        return hresult_from_vk_result(vr);
+    }
 
-    vkd3d_private_store_destroy(&heap->private_store);
+    /* A VkDeviceMemory object can only be mapped once, so keep host visible
+     * chunks mapped for their entire lifetime. */
+    object->map_ptr = NULL;
+    if (device->memory_properties.memoryTypes[vk_memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        if ((vr = VK_CALL(vkMapMemory(device->vk_device, object->vk_memory,
+                0, VK_WHOLE_SIZE, 0, &object->map_ptr))) < 0)
+        {
+            WARN("Failed to map memory chunk, vr %d.\n", vr);
+            VK_CALL(vkFreeMemory(device->vk_device, object->vk_memory, NULL));
+            vkd3d_free(object);
+            return hresult_from_vk_result(vr);
+        }
+    }
 
-    VK_CALL(vkFreeMemory(device->vk_device, heap->vk_memory, NULL));
+    object->vk_memory_type = vk_memory_type;
+    object->linear = linear;
+    object->allocation_count = 0;
 
-    pthread_mutex_destroy(&heap->mutex);
+    object->tree[0] = 0;
+    for (i = 1; i < ARRAY_SIZE(object->tree); ++i)
+    {
+        depth = vkd3d_log2i(i);
+        object->tree[i] = VKD3D_MEMORY_ORDER_COUNT - depth;
+    }
 
-    if (heap->is_private)
-        device = NULL;
+    vkd3d_residency_manager_add_allocation(&device->residency_manager, device,
+            vk_memory_type, (VkDeviceSize)1 << VKD3D_MEMORY_CHUNK_ORDER);
 
-    vkd3d_free(heap);
+    TRACE("Created memory chunk %p, memory type %u, linear %#x.\n", object, vk_memory_type, linear);
 
-    if (device)
-        d3d12_device_release(device);
+    *chunk = object;
+    return S_OK;
 }
 
-static ULONG STDMETHODCALLTYPE d3d12_heap_Release(ID3D12Heap *iface)
+static void vkd3d_memory_chunk_destroy(struct vkd3d_memory_chunk *chunk, struct d3d12_device *device)
 {
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
-    ULONG refcount = InterlockedDecrement(&heap->refcount);
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
 
-    TRACE("%p decreasing refcount to %u.\n", heap, refcount);
+    TRACE("Destroying memory chunk %p.\n", chunk);
 
-    if (!refcount)
-        d3d12_heap_destroy(heap);
+    vkd3d_residency_manager_remove_allocation(&device->residency_manager, device,
+            chunk->vk_memory_type, (VkDeviceSize)1 << VKD3D_MEMORY_CHUNK_ORDER);
 
-    return refcount;
+    if (chunk->map_ptr)
+        VK_CALL(vkUnmapMemory(device->vk_device, chunk->vk_memory));
+    VK_CALL(vkFreeMemory(device->vk_device, chunk->vk_memory, NULL));
+    vkd3d_free(chunk);
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_heap_GetPrivateData(ID3D12Heap *iface,
-        REFGUID guid, UINT *data_size, void *data)
+static bool vkd3d_memory_chunk_allocate(struct vkd3d_memory_chunk *chunk,
+        unsigned int order, VkDeviceSize *offset)
 {
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    unsigned int level = order - VKD3D_MEMORY_MIN_ORDER + 1;
+    unsigned int node = 1, depth = 0;
 
-    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+    if (chunk->tree[1] < level)
+        return false;
 
-    return vkd3d_get_private_data(&heap->private_store, guid, data_size, data);
-}
+    /* Prefer the left child to keep allocations packed at the start of the chunk. */
+    while (VKD3D_MEMORY_CHUNK_ORDER - depth > order)
+    {
+        node = 2 * node + (chunk->tree[2 * node] < level);
+        ++depth;
+    }
 
-static HRESULT STDMETHODCALLTYPE d3d12_heap_SetPrivateData(ID3D12Heap *iface,
-        REFGUID guid, UINT data_size, const void *data)
-{
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    assert(chunk->tree[node] == level);
+    chunk->tree[node] = 0;
+    *offset = (VkDeviceSize)(node - (1u << depth)) << order;
 
-    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+    for (node /= 2; node; node /= 2)
+        chunk->tree[node] = max(chunk->tree[2 * node], chunk->tree[2 * node + 1]);
 
-    return vkd3d_set_private_data(&heap->private_store, guid, data_size, data);
+    ++chunk->allocation_count;
+    return true;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_heap_SetPrivateDataInterface(ID3D12Heap *iface,
-        REFGUID guid, const IUnknown *data)
+static void vkd3d_memory_chunk_free(struct vkd3d_memory_chunk *chunk,
+        unsigned int order, VkDeviceSize offset)
 {
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    unsigned int depth = VKD3D_MEMORY_CHUNK_ORDER - order;
+    unsigned int node = (1u << depth) + (unsigned int)(offset >> order);
+    unsigned int full;
 
-    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
+    assert(!chunk->tree[node]);
+    chunk->tree[node] = VKD3D_MEMORY_ORDER_COUNT - depth;
 
-    return vkd3d_set_private_data_interface(&heap->private_store, guid, data);
+    for (node /= 2, --depth; node; node /= 2, --depth)
+    {
+        full = VKD3D_MEMORY_ORDER_COUNT - depth;
+        if (chunk->tree[2 * node] == full - 1 && chunk->tree[2 * node + 1] == full - 1)
+            chunk->tree[node] = full;
+        else
+            chunk->tree[node] = max(chunk->tree[2 * node], chunk->tree[2 * node + 1]);
+    }
+
+    assert(chunk->allocation_count);
+    --chunk->allocation_count;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_heap_SetName(ID3D12Heap *iface, const WCHAR *name)
+HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device)
 {
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    unsigned int i;
+    int rc;
 
-    TRACE("iface %p, name %s.\n", iface, debugstr_w(name, heap->device->wchar_size));
+    memset(allocator, 0, sizeof(*allocator));
 
-    return vkd3d_set_vk_object_name(heap->device, (uint64_t)heap->vk_memory,
-            VK_DEBUG_REPORT_OBJECT_TYPE_DEVICE_MEMORY_EXT, name);
+    if ((rc = pthread_mutex_init(&allocator->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(allocator->chunks); ++i)
+        list_init(&allocator->chunks[i]);
+
+    return S_OK;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_heap_GetDevice(ID3D12Heap *iface, REFIID iid, void **device)
+void vkd3d_memory_allocator_cleanup(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device)
 {
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    struct vkd3d_memory_chunk *chunk, *next;
+    unsigned int i;
 
-    TRACE("iface %p, iid %s, device %p.\n", iface, debugstr_guid(iid), device);
+    for (i = 0; i < ARRAY_SIZE(allocator->chunks); ++i)
+    {
+        LIST_FOR_EACH_ENTRY_SAFE(chunk, next, &allocator->chunks[i], struct vkd3d_memory_chunk, entry)
+        {
+            if (chunk->allocation_count)
+                ERR("Memory chunk %p still has %u allocations.\n", chunk, chunk->allocation_count);
+            vkd3d_memory_chunk_destroy(chunk, device);
+        }
+    }
 
-    return d3d12_device_query_interface(heap->device, iid, device);
+    pthread_mutex_destroy(&allocator->mutex);
 }
 
-static D3D12_HEAP_DESC * STDMETHODCALLTYPE d3d12_heap_GetDesc(ID3D12Heap *iface,
-        D3D12_HEAP_DESC *desc)
+void vkd3d_memory_allocator_get_statistics(struct vkd3d_memory_allocator *allocator,
+        struct vkd3d_memory_statistics *statistics)
 {
-    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    const struct vkd3d_memory_chunk *chunk;
+    unsigned int i;
+    int rc;
 
-    TRACE("iface %p, desc %p.\n", iface, desc);
+    memset(statistics, 0, sizeof(*statistics));
+    statistics->chunk_size = (uint64_t)1 << VKD3D_MEMORY_CHUNK_ORDER;
 
-    *desc = heap->desc;
-    return desc;
-}
+    if ((rc = pthread_mutex_lock(&allocator->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
 
-static const struct ID3D12HeapVtbl d3d12_heap_vtbl =
-{
-    /* IUnknown methods */
-    d3d12_heap_QueryInterface,
-    d3d12_heap_AddRef,
-    d3d12_heap_Release,
-    /* ID3D12Object methods */
-    d3d12_heap_GetPrivateData,
-    d3d12_heap_SetPrivateData,
-    d3d12_heap_SetPrivateDataInterface,
-    d3d12_heap_SetName,
-    /* ID3D12DeviceChild methods */
-    d3d12_heap_GetDevice,
-    /* ID3D12Heap methods */
-    d3d12_heap_GetDesc,
-};
+    statistics->chunk_count = allocator->chunk_count;
+    statistics->suballocation_count = allocator->suballocation_count;
+    statistics->suballocated_size = allocator->suballocated_size;
+    statistics->requested_size = allocator->requested_size;
+    statistics->dedicated_allocation_count = allocator->dedicated_allocation_count;
+    statistics->dedicated_allocation_size = allocator->dedicated_allocation_size;
 
-struct d3d12_heap *unsafe_impl_from_ID3D12Heap(ID3D12Heap *iface)
-{
-    if (!iface)
-        return NULL;
-    assert(iface->lpVtbl == &d3d12_heap_vtbl);
-    return impl_from_ID3D12Heap(iface);
+    for (i = 0; i < ARRAY_SIZE(allocator->chunks); ++i)
+    {
+        LIST_FOR_EACH_ENTRY(chunk, &allocator->chunks[i], struct vkd3d_memory_chunk, entry)
+        {
+            statistics->largest_free_block_size = max(statistics->largest_free_block_size,
+                    vkd3d_memory_chunk_free_block_size(chunk));
+        }
+    }
+
+    pthread_mutex_unlock(&allocator->mutex);
 }
 
-static HRESULT d3d12_heap_map(struct d3d12_heap *heap, uint64_t offset,
-        struct d3d12_resource *resource, void **data)
+static HRESULT vkd3d_memory_allocator_suballocate(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device, uint32_t vk_memory_type, bool linear,
+        const VkMemoryRequirements *memory_requirements, struct vkd3d_memory_allocation *allocation)
 {
-    struct d3d12_device *device = heap->device;
-    HRESULT hr = S_OK;
-    VkResult vr;
+    struct list *chunks = &allocator->chunks[vk_memory_type];
+    struct vkd3d_memory_chunk *chunk;
+    unsigned int order;
+    VkDeviceSize offset;
+    HRESULT hr;
     int rc;
 
-    if ((rc = pthread_mutex_lock(&heap->mutex)))
+    /* Buddy blocks are naturally aligned to their size. */
+    order = vkd3d_memory_order_from_size(max(memory_requirements->size, memory_requirements->alignment));
+    assert(order <= VKD3D_MEMORY_MAX_SUBALLOCATION_ORDER);
+
+    if ((rc = pthread_mutex_lock(&allocator->mutex)))
     {
         ERR("Failed to lock mutex, error %d.\n", rc);
-        if (data)
-            *data = NULL;
         return hresult_from_errno(rc);
     }
 
-    assert(!resource->map_count || heap->map_ptr);
-
-    if (!resource->map_count)
+    LIST_FOR_EACH_ENTRY(chunk, chunks, struct vkd3d_memory_chunk, entry)
     {
-        if (!heap->map_ptr)
-        {
-            const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+        if (chunk->linear == linear && vkd3d_memory_chunk_allocate(chunk, order, &offset))
+            goto done;
+    }
 
-            TRACE("Mapping heap %p.\n", heap);
+    if (FAILED(hr = vkd3d_memory_chunk_create(device, vk_memory_type, linear, &chunk)))
+    {
+        pthread_mutex_unlock(&allocator->mutex);
+        return hr;
+    }
+    list_add_tail(chunks, &chunk->entry);
+    ++allocator->chunk_count;
 
-            assert(!heap->map_count);
+    if (!vkd3d_memory_chunk_allocate(chunk, order, &offset))
+        ERR("Failed to allocate from a new chunk.\n");
 
-            if ((vr = VK_CALL(vkMapMemory(device->vk_device, heap->vk_memory,
-                    0, VK_WHOLE_SIZE, 0, &heap->map_ptr))) < 0)
-            {
-                WARN("Failed to map device memory, vr %d.\n", vr);
-                heap->map_ptr = NULL;
-            }
+done:
+    ++allocator->suballocation_count;
+    allocator->suballocated_size += (VkDeviceSize)1 << order;
+    allocator->requested_size += memory_requirements->size;
+
+    pthread_mutex_unlock(&allocator->mutex);
+
+    allocation->vk_memory = chunk->vk_memory;
+    allocation->vk_memory_type = vk_memory_type;
+    allocation->offset = offset;
+    allocation->size = memory_requirements->size;
+    allocation->order = order;
+    allocation->chunk = chunk;
+
+    TRACE("Suballocated %#"PRIx64" bytes at offset %#"PRIx64" from chunk %p.\n",
+            allocation->size, offset, chunk);
+
+    return S_OK;
+}
+
+static HRESULT vkd3d_allocate_memory(struct d3d12_device *device,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        const VkMemoryRequirements *memory_requirements,
+        const VkMemoryDedicatedAllocateInfo *dedicated_allocate_info, bool linear,
+        struct vkd3d_memory_allocation *allocation)
+{
+    struct vkd3d_memory_allocator *allocator = &device->memory_allocator;
+    uint32_t vk_memory_type;
+    HRESULT hr;
+    int rc;
+
+    memset(allocation, 0, sizeof(*allocation));
 
-            hr = hresult_from_vk_result(vr);
+    if (!dedicated_allocate_info
+            && !(heap_flags & (D3D12_HEAP_FLAG_SHARED | D3D12_HEAP_FLAG_SHARED_CROSS_ADAPTER
+            | D3D12_HEAP_FLAG_ALLOW_DISPLAY))
+            && vkd3d_memory_order_from_size(max(memory_requirements->size, memory_requirements->alignment))
+            <= VKD3D_MEMORY_MAX_SUBALLOCATION_ORDER)
+    {
+        if (FAILED(hr = vkd3d_select_memory_type(device, memory_requirements->memoryTypeBits,
+                heap_properties, heap_flags, memory_requirements->size, &vk_memory_type)))
+        {
+            if (hr != E_INVALIDARG)
+                FIXME("Failed to find suitable memory type (allowed types %#x).\n",
+                        memory_requirements->memoryTypeBits);
+            return hr;
         }
 
-        if (heap->map_ptr)
-            ++heap->map_count;
+        if (SUCCEEDED(hr = vkd3d_memory_allocator_suballocate(allocator, device,
+                vk_memory_type, linear, memory_requirements, allocation)))
+            return hr;
+
+        WARN("Failed to suballocate memory, hr %#x, falling back to a dedicated allocation.\n", hr);
     }
 
-    if (hr == S_OK)
+    if (FAILED(hr = vkd3d_allocate_device_memory(device, heap_properties, heap_flags,
+            memory_requirements, dedicated_allocate_info, &allocation->vk_memory, &allocation->vk_memory_type)))
+        return hr;
+    allocation->size = memory_requirements->size;
+
+    vkd3d_residency_manager_add_allocation(&device->residency_manager, device,
+            allocation->vk_memory_type, allocation->size);
+
+    if (!(rc = pthread_mutex_lock(&allocator->mutex)))
     {
-        assert(heap->map_ptr);
-        if (data)
-            *data = (BYTE *)heap->map_ptr + offset;
-        ++resource->map_count;
+        ++allocator->dedicated_allocation_count;
+        allocator->dedicated_allocation_size += allocation->size;
+        pthread_mutex_unlock(&allocator->mutex);
     }
     else
     {
-        assert(!heap->map_ptr);
-        if (data)
-            *data = NULL;
+        ERR("Failed to lock mutex, error %d.\n", rc);
     }
 
-    pthread_mutex_unlock(&heap->mutex);
-
-    return hr;
+    return S_OK;
 }
 
-static void d3d12_heap_unmap(struct d3d12_heap *heap, struct d3d12_resource *resource)
+void vkd3d_free_memory(struct d3d12_device *device, const struct vkd3d_memory_allocation *allocation)
 {
-    struct d3d12_device *device = heap->device;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_memory_allocator *allocator = &device->memory_allocator;
+    struct vkd3d_memory_chunk *chunk = allocation->chunk;
+    struct list *chunks;
     int rc;
 
-    if ((rc = pthread_mutex_lock(&heap->mutex)))
+    if (!chunk)
     {
-        ERR("Failed to lock mutex, error %d.\n", rc);
-        return;
+        VK_CALL(vkFreeMemory(device->vk_device, allocation->vk_memory, NULL));
+        vkd3d_residency_manager_remove_allocation(&device->residency_manager, device,
+                allocation->vk_memory_type, allocation->size);
     }
 
-    if (!resource->map_count)
+    if ((rc = pthread_mutex_lock(&allocator->mutex)))
     {
-        WARN("Resource %p is not mapped.\n", resource);
-        goto done;
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
     }
 
-    --resource->map_count;
-    if (resource->map_count)
-        goto done;
-
-    if (!heap->map_count)
+    if (!chunk)
     {
-        ERR("Heap %p is not mapped.\n", heap);
-        goto done;
+        --allocator->dedicated_allocation_count;
+        allocator->dedicated_allocation_size -= allocation->size;
+        pthread_mutex_unlock(&allocator->mutex);
+        return;
     }
 
-    --heap->map_count;
-    if (!heap->map_count)
-    {
-        const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    vkd3d_memory_chunk_free(chunk, allocation->order, allocation->offset);
 
-        TRACE("Unmapping heap %p, ptr %p.\n", heap, heap->map_ptr);
+    --allocator->suballocation_count;
+    allocator->suballocated_size -= (VkDeviceSize)1 << allocation->order;
+    allocator->requested_size -= allocation->size;
 
-        VK_CALL(vkUnmapMemory(device->vk_device, heap->vk_memory));
-        heap->map_ptr = NULL;
+    /* Keep one chunk per memory type around to avoid repeatedly allocating
+     * and freeing memory when a single resource is created and destroyed. */
+    chunks = &allocator->chunks[allocation->vk_memory_type];
+    if (!chunk->allocation_count && (list_head(chunks) != &chunk->entry || list_next(chunks, &chunk->entry)))
+    {
+        list_remove(&chunk->entry);
+        --allocator->chunk_count;
+        vkd3d_memory_chunk_destroy(chunk, device);
     }
 
-done:
-    pthread_mutex_unlock(&heap->mutex);
+    pthread_mutex_unlock(&allocator->mutex);
 }
 
-static HRESULT validate_heap_desc(const D3D12_HEAP_DESC *desc, const struct d3d12_resource *resource)
+static HRESULT vkd3d_allocate_resource_heap_memory(struct d3d12_device *device,
+        const struct d3d12_resource *resource, const D3D12_HEAP_PROPERTIES *heap_properties,
+        D3D12_HEAP_FLAGS heap_flags, struct vkd3d_memory_allocation *allocation)
 {
-    if (!resource && !desc->SizeInBytes)
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkMemoryDedicatedAllocateInfo dedicated_info;
+    VkMemoryRequirements memory_requirements;
+    bool dedicated, linear;
+    VkResult vr;
+    HRESULT hr;
+
+    if (d3d12_resource_is_buffer(resource))
     {
-        WARN("Invalid size %"PRIu64".\n", desc->SizeInBytes);
-        return E_INVALIDARG;
+        vkd3d_get_buffer_memory_requirements(device, resource->u.vk_buffer,
+                &memory_requirements, &dedicated_info, &dedicated);
+        linear = true;
     }
-
-    if (desc->Alignment != D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
-            && desc->Alignment != D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT)
+    else
     {
-        WARN("Invalid alignment %"PRIu64".\n", desc->Alignment);
-        return E_INVALIDARG;
+        vkd3d_get_image_memory_requirements(device, resource->u.vk_image,
+                &memory_requirements, &dedicated_info, &dedicated);
+        linear = resource->flags & VKD3D_RESOURCE_LINEAR_TILING;
     }
 
-    if (!resource && desc->Flags & D3D12_HEAP_FLAG_ALLOW_DISPLAY)
+    if (FAILED(hr = vkd3d_allocate_memory(device, heap_properties, heap_flags, &memory_requirements,
+            dedicated ? &dedicated_info : NULL, linear, allocation)))
+        return hr;
+
+    if (d3d12_resource_is_buffer(resource))
+        vr = VK_CALL(vkBindBufferMemory(device->vk_device, resource->u.vk_buffer,
+                allocation->vk_memory, allocation->offset));
+    else
+        vr = VK_CALL(vkBindImageMemory(device->vk_device, resource->u.vk_image,
+                allocation->vk_memory, allocation->offset));
+    if (vr < 0)
     {
-        WARN("D3D12_HEAP_FLAG_ALLOW_DISPLAY is only for committed resources.\n");
-        return E_INVALIDARG;
+        WARN("Failed to bind memory, vr %d.\n", vr);
+        vkd3d_free_memory(device, allocation);
+        return hresult_from_vk_result(vr);
     }
 
     return S_OK;
 }
 
-static HRESULT d3d12_resource_create(struct d3d12_device *device,
-                                     const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
-                                     const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
-                                     const D3D12_CLEAR_VALUE *optimized_clear_value, bool placed,
-                                     struct d3d12_resource **resource);
-
-static HRESULT d3d12_heap_init(struct d3d12_heap *heap,
-        struct d3d12_device *device, const D3D12_HEAP_DESC *desc, const struct d3d12_resource *resource)
+/* Allocates memory for internal buffers from the device memory allocator.
+ * Host visible memory is returned mapped. */
+HRESULT vkd3d_suballocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_buffer,
+        const D3D12_HEAP_PROPERTIES *heap_properties, struct vkd3d_memory_allocation *allocation, void **data)
 {
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkMemoryRequirements memory_requirements;
-    VkDeviceSize vk_memory_size;
+    void *map_ptr = NULL;
+    VkResult vr;
     HRESULT hr;
-    int rc;
-    bool buffers_allowed;
-    D3D12_RESOURCE_DESC resource_desc;
-    D3D12_RESOURCE_STATES initial_resource_state;
-
-    heap->ID3D12Heap_iface.lpVtbl = &d3d12_heap_vtbl;
-    heap->refcount = 1;
-
-    heap->is_private = !!resource;
-
-    heap->desc = *desc;
-
-    heap->map_ptr = NULL;
-    heap->map_count = 0;
-    heap->buffer_resource = NULL;
-
-    if (!heap->desc.Properties.CreationNodeMask)
-        heap->desc.Properties.CreationNodeMask = 1;
-    if (!heap->desc.Properties.VisibleNodeMask)
-        heap->desc.Properties.VisibleNodeMask = 1;
-
-    debug_ignored_node_mask(heap->desc.Properties.CreationNodeMask);
-    debug_ignored_node_mask(heap->desc.Properties.VisibleNodeMask);
-
-    if (!heap->desc.Alignment)
-        heap->desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
 
-    if (FAILED(hr = validate_heap_desc(&heap->desc, resource)))
-        return hr;
-
-    if ((rc = pthread_mutex_init(&heap->mutex, NULL)))
-    {
-        ERR("Failed to initialize mutex, error %d.\n", rc);
-        return hresult_from_errno(rc);
-    }
+    VK_CALL(vkGetBufferMemoryRequirements(device->vk_device, vk_buffer, &memory_requirements));
 
-    if (FAILED(hr = vkd3d_private_store_init(&heap->private_store)))
-    {
-        pthread_mutex_destroy(&heap->mutex);
+    if (FAILED(hr = vkd3d_allocate_memory(device, heap_properties, D3D12_HEAP_FLAG_NONE,
+            &memory_requirements, NULL, true, allocation)))
         return hr;
-    }
 
-    buffers_allowed = !(heap->desc.Flags & D3D12_HEAP_FLAG_DENY_BUFFERS);
-    if (buffers_allowed && !resource)
+    if ((vr = VK_CALL(vkBindBufferMemory(device->vk_device, vk_buffer,
+            allocation->vk_memory, allocation->offset))) < 0)
     {
-        /* Create a single omnipotent buffer which fills the entire heap.
-         * Whenever we place buffer resources on this heap, we'll just offset this VkBuffer.
-         * This allows us to keep VA space somewhat sane, and keeps number of (limited) VA allocations down.
-         * One possible downside is that the buffer might be slightly slower to access,
-         * but D3D12 has very lenient usage flags for buffers. */
-
-        memset(&resource_desc, 0, sizeof(resource_desc));
-        resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
-        resource_desc.Width = desc->SizeInBytes;
-        resource_desc.Height = 1;
-        resource_desc.DepthOrArraySize = 1;
-        resource_desc.MipLevels = 1;
-        resource_desc.SampleDesc.Count = 1;
-        resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
-
-        switch (desc->Properties.Type)
-        {
-        case D3D12_HEAP_TYPE_UPLOAD:
-            initial_resource_state = D3D12_RESOURCE_STATE_GENERIC_READ;
-            break;
-
-        case D3D12_HEAP_TYPE_READBACK:
-            initial_resource_state = D3D12_RESOURCE_STATE_COPY_DEST;
-            break;
-
-        default:
-            /* Upload and readback heaps do not allow UAV access, only enable this flag for other heaps. */
-            resource_desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
-            initial_resource_state = D3D12_RESOURCE_STATE_COMMON;
-            break;
-        }
-
-        if (FAILED(hr = d3d12_resource_create(device, &desc->Properties, desc->Flags,
-                                              &resource_desc, initial_resource_state,
-                                              NULL, false, &heap->buffer_resource)))
-        {
-            heap->buffer_resource = NULL;
-            return hr;
-        }
-        /* This internal resource should not own a reference on the device.
-         * d3d12_resource_create takes a reference on the device. */
-        d3d12_device_release(device);
+        WARN("Failed to bind memory, vr %d.\n", vr);
+        vkd3d_free_memory(device, allocation);
+        return hresult_from_vk_result(vr);
     }
 
-    if (resource)
+    if (data)
     {
-        if (d3d12_resource_is_buffer(resource))
+        if (allocation->chunk)
         {
-            hr = vkd3d_allocate_buffer_memory(device, resource->u.vk_buffer,
-                    &heap->desc.Properties, heap->desc.Flags,
-                    &heap->vk_memory, &heap->vk_memory_type, &vk_memory_size);
+            if (allocation->chunk->map_ptr)
+                map_ptr = (BYTE *)allocation->chunk->map_ptr + allocation->offset;
         }
-        else
+        /* The mapping is released along with the memory. */
+        else if ((vr = VK_CALL(vkMapMemory(device->vk_device, allocation->vk_memory,
+                0, VK_WHOLE_SIZE, 0, &map_ptr))) < 0)
         {
-            hr = vkd3d_allocate_image_memory(device, resource->u.vk_image,
-                    &heap->desc.Properties, heap->desc.Flags,
-                    &heap->vk_memory, &heap->vk_memory_type, &vk_memory_size);
+            WARN("Failed to map memory, vr %d.\n", vr);
+            vkd3d_free_memory(device, allocation);
+            return hresult_from_vk_result(vr);
         }
 
-        heap->desc.SizeInBytes = vk_memory_size;
-    }
-    else if (heap->buffer_resource)
-    {
-        hr = vkd3d_allocate_buffer_memory(device, heap->buffer_resource->u.vk_buffer,
-                                          &heap->desc.Properties, heap->desc.Flags,
-                                          &heap->vk_memory, &heap->vk_memory_type, &vk_memory_size);
-    }
-    else
-    {
-        /* Allocate generic memory which should hopefully match up with whatever resources
-         * we want to place here. */
-        memory_requirements.size = heap->desc.SizeInBytes;
-        memory_requirements.alignment = heap->desc.Alignment;
-        memory_requirements.memoryTypeBits = ~(uint32_t)0;
-
-        hr = vkd3d_allocate_device_memory(device, &heap->desc.Properties,
-                heap->desc.Flags, &memory_requirements, NULL,
-                &heap->vk_memory, &heap->vk_memory_type);
-    }
-    if (FAILED(hr))
-    {
-        vkd3d_private_store_destroy(&heap->private_store);
-        pthread_mutex_destroy(&heap->mutex);
-        if (heap->buffer_resource)
+        if (!map_ptr)
         {
-            d3d12_resource_decref(heap->buffer_resource);
-            heap->buffer_resource = NULL;
+            WARN("Memory type %u is not host visible.\n", allocation->vk_memory_type);
+            vkd3d_free_memory(device, allocation);
+            return E_INVALIDARG;
         }
-        return hr;
+        *data = map_ptr;
     }
 
-    heap->device = device;
-    if (!heap->is_private)
-        d3d12_device_add_ref(heap->device);
-
     return S_OK;
 }
 
-HRESULT d3d12_heap_create(struct d3d12_device *device, const D3D12_HEAP_DESC *desc,
-        const struct d3d12_resource *resource, struct d3d12_heap **heap)
+/* ID3D12Heap */
+static inline struct d3d12_heap *impl_from_ID3D12Heap(ID3D12Heap *iface)
 {
-    struct d3d12_heap *object;
-    HRESULT hr;
+    return CONTAINING_RECORD(iface, struct d3d12_heap, ID3D12Heap_iface);
+}
 
-    if (!(object = vkd3d_malloc(sizeof(*object))))
-        return E_OUTOFMEMORY;
+static HRESULT STDMETHODCALLTYPE d3d12_heap_QueryInterface(ID3D12Heap *iface,
+        REFIID iid, void **object)
+{
+    TRACE("iface %p, iid %s, object %p.\n", iface, debugstr_guid(iid), object);
 
-    if (FAILED(hr = d3d12_heap_init(object, device, desc, resource)))
+    if (IsEqualGUID(iid, &IID_ID3D12Heap)
+            || IsEqualGUID(iid, &IID_ID3D12Pageable)
+            || IsEqualGUID(iid, &IID_ID3D12DeviceChild)
+            || IsEqualGUID(iid, &IID_ID3D12Object)
+            || IsEqualGUID(iid, &IID_IUnknown))
     {
-        vkd3d_free(object);
-        return hr;
+        ID3D12Heap_AddRef(iface);
+        *object = iface;
+        return S_OK;
     }
 
-    TRACE("Created %s %p.\n", object->is_private ? "private heap" : "heap", object);
+    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(iid));
 
-    *heap = object;
+    *object = NULL;
+    return E_NOINTERFACE;
+}
 
-    return S_OK;
+static ULONG STDMETHODCALLTYPE d3d12_heap_AddRef(ID3D12Heap *iface)
+{
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    ULONG refcount = InterlockedIncrement(&heap->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", heap, refcount);
+
+    assert(!heap->is_private);
+
+    return refcount;
 }
 
-static VkImageType vk_image_type_from_d3d12_resource_dimension(D3D12_RESOURCE_DIMENSION dimension)
+static ULONG d3d12_resource_decref(struct d3d12_resource *resource);
+static void vkd3d_residency_manager_add_heap(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, struct d3d12_heap *heap);
+static void vkd3d_residency_manager_remove_heap(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, struct d3d12_heap *heap);
+
+static void d3d12_heap_destroy(struct d3d12_heap *heap)
 {
-    switch (dimension)
-    {
-        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
-            return VK_IMAGE_TYPE_1D;
-        case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
-            return VK_IMAGE_TYPE_2D;
-        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
-            return VK_IMAGE_TYPE_3D;
-        default:
-            ERR("Invalid resource dimension %#x.\n", dimension);
-            return VK_IMAGE_TYPE_2D;
-    }
+    struct d3d12_device *device = heap->device;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    TRACE("Destroying heap %p.\n", heap);
+
+    if (heap->buffer_resource)
+        d3d12_resource_decref(heap->buffer_resource);
+
+    vkd3d_private_store_destroy(&heap->private_store);
+
+    vkd3d_residency_manager_remove_heap(&device->residency_manager, device, heap);
+
+    /* Suballocated memory stays mapped for the lifetime of its chunk. */
+    if (heap->map_ptr && !heap->allocation.chunk)
+        VK_CALL(vkUnmapMemory(device->vk_device, heap->vk_memory));
+
+    if (heap->is_private)
+        vkd3d_free_memory(device, &heap->allocation);
+    else
+        VK_CALL(vkFreeMemory(device->vk_device, heap->vk_memory, NULL));
+
+    pthread_mutex_destroy(&heap->mutex);
+
+    if (heap->is_private)
+        device = NULL;
+
+    vkd3d_free(heap);
+
+    if (device)
+        d3d12_device_release(device);
 }
 
-VkSampleCountFlagBits vk_samples_from_sample_count(unsigned int sample_count)
+static ULONG STDMETHODCALLTYPE d3d12_heap_Release(ID3D12Heap *iface)
 {
-    switch (sample_count)
-    {
-        case 1:
-            return VK_SAMPLE_COUNT_1_BIT;
-        case 2:
-            return VK_SAMPLE_COUNT_2_BIT;
-        case 4:
-            return VK_SAMPLE_COUNT_4_BIT;
-        case 8:
-            return VK_SAMPLE_COUNT_8_BIT;
-        case 16:
-            return VK_SAMPLE_COUNT_16_BIT;
-        case 32:
-            return VK_SAMPLE_COUNT_32_BIT;
-        case 64:
-            return VK_SAMPLE_COUNT_64_BIT;
-        default:
-            return 0;
-    }
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+    ULONG refcount = InterlockedDecrement(&heap->refcount);
+
+    TRACE("%p decreasing refcount to %u.\n", heap, refcount);
+
+    if (!refcount)
+        d3d12_heap_destroy(heap);
+
+    return refcount;
 }
 
-VkSampleCountFlagBits vk_samples_from_dxgi_sample_desc(const DXGI_SAMPLE_DESC *desc)
+static HRESULT STDMETHODCALLTYPE d3d12_heap_GetPrivateData(ID3D12Heap *iface,
+        REFGUID guid, UINT *data_size, void *data)
 {
-    VkSampleCountFlagBits vk_samples;
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
 
-    if ((vk_samples = vk_samples_from_sample_count(desc->Count)))
-        return vk_samples;
+    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
 
-    FIXME("Unhandled sample count %u.\n", desc->Count);
-    return VK_SAMPLE_COUNT_1_BIT;
+    return vkd3d_get_private_data(&heap->private_store, guid, data_size, data);
 }
 
-HRESULT vkd3d_create_buffer(struct d3d12_device *device,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
-        const D3D12_RESOURCE_DESC *desc, VkBuffer *vk_buffer)
+static HRESULT STDMETHODCALLTYPE d3d12_heap_SetPrivateData(ID3D12Heap *iface,
+        REFGUID guid, UINT data_size, const void *data)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    const bool sparse_resource = !heap_properties;
-    VkBufferCreateInfo buffer_info;
-    D3D12_HEAP_TYPE heap_type;
-    VkResult vr;
-
-    heap_type = heap_properties ? heap_properties->Type : D3D12_HEAP_TYPE_DEFAULT;
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
 
-    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    buffer_info.pNext = NULL;
-    buffer_info.flags = 0;
-    buffer_info.size = desc->Width;
+    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
 
-    if (sparse_resource)
-    {
-        buffer_info.flags |= VK_BUFFER_CREATE_SPARSE_BINDING_BIT;
-        if (device->vk_info.sparse_properties.residencyNonResidentStrict)
-            buffer_info.flags |= VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT;
-    }
+    return vkd3d_set_private_data(&heap->private_store, guid, data_size, data);
+}
 
-    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
-            | VK_BUFFER_USAGE_TRANSFER_DST_BIT
-            | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
-            | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
-            | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
-            | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+static HRESULT STDMETHODCALLTYPE d3d12_heap_SetPrivateDataInterface(ID3D12Heap *iface,
+        REFGUID guid, const IUnknown *data)
+{
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
 
-    if (device->vk_info.EXT_conditional_rendering)
-        buffer_info.usage |= VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT;
+    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
 
-    if (heap_type == D3D12_HEAP_TYPE_DEFAULT && device->vk_info.EXT_transform_feedback)
-    {
-        buffer_info.usage |= VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_BUFFER_BIT_EXT
-                | VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_COUNTER_BUFFER_BIT_EXT;
-    }
+    return vkd3d_set_private_data_interface(&heap->private_store, guid, data);
+}
 
-    if (heap_type == D3D12_HEAP_TYPE_UPLOAD)
-        buffer_info.usage &= ~VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-    else if (heap_type == D3D12_HEAP_TYPE_READBACK)
-        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+static HRESULT STDMETHODCALLTYPE d3d12_heap_SetName(ID3D12Heap *iface, const WCHAR *name)
+{
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
 
-    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
-        buffer_info.usage |= VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
-    if (!(desc->Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE))
-        buffer_info.usage |= VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
+    TRACE("iface %p, name %s.\n", iface, debugstr_w(name, heap->device->wchar_size));
 
-    /* Buffers always have properties of D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS. */
-    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS)
-    {
-        WARN("D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS cannot be set for buffers.\n");
-        return E_INVALIDARG;
-    }
+    /* Suballocated memory is shared with other resources. */
+    if (heap->allocation.chunk)
+        return S_OK;
 
-    if (device->queue_family_count > 1)
-    {
-        buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
-        buffer_info.queueFamilyIndexCount = device->queue_family_count;
-        buffer_info.pQueueFamilyIndices = device->queue_family_indices;
-    }
-    else
-    {
-        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        buffer_info.queueFamilyIndexCount = 0;
-        buffer_info.pQueueFamilyIndices = NULL;
-    }
+    return vkd3d_set_vk_object_name(heap->device, (uint64_t)heap->vk_memory,
+            VK_DEBUG_REPORT_OBJECT_TYPE_DEVICE_MEMORY_EXT, name);
+}
 
-    if (desc->Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
-        FIXME("Unsupported resource flags %#x.\n", desc->Flags);
+static HRESULT STDMETHODCALLTYPE d3d12_heap_GetDevice(ID3D12Heap *iface, REFIID iid, void **device)
+{
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
 
-    if ((vr = VK_CALL(vkCreateBuffer(device->vk_device, &buffer_info, NULL, vk_buffer))) < 0)
-    {
-        WARN("Failed to create Vulkan buffer, vr %d.\n", vr);
-        *vk_buffer = VK_NULL_HANDLE;
-    }
+    TRACE("iface %p, iid %s, device %p.\n", iface, debugstr_guid(iid), device);
 
-    return hresult_from_vk_result(vr);
+    return d3d12_device_query_interface(heap->device, iid, device);
 }
 
-static unsigned int max_miplevel_count(const D3D12_RESOURCE_DESC *desc)
+static D3D12_HEAP_DESC * STDMETHODCALLTYPE d3d12_heap_GetDesc(ID3D12Heap *iface,
+        D3D12_HEAP_DESC *desc)
 {
-    unsigned int size = max(desc->Width, desc->Height);
-    size = max(size, d3d12_resource_desc_get_depth(desc, 0));
-    return vkd3d_log2i(size) + 1;
+    struct d3d12_heap *heap = impl_from_ID3D12Heap(iface);
+
+    TRACE("iface %p, desc %p.\n", iface, desc);
+
+    *desc = heap->desc;
+    return desc;
 }
 
-static const struct vkd3d_format_compatibility_list *vkd3d_get_format_compatibility_list(
-        const struct d3d12_device *device, DXGI_FORMAT dxgi_format)
+static const struct ID3D12HeapVtbl d3d12_heap_vtbl =
 {
-    unsigned int i;
-
-    for (i = 0; i < device->format_compatibility_list_count; ++i)
-    {
-        if (device->format_compatibility_lists[i].typeless_format == dxgi_format)
-            return &device->format_compatibility_lists[i];
-    }
+    /* IUnknown methods */
+    d3d12_heap_QueryInterface,
+    d3d12_heap_AddRef,
+    d3d12_heap_Release,
+    /* ID3D12Object methods */
+    d3d12_heap_GetPrivateData,
+    d3d12_heap_SetPrivateData,
+    d3d12_heap_SetPrivateDataInterface,
+    d3d12_heap_SetName,
+    /* ID3D12DeviceChild methods */
+    d3d12_heap_GetDevice,
+    /* ID3D12Heap methods */
+    d3d12_heap_GetDesc,
+};
 
-    return NULL;
+struct d3d12_heap *unsafe_impl_from_ID3D12Heap(ID3D12Heap *iface)
+{
+    if (!iface)
+        return NULL;
+    assert(iface->lpVtbl == &d3d12_heap_vtbl);
+    return impl_from_ID3D12Heap(iface);
 }
 
-static bool vkd3d_is_linear_tiling_supported(const struct d3d12_device *device, VkImageCreateInfo *image_info)
+static HRESULT d3d12_heap_map(struct d3d12_heap *heap, uint64_t offset,
+        struct d3d12_resource *resource, void **data)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkImageFormatProperties properties;
+    struct d3d12_device *device = heap->device;
+    void *map_ptr;
     VkResult vr;
+    int rc;
 
-    if ((vr = VK_CALL(vkGetPhysicalDeviceImageFormatProperties(device->vk_physical_device, image_info->format,
-            image_info->imageType, VK_IMAGE_TILING_LINEAR, image_info->usage, image_info->flags, &properties))) < 0)
+    /* Heaps stay mapped until they are destroyed, so the common case only
+     * needs a single atomic load. */
+    if (!(map_ptr = vkd3d_atomic_ptr_load(&heap->map_ptr)))
     {
-        if (vr != VK_ERROR_FORMAT_NOT_SUPPORTED)
-            WARN("Failed to get device image format properties, vr %d.\n", vr);
+        if ((rc = pthread_mutex_lock(&heap->mutex)))
+        {
+            ERR("Failed to lock mutex, error %d.\n", rc);
+            if (data)
+                *data = NULL;
+            return hresult_from_errno(rc);
+        }
 
-        return false;
+        if (!(map_ptr = heap->map_ptr))
+        {
+            const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+            /* Host visible chunks are always mapped. */
+            if (heap->allocation.chunk)
+            {
+                WARN("Heap %p is not host visible.\n", heap);
+                pthread_mutex_unlock(&heap->mutex);
+                if (data)
+                    *data = NULL;
+                return E_INVALIDARG;
+            }
+
+            TRACE("Mapping heap %p.\n", heap);
+
+            if ((vr = VK_CALL(vkMapMemory(device->vk_device, heap->vk_memory,
+                    0, VK_WHOLE_SIZE, 0, &map_ptr))) < 0)
+            {
+                WARN("Failed to map device memory, vr %d.\n", vr);
+                pthread_mutex_unlock(&heap->mutex);
+                if (data)
+                    *data = NULL;
+                return hresult_from_vk_result(vr);
+            }
+
+            vkd3d_atomic_ptr_store(&heap->map_ptr, map_ptr);
+        }
+
+        pthread_mutex_unlock(&heap->mutex);
     }
 
-    return image_info->extent.depth <= properties.maxExtent.depth
-            && image_info->mipLevels <= properties.maxMipLevels
-            && image_info->arrayLayers <= properties.maxArrayLayers
-            && (image_info->samples & properties.sampleCounts);
+    if (data)
+        *data = (BYTE *)map_ptr + offset;
+    InterlockedIncrement(&resource->map_count);
+
+    return S_OK;
 }
 
-static HRESULT vkd3d_create_image(struct d3d12_device *device,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
-        const D3D12_RESOURCE_DESC *desc, struct d3d12_resource *resource, VkImage *vk_image)
+static void d3d12_heap_unmap(struct d3d12_heap *heap, struct d3d12_resource *resource)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    const struct vkd3d_format_compatibility_list *compat_list;
-    const bool sparse_resource = !heap_properties;
-    VkImageFormatListCreateInfoKHR format_list;
-    const struct vkd3d_format *format;
-    VkImageCreateInfo image_info;
+    if (InterlockedDecrement(&resource->map_count) < 0)
+    {
+        WARN("Resource %p is not mapped.\n", resource);
+        InterlockedIncrement(&resource->map_count);
+    }
+}
+
+static void d3d12_heap_init_persistent_map(struct d3d12_heap *heap, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     VkResult vr;
 
-    if (!(format = vkd3d_format_from_d3d12_resource_desc(device, desc, 0)))
+    if (heap->map_ptr || heap->desc.Properties.Type == D3D12_HEAP_TYPE_DEFAULT)
+        return;
+    if (!(device->memory_properties.memoryTypes[heap->vk_memory_type].propertyFlags
+            & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT))
+        return;
+
+    /* Failures are not fatal, d3d12_heap_map() tries again. */
+    if ((vr = VK_CALL(vkMapMemory(device->vk_device, heap->vk_memory,
+            0, VK_WHOLE_SIZE, 0, &heap->map_ptr))) < 0)
     {
-        WARN("Invalid DXGI format %#x.\n", desc->Format);
-        return E_INVALIDARG;
+        WARN("Failed to map device memory, vr %d.\n", vr);
+        heap->map_ptr = NULL;
     }
+}
 
-    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    image_info.pNext = NULL;
-    image_info.flags = 0;
-    if (!(desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) && format->type == VKD3D_FORMAT_TYPE_TYPELESS)
+static HRESULT validate_heap_desc(const D3D12_HEAP_DESC *desc, const struct d3d12_resource *resource)
+{
+    if (!resource && !desc->SizeInBytes)
     {
-        image_info.flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
-
-        /* Format compatibility rules are more relaxed for UAVs. */
-        if (!(desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
-                && (compat_list = vkd3d_get_format_compatibility_list(device, desc->Format)))
-        {
-            format_list.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO_KHR;
-            format_list.pNext = NULL;
-            format_list.viewFormatCount = compat_list->format_count;
-            format_list.pViewFormats = compat_list->vk_formats;
+        WARN("Invalid size %"PRIu64".\n", desc->SizeInBytes);
+        return E_INVALIDARG;
+    }
 
-            image_info.pNext = &format_list;
-        }
+    if (desc->Alignment != D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT
+            && desc->Alignment != D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT)
+    {
+        WARN("Invalid alignment %"PRIu64".\n", desc->Alignment);
+        return E_INVALIDARG;
     }
-    if (desc->Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D
-            && desc->Width == desc->Height && desc->DepthOrArraySize >= 6
-            && desc->SampleDesc.Count == 1)
-        image_info.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
-    if (desc->Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
-        image_info.flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT_KHR;
 
-    if (sparse_resource)
+    if (!resource && desc->Flags & D3D12_HEAP_FLAG_ALLOW_DISPLAY)
     {
-        image_info.flags |= VK_IMAGE_CREATE_SPARSE_BINDING_BIT;
-        if (device->vk_info.sparse_properties.residencyNonResidentStrict)
-            image_info.flags |= VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+        WARN("D3D12_HEAP_FLAG_ALLOW_DISPLAY is only for committed resources.\n");
+        return E_INVALIDARG;
     }
 
-    image_info.imageType = vk_image_type_from_d3d12_resource_dimension(desc->Dimension);
-    image_info.format = format->vk_format;
-    image_info.extent.width = desc->Width;
-    image_info.extent.height = desc->Height;
+    return S_OK;
+}
 
-    if (desc->Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+static HRESULT d3d12_resource_create(struct d3d12_device *device,
+                                     const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+                                     const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
+                                     const D3D12_CLEAR_VALUE *optimized_clear_value, bool placed,
+                                     struct d3d12_resource **resource);
+
+static HRESULT d3d12_heap_init(struct d3d12_heap *heap,
+        struct d3d12_device *device, const D3D12_HEAP_DESC *desc, const struct d3d12_resource *resource)
+{
+    VkMemoryRequirements memory_requirements;
+    VkDeviceSize vk_memory_size;
+    HRESULT hr;
+    int rc;
+    bool buffers_allowed;
+    D3D12_RESOURCE_DESC resource_desc;
+    D3D12_RESOURCE_STATES initial_resource_state;
+
+    heap->ID3D12Heap_iface.lpVtbl = &d3d12_heap_vtbl;
+    heap->refcount = 1;
+
+    heap->is_private = !!resource;
+
+    heap->desc = *desc;
+
+    heap->map_ptr = NULL;
+    memset(&heap->allocation, 0, sizeof(heap->allocation));
+    heap->buffer_resource = NULL;
+
+    if (!heap->desc.Properties.CreationNodeMask)
+        heap->desc.Properties.CreationNodeMask = 1;
+    if (!heap->desc.Properties.VisibleNodeMask)
+        heap->desc.Properties.VisibleNodeMask = 1;
+
+    debug_ignored_node_mask(heap->desc.Properties.CreationNodeMask);
+    debug_ignored_node_mask(heap->desc.Properties.VisibleNodeMask);
+
+    if (!heap->desc.Alignment)
+        heap->desc.Alignment = D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+
+    if (FAILED(hr = validate_heap_desc(&heap->desc, resource)))
+        return hr;
+
+    if ((rc = pthread_mutex_init(&heap->mutex, NULL)))
     {
-        image_info.extent.depth = desc->DepthOrArraySize;
-        image_info.arrayLayers = 1;
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
     }
-    else
+
+    if (FAILED(hr = vkd3d_private_store_init(&heap->private_store)))
     {
-        image_info.extent.depth = 1;
-        image_info.arrayLayers = desc->DepthOrArraySize;
+        pthread_mutex_destroy(&heap->mutex);
+        return hr;
     }
 
-    image_info.mipLevels = min(desc->MipLevels, max_miplevel_count(desc));
-    image_info.samples = vk_samples_from_dxgi_sample_desc(&desc->SampleDesc);
-
-    if (sparse_resource)
+    buffers_allowed = !(heap->desc.Flags & D3D12_HEAP_FLAG_DENY_BUFFERS);
+    if (buffers_allowed && !resource)
     {
-        if (desc->Layout != D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE)
+        /* Create a single omnipotent buffer which fills the entire heap.
+         * Whenever we place buffer resources on this heap, we'll just offset this VkBuffer.
+         * This allows us to keep VA space somewhat sane, and keeps number of (limited) VA allocations down.
+         * One possible downside is that the buffer might be slightly slower to access,
+         * but D3D12 has very lenient usage flags for buffers. */
+
+        memset(&resource_desc, 0, sizeof(resource_desc));
+        resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        resource_desc.Width = desc->SizeInBytes;
+        resource_desc.Height = 1;
+        resource_desc.DepthOrArraySize = 1;
+        resource_desc.MipLevels = 1;
+        resource_desc.SampleDesc.Count = 1;
+        resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+
+        switch (desc->Properties.Type)
         {
-            WARN("D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE must be used for reserved texture.\n");
-            return E_INVALIDARG;
+        case D3D12_HEAP_TYPE_UPLOAD:
+            initial_resource_state = D3D12_RESOURCE_STATE_GENERIC_READ;
+            break;
+
+        case D3D12_HEAP_TYPE_READBACK:
+            initial_resource_state = D3D12_RESOURCE_STATE_COPY_DEST;
+            break;
+
+        default:
+            /* Upload and readback heaps do not allow UAV access, only enable this flag for other heaps. */
+            resource_desc.Flags |= D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS;
+            initial_resource_state = D3D12_RESOURCE_STATE_COMMON;
+            break;
         }
 
-        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        if (FAILED(hr = d3d12_resource_create(device, &desc->Properties, desc->Flags,
+                                              &resource_desc, initial_resource_state,
+                                              NULL, false, &heap->buffer_resource)))
+        {
+            heap->buffer_resource = NULL;
+            return hr;
+        }
+        /* This internal resource should not own a reference on the device.
+         * d3d12_resource_create takes a reference on the device. */
+        d3d12_device_release(device);
     }
-    else if (desc->Layout == D3D12_TEXTURE_LAYOUT_UNKNOWN)
+
+    if (resource)
     {
-        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        if (SUCCEEDED(hr = vkd3d_allocate_resource_heap_memory(device, resource,
+                &heap->desc.Properties, heap->desc.Flags, &heap->allocation)))
+        {
+            heap->vk_memory = heap->allocation.vk_memory;
+            heap->vk_memory_type = heap->allocation.vk_memory_type;
+            heap->desc.SizeInBytes = heap->allocation.size;
+            if (heap->allocation.chunk && heap->allocation.chunk->map_ptr)
+                heap->map_ptr = (BYTE *)heap->allocation.chunk->map_ptr + heap->allocation.offset;
+        }
     }
-    else if (desc->Layout == D3D12_TEXTURE_LAYOUT_ROW_MAJOR)
+    else if (heap->buffer_resource)
     {
-        image_info.tiling = VK_IMAGE_TILING_LINEAR;
+        hr = vkd3d_allocate_buffer_memory(device, heap->buffer_resource->u.vk_buffer,
+                                          &heap->desc.Properties, heap->desc.Flags,
+                                          &heap->vk_memory, &heap->vk_memory_type, &vk_memory_size);
     }
     else
     {
-        FIXME("Unsupported layout %#x.\n", desc->Layout);
-        return E_NOTIMPL;
-    }
-
-    image_info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
-    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
-        image_info.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
-        image_info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
-        image_info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
-    if (!(desc->Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE))
-        image_info.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+        /* Allocate generic memory which should hopefully match up with whatever resources
+         * we want to place here. */
+        memory_requirements.size = heap->desc.SizeInBytes;
+        memory_requirements.alignment = heap->desc.Alignment;
+        memory_requirements.memoryTypeBits = ~(uint32_t)0;
 
-    if ((desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS) && device->queue_family_count > 1)
-    {
-        TRACE("Creating image with VK_SHARING_MODE_CONCURRENT.\n");
-        image_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
-        image_info.queueFamilyIndexCount = device->queue_family_count;
-        image_info.pQueueFamilyIndices = device->queue_family_indices;
-    }
-    else
-    {
-        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-        image_info.queueFamilyIndexCount = 0;
-        image_info.pQueueFamilyIndices = NULL;
+        hr = vkd3d_allocate_device_memory(device, &heap->desc.Properties,
+                heap->desc.Flags, &memory_requirements, NULL,
+                &heap->vk_memory, &heap->vk_memory_type);
     }
-
-    if (heap_properties && is_cpu_accessible_heap(heap_properties))
+    if (FAILED(hr))
     {
-        image_info.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
-
-        if (vkd3d_is_linear_tiling_supported(device, &image_info))
+        vkd3d_private_store_destroy(&heap->private_store);
+        pthread_mutex_destroy(&heap->mutex);
+        if (heap->buffer_resource)
         {
-            /* Required for ReadFromSubresource(). */
-            WARN("Forcing VK_IMAGE_TILING_LINEAR for CPU readable texture.\n");
-            image_info.tiling = VK_IMAGE_TILING_LINEAR;
+            d3d12_resource_decref(heap->buffer_resource);
+            heap->buffer_resource = NULL;
         }
-    }
-    else
-    {
-        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        return hr;
     }
 
-    if (resource && image_info.tiling == VK_IMAGE_TILING_LINEAR)
-        resource->flags |= VKD3D_RESOURCE_LINEAR_TILING;
+    d3d12_heap_init_persistent_map(heap, device);
 
-    if ((vr = VK_CALL(vkCreateImage(device->vk_device, &image_info, NULL, vk_image))) < 0)
-        WARN("Failed to create Vulkan image, vr %d.\n", vr);
+    vkd3d_residency_manager_add_heap(&device->residency_manager, device, heap);
 
-    return hresult_from_vk_result(vr);
+    heap->device = device;
+    if (!heap->is_private)
+        d3d12_device_add_ref(heap->device);
+
+    return S_OK;
 }
 
-HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
-        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_ALLOCATION_INFO *allocation_info)
+HRESULT d3d12_heap_create(struct d3d12_device *device, const D3D12_HEAP_DESC *desc,
+        const struct d3d12_resource *resource, struct d3d12_heap **heap)
 {
-    static const D3D12_HEAP_PROPERTIES heap_properties = {D3D12_HEAP_TYPE_DEFAULT};
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    D3D12_RESOURCE_DESC validated_desc;
-    VkMemoryRequirements requirements;
-    VkImage vk_image;
+    struct d3d12_heap *object;
     HRESULT hr;
 
-    assert(desc->Dimension != D3D12_RESOURCE_DIMENSION_BUFFER);
-    assert(d3d12_resource_validate_desc(desc) == S_OK);
+    if (!(object = vkd3d_malloc(sizeof(*object))))
+        return E_OUTOFMEMORY;
+
+    if (FAILED(hr = d3d12_heap_init(object, device, desc, resource)))
+    {
+        vkd3d_free(object);
+        return hr;
+    }
+
+    TRACE("Created %s %p.\n", object->is_private ? "private heap" : "heap", object);
+
+    *heap = object;
+
+    return S_OK;
+}
+
+static VkImageType vk_image_type_from_d3d12_resource_dimension(D3D12_RESOURCE_DIMENSION dimension)
+{
+    switch (dimension)
+    {
+        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+            return VK_IMAGE_TYPE_1D;
+        case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+            return VK_IMAGE_TYPE_2D;
+        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+            return VK_IMAGE_TYPE_3D;
+        default:
+            ERR("Invalid resource dimension %#x.\n", dimension);
+            return VK_IMAGE_TYPE_2D;
+    }
+}
+
+VkSampleCountFlagBits vk_samples_from_sample_count(unsigned int sample_count)
+{
+    switch (sample_count)
+    {
+        case 1:
+            return VK_SAMPLE_COUNT_1_BIT;
+        case 2:
+            return VK_SAMPLE_COUNT_2_BIT;
+        case 4:
+            return VK_SAMPLE_COUNT_4_BIT;
+        case 8:
+            return VK_SAMPLE_COUNT_8_BIT;
+        case 16:
+            return VK_SAMPLE_COUNT_16_BIT;
+        case 32:
+            return VK_SAMPLE_COUNT_32_BIT;
+        case 64:
+            return VK_SAMPLE_COUNT_64_BIT;
+        default:
+            return 0;
+    }
+}
+
+VkSampleCountFlagBits vk_samples_from_dxgi_sample_desc(const DXGI_SAMPLE_DESC *desc)
+{
+    VkSampleCountFlagBits vk_samples;
+
+    if ((vk_samples = vk_samples_from_sample_count(desc->Count)))
+        return vk_samples;
+
+    FIXME("Unhandled sample count %u.\n", desc->Count);
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+HRESULT vkd3d_create_buffer(struct d3d12_device *device,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        const D3D12_RESOURCE_DESC *desc, VkBuffer *vk_buffer)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    const bool sparse_resource = !heap_properties;
+    VkBufferCreateInfo buffer_info;
+    D3D12_HEAP_TYPE heap_type;
+    VkResult vr;
+
+    heap_type = heap_properties ? heap_properties->Type : D3D12_HEAP_TYPE_DEFAULT;
+
+    buffer_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffer_info.pNext = NULL;
+    buffer_info.flags = 0;
+    buffer_info.size = desc->Width;
+
+    if (sparse_resource)
+    {
+        buffer_info.flags |= VK_BUFFER_CREATE_SPARSE_BINDING_BIT;
+        if (device->feature_options.TiledResourcesTier
+                || device->vk_info.sparse_properties.residencyNonResidentStrict)
+            buffer_info.flags |= VK_BUFFER_CREATE_SPARSE_RESIDENCY_BIT;
+    }
+
+    buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT
+            | VK_BUFFER_USAGE_TRANSFER_DST_BIT
+            | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+            | VK_BUFFER_USAGE_INDEX_BUFFER_BIT
+            | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT
+            | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+    if (device->vk_info.EXT_conditional_rendering)
+        buffer_info.usage |= VK_BUFFER_USAGE_CONDITIONAL_RENDERING_BIT_EXT;
+
+    if (heap_type == D3D12_HEAP_TYPE_DEFAULT && device->vk_info.EXT_transform_feedback)
+    {
+        buffer_info.usage |= VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_BUFFER_BIT_EXT
+                | VK_BUFFER_USAGE_TRANSFORM_FEEDBACK_COUNTER_BUFFER_BIT_EXT;
+    }
+
+    if (heap_type == D3D12_HEAP_TYPE_UPLOAD)
+        buffer_info.usage &= ~VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    else if (heap_type == D3D12_HEAP_TYPE_READBACK)
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
+        buffer_info.usage |= VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT;
+    if (!(desc->Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE))
+        buffer_info.usage |= VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT;
+
+    /* Buffers always have properties of D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS. */
+    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS)
+    {
+        WARN("D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS cannot be set for buffers.\n");
+        return E_INVALIDARG;
+    }
+
+    if (device->queue_family_count > 1)
+    {
+        buffer_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        buffer_info.queueFamilyIndexCount = device->queue_family_count;
+        buffer_info.pQueueFamilyIndices = device->queue_family_indices;
+    }
+    else
+    {
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        buffer_info.queueFamilyIndexCount = 0;
+        buffer_info.pQueueFamilyIndices = NULL;
+    }
+
+    if (desc->Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        FIXME("Unsupported resource flags %#x.\n", desc->Flags);
+
+    if ((vr = VK_CALL(vkCreateBuffer(device->vk_device, &buffer_info, NULL, vk_buffer))) < 0)
+    {
+        WARN("Failed to create Vulkan buffer, vr %d.\n", vr);
+        *vk_buffer = VK_NULL_HANDLE;
+    }
+
+    return hresult_from_vk_result(vr);
+}
+
+static unsigned int max_miplevel_count(const D3D12_RESOURCE_DESC *desc)
+{
+    unsigned int size = max(desc->Width, desc->Height);
+    size = max(size, d3d12_resource_desc_get_depth(desc, 0));
+    return vkd3d_log2i(size) + 1;
+}
+
+static const struct vkd3d_format_compatibility_list *vkd3d_get_format_compatibility_list(
+        const struct d3d12_device *device, DXGI_FORMAT dxgi_format)
+{
+    unsigned int i;
+
+    for (i = 0; i < device->format_compatibility_list_count; ++i)
+    {
+        if (device->format_compatibility_lists[i].typeless_format == dxgi_format)
+            return &device->format_compatibility_lists[i];
+    }
+
+    return NULL;
+}
+
+static bool vkd3d_is_linear_tiling_supported(const struct d3d12_device *device, VkImageCreateInfo *image_info)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkImageFormatProperties properties;
+    VkResult vr;
+
+    if ((vr = VK_CALL(vkGetPhysicalDeviceImageFormatProperties(device->vk_physical_device, image_info->format,
+            image_info->imageType, VK_IMAGE_TILING_LINEAR, image_info->usage, image_info->flags, &properties))) < 0)
+    {
+        if (vr != VK_ERROR_FORMAT_NOT_SUPPORTED)
+            WARN("Failed to get device image format properties, vr %d.\n", vr);
+
+        return false;
+    }
+
+    return image_info->extent.depth <= properties.maxExtent.depth
+            && image_info->mipLevels <= properties.maxMipLevels
+            && image_info->arrayLayers <= properties.maxArrayLayers
+            && (image_info->samples & properties.sampleCounts);
+}
+
+static HRESULT vkd3d_create_image(struct d3d12_device *device,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        const D3D12_RESOURCE_DESC *desc, struct d3d12_resource *resource, VkImage *vk_image)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    const struct vkd3d_format_compatibility_list *compat_list;
+    const bool sparse_resource = !heap_properties;
+    VkImageFormatListCreateInfoKHR format_list;
+    const struct vkd3d_format *format;
+    VkImageCreateInfo image_info;
+    VkResult vr;
+
+    if (!(format = vkd3d_format_from_d3d12_resource_desc(device, desc, 0)))
+    {
+        WARN("Invalid DXGI format %#x.\n", desc->Format);
+        return E_INVALIDARG;
+    }
+
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.pNext = NULL;
+    image_info.flags = 0;
+    if (!(desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL) && format->type == VKD3D_FORMAT_TYPE_TYPELESS)
+    {
+        image_info.flags |= VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+
+        /* Format compatibility rules are more relaxed for UAVs. */
+        if (!(desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
+                && (compat_list = vkd3d_get_format_compatibility_list(device, desc->Format)))
+        {
+            format_list.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_LIST_CREATE_INFO_KHR;
+            format_list.pNext = NULL;
+            format_list.viewFormatCount = compat_list->format_count;
+            format_list.pViewFormats = compat_list->vk_formats;
+
+            image_info.pNext = &format_list;
+        }
+    }
+    if (desc->Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE2D
+            && desc->Width == desc->Height && desc->DepthOrArraySize >= 6
+            && desc->SampleDesc.Count == 1)
+        image_info.flags |= VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT;
+    if (desc->Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+        image_info.flags |= VK_IMAGE_CREATE_2D_ARRAY_COMPATIBLE_BIT_KHR;
+
+    if (sparse_resource)
+    {
+        image_info.flags |= VK_IMAGE_CREATE_SPARSE_BINDING_BIT;
+        if (device->feature_options.TiledResourcesTier
+                || device->vk_info.sparse_properties.residencyNonResidentStrict)
+            image_info.flags |= VK_IMAGE_CREATE_SPARSE_RESIDENCY_BIT;
+    }
+
+    image_info.imageType = vk_image_type_from_d3d12_resource_dimension(desc->Dimension);
+    image_info.format = format->vk_format;
+    image_info.extent.width = desc->Width;
+    image_info.extent.height = desc->Height;
+
+    if (desc->Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D)
+    {
+        image_info.extent.depth = desc->DepthOrArraySize;
+        image_info.arrayLayers = 1;
+    }
+    else
+    {
+        image_info.extent.depth = 1;
+        image_info.arrayLayers = desc->DepthOrArraySize;
+    }
+
+    image_info.mipLevels = min(desc->MipLevels, max_miplevel_count(desc));
+    image_info.samples = vk_samples_from_dxgi_sample_desc(&desc->SampleDesc);
+
+    if (sparse_resource)
+    {
+        if (desc->Layout != D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE)
+        {
+            WARN("D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE must be used for reserved texture.\n");
+            return E_INVALIDARG;
+        }
+
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    }
+    else if (desc->Layout == D3D12_TEXTURE_LAYOUT_UNKNOWN)
+    {
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    }
+    else if (desc->Layout == D3D12_TEXTURE_LAYOUT_ROW_MAJOR)
+    {
+        image_info.tiling = VK_IMAGE_TILING_LINEAR;
+    }
+    else
+    {
+        FIXME("Unsupported layout %#x.\n", desc->Layout);
+        return E_NOTIMPL;
+    }
+
+    image_info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
+        image_info.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL)
+        image_info.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS)
+        image_info.usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+    if (!(desc->Flags & D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE))
+        image_info.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+
+    if ((desc->Flags & D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS) && device->queue_family_count > 1)
+    {
+        TRACE("Creating image with VK_SHARING_MODE_CONCURRENT.\n");
+        image_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        image_info.queueFamilyIndexCount = device->queue_family_count;
+        image_info.pQueueFamilyIndices = device->queue_family_indices;
+    }
+    else
+    {
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.queueFamilyIndexCount = 0;
+        image_info.pQueueFamilyIndices = NULL;
+    }
+
+    if (heap_properties && is_cpu_accessible_heap(heap_properties))
+    {
+        image_info.initialLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+
+        if (vkd3d_is_linear_tiling_supported(device, &image_info))
+        {
+            /* Required for ReadFromSubresource(). */
+            WARN("Forcing VK_IMAGE_TILING_LINEAR for CPU readable texture.\n");
+            image_info.tiling = VK_IMAGE_TILING_LINEAR;
+        }
+    }
+    else
+    {
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    if (resource && image_info.tiling == VK_IMAGE_TILING_LINEAR)
+        resource->flags |= VKD3D_RESOURCE_LINEAR_TILING;
+
+    if ((vr = VK_CALL(vkCreateImage(device->vk_device, &image_info, NULL, vk_image))) < 0)
+        WARN("Failed to create Vulkan image, vr %d.\n", vr);
+
+    return hresult_from_vk_result(vr);
+}
+
+HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
+        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_ALLOCATION_INFO *allocation_info)
+{
+    static const D3D12_HEAP_PROPERTIES heap_properties = {D3D12_HEAP_TYPE_DEFAULT};
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    D3D12_RESOURCE_DESC validated_desc;
+    VkMemoryRequirements requirements;
+    VkImage vk_image;
+    HRESULT hr;
+
+    assert(desc->Dimension != D3D12_RESOURCE_DIMENSION_BUFFER);
+    assert(d3d12_resource_validate_desc(desc) == S_OK);
+
+    if (!desc->MipLevels)
+    {
+        validated_desc = *desc;
+        validated_desc.MipLevels = max_miplevel_count(desc);
+        desc = &validated_desc;
+    }
+
+    /* XXX: We have to create an image to get its memory requirements. */
+    if (SUCCEEDED(hr = vkd3d_create_image(device, &heap_properties, 0, desc, NULL, &vk_image)))
+    {
+        VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, &requirements));
+        VK_CALL(vkDestroyImage(device->vk_device, vk_image, NULL));
+
+        allocation_info->SizeInBytes = requirements.size;
+        allocation_info->Alignment = requirements.alignment;
+    }
+
+    return hr;
+}
+
+static HRESULT vkd3d_view_cache_init(struct vkd3d_view_cache *cache);
+static void vkd3d_view_cache_cleanup(struct vkd3d_view_cache *cache, struct d3d12_device *device);
+
+static void d3d12_resource_destroy(struct d3d12_resource *resource, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    if (resource->flags & VKD3D_RESOURCE_EXTERNAL)
+        return;
+
+    if (!(resource->flags & VKD3D_RESOURCE_PLACED_BUFFER))
+    {
+        if (resource->gpu_address)
+            vkd3d_gpu_va_allocator_free(&device->gpu_va_allocator, resource->gpu_address);
+
+        if (d3d12_resource_is_buffer(resource))
+            VK_CALL(vkDestroyBuffer(device->vk_device, resource->u.vk_buffer, NULL));
+        else
+            VK_CALL(vkDestroyImage(device->vk_device, resource->u.vk_image, NULL));
+    }
+
+    if (resource->flags & VKD3D_RESOURCE_SPARSE)
+    {
+        VK_CALL(vkFreeMemory(device->vk_device, resource->sparse.vk_metadata_memory, NULL));
+        vkd3d_free(resource->sparse.tiles);
+        vkd3d_free(resource->sparse.tilings);
+    }
+
+    if (resource->flags & VKD3D_RESOURCE_DEDICATED_HEAP)
+        d3d12_heap_destroy(resource->heap);
+}
+
+static ULONG d3d12_resource_incref(struct d3d12_resource *resource)
+{
+    ULONG refcount = InterlockedIncrement(&resource->internal_refcount);
+
+    TRACE("%p increasing refcount to %u.\n", resource, refcount);
+
+    return refcount;
+}
+
+static ULONG d3d12_resource_decref(struct d3d12_resource *resource)
+{
+    ULONG refcount = InterlockedDecrement(&resource->internal_refcount);
+
+    TRACE("%p decreasing refcount to %u.\n", resource, refcount);
+
+    if (!refcount)
+    {
+        struct d3d12_device *device = resource->device;
+
+        vkd3d_view_cache_cleanup(&resource->view_cache, device);
+        vkd3d_private_store_destroy(&resource->private_store);
+        d3d12_resource_destroy(resource, device);
+        vkd3d_object_pool_free(&device->resource_pool, resource);
+    }
+
+    return refcount;
+}
+
+bool d3d12_resource_is_cpu_accessible(const struct d3d12_resource *resource)
+{
+    return resource->heap && is_cpu_accessible_heap(&resource->heap->desc.Properties);
+}
+
+static bool d3d12_resource_validate_box(const struct d3d12_resource *resource,
+        unsigned int sub_resource_idx, const D3D12_BOX *box)
+{
+    unsigned int mip_level = sub_resource_idx % resource->desc.MipLevels;
+    struct d3d12_device *device = resource->device;
+    const struct vkd3d_format *vkd3d_format;
+    uint32_t width_mask, height_mask;
+    uint64_t width, height, depth;
+
+    width = d3d12_resource_desc_get_width(&resource->desc, mip_level);
+    height = d3d12_resource_desc_get_height(&resource->desc, mip_level);
+    depth = d3d12_resource_desc_get_depth(&resource->desc, mip_level);
+
+    vkd3d_format = vkd3d_format_from_d3d12_resource_desc(device, &resource->desc, 0);
+    assert(vkd3d_format);
+    width_mask = vkd3d_format->block_width - 1;
+    height_mask = vkd3d_format->block_height - 1;
+
+    return box->left <= width && box->right <= width
+            && box->top <= height && box->bottom <= height
+            && box->front <= depth && box->back <= depth
+            && !(box->left & width_mask)
+            && !(box->right & width_mask)
+            && !(box->top & height_mask)
+            && !(box->bottom & height_mask);
+}
+
+static void d3d12_resource_get_level_box(const struct d3d12_resource *resource,
+        unsigned int level, D3D12_BOX *box)
+{
+    box->left = 0;
+    box->top = 0;
+    box->front = 0;
+    box->right = d3d12_resource_desc_get_width(&resource->desc, level);
+    box->bottom = d3d12_resource_desc_get_height(&resource->desc, level);
+    box->back = d3d12_resource_desc_get_depth(&resource->desc, level);
+}
+
+/* Transfer context */
+/* A multiple of every texel block size, so that slots are suitably aligned
+ * for buffer image copies. */
+#define VKD3D_TRANSFER_SLOT_SIZE 0x180000
+
+HRESULT vkd3d_transfer_context_init(struct vkd3d_transfer_context *context,
+        struct d3d12_device *device)
+{
+    int rc;
+
+    memset(context, 0, sizeof(*context));
+
+    if ((rc = pthread_mutex_init(&context->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    context->queue = d3d12_device_get_vkd3d_queue(device, D3D12_COMMAND_LIST_TYPE_COPY);
+
+    return S_OK;
+}
+
+void vkd3d_transfer_context_cleanup(struct vkd3d_transfer_context *context,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(context->slots); ++i)
+        VK_CALL(vkDestroyFence(device->vk_device, context->slots[i].vk_fence, NULL));
+    VK_CALL(vkDestroyCommandPool(device->vk_device, context->vk_command_pool, NULL));
+    if (context->mapped)
+        VK_CALL(vkUnmapMemory(device->vk_device, context->vk_memory));
+    VK_CALL(vkFreeMemory(device->vk_device, context->vk_memory, NULL));
+    VK_CALL(vkDestroyBuffer(device->vk_device, context->vk_buffer, NULL));
+
+    pthread_mutex_destroy(&context->mutex);
+}
+
+/* Vulkan objects are created on first use, since most applications never
+ * access optimally tiled textures from the CPU. */
+static HRESULT vkd3d_transfer_context_create_resources(struct vkd3d_transfer_context *context,
+        struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkCommandBuffer vk_command_buffers[VKD3D_TRANSFER_SLOT_COUNT];
+    VkCommandBufferAllocateInfo command_buffer_info;
+    VkCommandPoolCreateInfo command_pool_info;
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_RESOURCE_DESC buffer_desc;
+    VkFenceCreateInfo fence_info;
+    unsigned int i;
+    VkResult vr;
+    HRESULT hr;
+
+    if (context->mapped)
+        return S_OK;
+
+    if (!context->vk_command_pool)
+    {
+        command_pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        command_pool_info.pNext = NULL;
+        command_pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        command_pool_info.queueFamilyIndex = context->queue->vk_family_index;
+
+        if ((vr = VK_CALL(vkCreateCommandPool(device->vk_device, &command_pool_info,
+                NULL, &context->vk_command_pool))) < 0)
+        {
+            WARN("Failed to create Vulkan command pool, vr %d.\n", vr);
+            context->vk_command_pool = VK_NULL_HANDLE;
+            return hresult_from_vk_result(vr);
+        }
+
+        command_buffer_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        command_buffer_info.pNext = NULL;
+        command_buffer_info.commandPool = context->vk_command_pool;
+        command_buffer_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        command_buffer_info.commandBufferCount = ARRAY_SIZE(vk_command_buffers);
+
+        if ((vr = VK_CALL(vkAllocateCommandBuffers(device->vk_device, &command_buffer_info, vk_command_buffers))) < 0)
+        {
+            WARN("Failed to allocate Vulkan command buffers, vr %d.\n", vr);
+            VK_CALL(vkDestroyCommandPool(device->vk_device, context->vk_command_pool, NULL));
+            context->vk_command_pool = VK_NULL_HANDLE;
+            return hresult_from_vk_result(vr);
+        }
+
+        for (i = 0; i < ARRAY_SIZE(context->slots); ++i)
+            context->slots[i].vk_command_buffer = vk_command_buffers[i];
+    }
+
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.pNext = NULL;
+    fence_info.flags = 0;
+
+    for (i = 0; i < ARRAY_SIZE(context->slots); ++i)
+    {
+        if (context->slots[i].vk_fence)
+            continue;
+
+        if ((vr = VK_CALL(vkCreateFence(device->vk_device, &fence_info, NULL, &context->slots[i].vk_fence))) < 0)
+        {
+            WARN("Failed to create Vulkan fence, vr %d.\n", vr);
+            context->slots[i].vk_fence = VK_NULL_HANDLE;
+            return hresult_from_vk_result(vr);
+        }
+    }
+
+    if (!context->vk_buffer)
+    {
+        /* Reads are much faster from cached memory, and writes to it are
+         * no slower than to write-combined memory for streaming copies. */
+        memset(&heap_properties, 0, sizeof(heap_properties));
+        heap_properties.Type = D3D12_HEAP_TYPE_READBACK;
+
+        buffer_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+        buffer_desc.Alignment = 0;
+        buffer_desc.Width = VKD3D_TRANSFER_SLOT_SIZE * VKD3D_TRANSFER_SLOT_COUNT;
+        buffer_desc.Height = 1;
+        buffer_desc.DepthOrArraySize = 1;
+        buffer_desc.MipLevels = 1;
+        buffer_desc.Format = DXGI_FORMAT_UNKNOWN;
+        buffer_desc.SampleDesc.Count = 1;
+        buffer_desc.SampleDesc.Quality = 0;
+        buffer_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+        buffer_desc.Flags = D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE;
+
+        if (FAILED(hr = vkd3d_create_buffer(device, &heap_properties, D3D12_HEAP_FLAG_NONE,
+                &buffer_desc, &context->vk_buffer)))
+            return hr;
+        if (FAILED(hr = vkd3d_allocate_buffer_memory(device, context->vk_buffer,
+                &heap_properties, D3D12_HEAP_FLAG_NONE, &context->vk_memory, NULL, NULL)))
+        {
+            VK_CALL(vkDestroyBuffer(device->vk_device, context->vk_buffer, NULL));
+            context->vk_buffer = VK_NULL_HANDLE;
+            return hr;
+        }
+    }
+
+    if ((vr = VK_CALL(vkMapMemory(device->vk_device, context->vk_memory,
+            0, VK_WHOLE_SIZE, 0, (void **)&context->mapped))) < 0)
+    {
+        WARN("Failed to map staging memory, vr %d.\n", vr);
+        context->mapped = NULL;
+        return hresult_from_vk_result(vr);
+    }
+
+    return S_OK;
+}
+
+static HRESULT vkd3d_transfer_context_wait_slot(struct vkd3d_transfer_context *context,
+        struct d3d12_device *device, const struct vkd3d_format *format, unsigned int slot_idx)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_transfer_slot *slot = &context->slots[slot_idx];
+    VkResult vr;
+
+    if (!slot->pending)
+        return S_OK;
+
+    if ((vr = VK_CALL(vkWaitForFences(device->vk_device, 1, &slot->vk_fence, VK_TRUE, UINT64_MAX))) < 0)
+    {
+        ERR("Failed to wait for fence, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
+    VK_CALL(vkResetFences(device->vk_device, 1, &slot->vk_fence));
+    slot->pending = false;
+
+    if (slot->dst_data)
+    {
+        vkd3d_format_copy_data(format, &context->mapped[slot_idx * VKD3D_TRANSFER_SLOT_SIZE],
+                slot->row_pitch, slot->slice_pitch, slot->dst_data, slot->dst_row_pitch, slot->dst_slice_pitch,
+                slot->width, slot->height, slot->depth, false);
+        slot->dst_data = NULL;
+    }
+
+    return S_OK;
+}
+
+static HRESULT vkd3d_transfer_context_submit_slot(struct vkd3d_transfer_context *context,
+        struct d3d12_device *device, struct d3d12_resource *resource, const VkBufferImageCopy *region,
+        unsigned int slot_idx, bool read)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_transfer_slot *slot = &context->slots[slot_idx];
+    VkCommandBufferBeginInfo begin_info;
+    VkImageMemoryBarrier image_barrier;
+    VkMemoryBarrier memory_barrier;
+    VkSubmitInfo submit_info;
+    VkQueue vk_queue;
+    VkResult vr;
+
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.pNext = NULL;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    begin_info.pInheritanceInfo = NULL;
+
+    if ((vr = VK_CALL(vkBeginCommandBuffer(slot->vk_command_buffer, &begin_info))) < 0)
+    {
+        WARN("Failed to begin command buffer, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
+
+    /* CPU access requires textures to be in the COMMON state, i.e.
+     * VK_IMAGE_LAYOUT_GENERAL. Textures which were never used by a command
+     * list still need their initial transition. vkQueueSubmit() defines a
+     * memory dependency with prior host writes. */
+    image_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    image_barrier.pNext = NULL;
+    image_barrier.srcAccessMask = 0;
+    image_barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    image_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    image_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    image_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    image_barrier.image = resource->u.vk_image;
+    image_barrier.subresourceRange.aspectMask = region->imageSubresource.aspectMask;
+    image_barrier.subresourceRange.baseMipLevel = 0;
+    image_barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    image_barrier.subresourceRange.baseArrayLayer = 0;
+    image_barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+
+    /* Command lists recorded on other threads may clear the flag at the
+     * same time, so only one of them does the transition. */
+    if ((resource->flags & VKD3D_RESOURCE_INITIAL_STATE_TRANSITION)
+            && (vkd3d_atomic_uint_clear_bits(&resource->flags, VKD3D_RESOURCE_INITIAL_STATE_TRANSITION)
+            & VKD3D_RESOURCE_INITIAL_STATE_TRANSITION))
+    {
+        if (resource->initial_state != D3D12_RESOURCE_STATE_COMMON)
+            WARN("Resource %p is accessed by the CPU in state %#x.\n", resource, resource->initial_state);
+        image_barrier.oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
+    }
+
+    VK_CALL(vkCmdPipelineBarrier(slot->vk_command_buffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, NULL, 0, NULL, 1, &image_barrier));
+
+    if (read)
+    {
+        VK_CALL(vkCmdCopyImageToBuffer(slot->vk_command_buffer, resource->u.vk_image,
+                VK_IMAGE_LAYOUT_GENERAL, context->vk_buffer, 1, region));
+
+        memory_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        memory_barrier.pNext = NULL;
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+
+        VK_CALL(vkCmdPipelineBarrier(slot->vk_command_buffer,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                1, &memory_barrier, 0, NULL, 0, NULL));
+    }
+    else
+    {
+        VK_CALL(vkCmdCopyBufferToImage(slot->vk_command_buffer, context->vk_buffer,
+                resource->u.vk_image, VK_IMAGE_LAYOUT_GENERAL, 1, region));
+    }
+
+    if ((vr = VK_CALL(vkEndCommandBuffer(slot->vk_command_buffer))) < 0)
+    {
+        WARN("Failed to end command buffer, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
+
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.pNext = NULL;
+    submit_info.waitSemaphoreCount = 0;
+    submit_info.pWaitSemaphores = NULL;
+    submit_info.pWaitDstStageMask = NULL;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &slot->vk_command_buffer;
+    submit_info.signalSemaphoreCount = 0;
+    submit_info.pSignalSemaphores = NULL;
+
+    if (!(vk_queue = vkd3d_queue_acquire(context->queue)))
+    {
+        ERR("Failed to acquire queue %p.\n", context->queue);
+        return E_FAIL;
+    }
+
+    vr = VK_CALL(vkQueueSubmit(vk_queue, 1, &submit_info, slot->vk_fence));
+
+    vkd3d_queue_release(context->queue);
+
+    if (vr < 0)
+    {
+        ERR("Failed to submit, vr %d.\n", vr);
+        return hresult_from_vk_result(vr);
+    }
+
+    slot->pending = true;
+
+    return S_OK;
+}
+
+/* Copies a box between CPU memory and an optimally tiled texture through the
+ * staging slots. Boxes which don't fit in a single slot are split into
+ * chunks of whole slices or, for large slices, of block rows. */
+static HRESULT vkd3d_transfer_context_copy_image(struct vkd3d_transfer_context *context,
+        struct d3d12_resource *resource, const struct vkd3d_format *format,
+        const VkImageSubresource *sub_resource, const D3D12_BOX *box,
+        uint8_t *data, unsigned int row_pitch, unsigned int slice_pitch, bool read)
+{
+    unsigned int width, height, depth, block_row_count, row_size, slice_size;
+    unsigned int rows_per_chunk, slices_per_chunk, row_count, slice_count;
+    struct d3d12_device *device = resource->device;
+    struct vkd3d_transfer_slot *slot;
+    unsigned int slot_idx, buffer_row_length, y, z;
+    VkBufferImageCopy region;
+    HRESULT hr = S_OK, wait_hr;
+    uint8_t *staging;
+    int rc;
+
+    width = box->right - box->left;
+    height = box->bottom - box->top;
+    depth = box->back - box->front;
+    block_row_count = (height + format->block_height - 1) / format->block_height;
+    row_size = (width + format->block_width - 1) / format->block_width
+            * format->byte_count * format->block_byte_count;
+    slice_size = row_size * block_row_count;
+
+    if (slice_size <= VKD3D_TRANSFER_SLOT_SIZE)
+    {
+        rows_per_chunk = block_row_count;
+        slices_per_chunk = VKD3D_TRANSFER_SLOT_SIZE / slice_size;
+    }
+    else
+    {
+        rows_per_chunk = VKD3D_TRANSFER_SLOT_SIZE / row_size;
+        slices_per_chunk = 1;
+    }
+
+    if (!rows_per_chunk)
+    {
+        FIXME("Row size %u exceeds staging slot size.\n", row_size);
+        return E_NOTIMPL;
+    }
+
+    if ((rc = pthread_mutex_lock(&context->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if (FAILED(hr = vkd3d_transfer_context_create_resources(context, device)))
+        goto done;
+
+    buffer_row_length = (width + format->block_width - 1) / format->block_width * format->block_width;
+
+    for (z = 0; z < depth; z += slice_count)
+    {
+        slice_count = min(slices_per_chunk, depth - z);
+
+        for (y = 0; y < block_row_count; y += row_count)
+        {
+            row_count = min(rows_per_chunk, block_row_count - y);
+
+            slot_idx = context->next_slot;
+            context->next_slot = (slot_idx + 1) % ARRAY_SIZE(context->slots);
+            slot = &context->slots[slot_idx];
+
+            if (FAILED(hr = vkd3d_transfer_context_wait_slot(context, device, format, slot_idx)))
+                goto done;
+
+            staging = &context->mapped[slot_idx * VKD3D_TRANSFER_SLOT_SIZE];
+            if (!read)
+                vkd3d_format_copy_data(format, &data[z * slice_pitch + y * row_pitch], row_pitch, slice_pitch,
+                        staging, row_size, row_size * row_count, width, row_count * format->block_height, slice_count,
+                        true);
+
+            region.bufferOffset = slot_idx * VKD3D_TRANSFER_SLOT_SIZE;
+            region.bufferRowLength = buffer_row_length;
+            region.bufferImageHeight = row_count * format->block_height;
+            region.imageSubresource.aspectMask = sub_resource->aspectMask;
+            region.imageSubresource.mipLevel = sub_resource->mipLevel;
+            region.imageSubresource.baseArrayLayer = sub_resource->arrayLayer;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset.x = box->left;
+            region.imageOffset.y = box->top + y * format->block_height;
+            region.imageOffset.z = box->front + z;
+            region.imageExtent.width = width;
+            region.imageExtent.height = min(row_count * format->block_height, height - y * format->block_height);
+            region.imageExtent.depth = slice_count;
+
+            if (FAILED(hr = vkd3d_transfer_context_submit_slot(context, device, resource, &region, slot_idx, read)))
+                goto done;
+
+            if (read)
+            {
+                slot->dst_data = &data[z * slice_pitch + y * row_pitch];
+                slot->dst_row_pitch = row_pitch;
+                slot->dst_slice_pitch = slice_pitch;
+                slot->row_pitch = row_size;
+                slot->slice_pitch = row_size * row_count;
+                slot->width = width;
+                slot->height = row_count * format->block_height;
+                slot->depth = slice_count;
+            }
+        }
+    }
+
+done:
+    /* Wait for all chunks, oldest first, so that reads complete in order. */
+    for (slot_idx = 0; slot_idx < ARRAY_SIZE(context->slots); ++slot_idx)
+    {
+        if (FAILED(wait_hr = vkd3d_transfer_context_wait_slot(context, device, format,
+                (context->next_slot + slot_idx) % ARRAY_SIZE(context->slots))) && SUCCEEDED(hr))
+            hr = wait_hr;
+    }
+
+    pthread_mutex_unlock(&context->mutex);
+
+    return hr;
+}
+
+/* ID3D12Resource */
+static inline struct d3d12_resource *impl_from_ID3D12Resource(ID3D12Resource *iface)
+{
+    return CONTAINING_RECORD(iface, struct d3d12_resource, ID3D12Resource_iface);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_QueryInterface(ID3D12Resource *iface,
+        REFIID riid, void **object)
+{
+    TRACE("iface %p, riid %s, object %p.\n", iface, debugstr_guid(riid), object);
+
+    if (IsEqualGUID(riid, &IID_ID3D12Resource)
+            || IsEqualGUID(riid, &IID_ID3D12Pageable)
+            || IsEqualGUID(riid, &IID_ID3D12DeviceChild)
+            || IsEqualGUID(riid, &IID_ID3D12Object)
+            || IsEqualGUID(riid, &IID_IUnknown))
+    {
+        ID3D12Resource_AddRef(iface);
+        *object = iface;
+        return S_OK;
+    }
+
+    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(riid));
+
+    *object = NULL;
+    return E_NOINTERFACE;
+}
+
+static ULONG STDMETHODCALLTYPE d3d12_resource_AddRef(ID3D12Resource *iface)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    ULONG refcount = InterlockedIncrement(&resource->refcount);
+
+    TRACE("%p increasing refcount to %u.\n", resource, refcount);
+
+    if (refcount == 1)
+    {
+        struct d3d12_device *device = resource->device;
+
+        d3d12_device_add_ref(device);
+        d3d12_resource_incref(resource);
+    }
+
+    return refcount;
+}
+
+static ULONG STDMETHODCALLTYPE d3d12_resource_Release(ID3D12Resource *iface)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    ULONG refcount = InterlockedDecrement(&resource->refcount);
+
+    TRACE("%p decreasing refcount to %u.\n", resource, refcount);
+
+    if (!refcount)
+    {
+        struct d3d12_device *device = resource->device;
+
+        d3d12_resource_decref(resource);
+
+        d3d12_device_release(device);
+    }
+
+    return refcount;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_GetPrivateData(ID3D12Resource *iface,
+        REFGUID guid, UINT *data_size, void *data)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+
+    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return vkd3d_get_private_data(&resource->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_SetPrivateData(ID3D12Resource *iface,
+        REFGUID guid, UINT data_size, const void *data)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+
+    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+
+    return vkd3d_set_private_data(&resource->private_store, guid, data_size, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_SetPrivateDataInterface(ID3D12Resource *iface,
+        REFGUID guid, const IUnknown *data)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+
+    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
+
+    return vkd3d_set_private_data_interface(&resource->private_store, guid, data);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_SetName(ID3D12Resource *iface, const WCHAR *name)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    HRESULT hr;
+
+    TRACE("iface %p, name %s.\n", iface, debugstr_w(name, resource->device->wchar_size));
+
+    if (resource->flags & VKD3D_RESOURCE_DEDICATED_HEAP)
+    {
+        if (FAILED(hr = d3d12_heap_SetName(&resource->heap->ID3D12Heap_iface, name)))
+            return hr;
+    }
+
+    if (d3d12_resource_is_buffer(resource))
+        return vkd3d_set_vk_object_name(resource->device, (uint64_t)resource->u.vk_buffer,
+                VK_DEBUG_REPORT_OBJECT_TYPE_BUFFER_EXT, name);
+    else
+        return vkd3d_set_vk_object_name(resource->device, (uint64_t)resource->u.vk_image,
+                VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, name);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_GetDevice(ID3D12Resource *iface, REFIID iid, void **device)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+
+    TRACE("iface %p, iid %s, device %p.\n", iface, debugstr_guid(iid), device);
+
+    return d3d12_device_query_interface(resource->device, iid, device);
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_Map(ID3D12Resource *iface, UINT sub_resource,
+        const D3D12_RANGE *read_range, void **data)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    unsigned int sub_resource_count;
+    HRESULT hr;
+
+    TRACE("iface %p, sub_resource %u, read_range %p, data %p.\n",
+            iface, sub_resource, read_range, data);
+
+    if (!d3d12_resource_is_cpu_accessible(resource))
+    {
+        WARN("Resource is not CPU accessible.\n");
+        return E_INVALIDARG;
+    }
+
+    sub_resource_count = d3d12_resource_desc_get_sub_resource_count(&resource->desc);
+    if (sub_resource >= sub_resource_count)
+    {
+        WARN("Sub-resource index %u is out of range (%u sub-resources).\n", sub_resource, sub_resource_count);
+        return E_INVALIDARG;
+    }
+
+    if (d3d12_resource_is_texture(resource))
+    {
+        /* Textures seem to be mappable only on UMA adapters. */
+        FIXME("Not implemented for textures.\n");
+        return E_INVALIDARG;
+    }
+
+    if (!resource->heap)
+    {
+        FIXME("Not implemented for this resource type.\n");
+        return E_NOTIMPL;
+    }
+
+    WARN("Ignoring read range %p.\n", read_range);
+
+    if (FAILED(hr = d3d12_heap_map(resource->heap, resource->heap_offset, resource, data)))
+        WARN("Failed to map resource %p, hr %#x.\n", resource, hr);
+
+    if (data)
+        TRACE("Returning pointer %p.\n", *data);
+
+    return hr;
+}
+
+static void STDMETHODCALLTYPE d3d12_resource_Unmap(ID3D12Resource *iface, UINT sub_resource,
+        const D3D12_RANGE *written_range)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    unsigned int sub_resource_count;
+
+    TRACE("iface %p, sub_resource %u, written_range %p.\n",
+            iface, sub_resource, written_range);
+
+    sub_resource_count = d3d12_resource_desc_get_sub_resource_count(&resource->desc);
+    if (sub_resource >= sub_resource_count)
+    {
+        WARN("Sub-resource index %u is out of range (%u sub-resources).\n", sub_resource, sub_resource_count);
+        return;
+    }
+
+    WARN("Ignoring written range %p.\n", written_range);
+
+    d3d12_heap_unmap(resource->heap, resource);
+}
+
+static D3D12_RESOURCE_DESC * STDMETHODCALLTYPE d3d12_resource_GetDesc(ID3D12Resource *iface,
+        D3D12_RESOURCE_DESC *resource_desc)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+
+    TRACE("iface %p, resource_desc %p.\n", iface, resource_desc);
+
+    *resource_desc = resource->desc;
+    return resource_desc;
+}
+
+static D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE d3d12_resource_GetGPUVirtualAddress(ID3D12Resource *iface)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+
+    TRACE("iface %p.\n", iface);
+
+    return resource->gpu_address;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_WriteToSubresource(ID3D12Resource *iface,
+        UINT dst_sub_resource, const D3D12_BOX *dst_box, const void *src_data,
+        UINT src_row_pitch, UINT src_slice_pitch)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    const struct vkd3d_vk_device_procs *vk_procs;
+    VkImageSubresource vk_sub_resource;
+    const struct vkd3d_format *format;
+    VkSubresourceLayout vk_layout;
+    struct d3d12_device *device;
+    uint8_t *dst_data;
+    D3D12_BOX box;
+    HRESULT hr;
+
+    TRACE("iface %p, src_data %p, src_row_pitch %u, src_slice_pitch %u, "
+            "dst_sub_resource %u, dst_box %s.\n",
+            iface, src_data, src_row_pitch, src_slice_pitch, dst_sub_resource, debug_d3d12_box(dst_box));
+
+    if (d3d12_resource_is_buffer(resource))
+    {
+        WARN("Buffers are not supported.\n");
+        return E_INVALIDARG;
+    }
+
+    device = resource->device;
+    vk_procs = &device->vk_procs;
+
+    if (!(format = vkd3d_format_from_d3d12_resource_desc(device, &resource->desc, 0)))
+    {
+        ERR("Invalid DXGI format %#x.\n", resource->desc.Format);
+        return E_INVALIDARG;
+    }
+    if (format->vk_aspect_mask != VK_IMAGE_ASPECT_COLOR_BIT)
+    {
+        FIXME("Not supported for format %#x.\n", format->dxgi_format);
+        return E_NOTIMPL;
+    }
+
+    vk_sub_resource.arrayLayer = dst_sub_resource / resource->desc.MipLevels;
+    vk_sub_resource.mipLevel = dst_sub_resource % resource->desc.MipLevels;
+    vk_sub_resource.aspectMask = format->vk_aspect_mask;
+
+    if (!dst_box)
+    {
+        d3d12_resource_get_level_box(resource, vk_sub_resource.mipLevel, &box);
+        dst_box = &box;
+    }
+    else if (!d3d12_resource_validate_box(resource, dst_sub_resource, dst_box))
+    {
+        WARN("Invalid box %s.\n", debug_d3d12_box(dst_box));
+        return E_INVALIDARG;
+    }
+
+    if (d3d12_box_is_empty(dst_box))
+    {
+        WARN("Empty box %s.\n", debug_d3d12_box(dst_box));
+        return S_OK;
+    }
+
+    if (!d3d12_resource_is_cpu_accessible(resource))
+    {
+        FIXME_ONCE("Not implemented for this resource type.\n");
+        return E_NOTIMPL;
+    }
+    if (!(resource->flags & VKD3D_RESOURCE_LINEAR_TILING))
+    {
+        TRACE("Writing optimally tiled image through staging memory.\n");
+        return vkd3d_transfer_context_copy_image(&device->transfer_context, resource, format,
+                &vk_sub_resource, dst_box, (uint8_t *)src_data, src_row_pitch, src_slice_pitch, false);
+    }
+
+    VK_CALL(vkGetImageSubresourceLayout(device->vk_device, resource->u.vk_image, &vk_sub_resource, &vk_layout));
+    TRACE("Offset %#"PRIx64", size %#"PRIx64", row pitch %#"PRIx64", depth pitch %#"PRIx64".\n",
+            vk_layout.offset, vk_layout.size, vk_layout.rowPitch, vk_layout.depthPitch);
+
+    if (FAILED(hr = d3d12_heap_map(resource->heap, resource->heap_offset, resource, (void **)&dst_data)))
+    {
+        WARN("Failed to map resource %p, hr %#x.\n", resource, hr);
+        return hr;
+    }
+
+    dst_data += vk_layout.offset + vkd3d_format_get_data_offset(format, vk_layout.rowPitch,
+            vk_layout.depthPitch, dst_box->left, dst_box->top, dst_box->front);
+
+    vkd3d_format_copy_data(format, src_data, src_row_pitch, src_slice_pitch,
+            dst_data, vk_layout.rowPitch, vk_layout.depthPitch, dst_box->right - dst_box->left,
+            dst_box->bottom - dst_box->top, dst_box->back - dst_box->front, true);
+
+    d3d12_heap_unmap(resource->heap, resource);
+
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_ReadFromSubresource(ID3D12Resource *iface,
+        void *dst_data, UINT dst_row_pitch, UINT dst_slice_pitch,
+        UINT src_sub_resource, const D3D12_BOX *src_box)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    const struct vkd3d_vk_device_procs *vk_procs;
+    VkImageSubresource vk_sub_resource;
+    const struct vkd3d_format *format;
+    VkSubresourceLayout vk_layout;
+    struct d3d12_device *device;
+    uint8_t *src_data;
+    D3D12_BOX box;
+    HRESULT hr;
+
+    TRACE("iface %p, dst_data %p, dst_row_pitch %u, dst_slice_pitch %u, "
+            "src_sub_resource %u, src_box %s.\n",
+            iface, dst_data, dst_row_pitch, dst_slice_pitch, src_sub_resource, debug_d3d12_box(src_box));
+
+    if (d3d12_resource_is_buffer(resource))
+    {
+        WARN("Buffers are not supported.\n");
+        return E_INVALIDARG;
+    }
+
+    device = resource->device;
+    vk_procs = &device->vk_procs;
+
+    if (!(format = vkd3d_format_from_d3d12_resource_desc(device, &resource->desc, 0)))
+    {
+        ERR("Invalid DXGI format %#x.\n", resource->desc.Format);
+        return E_INVALIDARG;
+    }
+    if (format->vk_aspect_mask != VK_IMAGE_ASPECT_COLOR_BIT)
+    {
+        FIXME("Not supported for format %#x.\n", format->dxgi_format);
+        return E_NOTIMPL;
+    }
+
+    vk_sub_resource.arrayLayer = src_sub_resource / resource->desc.MipLevels;
+    vk_sub_resource.mipLevel = src_sub_resource % resource->desc.MipLevels;
+    vk_sub_resource.aspectMask = format->vk_aspect_mask;
+
+    if (!src_box)
+    {
+        d3d12_resource_get_level_box(resource, vk_sub_resource.mipLevel, &box);
+        src_box = &box;
+    }
+    else if (!d3d12_resource_validate_box(resource, src_sub_resource, src_box))
+    {
+        WARN("Invalid box %s.\n", debug_d3d12_box(src_box));
+        return E_INVALIDARG;
+    }
+
+    if (d3d12_box_is_empty(src_box))
+    {
+        WARN("Empty box %s.\n", debug_d3d12_box(src_box));
+        return S_OK;
+    }
+
+    if (!d3d12_resource_is_cpu_accessible(resource))
+    {
+        FIXME_ONCE("Not implemented for this resource type.\n");
+        return E_NOTIMPL;
+    }
+    if (!(resource->flags & VKD3D_RESOURCE_LINEAR_TILING))
+    {
+        TRACE("Reading optimally tiled image through staging memory.\n");
+        return vkd3d_transfer_context_copy_image(&device->transfer_context, resource, format,
+                &vk_sub_resource, src_box, dst_data, dst_row_pitch, dst_slice_pitch, true);
+    }
+
+    VK_CALL(vkGetImageSubresourceLayout(device->vk_device, resource->u.vk_image, &vk_sub_resource, &vk_layout));
+    TRACE("Offset %#"PRIx64", size %#"PRIx64", row pitch %#"PRIx64", depth pitch %#"PRIx64".\n",
+            vk_layout.offset, vk_layout.size, vk_layout.rowPitch, vk_layout.depthPitch);
+
+    if (FAILED(hr = d3d12_heap_map(resource->heap, resource->heap_offset, resource, (void **)&src_data)))
+    {
+        WARN("Failed to map resource %p, hr %#x.\n", resource, hr);
+        return hr;
+    }
+
+    src_data += vk_layout.offset + vkd3d_format_get_data_offset(format, vk_layout.rowPitch,
+            vk_layout.depthPitch, src_box->left, src_box->top, src_box->front);
+
+    vkd3d_format_copy_data(format, src_data, vk_layout.rowPitch, vk_layout.depthPitch,
+            dst_data, dst_row_pitch, dst_slice_pitch, src_box->right - src_box->left,
+            src_box->bottom - src_box->top, src_box->back - src_box->front, false);
+
+    d3d12_heap_unmap(resource->heap, resource);
+
+    return S_OK;
+}
+
+static HRESULT STDMETHODCALLTYPE d3d12_resource_GetHeapProperties(ID3D12Resource *iface,
+        D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS *flags)
+{
+    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    struct d3d12_heap *heap;
+
+    TRACE("iface %p, heap_properties %p, flags %p.\n",
+            iface, heap_properties, flags);
+
+    if (resource->flags & VKD3D_RESOURCE_EXTERNAL)
+    {
+        if (heap_properties)
+        {
+            memset(heap_properties, 0, sizeof(*heap_properties));
+            heap_properties->Type = D3D12_HEAP_TYPE_DEFAULT;
+        }
+        if (flags)
+            *flags = D3D12_HEAP_FLAG_NONE;
+        return S_OK;
+    }
+
+    if (!(heap = resource->heap))
+    {
+        WARN("Cannot get heap properties for reserved resources.\n");
+        return E_INVALIDARG;
+    }
+
+    if (heap_properties)
+        *heap_properties = heap->desc.Properties;
+    if (flags)
+        *flags = heap->desc.Flags;
+
+    return S_OK;
+}
+
+static const struct ID3D12ResourceVtbl d3d12_resource_vtbl =
+{
+    /* IUnknown methods */
+    d3d12_resource_QueryInterface,
+    d3d12_resource_AddRef,
+    d3d12_resource_Release,
+    /* ID3D12Object methods */
+    d3d12_resource_GetPrivateData,
+    d3d12_resource_SetPrivateData,
+    d3d12_resource_SetPrivateDataInterface,
+    d3d12_resource_SetName,
+    /* ID3D12DeviceChild methods */
+    d3d12_resource_GetDevice,
+    /* ID3D12Resource methods */
+    d3d12_resource_Map,
+    d3d12_resource_Unmap,
+    d3d12_resource_GetDesc,
+    d3d12_resource_GetGPUVirtualAddress,
+    d3d12_resource_WriteToSubresource,
+    d3d12_resource_ReadFromSubresource,
+    d3d12_resource_GetHeapProperties,
+};
+
+struct d3d12_resource *unsafe_impl_from_ID3D12Resource(ID3D12Resource *iface)
+{
+    if (!iface)
+        return NULL;
+    assert(iface->lpVtbl == &d3d12_resource_vtbl);
+    return impl_from_ID3D12Resource(iface);
+}
+
+static void d3d12_validate_resource_flags(D3D12_RESOURCE_FLAGS flags)
+{
+    unsigned int unknown_flags = flags & ~(D3D12_RESOURCE_FLAG_NONE
+            | D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET
+            | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL
+            | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
+            | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE
+            | D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER
+            | D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS);
+
+    if (unknown_flags)
+        FIXME("Unknown resource flags %#x.\n", unknown_flags);
+    if (flags & D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER)
+        FIXME("Ignoring D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER.\n");
+}
+
+HRESULT d3d12_resource_validate_desc(const D3D12_RESOURCE_DESC *desc)
+{
+    switch (desc->Dimension)
+    {
+        case D3D12_RESOURCE_DIMENSION_BUFFER:
+            if (desc->MipLevels != 1)
+            {
+                WARN("Invalid miplevel count %u for buffer.\n", desc->MipLevels);
+                return E_INVALIDARG;
+            }
+
+            if (desc->Format != DXGI_FORMAT_UNKNOWN || desc->Layout != D3D12_TEXTURE_LAYOUT_ROW_MAJOR
+                    || desc->Height != 1 || desc->DepthOrArraySize != 1
+                    || desc->SampleDesc.Count != 1 || desc->SampleDesc.Quality != 0
+                    || (desc->Alignment != 0 && desc->Alignment != D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))
+            {
+                WARN("Invalid parameters for a buffer resource.\n");
+                return E_INVALIDARG;
+            }
+            break;
+
+        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+            if (desc->Height != 1)
+            {
+                WARN("1D texture with a height of %u.\n", desc->Height);
+                return E_INVALIDARG;
+            }
+            break;
 
-    if (!desc->MipLevels)
-    {
-        validated_desc = *desc;
-        validated_desc.MipLevels = max_miplevel_count(desc);
-        desc = &validated_desc;
+        case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+            break;
+
+        default:
+            WARN("Invalid resource dimension %#x.\n", desc->Dimension);
+            return E_INVALIDARG;
     }
 
-    /* XXX: We have to create an image to get its memory requirements. */
-    if (SUCCEEDED(hr = vkd3d_create_image(device, &heap_properties, 0, desc, NULL, &vk_image)))
-    {
-        VK_CALL(vkGetImageMemoryRequirements(device->vk_device, vk_image, &requirements));
-        VK_CALL(vkDestroyImage(device->vk_device, vk_image, NULL));
+    d3d12_validate_resource_flags(desc->Flags);
 
-        allocation_info->SizeInBytes = requirements.size;
-        allocation_info->Alignment = requirements.alignment;
-    }
+    /* FIXME: Validate alignment for textures. */
 
-    return hr;
+    return S_OK;
 }
 
-static void d3d12_resource_destroy(struct d3d12_resource *resource, struct d3d12_device *device)
+static bool d3d12_resource_validate_heap_properties(const struct d3d12_resource *resource,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_RESOURCE_STATES initial_state)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    if (heap_properties->Type == D3D12_HEAP_TYPE_UPLOAD
+            || heap_properties->Type == D3D12_HEAP_TYPE_READBACK)
+    {
+        if (d3d12_resource_is_texture(resource))
+        {
+            WARN("Textures cannot be created on upload/readback heaps.\n");
+            return false;
+        }
 
-    if (resource->flags & VKD3D_RESOURCE_EXTERNAL)
-        return;
+        if (resource->desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS))
+        {
+            WARN("Render target and unordered access buffers cannot be created on upload/readback heaps.\n");
+            return false;
+        }
+    }
 
-    if (!(resource->flags & VKD3D_RESOURCE_PLACED_BUFFER))
+    if (heap_properties->Type == D3D12_HEAP_TYPE_UPLOAD && initial_state != D3D12_RESOURCE_STATE_GENERIC_READ)
     {
-        if (resource->gpu_address)
-            vkd3d_gpu_va_allocator_free(&device->gpu_va_allocator, resource->gpu_address);
-
-        if (d3d12_resource_is_buffer(resource))
-            VK_CALL(vkDestroyBuffer(device->vk_device, resource->u.vk_buffer, NULL));
-        else
-            VK_CALL(vkDestroyImage(device->vk_device, resource->u.vk_image, NULL));
+        WARN("For D3D12_HEAP_TYPE_UPLOAD the state must be D3D12_RESOURCE_STATE_GENERIC_READ.\n");
+        return false;
+    }
+    if (heap_properties->Type == D3D12_HEAP_TYPE_READBACK && initial_state != D3D12_RESOURCE_STATE_COPY_DEST)
+    {
+        WARN("For D3D12_HEAP_TYPE_READBACK the state must be D3D12_RESOURCE_STATE_COPY_DEST.\n");
+        return false;
     }
 
-    if (resource->flags & VKD3D_RESOURCE_DEDICATED_HEAP)
-        d3d12_heap_destroy(resource->heap);
+    return true;
 }
 
-static ULONG d3d12_resource_incref(struct d3d12_resource *resource)
+static HRESULT d3d12_resource_init(struct d3d12_resource *resource, struct d3d12_device *device,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
+        const D3D12_CLEAR_VALUE *optimized_clear_value, bool placed)
 {
-    ULONG refcount = InterlockedIncrement(&resource->internal_refcount);
+    HRESULT hr;
 
-    TRACE("%p increasing refcount to %u.\n", resource, refcount);
+    resource->ID3D12Resource_iface.lpVtbl = &d3d12_resource_vtbl;
+    resource->refcount = 1;
+    resource->internal_refcount = 1;
 
-    return refcount;
-}
+    resource->desc = *desc;
 
-static ULONG d3d12_resource_decref(struct d3d12_resource *resource)
-{
-    ULONG refcount = InterlockedDecrement(&resource->internal_refcount);
+    if (heap_properties && !d3d12_resource_validate_heap_properties(resource, heap_properties, initial_state))
+        return E_INVALIDARG;
 
-    TRACE("%p decreasing refcount to %u.\n", resource, refcount);
+    if (!is_valid_resource_state(initial_state))
+    {
+        WARN("Invalid initial resource state %#x.\n", initial_state);
+        return E_INVALIDARG;
+    }
 
-    if (!refcount)
+    if (optimized_clear_value && d3d12_resource_is_buffer(resource))
     {
-        vkd3d_private_store_destroy(&resource->private_store);
-        d3d12_resource_destroy(resource, resource->device);
-        vkd3d_free(resource);
+        WARN("Optimized clear value must be NULL for buffers.\n");
+        return E_INVALIDARG;
     }
 
-    return refcount;
-}
+    if (optimized_clear_value)
+        WARN("Ignoring optimized clear value.\n");
 
-bool d3d12_resource_is_cpu_accessible(const struct d3d12_resource *resource)
-{
-    return resource->heap && is_cpu_accessible_heap(&resource->heap->desc.Properties);
-}
+    resource->gpu_address = 0;
+    resource->flags = 0;
+    if (placed && d3d12_resource_is_buffer(resource))
+        resource->flags |= VKD3D_RESOURCE_PLACED_BUFFER;
 
-static bool d3d12_resource_validate_box(const struct d3d12_resource *resource,
-        unsigned int sub_resource_idx, const D3D12_BOX *box)
-{
-    unsigned int mip_level = sub_resource_idx % resource->desc.MipLevels;
-    struct d3d12_device *device = resource->device;
-    const struct vkd3d_format *vkd3d_format;
-    uint32_t width_mask, height_mask;
-    uint64_t width, height, depth;
+    if (FAILED(hr = d3d12_resource_validate_desc(&resource->desc)))
+        return hr;
 
-    width = d3d12_resource_desc_get_width(&resource->desc, mip_level);
-    height = d3d12_resource_desc_get_height(&resource->desc, mip_level);
-    depth = d3d12_resource_desc_get_depth(&resource->desc, mip_level);
+    switch (desc->Dimension)
+    {
+        case D3D12_RESOURCE_DIMENSION_BUFFER:
+            /* We'll inherit a VkBuffer reference from the heap with an implied offset. */
+            if (placed)
+            {
+                resource->u.vk_buffer = VK_NULL_HANDLE;
+                break;
+            }
 
-    vkd3d_format = vkd3d_format_from_d3d12_resource_desc(device, &resource->desc, 0);
-    assert(vkd3d_format);
-    width_mask = vkd3d_format->block_width - 1;
-    height_mask = vkd3d_format->block_height - 1;
+            if (FAILED(hr = vkd3d_create_buffer(device, heap_properties, heap_flags,
+                    &resource->desc, &resource->u.vk_buffer)))
+                return hr;
+            if (!(resource->gpu_address = vkd3d_gpu_va_allocator_allocate(&device->gpu_va_allocator,
+                    desc->Alignment ? desc->Alignment : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
+                    desc->Width, resource)))
+            {
+                ERR("Failed to allocate GPU VA.\n");
+                d3d12_resource_destroy(resource, device);
+                return E_OUTOFMEMORY;
+            }
+            break;
 
-    return box->left <= width && box->right <= width
-            && box->top <= height && box->bottom <= height
-            && box->front <= depth && box->back <= depth
-            && !(box->left & width_mask)
-            && !(box->right & width_mask)
-            && !(box->top & height_mask)
-            && !(box->bottom & height_mask);
-}
+        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
+        case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
+        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
+            if (!resource->desc.MipLevels)
+                resource->desc.MipLevels = max_miplevel_count(desc);
+            resource->flags |= VKD3D_RESOURCE_INITIAL_STATE_TRANSITION;
+            if (FAILED(hr = vkd3d_create_image(device, heap_properties, heap_flags,
+                    &resource->desc, resource, &resource->u.vk_image)))
+                return hr;
+            break;
 
-static void d3d12_resource_get_level_box(const struct d3d12_resource *resource,
-        unsigned int level, D3D12_BOX *box)
-{
-    box->left = 0;
-    box->top = 0;
-    box->front = 0;
-    box->right = d3d12_resource_desc_get_width(&resource->desc, level);
-    box->bottom = d3d12_resource_desc_get_height(&resource->desc, level);
-    box->back = d3d12_resource_desc_get_depth(&resource->desc, level);
-}
+        default:
+            WARN("Invalid resource dimension %#x.\n", resource->desc.Dimension);
+            return E_INVALIDARG;
+    }
 
-/* ID3D12Resource */
-static inline struct d3d12_resource *impl_from_ID3D12Resource(ID3D12Resource *iface)
-{
-    return CONTAINING_RECORD(iface, struct d3d12_resource, ID3D12Resource_iface);
-}
+    resource->map_count = 0;
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_QueryInterface(ID3D12Resource *iface,
-        REFIID riid, void **object)
-{
-    TRACE("iface %p, riid %s, object %p.\n", iface, debugstr_guid(riid), object);
+    resource->initial_state = initial_state;
 
-    if (IsEqualGUID(riid, &IID_ID3D12Resource)
-            || IsEqualGUID(riid, &IID_ID3D12Pageable)
-            || IsEqualGUID(riid, &IID_ID3D12DeviceChild)
-            || IsEqualGUID(riid, &IID_ID3D12Object)
-            || IsEqualGUID(riid, &IID_IUnknown))
+    resource->heap = NULL;
+    resource->heap_offset = 0;
+
+    if (FAILED(hr = vkd3d_private_store_init(&resource->private_store)))
     {
-        ID3D12Resource_AddRef(iface);
-        *object = iface;
-        return S_OK;
+        d3d12_resource_destroy(resource, device);
+        return hr;
     }
 
-    WARN("%s not implemented, returning E_NOINTERFACE.\n", debugstr_guid(riid));
+    if (FAILED(hr = vkd3d_view_cache_init(&resource->view_cache)))
+    {
+        vkd3d_private_store_destroy(&resource->private_store);
+        d3d12_resource_destroy(resource, device);
+        return hr;
+    }
 
-    *object = NULL;
-    return E_NOINTERFACE;
+    d3d12_device_add_ref(resource->device = device);
+
+    return S_OK;
 }
 
-static ULONG STDMETHODCALLTYPE d3d12_resource_AddRef(ID3D12Resource *iface)
+static HRESULT d3d12_resource_create(struct d3d12_device *device,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
+        const D3D12_CLEAR_VALUE *optimized_clear_value, bool placed, struct d3d12_resource **resource)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    ULONG refcount = InterlockedIncrement(&resource->refcount);
+    struct d3d12_resource *object;
+    HRESULT hr;
 
-    TRACE("%p increasing refcount to %u.\n", resource, refcount);
+    if (!(object = vkd3d_object_pool_alloc(&device->resource_pool)))
+        return E_OUTOFMEMORY;
 
-    if (refcount == 1)
+    if (FAILED(hr = d3d12_resource_init(object, device, heap_properties, heap_flags,
+            desc, initial_state, optimized_clear_value, placed)))
     {
-        struct d3d12_device *device = resource->device;
-
-        d3d12_device_add_ref(device);
-        d3d12_resource_incref(resource);
+        vkd3d_object_pool_free(&device->resource_pool, object);
+        return hr;
     }
 
-    return refcount;
+    *resource = object;
+
+    return hr;
 }
 
-static ULONG STDMETHODCALLTYPE d3d12_resource_Release(ID3D12Resource *iface)
+static HRESULT vkd3d_allocate_resource_memory(
+        struct d3d12_device *device, struct d3d12_resource *resource,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    ULONG refcount = InterlockedDecrement(&resource->refcount);
-
-    TRACE("%p decreasing refcount to %u.\n", resource, refcount);
-
-    if (!refcount)
-    {
-        struct d3d12_device *device = resource->device;
-
-        d3d12_resource_decref(resource);
-
-        d3d12_device_release(device);
-    }
+    D3D12_HEAP_DESC heap_desc;
+    HRESULT hr;
 
-    return refcount;
+    heap_desc.SizeInBytes = 0;
+    heap_desc.Properties = *heap_properties;
+    heap_desc.Alignment = 0;
+    heap_desc.Flags = heap_flags;
+    if (SUCCEEDED(hr = d3d12_heap_create(device, &heap_desc, resource, &resource->heap)))
+        resource->flags |= VKD3D_RESOURCE_DEDICATED_HEAP;
+    return hr;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_GetPrivateData(ID3D12Resource *iface,
-        REFGUID guid, UINT *data_size, void *data)
+HRESULT d3d12_committed_resource_create(struct d3d12_device *device,
+        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
+        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
+        const D3D12_CLEAR_VALUE *optimized_clear_value, struct d3d12_resource **resource)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    struct d3d12_resource *object;
+    HRESULT hr;
 
-    TRACE("iface %p, guid %s, data_size %p, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+    if (!heap_properties)
+    {
+        WARN("Heap properties are NULL.\n");
+        return E_INVALIDARG;
+    }
 
-    return vkd3d_get_private_data(&resource->private_store, guid, data_size, data);
-}
+    if (FAILED(hr = d3d12_resource_create(device, heap_properties, heap_flags,
+            desc, initial_state, optimized_clear_value, false, &object)))
+        return hr;
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_SetPrivateData(ID3D12Resource *iface,
-        REFGUID guid, UINT data_size, const void *data)
-{
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    if (FAILED(hr = vkd3d_allocate_resource_memory(device, object, heap_properties, heap_flags)))
+    {
+        d3d12_resource_Release(&object->ID3D12Resource_iface);
+        return hr;
+    }
 
-    TRACE("iface %p, guid %s, data_size %u, data %p.\n", iface, debugstr_guid(guid), data_size, data);
+    TRACE("Created committed resource %p.\n", object);
 
-    return vkd3d_set_private_data(&resource->private_store, guid, data_size, data);
+    *resource = object;
+
+    return S_OK;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_SetPrivateDataInterface(ID3D12Resource *iface,
-        REFGUID guid, const IUnknown *data)
+static HRESULT vkd3d_bind_heap_memory(struct d3d12_device *device,
+        struct d3d12_resource *resource, struct d3d12_heap *heap, uint64_t heap_offset)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-
-    TRACE("iface %p, guid %s, data %p.\n", iface, debugstr_guid(guid), data);
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkDevice vk_device = device->vk_device;
+    VkMemoryRequirements requirements;
+    VkResult vr;
 
-    return vkd3d_set_private_data_interface(&resource->private_store, guid, data);
-}
+    if (resource->flags & VKD3D_RESOURCE_PLACED_BUFFER)
+    {
+        /* Just inherit the buffer from the heap. */
+        resource->u.vk_buffer = heap->buffer_resource->u.vk_buffer;
+        resource->heap = heap;
+        resource->heap_offset = heap_offset;
+        resource->gpu_address = heap->buffer_resource->gpu_address + heap_offset;
+        return S_OK;
+    }
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_SetName(ID3D12Resource *iface, const WCHAR *name)
-{
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    HRESULT hr;
+    if (d3d12_resource_is_buffer(resource))
+        VK_CALL(vkGetBufferMemoryRequirements(vk_device, resource->u.vk_buffer, &requirements));
+    else
+        VK_CALL(vkGetImageMemoryRequirements(vk_device, resource->u.vk_image, &requirements));
 
-    TRACE("iface %p, name %s.\n", iface, debugstr_w(name, resource->device->wchar_size));
+    if (heap_offset % requirements.alignment)
+    {
+        FIXME("Invalid heap offset %#"PRIx64" (alignment %#"PRIx64").\n",
+                heap_offset, requirements.alignment);
+        goto allocate_memory;
+    }
 
-    if (resource->flags & VKD3D_RESOURCE_DEDICATED_HEAP)
+    if (!(requirements.memoryTypeBits & (1u << heap->vk_memory_type)))
     {
-        if (FAILED(hr = d3d12_heap_SetName(&resource->heap->ID3D12Heap_iface, name)))
-            return hr;
+        FIXME("Memory type %u cannot be bound to resource %p (allowed types %#x).\n",
+                heap->vk_memory_type, resource, requirements.memoryTypeBits);
+        goto allocate_memory;
     }
 
     if (d3d12_resource_is_buffer(resource))
-        return vkd3d_set_vk_object_name(resource->device, (uint64_t)resource->u.vk_buffer,
-                VK_DEBUG_REPORT_OBJECT_TYPE_BUFFER_EXT, name);
+        vr = VK_CALL(vkBindBufferMemory(vk_device, resource->u.vk_buffer, heap->vk_memory, heap_offset));
     else
-        return vkd3d_set_vk_object_name(resource->device, (uint64_t)resource->u.vk_image,
-                VK_DEBUG_REPORT_OBJECT_TYPE_IMAGE_EXT, name);
-}
+        vr = VK_CALL(vkBindImageMemory(vk_device, resource->u.vk_image, heap->vk_memory, heap_offset));
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_GetDevice(ID3D12Resource *iface, REFIID iid, void **device)
-{
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    if (vr == VK_SUCCESS)
+    {
+        resource->heap = heap;
+        resource->heap_offset = heap_offset;
+    }
+    else
+    {
+        WARN("Failed to bind memory, vr %d.\n", vr);
+    }
 
-    TRACE("iface %p, iid %s, device %p.\n", iface, debugstr_guid(iid), device);
+    return hresult_from_vk_result(vr);
 
-    return d3d12_device_query_interface(resource->device, iid, device);
+allocate_memory:
+    FIXME("Allocating device memory.\n");
+    return vkd3d_allocate_resource_memory(device, resource, &heap->desc.Properties, heap->desc.Flags);
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_Map(ID3D12Resource *iface, UINT sub_resource,
-        const D3D12_RANGE *read_range, void **data)
+HRESULT d3d12_placed_resource_create(struct d3d12_device *device, struct d3d12_heap *heap, uint64_t heap_offset,
+        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
+        const D3D12_CLEAR_VALUE *optimized_clear_value, struct d3d12_resource **resource)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    unsigned int sub_resource_count;
+    struct d3d12_resource *object;
     HRESULT hr;
 
-    TRACE("iface %p, sub_resource %u, read_range %p, data %p.\n",
-            iface, sub_resource, read_range, data);
+    if (FAILED(hr = d3d12_resource_create(device, &heap->desc.Properties, heap->desc.Flags,
+            desc, initial_state, optimized_clear_value, true, &object)))
+        return hr;
 
-    if (!d3d12_resource_is_cpu_accessible(resource))
+    if (FAILED(hr = vkd3d_bind_heap_memory(device, object, heap, heap_offset)))
     {
-        WARN("Resource is not CPU accessible.\n");
-        return E_INVALIDARG;
+        d3d12_resource_Release(&object->ID3D12Resource_iface);
+        return hr;
     }
 
-    sub_resource_count = d3d12_resource_desc_get_sub_resource_count(&resource->desc);
-    if (sub_resource >= sub_resource_count)
-    {
-        WARN("Sub-resource index %u is out of range (%u sub-resources).\n", sub_resource, sub_resource_count);
-        return E_INVALIDARG;
-    }
+    TRACE("Created placed resource %p.\n", object);
 
-    if (d3d12_resource_is_texture(resource))
-    {
-        /* Textures seem to be mappable only on UMA adapters. */
-        FIXME("Not implemented for textures.\n");
-        return E_INVALIDARG;
-    }
+    *resource = object;
 
-    if (!resource->heap)
+    return S_OK;
+}
+
+static HRESULT d3d12_resource_bind_sparse_metadata(struct d3d12_resource *resource,
+        struct d3d12_device *device, const VkSparseImageMemoryRequirements *metadata_requirements,
+        const VkMemoryRequirements *requirements, unsigned int layer_count)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    static const D3D12_HEAP_PROPERTIES heap_properties = {D3D12_HEAP_TYPE_DEFAULT};
+    VkSparseImageOpaqueMemoryBindInfo opaque_info;
+    VkMemoryRequirements memory_requirements;
+    VkSparseMemoryBind *binds = NULL;
+    VkFence vk_fence = VK_NULL_HANDLE;
+    VkFenceCreateInfo fence_info;
+    struct vkd3d_queue *queue;
+    VkBindSparseInfo bind_info;
+    unsigned int i;
+    VkQueue vk_queue;
+    VkResult vr;
+    HRESULT hr;
+
+    queue = d3d12_device_get_vkd3d_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT);
+    if (!(queue->vk_queue_flags & VK_QUEUE_SPARSE_BINDING_BIT))
     {
-        FIXME("Not implemented for this resource type.\n");
+        FIXME("Direct queue does not support sparse binding.\n");
         return E_NOTIMPL;
     }
 
-    WARN("Ignoring read range %p.\n", read_range);
+    if (metadata_requirements->formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT)
+        layer_count = 1;
 
-    if (FAILED(hr = d3d12_heap_map(resource->heap, resource->heap_offset, resource, data)))
-        WARN("Failed to map resource %p, hr %#x.\n", resource, hr);
+    memory_requirements = *requirements;
+    memory_requirements.size = metadata_requirements->imageMipTailSize * layer_count;
+    if (FAILED(hr = vkd3d_allocate_device_memory(device, &heap_properties, 0, &memory_requirements,
+            NULL, &resource->sparse.vk_metadata_memory, NULL)))
+        return hr;
 
-    if (data)
-        TRACE("Returning pointer %p.\n", *data);
+    if (!(binds = vkd3d_calloc(layer_count, sizeof(*binds))))
+        return E_OUTOFMEMORY;
 
-    return hr;
-}
+    for (i = 0; i < layer_count; ++i)
+    {
+        binds[i].resourceOffset = metadata_requirements->imageMipTailOffset
+                + i * metadata_requirements->imageMipTailStride;
+        binds[i].size = metadata_requirements->imageMipTailSize;
+        binds[i].memory = resource->sparse.vk_metadata_memory;
+        binds[i].memoryOffset = i * metadata_requirements->imageMipTailSize;
+        binds[i].flags = VK_SPARSE_MEMORY_BIND_METADATA_BIT;
+    }
 
-static void STDMETHODCALLTYPE d3d12_resource_Unmap(ID3D12Resource *iface, UINT sub_resource,
-        const D3D12_RANGE *written_range)
-{
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    unsigned int sub_resource_count;
+    opaque_info.image = resource->u.vk_image;
+    opaque_info.bindCount = layer_count;
+    opaque_info.pBinds = binds;
 
-    TRACE("iface %p, sub_resource %u, written_range %p.\n",
-            iface, sub_resource, written_range);
+    memset(&bind_info, 0, sizeof(bind_info));
+    bind_info.sType = VK_STRUCTURE_TYPE_BIND_SPARSE_INFO;
+    bind_info.imageOpaqueBindCount = 1;
+    bind_info.pImageOpaqueBinds = &opaque_info;
 
-    sub_resource_count = d3d12_resource_desc_get_sub_resource_count(&resource->desc);
-    if (sub_resource >= sub_resource_count)
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.pNext = NULL;
+    fence_info.flags = 0;
+
+    if ((vr = VK_CALL(vkCreateFence(device->vk_device, &fence_info, NULL, &vk_fence))) < 0)
     {
-        WARN("Sub-resource index %u is out of range (%u sub-resources).\n", sub_resource, sub_resource_count);
-        return;
+        WARN("Failed to create Vulkan fence, vr %d.\n", vr);
+        goto done;
     }
 
-    WARN("Ignoring written range %p.\n", written_range);
-
-    d3d12_heap_unmap(resource->heap, resource);
-}
+    if (!(vk_queue = vkd3d_queue_acquire(queue)))
+    {
+        ERR("Failed to acquire queue %p.\n", queue);
+        vr = VK_ERROR_INITIALIZATION_FAILED;
+        goto done;
+    }
 
-static D3D12_RESOURCE_DESC * STDMETHODCALLTYPE d3d12_resource_GetDesc(ID3D12Resource *iface,
-        D3D12_RESOURCE_DESC *resource_desc)
-{
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    vr = VK_CALL(vkQueueBindSparse(vk_queue, 1, &bind_info, vk_fence));
 
-    TRACE("iface %p, resource_desc %p.\n", iface, resource_desc);
+    vkd3d_queue_release(queue);
 
-    *resource_desc = resource->desc;
-    return resource_desc;
-}
+    if (vr < 0)
+    {
+        ERR("Failed to bind sparse metadata, vr %d.\n", vr);
+        goto done;
+    }
 
-static D3D12_GPU_VIRTUAL_ADDRESS STDMETHODCALLTYPE d3d12_resource_GetGPUVirtualAddress(ID3D12Resource *iface)
-{
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
+    if ((vr = VK_CALL(vkWaitForFences(device->vk_device, 1, &vk_fence, VK_TRUE, UINT64_MAX))) < 0)
+        ERR("Failed to wait for fence, vr %d.\n", vr);
 
-    TRACE("iface %p.\n", iface);
+done:
+    VK_CALL(vkDestroyFence(device->vk_device, vk_fence, NULL));
+    vkd3d_free(binds);
 
-    return resource->gpu_address;
+    return hresult_from_vk_result(vr);
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_WriteToSubresource(ID3D12Resource *iface,
-        UINT dst_sub_resource, const D3D12_BOX *dst_box, const void *src_data,
-        UINT src_row_pitch, UINT src_slice_pitch)
+/* Tiles are numbered by subresource. Packed mips of each layer follow the
+ * standard mips of that layer, unless all layers share a single mip tail,
+ * which is then placed after all layers. */
+static HRESULT d3d12_resource_init_sparse_info(struct d3d12_resource *resource,
+        struct d3d12_device *device)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    const struct vkd3d_vk_device_procs *vk_procs;
-    VkImageSubresource vk_sub_resource;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkSparseImageMemoryRequirements *sparse_requirements = NULL;
+    const VkSparseImageMemoryRequirements *color, *metadata;
+    unsigned int layer_count, standard_mip_count, level, layer;
+    uint32_t requirement_count, tile_idx, x, y, z, i;
+    struct d3d12_sparse_info *sparse = &resource->sparse;
+    D3D12_SUBRESOURCE_TILING *tiling;
     const struct vkd3d_format *format;
-    VkSubresourceLayout vk_layout;
-    struct d3d12_device *device;
-    uint8_t *dst_data;
-    D3D12_BOX box;
+    VkMemoryRequirements requirements;
+    struct d3d12_sparse_tile *tile;
+    uint32_t packed_tile_count;
+    VkExtent3D granularity;
+    bool single_mip_tail;
     HRESULT hr;
 
-    TRACE("iface %p, src_data %p, src_row_pitch %u, src_slice_pitch %u, "
-            "dst_sub_resource %u, dst_box %s.\n",
-            iface, src_data, src_row_pitch, src_slice_pitch, dst_sub_resource, debug_d3d12_box(dst_box));
+    memset(sparse, 0, sizeof(*sparse));
+    resource->flags |= VKD3D_RESOURCE_SPARSE;
 
     if (d3d12_resource_is_buffer(resource))
-    {
-        WARN("Buffers are not supported.\n");
-        return E_INVALIDARG;
-    }
-
-    device = resource->device;
-    vk_procs = &device->vk_procs;
+        VK_CALL(vkGetBufferMemoryRequirements(device->vk_device, resource->u.vk_buffer, &requirements));
+    else
+        VK_CALL(vkGetImageMemoryRequirements(device->vk_device, resource->u.vk_image, &requirements));
 
-    if (!(format = vkd3d_format_from_d3d12_resource_desc(device, &resource->desc, 0)))
+    if (D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES % requirements.alignment)
     {
-        ERR("Invalid DXGI format %#x.\n", resource->desc.Format);
-        return E_INVALIDARG;
+        FIXME("Unsupported sparse block size %#"PRIx64".\n", requirements.alignment);
+        return E_NOTIMPL;
     }
-    if (format->vk_aspect_mask != VK_IMAGE_ASPECT_COLOR_BIT)
+    sparse->vk_memory_type_bits = requirements.memoryTypeBits;
+
+    if (d3d12_resource_is_buffer(resource))
     {
-        FIXME("Not supported for format %#x.\n", format->dxgi_format);
-        return E_NOTIMPL;
+        sparse->tile_count = DIV_ROUND_UP(resource->desc.Width, D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES);
+        sparse->tiling_count = 1;
+
+        if (!(sparse->tiles = vkd3d_calloc(sparse->tile_count, sizeof(*sparse->tiles)))
+                || !(sparse->tilings = vkd3d_calloc(sparse->tiling_count, sizeof(*sparse->tilings))))
+            return E_OUTOFMEMORY;
+
+        for (i = 0; i < sparse->tile_count; ++i)
+        {
+            tile = &sparse->tiles[i];
+            tile->opaque = true;
+            tile->u.buffer.offset = (VkDeviceSize)i * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+            tile->u.buffer.length = min(D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES,
+                    requirements.size - tile->u.buffer.offset);
+        }
+
+        sparse->tilings[0].WidthInTiles = sparse->tile_count;
+        sparse->tilings[0].HeightInTiles = 1;
+        sparse->tilings[0].DepthInTiles = 1;
+        sparse->tilings[0].StartTileIndexInOverallResource = 0;
+
+        sparse->tile_shape.WidthInTexels = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+        sparse->tile_shape.HeightInTexels = 1;
+        sparse->tile_shape.DepthInTexels = 1;
+
+        return S_OK;
     }
 
-    vk_sub_resource.arrayLayer = dst_sub_resource / resource->desc.MipLevels;
-    vk_sub_resource.mipLevel = dst_sub_resource % resource->desc.MipLevels;
-    vk_sub_resource.aspectMask = format->vk_aspect_mask;
+    if (!(format = vkd3d_format_from_d3d12_resource_desc(device, &resource->desc, 0)))
+        return E_INVALIDARG;
 
-    if (!dst_box)
+    VK_CALL(vkGetImageSparseMemoryRequirements(device->vk_device, resource->u.vk_image, &requirement_count, NULL));
+    if (!(sparse_requirements = vkd3d_calloc(requirement_count, sizeof(*sparse_requirements))))
+        return E_OUTOFMEMORY;
+    VK_CALL(vkGetImageSparseMemoryRequirements(device->vk_device, resource->u.vk_image,
+            &requirement_count, sparse_requirements));
+
+    color = metadata = NULL;
+    for (i = 0; i < requirement_count; ++i)
     {
-        d3d12_resource_get_level_box(resource, vk_sub_resource.mipLevel, &box);
-        dst_box = &box;
+        if (sparse_requirements[i].formatProperties.aspectMask & format->vk_aspect_mask)
+            color = &sparse_requirements[i];
+        else if (sparse_requirements[i].formatProperties.aspectMask & VK_IMAGE_ASPECT_METADATA_BIT)
+            metadata = &sparse_requirements[i];
     }
-    else if (!d3d12_resource_validate_box(resource, dst_sub_resource, dst_box))
+
+    if (!color)
     {
-        WARN("Invalid box %s.\n", debug_d3d12_box(dst_box));
-        return E_INVALIDARG;
+        ERR("No sparse memory requirements for aspect mask %#x.\n", format->vk_aspect_mask);
+        hr = E_FAIL;
+        goto done;
     }
 
-    if (d3d12_box_is_empty(dst_box))
+    layer_count = d3d12_resource_desc_get_layer_count(&resource->desc);
+    granularity = color->formatProperties.imageGranularity;
+    single_mip_tail = color->formatProperties.flags & VK_SPARSE_IMAGE_FORMAT_SINGLE_MIPTAIL_BIT;
+    standard_mip_count = min(color->imageMipTailFirstLod, resource->desc.MipLevels);
+    packed_tile_count = standard_mip_count < resource->desc.MipLevels
+            ? DIV_ROUND_UP(color->imageMipTailSize, D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES) : 0;
+
+    sparse->tiling_count = layer_count * resource->desc.MipLevels;
+    if (!(sparse->tilings = vkd3d_calloc(sparse->tiling_count, sizeof(*sparse->tilings))))
     {
-        WARN("Empty box %s.\n", debug_d3d12_box(dst_box));
-        return S_OK;
+        hr = E_OUTOFMEMORY;
+        goto done;
     }
 
-    if (!d3d12_resource_is_cpu_accessible(resource))
+    /* Compute the tile layout first, then fill in the tiles. */
+    for (layer = 0, tile_idx = 0; layer < layer_count; ++layer)
     {
-        FIXME_ONCE("Not implemented for this resource type.\n");
-        return E_NOTIMPL;
+        for (level = 0; level < resource->desc.MipLevels; ++level)
+        {
+            tiling = &sparse->tilings[layer * resource->desc.MipLevels + level];
+
+            if (level >= standard_mip_count)
+            {
+                tiling->StartTileIndexInOverallResource = D3D12_PACKED_TILE;
+                continue;
+            }
+
+            tiling->WidthInTiles = DIV_ROUND_UP(d3d12_resource_desc_get_width(&resource->desc, level),
+                    granularity.width);
+            tiling->HeightInTiles = DIV_ROUND_UP(d3d12_resource_desc_get_height(&resource->desc, level),
+                    granularity.height);
+            tiling->DepthInTiles = DIV_ROUND_UP(d3d12_resource_desc_get_depth(&resource->desc, level),
+                    granularity.depth);
+            tiling->StartTileIndexInOverallResource = tile_idx;
+            tile_idx += tiling->WidthInTiles * tiling->HeightInTiles * tiling->DepthInTiles;
+        }
+
+        if (!single_mip_tail)
+        {
+            if (!layer)
+            {
+                sparse->packed_mips.StartTileIndexInOverallResource = tile_idx;
+                sparse->packed_mip_layer_stride = tile_idx + packed_tile_count;
+            }
+            tile_idx += packed_tile_count;
+        }
     }
-    if (!(resource->flags & VKD3D_RESOURCE_LINEAR_TILING))
+    if (single_mip_tail)
     {
-        FIXME_ONCE("Not implemented for image tiling other than VK_IMAGE_TILING_LINEAR.\n");
-        return E_NOTIMPL;
+        sparse->packed_mips.StartTileIndexInOverallResource = tile_idx;
+        tile_idx += packed_tile_count;
     }
 
-    VK_CALL(vkGetImageSubresourceLayout(device->vk_device, resource->u.vk_image, &vk_sub_resource, &vk_layout));
-    TRACE("Offset %#"PRIx64", size %#"PRIx64", row pitch %#"PRIx64", depth pitch %#"PRIx64".\n",
-            vk_layout.offset, vk_layout.size, vk_layout.rowPitch, vk_layout.depthPitch);
+    sparse->tile_count = tile_idx;
+    sparse->packed_mips.NumStandardMips = standard_mip_count;
+    sparse->packed_mips.NumPackedMips = resource->desc.MipLevels - standard_mip_count;
+    sparse->packed_mips.NumTilesForPackedMips = packed_tile_count;
+    if (!packed_tile_count)
+        sparse->packed_mips.StartTileIndexInOverallResource = 0;
 
-    if (FAILED(hr = d3d12_heap_map(resource->heap, resource->heap_offset, resource, (void **)&dst_data)))
+    sparse->tile_shape.WidthInTexels = granularity.width;
+    sparse->tile_shape.HeightInTexels = granularity.height;
+    sparse->tile_shape.DepthInTexels = granularity.depth;
+
+    if (!(sparse->tiles = vkd3d_calloc(sparse->tile_count, sizeof(*sparse->tiles))))
     {
-        WARN("Failed to map resource %p, hr %#x.\n", resource, hr);
-        return hr;
+        hr = E_OUTOFMEMORY;
+        goto done;
     }
 
-    dst_data += vk_layout.offset + vkd3d_format_get_data_offset(format, vk_layout.rowPitch,
-            vk_layout.depthPitch, dst_box->left, dst_box->top, dst_box->front);
+    for (layer = 0; layer < layer_count; ++layer)
+    {
+        for (level = 0; level < standard_mip_count; ++level)
+        {
+            tiling = &sparse->tilings[layer * resource->desc.MipLevels + level];
+            tile = &sparse->tiles[tiling->StartTileIndexInOverallResource];
 
-    vkd3d_format_copy_data(format, src_data, src_row_pitch, src_slice_pitch,
-            dst_data, vk_layout.rowPitch, vk_layout.depthPitch, dst_box->right - dst_box->left,
-            dst_box->bottom - dst_box->top, dst_box->back - dst_box->front);
+            for (z = 0; z < tiling->DepthInTiles; ++z)
+            {
+                for (y = 0; y < tiling->HeightInTiles; ++y)
+                {
+                    for (x = 0; x < tiling->WidthInTiles; ++x, ++tile)
+                    {
+                        tile->u.image.subresource.aspectMask = format->vk_aspect_mask;
+                        tile->u.image.subresource.mipLevel = level;
+                        tile->u.image.subresource.arrayLayer = layer;
+                        tile->u.image.offset.x = x * granularity.width;
+                        tile->u.image.offset.y = y * granularity.height;
+                        tile->u.image.offset.z = z * granularity.depth;
+                        tile->u.image.extent.width = min(granularity.width,
+                                d3d12_resource_desc_get_width(&resource->desc, level) - tile->u.image.offset.x);
+                        tile->u.image.extent.height = min(granularity.height,
+                                d3d12_resource_desc_get_height(&resource->desc, level) - tile->u.image.offset.y);
+                        tile->u.image.extent.depth = min(granularity.depth,
+                                d3d12_resource_desc_get_depth(&resource->desc, level) - tile->u.image.offset.z);
+                    }
+                }
+            }
+        }
 
-    d3d12_heap_unmap(resource->heap, resource);
+        if (!packed_tile_count || (single_mip_tail && layer))
+            continue;
 
-    return S_OK;
+        tile = &sparse->tiles[sparse->packed_mips.StartTileIndexInOverallResource
+                + layer * sparse->packed_mip_layer_stride];
+        for (i = 0; i < packed_tile_count; ++i, ++tile)
+        {
+            tile->opaque = true;
+            tile->u.buffer.offset = color->imageMipTailOffset + layer * color->imageMipTailStride
+                    + (VkDeviceSize)i * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+            tile->u.buffer.length = min(D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES,
+                    color->imageMipTailSize - (VkDeviceSize)i * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES);
+        }
+    }
+
+    hr = S_OK;
+    if (metadata)
+        hr = d3d12_resource_bind_sparse_metadata(resource, device, metadata, &requirements, layer_count);
+
+done:
+    vkd3d_free(sparse_requirements);
+    return hr;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_ReadFromSubresource(ID3D12Resource *iface,
-        void *dst_data, UINT dst_row_pitch, UINT dst_slice_pitch,
-        UINT src_sub_resource, const D3D12_BOX *src_box)
+bool d3d12_resource_get_tile_index(const struct d3d12_resource *resource,
+        const D3D12_TILED_RESOURCE_COORDINATE *coordinate, uint32_t *tile_index)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    const struct vkd3d_vk_device_procs *vk_procs;
-    VkImageSubresource vk_sub_resource;
-    const struct vkd3d_format *format;
-    VkSubresourceLayout vk_layout;
-    struct d3d12_device *device;
-    uint8_t *src_data;
-    D3D12_BOX box;
-    HRESULT hr;
+    const struct d3d12_sparse_info *sparse = &resource->sparse;
+    const D3D12_SUBRESOURCE_TILING *tiling;
+    unsigned int layer;
 
-    TRACE("iface %p, dst_data %p, dst_row_pitch %u, dst_slice_pitch %u, "
-            "src_sub_resource %u, src_box %s.\n",
-            iface, dst_data, dst_row_pitch, dst_slice_pitch, src_sub_resource, debug_d3d12_box(src_box));
+    if (coordinate->Subresource >= sparse->tiling_count)
+        return false;
 
-    if (d3d12_resource_is_buffer(resource))
+    tiling = &sparse->tilings[coordinate->Subresource];
+    if (tiling->StartTileIndexInOverallResource == D3D12_PACKED_TILE)
     {
-        WARN("Buffers are not supported.\n");
-        return E_INVALIDARG;
+        if (coordinate->X >= sparse->packed_mips.NumTilesForPackedMips || coordinate->Y || coordinate->Z)
+            return false;
+
+        layer = coordinate->Subresource / resource->desc.MipLevels;
+        *tile_index = sparse->packed_mips.StartTileIndexInOverallResource
+                + layer * sparse->packed_mip_layer_stride + coordinate->X;
+        return true;
     }
 
-    device = resource->device;
-    vk_procs = &device->vk_procs;
+    if (coordinate->X >= tiling->WidthInTiles || coordinate->Y >= tiling->HeightInTiles
+            || coordinate->Z >= tiling->DepthInTiles)
+        return false;
 
-    if (!(format = vkd3d_format_from_d3d12_resource_desc(device, &resource->desc, 0)))
-    {
-        ERR("Invalid DXGI format %#x.\n", resource->desc.Format);
-        return E_INVALIDARG;
-    }
-    if (format->vk_aspect_mask != VK_IMAGE_ASPECT_COLOR_BIT)
-    {
-        FIXME("Not supported for format %#x.\n", format->dxgi_format);
-        return E_NOTIMPL;
-    }
+    *tile_index = tiling->StartTileIndexInOverallResource
+            + (coordinate->Z * tiling->HeightInTiles + coordinate->Y) * tiling->WidthInTiles + coordinate->X;
+    return true;
+}
 
-    vk_sub_resource.arrayLayer = src_sub_resource / resource->desc.MipLevels;
-    vk_sub_resource.mipLevel = src_sub_resource % resource->desc.MipLevels;
-    vk_sub_resource.aspectMask = format->vk_aspect_mask;
+HRESULT d3d12_reserved_resource_create(struct d3d12_device *device,
+        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
+        const D3D12_CLEAR_VALUE *optimized_clear_value, struct d3d12_resource **resource)
+{
+    D3D12_TILED_RESOURCES_TIER tier = device->feature_options.TiledResourcesTier;
+    struct d3d12_resource *object;
+    HRESULT hr;
 
-    if (!src_box)
+    if (!tier)
     {
-        d3d12_resource_get_level_box(resource, vk_sub_resource.mipLevel, &box);
-        src_box = &box;
-    }
-    else if (!d3d12_resource_validate_box(resource, src_sub_resource, src_box))
-    {
-        WARN("Invalid box %s.\n", debug_d3d12_box(src_box));
+        WARN("Tiled resources are not supported.\n");
         return E_INVALIDARG;
     }
-
-    if (d3d12_box_is_empty(src_box))
-    {
-        WARN("Empty box %s.\n", debug_d3d12_box(src_box));
-        return S_OK;
-    }
-
-    if (!d3d12_resource_is_cpu_accessible(resource))
+    if (desc->Dimension == D3D12_RESOURCE_DIMENSION_TEXTURE3D && tier < D3D12_TILED_RESOURCES_TIER_3)
     {
-        FIXME_ONCE("Not implemented for this resource type.\n");
-        return E_NOTIMPL;
+        WARN("Reserved 3D textures require tiled resources tier 3.\n");
+        return E_INVALIDARG;
     }
-    if (!(resource->flags & VKD3D_RESOURCE_LINEAR_TILING))
+    if (desc->SampleDesc.Count > 1)
     {
-        FIXME_ONCE("Not implemented for image tiling other than VK_IMAGE_TILING_LINEAR.\n");
+        FIXME("Multisampled reserved resources are not supported.\n");
         return E_NOTIMPL;
     }
 
-    VK_CALL(vkGetImageSubresourceLayout(device->vk_device, resource->u.vk_image, &vk_sub_resource, &vk_layout));
-    TRACE("Offset %#"PRIx64", size %#"PRIx64", row pitch %#"PRIx64", depth pitch %#"PRIx64".\n",
-            vk_layout.offset, vk_layout.size, vk_layout.rowPitch, vk_layout.depthPitch);
+    if (FAILED(hr = d3d12_resource_create(device, NULL, 0,
+            desc, initial_state, optimized_clear_value, false, &object)))
+        return hr;
 
-    if (FAILED(hr = d3d12_heap_map(resource->heap, resource->heap_offset, resource, (void **)&src_data)))
+    if (FAILED(hr = d3d12_resource_init_sparse_info(object, device)))
     {
-        WARN("Failed to map resource %p, hr %#x.\n", resource, hr);
+        d3d12_resource_Release(&object->ID3D12Resource_iface);
         return hr;
     }
 
-    src_data += vk_layout.offset + vkd3d_format_get_data_offset(format, vk_layout.rowPitch,
-            vk_layout.depthPitch, src_box->left, src_box->top, src_box->front);
-
-    vkd3d_format_copy_data(format, src_data, vk_layout.rowPitch, vk_layout.depthPitch,
-            dst_data, dst_row_pitch, dst_slice_pitch, src_box->right - src_box->left,
-            src_box->bottom - src_box->top, src_box->back - src_box->front);
+    TRACE("Created reserved resource %p.\n", object);
 
-    d3d12_heap_unmap(resource->heap, resource);
+    *resource = object;
 
     return S_OK;
 }
 
-static HRESULT STDMETHODCALLTYPE d3d12_resource_GetHeapProperties(ID3D12Resource *iface,
-        D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS *flags)
+HRESULT vkd3d_create_image_resource(ID3D12Device *device,
+        const struct vkd3d_image_resource_create_info *create_info, ID3D12Resource **resource)
 {
-    struct d3d12_resource *resource = impl_from_ID3D12Resource(iface);
-    struct d3d12_heap *heap;
+    struct d3d12_device *d3d12_device = unsafe_impl_from_ID3D12Device(device);
+    struct d3d12_resource *object;
+    HRESULT hr;
 
-    TRACE("iface %p, heap_properties %p, flags %p.\n",
-            iface, heap_properties, flags);
+    TRACE("device %p, create_info %p, resource %p.\n", device, create_info, resource);
 
-    if (resource->flags & VKD3D_RESOURCE_EXTERNAL)
+    if (!create_info || !resource)
+        return E_INVALIDARG;
+    if (create_info->type != VKD3D_STRUCTURE_TYPE_IMAGE_RESOURCE_CREATE_INFO)
     {
-        if (heap_properties)
-        {
-            memset(heap_properties, 0, sizeof(*heap_properties));
-            heap_properties->Type = D3D12_HEAP_TYPE_DEFAULT;
-        }
-        if (flags)
-            *flags = D3D12_HEAP_FLAG_NONE;
-        return S_OK;
+        WARN("Invalid structure type %#x.\n", create_info->type);
+        return E_INVALIDARG;
     }
+    if (create_info->next)
+        WARN("Unhandled next %p.\n", create_info->next);
 
-    if (!(heap = resource->heap))
+    if (!(object = vkd3d_object_pool_alloc(&d3d12_device->resource_pool)))
+        return E_OUTOFMEMORY;
+
+    memset(object, 0, sizeof(*object));
+
+    object->ID3D12Resource_iface.lpVtbl = &d3d12_resource_vtbl;
+    object->refcount = 1;
+    object->internal_refcount = 1;
+    object->desc = create_info->desc;
+    object->u.vk_image = create_info->vk_image;
+    object->flags = VKD3D_RESOURCE_EXTERNAL;
+    object->flags |= create_info->flags & VKD3D_RESOURCE_PUBLIC_FLAGS;
+    object->initial_state = D3D12_RESOURCE_STATE_COMMON;
+    if (create_info->flags & VKD3D_RESOURCE_PRESENT_STATE_TRANSITION)
+        object->present_state = create_info->present_state;
+    else
+        object->present_state = D3D12_RESOURCE_STATE_COMMON;
+
+    if (FAILED(hr = vkd3d_private_store_init(&object->private_store)))
     {
-        WARN("Cannot get heap properties for reserved resources.\n");
-        return E_INVALIDARG;
+        vkd3d_object_pool_free(&d3d12_device->resource_pool, object);
+        return hr;
     }
 
-    if (heap_properties)
-        *heap_properties = heap->desc.Properties;
-    if (flags)
-        *flags = heap->desc.Flags;
+    if (FAILED(hr = vkd3d_view_cache_init(&object->view_cache)))
+    {
+        vkd3d_private_store_destroy(&object->private_store);
+        vkd3d_object_pool_free(&d3d12_device->resource_pool, object);
+        return hr;
+    }
 
-    return S_OK;
-}
+    d3d12_device_add_ref(object->device = d3d12_device);
 
-static const struct ID3D12ResourceVtbl d3d12_resource_vtbl =
-{
-    /* IUnknown methods */
-    d3d12_resource_QueryInterface,
-    d3d12_resource_AddRef,
-    d3d12_resource_Release,
-    /* ID3D12Object methods */
-    d3d12_resource_GetPrivateData,
-    d3d12_resource_SetPrivateData,
-    d3d12_resource_SetPrivateDataInterface,
-    d3d12_resource_SetName,
-    /* ID3D12DeviceChild methods */
-    d3d12_resource_GetDevice,
-    /* ID3D12Resource methods */
-    d3d12_resource_Map,
-    d3d12_resource_Unmap,
-    d3d12_resource_GetDesc,
-    d3d12_resource_GetGPUVirtualAddress,
-    d3d12_resource_WriteToSubresource,
-    d3d12_resource_ReadFromSubresource,
-    d3d12_resource_GetHeapProperties,
-};
+    TRACE("Created resource %p.\n", object);
 
-struct d3d12_resource *unsafe_impl_from_ID3D12Resource(ID3D12Resource *iface)
-{
-    if (!iface)
-        return NULL;
-    assert(iface->lpVtbl == &d3d12_resource_vtbl);
-    return impl_from_ID3D12Resource(iface);
+    *resource = &object->ID3D12Resource_iface;
+
+    return S_OK;
 }
 
-static void d3d12_validate_resource_flags(D3D12_RESOURCE_FLAGS flags)
+ULONG vkd3d_resource_incref(ID3D12Resource *resource)
 {
-    unsigned int unknown_flags = flags & ~(D3D12_RESOURCE_FLAG_NONE
-            | D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET
-            | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL
-            | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS
-            | D3D12_RESOURCE_FLAG_DENY_SHADER_RESOURCE
-            | D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER
-            | D3D12_RESOURCE_FLAG_ALLOW_SIMULTANEOUS_ACCESS);
-
-    if (unknown_flags)
-        FIXME("Unknown resource flags %#x.\n", unknown_flags);
-    if (flags & D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER)
-        FIXME("Ignoring D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER.\n");
+    TRACE("resource %p.\n", resource);
+    return d3d12_resource_incref(impl_from_ID3D12Resource(resource));
 }
 
-HRESULT d3d12_resource_validate_desc(const D3D12_RESOURCE_DESC *desc)
+ULONG vkd3d_resource_decref(ID3D12Resource *resource)
 {
-    switch (desc->Dimension)
-    {
-        case D3D12_RESOURCE_DIMENSION_BUFFER:
-            if (desc->MipLevels != 1)
-            {
-                WARN("Invalid miplevel count %u for buffer.\n", desc->MipLevels);
-                return E_INVALIDARG;
-            }
-
-            if (desc->Format != DXGI_FORMAT_UNKNOWN || desc->Layout != D3D12_TEXTURE_LAYOUT_ROW_MAJOR
-                    || desc->Height != 1 || desc->DepthOrArraySize != 1
-                    || desc->SampleDesc.Count != 1 || desc->SampleDesc.Quality != 0
-                    || (desc->Alignment != 0 && desc->Alignment != D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT))
-            {
-                WARN("Invalid parameters for a buffer resource.\n");
-                return E_INVALIDARG;
-            }
-            break;
+    TRACE("resource %p.\n", resource);
+    return d3d12_resource_decref(impl_from_ID3D12Resource(resource));
+}
 
-        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
-            if (desc->Height != 1)
-            {
-                WARN("1D texture with a height of %u.\n", desc->Height);
-                return E_INVALIDARG;
-            }
-            break;
+HRESULT vkd3d_get_view_cache_statistics(ID3D12Resource *resource,
+        struct vkd3d_view_cache_statistics *statistics)
+{
+    struct vkd3d_view_cache *cache = &impl_from_ID3D12Resource(resource)->view_cache;
+    int rc;
 
-        case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
-        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
-            break;
+    TRACE("resource %p, statistics %p.\n", resource, statistics);
 
-        default:
-            WARN("Invalid resource dimension %#x.\n", desc->Dimension);
-            return E_INVALIDARG;
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
     }
 
-    d3d12_validate_resource_flags(desc->Flags);
+    statistics->view_count = cache->entry_count;
+    statistics->hit_count = cache->hit_count;
+    statistics->miss_count = cache->miss_count;
+    statistics->purged_count = cache->purged_count;
 
-    /* FIXME: Validate alignment for textures. */
+    pthread_mutex_unlock(&cache->mutex);
 
     return S_OK;
 }
 
-static bool d3d12_resource_validate_heap_properties(const struct d3d12_resource *resource,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_RESOURCE_STATES initial_state)
+/* Residency
+ *
+ * With VK_EXT_pageable_device_local_memory, evicted heaps get the lowest
+ * memory priority, which lets the driver page them out first. Otherwise
+ * eviction is left to the driver. Evicted heaps are excluded from the
+ * reported usage, and default heaps which don't fit into the device memory
+ * budget anymore are placed in system memory. */
+#define VKD3D_RESIDENCY_BUDGET_UPDATE_INTERVAL 32
+#define VKD3D_RESIDENCY_DEFAULT_PRIORITY 0.5f
+#define VKD3D_RESIDENCY_EVICTED_PRIORITY 0.0f
+
+HRESULT vkd3d_residency_manager_init(struct vkd3d_residency_manager *manager)
 {
-    if (heap_properties->Type == D3D12_HEAP_TYPE_UPLOAD
-            || heap_properties->Type == D3D12_HEAP_TYPE_READBACK)
-    {
-        if (d3d12_resource_is_texture(resource))
-        {
-            WARN("Textures cannot be created on upload/readback heaps.\n");
-            return false;
-        }
+    int rc;
 
-        if (resource->desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS))
-        {
-            WARN("Render target and unordered access buffers cannot be created on upload/readback heaps.\n");
-            return false;
-        }
-    }
+    memset(manager, 0, sizeof(*manager));
 
-    if (heap_properties->Type == D3D12_HEAP_TYPE_UPLOAD && initial_state != D3D12_RESOURCE_STATE_GENERIC_READ)
-    {
-        WARN("For D3D12_HEAP_TYPE_UPLOAD the state must be D3D12_RESOURCE_STATE_GENERIC_READ.\n");
-        return false;
-    }
-    if (heap_properties->Type == D3D12_HEAP_TYPE_READBACK && initial_state != D3D12_RESOURCE_STATE_COPY_DEST)
+    if ((rc = pthread_mutex_init(&manager->mutex, NULL)))
     {
-        WARN("For D3D12_HEAP_TYPE_READBACK the state must be D3D12_RESOURCE_STATE_COPY_DEST.\n");
-        return false;
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
     }
 
-    return true;
+    return S_OK;
 }
 
-static HRESULT d3d12_resource_init(struct d3d12_resource *resource, struct d3d12_device *device,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
-        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
-        const D3D12_CLEAR_VALUE *optimized_clear_value, bool placed)
+void vkd3d_residency_manager_cleanup(struct vkd3d_residency_manager *manager)
 {
-    HRESULT hr;
-
-    resource->ID3D12Resource_iface.lpVtbl = &d3d12_resource_vtbl;
-    resource->refcount = 1;
-    resource->internal_refcount = 1;
+    pthread_mutex_destroy(&manager->mutex);
+}
 
-    resource->desc = *desc;
+static unsigned int d3d12_heap_get_vk_heap_index(const struct d3d12_heap *heap, const struct d3d12_device *device)
+{
+    return device->memory_properties.memoryTypes[heap->vk_memory_type].heapIndex;
+}
 
-    if (heap_properties && !d3d12_resource_validate_heap_properties(resource, heap_properties, initial_state))
-        return E_INVALIDARG;
+static void vkd3d_residency_manager_add_allocation(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, uint32_t vk_memory_type, VkDeviceSize size)
+{
+    int rc;
 
-    if (!is_valid_resource_state(initial_state))
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
     {
-        WARN("Invalid initial resource state %#x.\n", initial_state);
-        return E_INVALIDARG;
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
     }
+    manager->allocated_size[device->memory_properties.memoryTypes[vk_memory_type].heapIndex] += size;
+    pthread_mutex_unlock(&manager->mutex);
+}
 
-    if (optimized_clear_value && d3d12_resource_is_buffer(resource))
+static void vkd3d_residency_manager_remove_allocation(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, uint32_t vk_memory_type, VkDeviceSize size)
+{
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
     {
-        WARN("Optimized clear value must be NULL for buffers.\n");
-        return E_INVALIDARG;
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
     }
+    manager->allocated_size[device->memory_properties.memoryTypes[vk_memory_type].heapIndex] -= size;
+    pthread_mutex_unlock(&manager->mutex);
+}
 
-    if (optimized_clear_value)
-        WARN("Ignoring optimized clear value.\n");
+/* Private heaps are allocated through the memory allocator, which accounts
+ * for their memory. */
+static void vkd3d_residency_manager_add_heap(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, struct d3d12_heap *heap)
+{
+    heap->residency_count = 1;
 
-    resource->gpu_address = 0;
-    resource->flags = 0;
-    if (placed && d3d12_resource_is_buffer(resource))
-        resource->flags |= VKD3D_RESOURCE_PLACED_BUFFER;
+    if (!heap->is_private)
+        vkd3d_residency_manager_add_allocation(manager, device, heap->vk_memory_type, heap->desc.SizeInBytes);
+}
 
-    if (FAILED(hr = d3d12_resource_validate_desc(&resource->desc)))
-        return hr;
+static void vkd3d_residency_manager_remove_heap(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, struct d3d12_heap *heap)
+{
+    int rc;
 
-    switch (desc->Dimension)
+    if (!heap->is_private)
+        vkd3d_residency_manager_remove_allocation(manager, device, heap->vk_memory_type, heap->desc.SizeInBytes);
+
+    if (heap->residency_count)
+        return;
+
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
     {
-        case D3D12_RESOURCE_DIMENSION_BUFFER:
-            /* We'll inherit a VkBuffer reference from the heap with an implied offset. */
-            if (placed)
-            {
-                resource->u.vk_buffer = VK_NULL_HANDLE;
-                break;
-            }
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+    manager->evicted_size[d3d12_heap_get_vk_heap_index(heap, device)] -= heap->desc.SizeInBytes;
+    pthread_mutex_unlock(&manager->mutex);
+}
 
-            if (FAILED(hr = vkd3d_create_buffer(device, heap_properties, heap_flags,
-                    &resource->desc, &resource->u.vk_buffer)))
-                return hr;
-            if (!(resource->gpu_address = vkd3d_gpu_va_allocator_allocate(&device->gpu_va_allocator,
-                    desc->Alignment ? desc->Alignment : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT,
-                    desc->Width, resource)))
-            {
-                ERR("Failed to allocate GPU VA.\n");
-                d3d12_resource_destroy(resource, device);
-                return E_OUTOFMEMORY;
-            }
-            break;
+/* Suballocated heaps share their VkDeviceMemory with other resources, and
+ * keep the default priority. */
+static void d3d12_heap_set_priority(struct d3d12_heap *heap, struct d3d12_device *device, float priority)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
 
-        case D3D12_RESOURCE_DIMENSION_TEXTURE1D:
-        case D3D12_RESOURCE_DIMENSION_TEXTURE2D:
-        case D3D12_RESOURCE_DIMENSION_TEXTURE3D:
-            if (!resource->desc.MipLevels)
-                resource->desc.MipLevels = max_miplevel_count(desc);
-            resource->flags |= VKD3D_RESOURCE_INITIAL_STATE_TRANSITION;
-            if (FAILED(hr = vkd3d_create_image(device, heap_properties, heap_flags,
-                    &resource->desc, resource, &resource->u.vk_image)))
-                return hr;
-            break;
+    if (!device->vk_info.EXT_pageable_device_local_memory || heap->allocation.chunk)
+        return;
 
-        default:
-            WARN("Invalid resource dimension %#x.\n", resource->desc.Dimension);
-            return E_INVALIDARG;
+    VK_CALL(vkSetDeviceMemoryPriorityEXT(device->vk_device, heap->vk_memory, priority));
+}
+
+/* Heaps and committed resources are the only pageable objects owning a
+ * meaningful amount of memory. */
+static struct d3d12_heap *d3d12_heap_from_pageable(ID3D12Pageable *pageable)
+{
+    struct d3d12_resource *resource;
+
+    if ((const void *)pageable->lpVtbl == (const void *)&d3d12_heap_vtbl)
+        return impl_from_ID3D12Heap((ID3D12Heap *)pageable);
+
+    if ((const void *)pageable->lpVtbl == (const void *)&d3d12_resource_vtbl)
+    {
+        resource = impl_from_ID3D12Resource((ID3D12Resource *)pageable);
+        if (resource->flags & VKD3D_RESOURCE_DEDICATED_HEAP)
+            return resource->heap;
     }
 
-    resource->map_count = 0;
+    return NULL;
+}
 
-    resource->initial_state = initial_state;
+HRESULT vkd3d_residency_manager_make_resident(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, unsigned int object_count, ID3D12Pageable * const *objects)
+{
+    struct d3d12_heap *heap;
+    unsigned int i;
+    int rc;
 
-    resource->heap = NULL;
-    resource->heap_offset = 0;
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
 
-    if (FAILED(hr = vkd3d_private_store_init(&resource->private_store)))
+    for (i = 0; i < object_count; ++i)
     {
-        d3d12_resource_destroy(resource, device);
-        return hr;
+        if (!(heap = d3d12_heap_from_pageable(objects[i])))
+            continue;
+
+        if (!heap->residency_count++)
+        {
+            TRACE("Making heap %p resident.\n", heap);
+            manager->evicted_size[d3d12_heap_get_vk_heap_index(heap, device)] -= heap->desc.SizeInBytes;
+            d3d12_heap_set_priority(heap, device, VKD3D_RESIDENCY_DEFAULT_PRIORITY);
+        }
     }
 
-    d3d12_device_add_ref(resource->device = device);
+    pthread_mutex_unlock(&manager->mutex);
 
     return S_OK;
 }
 
-static HRESULT d3d12_resource_create(struct d3d12_device *device,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
-        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
-        const D3D12_CLEAR_VALUE *optimized_clear_value, bool placed, struct d3d12_resource **resource)
+HRESULT vkd3d_residency_manager_evict(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, unsigned int object_count, ID3D12Pageable * const *objects)
 {
-    struct d3d12_resource *object;
-    HRESULT hr;
-
-    if (!(object = vkd3d_malloc(sizeof(*object))))
-        return E_OUTOFMEMORY;
+    struct d3d12_heap *heap;
+    unsigned int i;
+    int rc;
 
-    if (FAILED(hr = d3d12_resource_init(object, device, heap_properties, heap_flags,
-            desc, initial_state, optimized_clear_value, placed)))
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
     {
-        vkd3d_free(object);
-        return hr;
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
     }
 
-    *resource = object;
+    for (i = 0; i < object_count; ++i)
+    {
+        if (!(heap = d3d12_heap_from_pageable(objects[i])))
+            continue;
 
-    return hr;
-}
+        if (!heap->residency_count)
+        {
+            WARN("Heap %p is not resident.\n", heap);
+            continue;
+        }
 
-static HRESULT vkd3d_allocate_resource_memory(
-        struct d3d12_device *device, struct d3d12_resource *resource,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags)
-{
-    D3D12_HEAP_DESC heap_desc;
-    HRESULT hr;
+        if (!--heap->residency_count)
+        {
+            TRACE("Evicting heap %p.\n", heap);
+            manager->evicted_size[d3d12_heap_get_vk_heap_index(heap, device)] += heap->desc.SizeInBytes;
+            d3d12_heap_set_priority(heap, device, VKD3D_RESIDENCY_EVICTED_PRIORITY);
+        }
+    }
 
-    heap_desc.SizeInBytes = 0;
-    heap_desc.Properties = *heap_properties;
-    heap_desc.Alignment = 0;
-    heap_desc.Flags = heap_flags;
-    if (SUCCEEDED(hr = d3d12_heap_create(device, &heap_desc, resource, &resource->heap)))
-        resource->flags |= VKD3D_RESOURCE_DEDICATED_HEAP;
-    return hr;
+    pthread_mutex_unlock(&manager->mutex);
+
+    return S_OK;
 }
 
-HRESULT d3d12_committed_resource_create(struct d3d12_device *device,
-        const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
-        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
-        const D3D12_CLEAR_VALUE *optimized_clear_value, struct d3d12_resource **resource)
+static void vkd3d_residency_manager_update_budget(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device)
 {
-    struct d3d12_resource *object;
-    HRESULT hr;
-
-    if (!heap_properties)
-    {
-        WARN("Heap properties are NULL.\n");
-        return E_INVALIDARG;
-    }
+    const struct vkd3d_vk_instance_procs *vk_procs = &device->vkd3d_instance->vk_procs;
+    const VkPhysicalDeviceMemoryProperties *memory_info = &device->memory_properties;
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_properties;
+    VkPhysicalDeviceMemoryProperties2KHR memory_properties2;
+    unsigned int i;
+    int rc;
 
-    if (FAILED(hr = d3d12_resource_create(device, heap_properties, heap_flags,
-            desc, initial_state, optimized_clear_value, false, &object)))
-        return hr;
+    memset(&budget_properties, 0, sizeof(budget_properties));
+    budget_properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+    memory_properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2_KHR;
+    memory_properties2.pNext = &budget_properties;
+    VK_CALL(vkGetPhysicalDeviceMemoryProperties2KHR(device->vk_physical_device, &memory_properties2));
 
-    if (FAILED(hr = vkd3d_allocate_resource_memory(device, object, heap_properties, heap_flags)))
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
     {
-        d3d12_resource_Release(&object->ID3D12Resource_iface);
-        return hr;
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
     }
 
-    TRACE("Created committed resource %p.\n", object);
-
-    *resource = object;
+    for (i = 0; i < memory_info->memoryHeapCount; ++i)
+    {
+        manager->heap_budget[i] = budget_properties.heapBudget[i];
+        manager->heap_usage[i] = budget_properties.heapUsage[i];
+        manager->budget_allocated_size[i] = manager->allocated_size[i];
+    }
 
-    return S_OK;
+    pthread_mutex_unlock(&manager->mutex);
 }
 
-static HRESULT vkd3d_bind_heap_memory(struct d3d12_device *device,
-        struct d3d12_resource *resource, struct d3d12_heap *heap, uint64_t heap_offset)
+/* Returns the budget and the usage of resident memory for each Vulkan
+ * memory heap. Called with the residency manager mutex held. */
+static void vkd3d_residency_manager_get_heap_budgets_locked(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, VkDeviceSize *budgets, VkDeviceSize *usages)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
-    VkDevice vk_device = device->vk_device;
-    VkMemoryRequirements requirements;
-    VkResult vr;
+    const VkPhysicalDeviceMemoryProperties *memory_info = &device->memory_properties;
+    unsigned int i;
 
-    if (resource->flags & VKD3D_RESOURCE_PLACED_BUFFER)
+    for (i = 0; i < memory_info->memoryHeapCount; ++i)
     {
-        /* Just inherit the buffer from the heap. */
-        resource->u.vk_buffer = heap->buffer_resource->u.vk_buffer;
-        resource->heap = heap;
-        resource->heap_offset = heap_offset;
-        resource->gpu_address = heap->buffer_resource->gpu_address + heap_offset;
-        return S_OK;
+        if (device->vk_info.EXT_memory_budget)
+        {
+            budgets[i] = manager->heap_budget[i];
+            usages[i] = manager->heap_usage[i];
+            if (manager->allocated_size[i] >= manager->budget_allocated_size[i])
+                usages[i] += manager->allocated_size[i] - manager->budget_allocated_size[i];
+            else
+                usages[i] -= min(usages[i], manager->budget_allocated_size[i] - manager->allocated_size[i]);
+        }
+        else
+        {
+            budgets[i] = memory_info->memoryHeaps[i].size;
+            usages[i] = manager->allocated_size[i];
+        }
+        usages[i] -= min(usages[i], manager->evicted_size[i]);
     }
+}
 
-    if (d3d12_resource_is_buffer(resource))
-        VK_CALL(vkGetBufferMemoryRequirements(vk_device, resource->u.vk_buffer, &requirements));
-    else
-        VK_CALL(vkGetImageMemoryRequirements(vk_device, resource->u.vk_image, &requirements));
+bool vkd3d_residency_manager_is_over_budget(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, uint32_t vk_memory_type, VkDeviceSize size)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_info = &device->memory_properties;
+    VkDeviceSize budgets[VK_MAX_MEMORY_HEAPS], usages[VK_MAX_MEMORY_HEAPS];
+    unsigned int heap_index = memory_info->memoryTypes[vk_memory_type].heapIndex;
+    int rc;
 
-    if (heap_offset % requirements.alignment)
+    if (!(memory_info->memoryHeaps[heap_index].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT))
+        return false;
+
+    /* Querying the budget is expensive with some drivers. */
+    if (device->vk_info.EXT_memory_budget
+            && (InterlockedIncrement(&manager->budget_check_count) - 1) % VKD3D_RESIDENCY_BUDGET_UPDATE_INTERVAL == 0)
+        vkd3d_residency_manager_update_budget(manager, device);
+
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
     {
-        FIXME("Invalid heap offset %#"PRIx64" (alignment %#"PRIx64").\n",
-                heap_offset, requirements.alignment);
-        goto allocate_memory;
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return false;
     }
+    vkd3d_residency_manager_get_heap_budgets_locked(manager, device, budgets, usages);
+    pthread_mutex_unlock(&manager->mutex);
 
-    if (!(requirements.memoryTypeBits & (1u << heap->vk_memory_type)))
+    return usages[heap_index] + size > budgets[heap_index];
+}
+
+void vkd3d_residency_manager_get_video_memory_info(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, enum vkd3d_memory_segment_group segment_group,
+        struct vkd3d_video_memory_info *info)
+{
+    const VkPhysicalDeviceMemoryProperties *memory_info = &device->memory_properties;
+    VkDeviceSize budgets[VK_MAX_MEMORY_HEAPS], usages[VK_MAX_MEMORY_HEAPS];
+    bool local;
+    unsigned int i;
+    int rc;
+
+    memset(info, 0, sizeof(*info));
+
+    if (device->vk_info.EXT_memory_budget)
+        vkd3d_residency_manager_update_budget(manager, device);
+
+    if ((rc = pthread_mutex_lock(&manager->mutex)))
     {
-        FIXME("Memory type %u cannot be bound to resource %p (allowed types %#x).\n",
-                heap->vk_memory_type, resource, requirements.memoryTypeBits);
-        goto allocate_memory;
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
     }
 
-    if (d3d12_resource_is_buffer(resource))
-        vr = VK_CALL(vkBindBufferMemory(vk_device, resource->u.vk_buffer, heap->vk_memory, heap_offset));
-    else
-        vr = VK_CALL(vkBindImageMemory(vk_device, resource->u.vk_image, heap->vk_memory, heap_offset));
+    vkd3d_residency_manager_get_heap_budgets_locked(manager, device, budgets, usages);
 
-    if (vr == VK_SUCCESS)
+    for (i = 0; i < memory_info->memoryHeapCount; ++i)
     {
-        resource->heap = heap;
-        resource->heap_offset = heap_offset;
+        local = memory_info->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+        if (local != (segment_group == VKD3D_MEMORY_SEGMENT_GROUP_LOCAL))
+            continue;
+
+        info->budget += budgets[i];
+        info->current_usage += usages[i];
+        info->evicted_size += manager->evicted_size[i];
     }
-    else
+
+    pthread_mutex_unlock(&manager->mutex);
+}
+
+/* SRVs, UAVs */
+static struct vkd3d_view *vkd3d_view_create(struct d3d12_device *device, enum vkd3d_view_type type)
+{
+    struct vkd3d_view *view;
+
+    STATIC_ASSERT(offsetof(struct vkd3d_view, refcount) >= sizeof(void *));
+    STATIC_ASSERT(offsetof(struct vkd3d_view, vk_counter_view) <= VKD3D_VIEW_HOT_SIZE);
+
+    if ((view = vkd3d_object_pool_alloc(&device->view_pool)))
     {
-        WARN("Failed to bind memory, vr %d.\n", vr);
-    }
+        assert(!((uintptr_t)view & ~VKD3D_DESCRIPTOR_VIEW_MASK));
 
-    return hresult_from_vk_result(vr);
+        memset(&view->info, 0, sizeof(view->info));
+        view->vk_counter_view = VK_NULL_HANDLE;
+        view->type = type;
+        view->refcount = 1;
+    }
+    return view;
+}
 
-allocate_memory:
-    FIXME("Allocating device memory.\n");
-    return vkd3d_allocate_resource_memory(device, resource, &heap->desc.Properties, heap->desc.Flags);
+void vkd3d_view_incref(struct vkd3d_view *view)
+{
+    InterlockedIncrement(&view->refcount);
 }
 
-HRESULT d3d12_placed_resource_create(struct d3d12_device *device, struct d3d12_heap *heap, uint64_t heap_offset,
-        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
-        const D3D12_CLEAR_VALUE *optimized_clear_value, struct d3d12_resource **resource)
+static void vkd3d_view_destroy(struct vkd3d_view *view, struct d3d12_device *device)
 {
-    struct d3d12_resource *object;
-    HRESULT hr;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
 
-    if (FAILED(hr = d3d12_resource_create(device, &heap->desc.Properties, heap->desc.Flags,
-            desc, initial_state, optimized_clear_value, true, &object)))
-        return hr;
+    TRACE("Destroying view %p.\n", view);
 
-    if (FAILED(hr = vkd3d_bind_heap_memory(device, object, heap, heap_offset)))
+    switch (view->type)
     {
-        d3d12_resource_Release(&object->ID3D12Resource_iface);
-        return hr;
+        case VKD3D_VIEW_TYPE_BUFFER:
+            VK_CALL(vkDestroyBufferView(device->vk_device, view->u.vk_buffer_view, NULL));
+            break;
+        case VKD3D_VIEW_TYPE_IMAGE:
+            VK_CALL(vkDestroyImageView(device->vk_device, view->u.vk_image_view, NULL));
+            break;
+        case VKD3D_VIEW_TYPE_SAMPLER:
+            vkd3d_sampler_cache_release(&device->sampler_cache, device, view->u.vk_sampler);
+            break;
+        default:
+            WARN("Unhandled view type %d.\n", view->type);
     }
 
-    TRACE("Created placed resource %p.\n", object);
+    if (view->vk_counter_view)
+        VK_CALL(vkDestroyBufferView(device->vk_device, view->vk_counter_view, NULL));
 
-    *resource = object;
+    vkd3d_object_pool_free(&device->view_pool, view);
+}
 
-    return S_OK;
+void vkd3d_view_decref(struct vkd3d_view *view, struct d3d12_device *device)
+{
+    if (!InterlockedDecrement(&view->refcount))
+        vkd3d_view_destroy(view, device);
 }
 
-HRESULT d3d12_reserved_resource_create(struct d3d12_device *device,
-        const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_STATES initial_state,
-        const D3D12_CLEAR_VALUE *optimized_clear_value, struct d3d12_resource **resource)
+/* View cache */
+#define VKD3D_VIEW_CACHE_MAX_SIZE 64
+
+/* Normalized view desc. Keys are compared bytewise and must be zero
+ * initialised. */
+struct vkd3d_view_key
 {
-    struct d3d12_resource *object;
-    HRESULT hr;
+    enum vkd3d_view_type type;
+    uint32_t magic;
+    union
+    {
+        struct
+        {
+            VkFormat vk_format;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        } buffer;
+        struct
+        {
+            VkImageViewType view_type;
+            VkFormat vk_format;
+            VkComponentMapping components;
+            VkImageSubresourceRange range;
+        } texture;
+    } u;
+};
 
-    if (FAILED(hr = d3d12_resource_create(device, NULL, 0,
-            desc, initial_state, optimized_clear_value, false, &object)))
-        return hr;
+struct vkd3d_view_cache_entry
+{
+    struct vkd3d_view_key key;
+    struct vkd3d_view *view;
+};
 
-    TRACE("Created reserved resource %p.\n", object);
+static HRESULT vkd3d_view_cache_init(struct vkd3d_view_cache *cache)
+{
+    int rc;
 
-    *resource = object;
+    cache->entries = NULL;
+    cache->entries_size = 0;
+    cache->entry_count = 0;
+    cache->hit_count = 0;
+    cache->miss_count = 0;
+    cache->purged_count = 0;
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
 
     return S_OK;
 }
 
-HRESULT vkd3d_create_image_resource(ID3D12Device *device,
-        const struct vkd3d_image_resource_create_info *create_info, ID3D12Resource **resource)
+static void vkd3d_view_cache_cleanup(struct vkd3d_view_cache *cache, struct d3d12_device *device)
 {
-    struct d3d12_device *d3d12_device = unsafe_impl_from_ID3D12Device(device);
-    struct d3d12_resource *object;
-    HRESULT hr;
+    size_t i;
 
-    TRACE("device %p, create_info %p, resource %p.\n", device, create_info, resource);
+    for (i = 0; i < cache->entry_count; ++i)
+        vkd3d_view_decref(cache->entries[i].view, device);
+    vkd3d_free(cache->entries);
 
-    if (!create_info || !resource)
-        return E_INVALIDARG;
-    if (create_info->type != VKD3D_STRUCTURE_TYPE_IMAGE_RESOURCE_CREATE_INFO)
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+/* Returns a new reference to a cached view. */
+static struct vkd3d_view *vkd3d_view_cache_find_locked(struct vkd3d_view_cache *cache,
+        const struct vkd3d_view_key *key)
+{
+    size_t i;
+
+    for (i = 0; i < cache->entry_count; ++i)
     {
-        WARN("Invalid structure type %#x.\n", create_info->type);
-        return E_INVALIDARG;
+        if (!memcmp(&cache->entries[i].key, key, sizeof(*key)))
+        {
+            vkd3d_view_incref(cache->entries[i].view);
+            ++cache->hit_count;
+            return cache->entries[i].view;
+        }
     }
-    if (create_info->next)
-        WARN("Unhandled next %p.\n", create_info->next);
-
-    if (!(object = vkd3d_malloc(sizeof(*object))))
-        return E_OUTOFMEMORY;
 
-    memset(object, 0, sizeof(*object));
+    ++cache->miss_count;
+    return NULL;
+}
 
-    object->ID3D12Resource_iface.lpVtbl = &d3d12_resource_vtbl;
-    object->refcount = 1;
-    object->internal_refcount = 1;
-    object->desc = create_info->desc;
-    object->u.vk_image = create_info->vk_image;
-    object->flags = VKD3D_RESOURCE_EXTERNAL;
-    object->flags |= create_info->flags & VKD3D_RESOURCE_PUBLIC_FLAGS;
-    object->initial_state = D3D12_RESOURCE_STATE_COMMON;
-    if (create_info->flags & VKD3D_RESOURCE_PRESENT_STATE_TRANSITION)
-        object->present_state = create_info->present_state;
-    else
-        object->present_state = D3D12_RESOURCE_STATE_COMMON;
+/* Views which are referenced only by the cache can't be reached by
+ * descriptors anymore, since new references are only handed out while
+ * the cache is locked. */
+static void vkd3d_view_cache_purge_locked(struct vkd3d_view_cache *cache, struct d3d12_device *device)
+{
+    size_t i, j;
 
-    if (FAILED(hr = vkd3d_private_store_init(&object->private_store)))
+    for (i = 0, j = 0; i < cache->entry_count; ++i)
     {
-        vkd3d_free(object);
-        return hr;
+        if (cache->entries[i].view->refcount == 1)
+            vkd3d_view_decref(cache->entries[i].view, device);
+        else
+            cache->entries[j++] = cache->entries[i];
     }
 
-    d3d12_device_add_ref(object->device = d3d12_device);
-
-    TRACE("Created resource %p.\n", object);
-
-    *resource = &object->ID3D12Resource_iface;
+    TRACE("Purged %zu views.\n", cache->entry_count - j);
 
-    return S_OK;
+    cache->purged_count += cache->entry_count - j;
+    cache->entry_count = j;
 }
 
-ULONG vkd3d_resource_incref(ID3D12Resource *resource)
+static void vkd3d_view_cache_add_locked(struct vkd3d_view_cache *cache, struct d3d12_device *device,
+        const struct vkd3d_view_key *key, struct vkd3d_view *view)
 {
-    TRACE("resource %p.\n", resource);
-    return d3d12_resource_incref(impl_from_ID3D12Resource(resource));
-}
+    struct vkd3d_view_cache_entry *entry;
 
-ULONG vkd3d_resource_decref(ID3D12Resource *resource)
-{
-    TRACE("resource %p.\n", resource);
-    return d3d12_resource_decref(impl_from_ID3D12Resource(resource));
+    if (cache->entry_count == VKD3D_VIEW_CACHE_MAX_SIZE)
+    {
+        vkd3d_view_cache_purge_locked(cache, device);
+        if (cache->entry_count == VKD3D_VIEW_CACHE_MAX_SIZE)
+            return;
+    }
+
+    if (!vkd3d_array_reserve((void **)&cache->entries, &cache->entries_size,
+            cache->entry_count + 1, sizeof(*cache->entries)))
+        return;
+
+    entry = &cache->entries[cache->entry_count++];
+    entry->key = *key;
+    entry->view = view;
+    vkd3d_view_incref(view);
 }
 
-/* CBVs, SRVs, UAVs */
-static struct vkd3d_view *vkd3d_view_create(void)
+HRESULT vkd3d_descriptor_heap_map_init(struct vkd3d_descriptor_heap_map *map)
 {
-    struct vkd3d_view *view;
+    int rc;
 
-    if ((view = vkd3d_malloc(sizeof(*view))))
+    memset(map, 0, sizeof(*map));
+
+    if ((rc = pthread_mutex_init(&map->mutex, NULL)))
     {
-        view->refcount = 1;
-        view->vk_counter_view = VK_NULL_HANDLE;
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
     }
-    return view;
+
+    return S_OK;
 }
 
-void vkd3d_view_incref(struct vkd3d_view *view)
+void vkd3d_descriptor_heap_map_cleanup(struct vkd3d_descriptor_heap_map *map)
 {
-    InterlockedIncrement(&view->refcount);
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(map->leaves); ++i)
+        vkd3d_free(map->leaves[i]);
+
+    pthread_mutex_destroy(&map->mutex);
 }
 
-static void vkd3d_view_destroy_descriptor(struct vkd3d_view *view,
-        const struct d3d12_desc *descriptor, struct d3d12_device *device)
+static bool vkd3d_descriptor_heap_map_insert(struct vkd3d_descriptor_heap_map *map,
+        struct d3d12_descriptor_heap *heap)
 {
-    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    uint64_t granule, first, end;
+    struct d3d12_descriptor_heap **leaf;
+    bool ret = false;
+    int rc;
 
-    TRACE("Destroying view %p.\n", view);
+    first = (uint64_t)(uintptr_t)heap->descriptors >> VKD3D_DESCRIPTOR_HEAP_GRANULE_SHIFT;
+    end = first + (heap->mapping_size >> VKD3D_DESCRIPTOR_HEAP_GRANULE_SHIFT);
+    if (end - 1 >= (uint64_t)VKD3D_DESCRIPTOR_HEAP_MAP_ROOT_SIZE << VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT)
+        return false;
+
+    if ((rc = pthread_mutex_lock(&map->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return false;
+    }
 
-    if (!descriptor)
+    for (granule = first; granule < end; ++granule)
     {
-        VK_CALL(vkDestroyImageView(device->vk_device, view->u.vk_image_view, NULL));
+        if (!(leaf = map->leaves[granule >> VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT]))
+        {
+            if (!(leaf = vkd3d_calloc(VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SIZE, sizeof(*leaf))))
+                goto done;
+            vkd3d_atomic_ptr_store((void **)&map->leaves[granule >> VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT], leaf);
+        }
     }
-    else if (descriptor->magic == VKD3D_DESCRIPTOR_MAGIC_SRV || descriptor->magic == VKD3D_DESCRIPTOR_MAGIC_UAV)
+
+    for (granule = first; granule < end; ++granule)
     {
-        if (descriptor->vk_descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER
-                || descriptor->vk_descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER)
-            VK_CALL(vkDestroyBufferView(device->vk_device, view->u.vk_buffer_view, NULL));
-        else
-            VK_CALL(vkDestroyImageView(device->vk_device, view->u.vk_image_view, NULL));
+        leaf = map->leaves[granule >> VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT];
+        vkd3d_atomic_ptr_store((void **)&leaf[granule & (VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SIZE - 1)], heap);
+    }
+    ret = true;
+
+done:
+    pthread_mutex_unlock(&map->mutex);
+    return ret;
+}
 
-        if (view->vk_counter_view)
-            VK_CALL(vkDestroyBufferView(device->vk_device, view->vk_counter_view, NULL));
+static void vkd3d_descriptor_heap_map_remove(struct vkd3d_descriptor_heap_map *map,
+        struct d3d12_descriptor_heap *heap)
+{
+    struct d3d12_descriptor_heap **leaf;
+    uint64_t granule, end;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&map->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
     }
-    else if (descriptor->magic == VKD3D_DESCRIPTOR_MAGIC_SAMPLER)
+
+    granule = (uint64_t)(uintptr_t)heap->descriptors >> VKD3D_DESCRIPTOR_HEAP_GRANULE_SHIFT;
+    for (end = granule + (heap->mapping_size >> VKD3D_DESCRIPTOR_HEAP_GRANULE_SHIFT); granule < end; ++granule)
     {
-        VK_CALL(vkDestroySampler(device->vk_device, view->u.vk_sampler, NULL));
+        leaf = map->leaves[granule >> VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT];
+        vkd3d_atomic_ptr_store((void **)&leaf[granule & (VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SIZE - 1)], NULL);
     }
 
-    vkd3d_free(view);
+    pthread_mutex_unlock(&map->mutex);
 }
 
-void vkd3d_view_decref(struct vkd3d_view *view, struct d3d12_device *device)
+/* Returns NULL for descriptors of heaps which are not mapped. Leaves are
+ * never freed while the device is alive. */
+static struct d3d12_descriptor_heap *vkd3d_descriptor_heap_map_find(struct vkd3d_descriptor_heap_map *map,
+        const struct d3d12_desc *descriptor)
 {
-    if (!InterlockedDecrement(&view->refcount))
-        vkd3d_view_destroy_descriptor(view, NULL, device);
+    uint64_t granule = (uint64_t)(uintptr_t)descriptor >> VKD3D_DESCRIPTOR_HEAP_GRANULE_SHIFT;
+    struct d3d12_descriptor_heap **leaf;
+
+    if (granule >> VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT >= VKD3D_DESCRIPTOR_HEAP_MAP_ROOT_SIZE)
+        return NULL;
+    if (!(leaf = vkd3d_atomic_ptr_load((void **)&map->leaves[granule >> VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT])))
+        return NULL;
+    return vkd3d_atomic_ptr_load((void **)&leaf[granule & (VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SIZE - 1)]);
 }
 
-void d3d12_desc_write_atomic(struct d3d12_desc *dst, const struct d3d12_desc *src,
+static void d3d12_desc_mark_used(const struct d3d12_desc *descriptor, unsigned int count,
         struct d3d12_device *device)
 {
-    struct d3d12_desc destroy_desc;
-    pthread_mutex_t *mutex;
+    struct d3d12_descriptor_heap *heap;
+    size_t page, last_page;
+    LONG *word, bit, old;
+
+    if (!(heap = vkd3d_descriptor_heap_map_find(&device->descriptor_heap_map, descriptor)))
+        return;
 
-    destroy_desc.u.view = NULL;
+    page = ((const BYTE *)descriptor - heap->descriptors) >> VKD3D_DESCRIPTOR_HEAP_PAGE_SHIFT;
+    last_page = ((const BYTE *)&descriptor[count] - 1 - heap->descriptors) >> VKD3D_DESCRIPTOR_HEAP_PAGE_SHIFT;
+    for (; page <= last_page; ++page)
+    {
+        word = &heap->used_pages[page / 32];
+        bit = (LONG)(1u << (page % 32));
+        while (!((old = *(LONG volatile *)word) & bit))
+            InterlockedCompareExchange(word, old | bit, old);
+    }
+}
 
-    mutex = d3d12_device_get_descriptor_mutex(device, dst);
-    pthread_mutex_lock(mutex);
+void d3d12_desc_write_atomic(struct d3d12_desc *dst, const struct d3d12_desc *src,
+        struct d3d12_device *device)
+{
+    uintptr_t old_tagged_view;
+    struct vkd3d_view *view;
 
-    /* Nothing to do for VKD3D_DESCRIPTOR_MAGIC_CBV. */
-    if ((dst->magic == VKD3D_DESCRIPTOR_MAGIC_SRV
-            || dst->magic == VKD3D_DESCRIPTOR_MAGIC_UAV
-            || dst->magic == VKD3D_DESCRIPTOR_MAGIC_SAMPLER)
-            && !InterlockedDecrement(&dst->u.view->refcount))
-        destroy_desc = *dst;
+    if (src->tagged_view)
+        d3d12_desc_mark_used(dst, 1, device);
 
-    *dst = *src;
+    if (src->tagged_view == VKD3D_DESCRIPTOR_INLINE_CBV)
+        dst->vk_cbv_info = src->vk_cbv_info;
 
-    pthread_mutex_unlock(mutex);
+    /* The reference held by "src" is transferred to "dst". */
+    old_tagged_view = (uintptr_t)InterlockedExchangePointer((void * volatile *)&dst->tagged_view,
+            (void *)src->tagged_view);
 
-    /* Destroy the view after unlocking to reduce wait time. */
-    if (destroy_desc.u.view)
-        vkd3d_view_destroy_descriptor(destroy_desc.u.view, &destroy_desc, device);
+    if ((view = vkd3d_view_from_tagged_view(old_tagged_view)))
+        vkd3d_view_decref(view, device);
 }
 
 static void d3d12_desc_destroy(struct d3d12_desc *descriptor, struct d3d12_device *device)
@@ -2169,31 +4137,125 @@ static void d3d12_desc_destroy(struct d3d12_desc *descriptor, struct d3d12_devic
     d3d12_desc_write_atomic(descriptor, &null_desc, device);
 }
 
+/* Shadow of the Tomb Raider and possibly other titles sometimes destroy
+ * and rewrite a descriptor in another thread while it is being copied.
+ * The view may be freed between reading the descriptor and taking the
+ * reference, so the refcount is only incremented if it is non-zero, and
+ * the descriptor is checked again afterwards. Freed views stay readable,
+ * see struct vkd3d_view. */
+static uintptr_t d3d12_desc_get_view_ref(const struct d3d12_desc *descriptor,
+        struct d3d12_device *device)
+{
+    uintptr_t tagged_view;
+    struct vkd3d_view *view;
+    LONG refcount;
+
+    for (;;)
+    {
+        if (!(tagged_view = *(const volatile uintptr_t *)&descriptor->tagged_view))
+            return 0;
+        if (!(view = vkd3d_view_from_tagged_view(tagged_view)))
+            return tagged_view;
+
+        if ((refcount = *(const LONG volatile *)&view->refcount) <= 0)
+            continue;
+
+        if (InterlockedCompareExchange(&view->refcount, refcount + 1, refcount) != refcount)
+            continue;
+
+        if (tagged_view == *(const volatile uintptr_t *)&descriptor->tagged_view)
+            return tagged_view;
+
+        /* The view was replaced, and possibly recycled for another descriptor. */
+        vkd3d_view_decref(view, device);
+    }
+}
+
 void d3d12_desc_copy(struct d3d12_desc *dst, const struct d3d12_desc *src,
         struct d3d12_device *device)
 {
     struct d3d12_desc tmp;
-    pthread_mutex_t *mutex;
 
     assert(dst != src);
 
-    /* Shadow of the Tomb Raider and possibly other titles sometimes destroy
-     * and rewrite a descriptor in another thread while it is being copied. */
-    mutex = d3d12_device_get_descriptor_mutex(device, src);
-    pthread_mutex_lock(mutex);
+    tmp.tagged_view = d3d12_desc_get_view_ref(src, device);
+    if (tmp.tagged_view == VKD3D_DESCRIPTOR_INLINE_CBV)
+        tmp.vk_cbv_info = src->vk_cbv_info;
+
+    d3d12_desc_write_atomic(dst, &tmp, device);
+}
+
+#define VKD3D_DESC_COPY_PREFETCH_DISTANCE 8
+#define VKD3D_DESC_COPY_RELEASE_BATCH_SIZE 64
+
+static void vkd3d_view_release_batch(struct vkd3d_view **views, unsigned int count,
+        struct d3d12_device *device)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; ++i)
+        vkd3d_view_decref(views[i], device);
+}
+
+/* Copies a contiguous range of descriptors. Descriptors which already
+ * reference the source view are skipped, which avoids refcount traffic
+ * for tables which are rebuilt with mostly unchanged contents. References
+ * to the replaced views are released after the copy, in batches, so that
+ * view destruction does not stall the copy loop. Overlapping ranges are
+ * copied as if through an intermediate buffer. */
+void d3d12_desc_copy_range(struct d3d12_desc *dst, const struct d3d12_desc *src,
+        unsigned int count, struct d3d12_device *device)
+{
+    struct vkd3d_view *released[VKD3D_DESC_COPY_RELEASE_BATCH_SIZE];
+    uintptr_t tagged_view, old_tagged_view, next;
+    struct vkd3d_view *view;
+    unsigned int i, idx, released_count = 0;
+    bool reverse;
+
+    if (dst == src || !count)
+        return;
+
+    reverse = dst > src && dst < src + count;
+
+    d3d12_desc_mark_used(dst, count, device);
 
-    if (src->magic == VKD3D_DESCRIPTOR_MAGIC_SRV
-            || src->magic == VKD3D_DESCRIPTOR_MAGIC_UAV
-            || src->magic == VKD3D_DESCRIPTOR_MAGIC_SAMPLER)
+    for (i = 0; i < count; ++i)
     {
-        vkd3d_view_incref(src->u.view);
-    }
+        idx = reverse ? count - i - 1 : i;
 
-    tmp = *src;
+        /* Views are pointer-chased, so the hardware prefetcher does not
+         * help with the refcount updates below. Freed views stay mapped. */
+        if (i + VKD3D_DESC_COPY_PREFETCH_DISTANCE < count)
+        {
+            next = src[reverse ? idx - VKD3D_DESC_COPY_PREFETCH_DISTANCE
+                    : idx + VKD3D_DESC_COPY_PREFETCH_DISTANCE].tagged_view;
+            if ((view = vkd3d_view_from_tagged_view(next)))
+                vkd3d_prefetch(view);
+        }
 
-    pthread_mutex_unlock(mutex);
+        /* Inline CBVs are equal only if their buffer ranges are equal, so
+         * they are always copied. */
+        tagged_view = *(const volatile uintptr_t *)&src[idx].tagged_view;
+        if (tagged_view == VKD3D_DESCRIPTOR_INLINE_CBV)
+            dst[idx].vk_cbv_info = src[idx].vk_cbv_info;
+        else if (tagged_view == *(const volatile uintptr_t *)&dst[idx].tagged_view)
+            continue;
+
+        tagged_view = d3d12_desc_get_view_ref(&src[idx], device);
+        old_tagged_view = (uintptr_t)InterlockedExchangePointer(
+                (void * volatile *)&dst[idx].tagged_view, (void *)tagged_view);
+        if (!(view = vkd3d_view_from_tagged_view(old_tagged_view)))
+            continue;
+
+        if (released_count == ARRAY_SIZE(released))
+        {
+            vkd3d_view_release_batch(released, released_count, device);
+            released_count = 0;
+        }
+        released[released_count++] = view;
+    }
 
-    d3d12_desc_write_atomic(dst, &tmp, device);
+    vkd3d_view_release_batch(released, released_count, device);
 }
 
 static VkDeviceSize vkd3d_get_required_texel_buffer_alignment(const struct d3d12_device *device,
@@ -2254,26 +4316,62 @@ static bool vkd3d_create_vk_buffer_view(struct d3d12_device *device,
     return vr == VK_SUCCESS;
 }
 
-static bool vkd3d_create_buffer_view(struct d3d12_device *device,
-        VkBuffer vk_buffer, const struct vkd3d_format *format,
+static bool vkd3d_create_buffer_view(struct d3d12_device *device, struct vkd3d_view_cache *cache,
+        uint32_t magic, VkBuffer vk_buffer, const struct vkd3d_format *format,
         VkDeviceSize offset, VkDeviceSize size, struct vkd3d_view **view)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_view_key key;
     struct vkd3d_view *object;
     VkBufferView vk_view;
 
+    if (cache)
+    {
+        memset(&key, 0, sizeof(key));
+        key.type = VKD3D_VIEW_TYPE_BUFFER;
+        key.magic = magic;
+        key.u.buffer.vk_format = format->vk_format;
+        key.u.buffer.offset = offset;
+        key.u.buffer.size = size;
+
+        pthread_mutex_lock(&cache->mutex);
+        if ((*view = vkd3d_view_cache_find_locked(cache, &key)))
+        {
+            pthread_mutex_unlock(&cache->mutex);
+            return true;
+        }
+    }
+
     if (!vkd3d_create_vk_buffer_view(device, vk_buffer, format, offset, size, &vk_view))
-        return false;
+        goto fail;
 
-    if (!(object = vkd3d_view_create()))
+    if (!(object = vkd3d_view_create(device, VKD3D_VIEW_TYPE_BUFFER)))
     {
         VK_CALL(vkDestroyBufferView(device->vk_device, vk_view, NULL));
-        return false;
+        goto fail;
     }
 
     object->u.vk_buffer_view = vk_view;
+    /* FIXME: Clears are implemented only for R32_UINT buffer UAVs. */
+    if (format->dxgi_format == DXGI_FORMAT_R32_UINT)
+    {
+        object->info.buffer.offset = offset;
+        object->info.buffer.size = size;
+    }
+
+    if (cache)
+    {
+        vkd3d_view_cache_add_locked(cache, device, &key, object);
+        pthread_mutex_unlock(&cache->mutex);
+    }
+
     *view = object;
     return true;
+
+fail:
+    if (cache)
+        pthread_mutex_unlock(&cache->mutex);
+    return false;
 }
 
 #define VKD3D_VIEW_RAW_BUFFER 0x1
@@ -2281,7 +4379,7 @@ static bool vkd3d_create_buffer_view(struct d3d12_device *device,
 static bool vkd3d_create_buffer_view_for_resource(struct d3d12_device *device,
         struct d3d12_resource *resource, DXGI_FORMAT view_format,
         unsigned int offset, unsigned int size, unsigned int structure_stride,
-        unsigned int flags, struct vkd3d_view **view)
+        unsigned int flags, uint32_t magic, bool cached, struct vkd3d_view **view)
 {
     const struct vkd3d_format *format;
     VkDeviceSize element_size;
@@ -2308,8 +4406,9 @@ static bool vkd3d_create_buffer_view_for_resource(struct d3d12_device *device,
 
     assert(d3d12_resource_is_buffer(resource));
 
-    return vkd3d_create_buffer_view(device, resource->u.vk_buffer,
-            format, resource->heap_offset + offset * element_size, size * element_size, view);
+    return vkd3d_create_buffer_view(device, cached ? &resource->view_cache : NULL, magic,
+            resource->u.vk_buffer, format, resource->heap_offset + offset * element_size,
+            size * element_size, view);
 }
 
 static void vkd3d_set_view_swizzle_for_format(VkComponentMapping *components,
@@ -2510,13 +4609,13 @@ static bool init_default_texture_view_desc(struct vkd3d_texture_view_desc *desc,
     return true;
 }
 
-static bool vkd3d_create_texture_view(struct d3d12_device *device,
-        VkImage vk_image, const struct vkd3d_texture_view_desc *desc,
-        struct vkd3d_view **view)
+static bool vkd3d_create_texture_view(struct d3d12_device *device, struct vkd3d_view_cache *cache,
+        uint32_t magic, VkImage vk_image, const struct vkd3d_texture_view_desc *desc, struct vkd3d_view **view)
 {
     const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
     const struct vkd3d_format *format = desc->format;
     struct VkImageViewCreateInfo view_desc;
+    struct vkd3d_view_key key;
     struct vkd3d_view *object;
     VkImageView vk_view;
     VkResult vr;
@@ -2535,21 +4634,56 @@ static bool vkd3d_create_texture_view(struct d3d12_device *device,
     view_desc.subresourceRange.levelCount = desc->miplevel_count;
     view_desc.subresourceRange.baseArrayLayer = desc->layer_idx;
     view_desc.subresourceRange.layerCount = desc->layer_count;
+
+    if (cache)
+    {
+        memset(&key, 0, sizeof(key));
+        key.type = VKD3D_VIEW_TYPE_IMAGE;
+        key.magic = magic;
+        key.u.texture.view_type = view_desc.viewType;
+        key.u.texture.vk_format = view_desc.format;
+        key.u.texture.components = view_desc.components;
+        key.u.texture.range = view_desc.subresourceRange;
+
+        pthread_mutex_lock(&cache->mutex);
+        if ((*view = vkd3d_view_cache_find_locked(cache, &key)))
+        {
+            pthread_mutex_unlock(&cache->mutex);
+            return true;
+        }
+    }
+
     if ((vr = VK_CALL(vkCreateImageView(device->vk_device, &view_desc, NULL, &vk_view))) < 0)
     {
         WARN("Failed to create Vulkan image view, vr %d.\n", vr);
-        return false;
+        goto fail;
     }
 
-    if (!(object = vkd3d_view_create()))
+    if (!(object = vkd3d_view_create(device, VKD3D_VIEW_TYPE_IMAGE)))
     {
         VK_CALL(vkDestroyImageView(device->vk_device, vk_view, NULL));
-        return false;
+        goto fail;
     }
 
     object->u.vk_image_view = vk_view;
+    object->info.texture.vk_aspect_mask = format->vk_aspect_mask;
+    object->info.texture.miplevel_idx = desc->miplevel_idx;
+    object->info.texture.layer_idx = desc->layer_idx;
+    object->info.texture.layer_count = desc->layer_count;
+
+    if (cache)
+    {
+        vkd3d_view_cache_add_locked(cache, device, &key, object);
+        pthread_mutex_unlock(&cache->mutex);
+    }
+
     *view = object;
     return true;
+
+fail:
+    if (cache)
+        pthread_mutex_unlock(&cache->mutex);
+    return false;
 }
 
 void d3d12_desc_create_cbv(struct d3d12_desc *descriptor,
@@ -2570,7 +4704,7 @@ void d3d12_desc_create_cbv(struct d3d12_desc *descriptor,
         return;
     }
 
-    buffer_info = &descriptor->u.vk_cbv_info;
+    buffer_info = &descriptor->vk_cbv_info;
     if (desc->BufferLocation)
     {
         resource = vkd3d_gpu_va_allocator_dereference(&device->gpu_va_allocator, desc->BufferLocation);
@@ -2586,8 +4720,7 @@ void d3d12_desc_create_cbv(struct d3d12_desc *descriptor,
         buffer_info->range = VKD3D_NULL_BUFFER_SIZE;
     }
 
-    descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_CBV;
-    descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptor->tagged_view = VKD3D_DESCRIPTOR_INLINE_CBV;
 }
 
 static unsigned int vkd3d_view_flags_from_d3d12_buffer_srv_flags(D3D12_BUFFER_SRV_FLAGS flags)
@@ -2618,14 +4751,9 @@ static void vkd3d_create_null_srv(struct d3d12_desc *descriptor,
         case D3D12_SRV_DIMENSION_BUFFER:
             WARN("Creating NULL buffer SRV %#x.\n", desc->Format);
 
-            if (vkd3d_create_buffer_view(device, null_resources->vk_buffer,
-                    vkd3d_get_format(device, DXGI_FORMAT_R32_UINT, false),
-                    0, VKD3D_NULL_BUFFER_SIZE, &view))
-            {
-                descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_SRV;
-                descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
-                descriptor->u.view = view;
-            }
+            if (vkd3d_create_buffer_view(device, NULL, VKD3D_DESCRIPTOR_MAGIC_SRV, null_resources->vk_buffer,
+                    vkd3d_get_format(device, DXGI_FORMAT_R32_UINT, false), 0, VKD3D_NULL_BUFFER_SIZE, &view))
+                d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_SRV);
             return;
 
         case D3D12_SRV_DIMENSION_TEXTURE2D:
@@ -2655,12 +4783,10 @@ static void vkd3d_create_null_srv(struct d3d12_desc *descriptor,
     vkd3d_desc.components.a = VK_COMPONENT_SWIZZLE_ZERO;
     vkd3d_desc.allowed_swizzle = true;
 
-    if (!vkd3d_create_texture_view(device, vk_image, &vkd3d_desc, &view))
+    if (!vkd3d_create_texture_view(device, NULL, VKD3D_DESCRIPTOR_MAGIC_SRV, vk_image, &vkd3d_desc, &view))
         return;
 
-    descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_SRV;
-    descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    descriptor->u.view = view;
+    d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_SRV);
 }
 
 static void vkd3d_create_buffer_srv(struct d3d12_desc *descriptor,
@@ -2685,12 +4811,10 @@ static void vkd3d_create_buffer_srv(struct d3d12_desc *descriptor,
     flags = vkd3d_view_flags_from_d3d12_buffer_srv_flags(desc->u.Buffer.Flags);
     if (!vkd3d_create_buffer_view_for_resource(device, resource, desc->Format,
             desc->u.Buffer.FirstElement, desc->u.Buffer.NumElements,
-            desc->u.Buffer.StructureByteStride, flags, &view))
+            desc->u.Buffer.StructureByteStride, flags, VKD3D_DESCRIPTOR_MAGIC_SRV, true, &view))
         return;
 
-    descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_SRV;
-    descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
-    descriptor->u.view = view;
+    d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_SRV);
 }
 
 void d3d12_desc_create_srv(struct d3d12_desc *descriptor,
@@ -2789,12 +4913,11 @@ void d3d12_desc_create_srv(struct d3d12_desc *descriptor,
         }
     }
 
-    if (!vkd3d_create_texture_view(device, resource->u.vk_image, &vkd3d_desc, &view))
+    if (!vkd3d_create_texture_view(device, &resource->view_cache, VKD3D_DESCRIPTOR_MAGIC_SRV,
+            resource->u.vk_image, &vkd3d_desc, &view))
         return;
 
-    descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_SRV;
-    descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-    descriptor->u.view = view;
+    d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_SRV);
 }
 
 static unsigned int vkd3d_view_flags_from_d3d12_buffer_uav_flags(D3D12_BUFFER_UAV_FLAGS flags)
@@ -2825,14 +4948,9 @@ static void vkd3d_create_null_uav(struct d3d12_desc *descriptor,
         case D3D12_UAV_DIMENSION_BUFFER:
             WARN("Creating NULL buffer UAV %#x.\n", desc->Format);
 
-            if (vkd3d_create_buffer_view(device, null_resources->vk_storage_buffer,
-                    vkd3d_get_format(device, DXGI_FORMAT_R32_UINT, false),
-                    0, VKD3D_NULL_BUFFER_SIZE, &view))
-            {
-                descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_UAV;
-                descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
-                descriptor->u.view = view;
-            }
+            if (vkd3d_create_buffer_view(device, NULL, VKD3D_DESCRIPTOR_MAGIC_UAV, null_resources->vk_storage_buffer,
+                    vkd3d_get_format(device, DXGI_FORMAT_R32_UINT, false), 0, VKD3D_NULL_BUFFER_SIZE, &view))
+                d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_UAV);
             return;
 
         case D3D12_UAV_DIMENSION_TEXTURE2D:
@@ -2862,12 +4980,10 @@ static void vkd3d_create_null_uav(struct d3d12_desc *descriptor,
     vkd3d_desc.components.a = VK_COMPONENT_SWIZZLE_A;
     vkd3d_desc.allowed_swizzle = false;
 
-    if (!vkd3d_create_texture_view(device, vk_image, &vkd3d_desc, &view))
+    if (!vkd3d_create_texture_view(device, NULL, VKD3D_DESCRIPTOR_MAGIC_UAV, vk_image, &vkd3d_desc, &view))
         return;
 
-    descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_UAV;
-    descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    descriptor->u.view = view;
+    d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_UAV);
 }
 
 static void vkd3d_create_buffer_uav(struct d3d12_desc *descriptor, struct d3d12_device *device,
@@ -2892,15 +5008,14 @@ static void vkd3d_create_buffer_uav(struct d3d12_desc *descriptor, struct d3d12_
     if (desc->u.Buffer.CounterOffsetInBytes)
         FIXME("Ignoring counter offset %"PRIu64".\n", desc->u.Buffer.CounterOffsetInBytes);
 
+    /* The counter view is stored in the view, which therefore can't be shared. */
     flags = vkd3d_view_flags_from_d3d12_buffer_uav_flags(desc->u.Buffer.Flags);
     if (!vkd3d_create_buffer_view_for_resource(device, resource, desc->Format,
             desc->u.Buffer.FirstElement, desc->u.Buffer.NumElements,
-            desc->u.Buffer.StructureByteStride, flags, &view))
+            desc->u.Buffer.StructureByteStride, flags, VKD3D_DESCRIPTOR_MAGIC_UAV, !counter_resource, &view))
         return;
 
-    descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_UAV;
-    descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
-    descriptor->u.view = view;
+    d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_UAV);
 
     if (counter_resource)
     {
@@ -2918,16 +5033,6 @@ static void vkd3d_create_buffer_uav(struct d3d12_desc *descriptor, struct d3d12_
             d3d12_desc_destroy(descriptor, device);
         }
     }
-
-    /* FIXME: Clears are implemented only for R32_UINT buffer UAVs. */
-    if ((desc->Format == DXGI_FORMAT_R32_TYPELESS && (desc->u.Buffer.Flags & VKD3D_VIEW_RAW_BUFFER))
-            || desc->Format == DXGI_FORMAT_R32_UINT)
-    {
-        const struct vkd3d_format *format = vkd3d_get_format(device, DXGI_FORMAT_R32_UINT, false);
-
-        descriptor->uav.buffer.offset = desc->u.Buffer.FirstElement * format->byte_count + resource->heap_offset;
-        descriptor->uav.buffer.size = desc->u.Buffer.NumElements * format->byte_count;
-    }
 }
 
 static void vkd3d_create_texture_uav(struct d3d12_desc *descriptor,
@@ -2975,17 +5080,11 @@ static void vkd3d_create_texture_uav(struct d3d12_desc *descriptor,
         }
     }
 
-    if (!vkd3d_create_texture_view(device, resource->u.vk_image, &vkd3d_desc, &view))
+    if (!vkd3d_create_texture_view(device, &resource->view_cache, VKD3D_DESCRIPTOR_MAGIC_UAV,
+            resource->u.vk_image, &vkd3d_desc, &view))
         return;
 
-    descriptor->magic = VKD3D_DESCRIPTOR_MAGIC_UAV;
-    descriptor->vk_descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    descriptor->u.view = view;
-
-    descriptor->uav.texture.vk_aspect_mask = vkd3d_desc.format->vk_aspect_mask;
-    descriptor->uav.texture.miplevel_idx = vkd3d_desc.miplevel_idx;
-    descriptor->uav.texture.layer_idx = vkd3d_desc.layer_idx;
-    descriptor->uav.texture.layer_count = vkd3d_desc.layer_count;
+    d3d12_desc_set_view(descriptor, view, VKD3D_DESCRIPTOR_TAG_UAV);
 }
 
 void d3d12_desc_create_uav(struct d3d12_desc *descriptor, struct d3d12_device *device,
@@ -3031,6 +5130,14 @@ bool vkd3d_create_raw_buffer_view(struct d3d12_device *device,
             offset, range, vk_buffer_view);
 }
 
+bool vkd3d_create_raw_vk_buffer_view(struct d3d12_device *device, VkBuffer vk_buffer,
+        VkDeviceSize offset, VkDeviceSize range, VkBufferView *vk_buffer_view)
+{
+    const struct vkd3d_format *format = vkd3d_get_format(device, DXGI_FORMAT_R32_UINT, false);
+
+    return vkd3d_create_vk_buffer_view(device, vk_buffer, format, offset, range, vk_buffer_view);
+}
+
 /* samplers */
 static VkFilter vk_filter_from_d3d12(D3D12_FILTER_TYPE type)
 {
@@ -3079,22 +5186,195 @@ static VkSamplerAddressMode vk_address_mode_from_d3d12(D3D12_TEXTURE_ADDRESS_MOD
     }
 }
 
+struct vkd3d_sampler_entry
+{
+    struct rb_entry entry;
+    struct rb_entry handle_entry;
+
+    VkSamplerCreateInfo key;
+    VkSampler vk_sampler;
+    unsigned int refcount;
+};
+
+static int vkd3d_sampler_entry_compare(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_sampler_entry *sampler = RB_ENTRY_VALUE(entry, const struct vkd3d_sampler_entry, entry);
+
+    return memcmp(key, &sampler->key, sizeof(sampler->key));
+}
+
+static int vkd3d_sampler_handle_compare(const void *key, const struct rb_entry *entry)
+{
+    const struct vkd3d_sampler_entry *sampler = RB_ENTRY_VALUE(entry, const struct vkd3d_sampler_entry, handle_entry);
+
+    return memcmp(key, &sampler->vk_sampler, sizeof(sampler->vk_sampler));
+}
+
+HRESULT vkd3d_sampler_cache_init(struct vkd3d_sampler_cache *cache)
+{
+    int rc;
+
+    memset(cache, 0, sizeof(*cache));
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    rb_init(&cache->samplers, vkd3d_sampler_entry_compare);
+    rb_init(&cache->handles, vkd3d_sampler_handle_compare);
+
+    return S_OK;
+}
+
+static void vkd3d_sampler_entry_destroy(struct rb_entry *entry, void *context)
+{
+    struct vkd3d_sampler_entry *sampler = RB_ENTRY_VALUE(entry, struct vkd3d_sampler_entry, entry);
+    struct d3d12_device *device = context;
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    WARN("Destroying sampler entry %p with refcount %u.\n", sampler, sampler->refcount);
+
+    VK_CALL(vkDestroySampler(device->vk_device, sampler->vk_sampler, NULL));
+    vkd3d_free(sampler);
+}
+
+void vkd3d_sampler_cache_cleanup(struct vkd3d_sampler_cache *cache,
+        struct d3d12_device *device)
+{
+    TRACE("Sampler cache hits %"PRIu64", misses %"PRIu64".\n", cache->hit_count, cache->miss_count);
+
+    rb_destroy(&cache->samplers, vkd3d_sampler_entry_destroy, device);
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+/* "key" must be fully initialised, including padding, since entries are
+ * compared bytewise. */
+static VkResult vkd3d_sampler_cache_get(struct vkd3d_sampler_cache *cache,
+        struct d3d12_device *device, const VkSamplerCreateInfo *key, VkSampler *vk_sampler)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_sampler_entry *sampler;
+    struct rb_entry *entry;
+    VkResult vr;
+    int rc;
+
+    assert(!key->pNext);
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return VK_ERROR_INITIALIZATION_FAILED;
+    }
+
+    if ((entry = rb_get(&cache->samplers, key)))
+    {
+        sampler = RB_ENTRY_VALUE(entry, struct vkd3d_sampler_entry, entry);
+        ++sampler->refcount;
+        ++cache->hit_count;
+        *vk_sampler = sampler->vk_sampler;
+        pthread_mutex_unlock(&cache->mutex);
+        return VK_SUCCESS;
+    }
+
+    ++cache->miss_count;
+
+    if (!(sampler = vkd3d_malloc(sizeof(*sampler))))
+    {
+        pthread_mutex_unlock(&cache->mutex);
+        return VK_ERROR_OUT_OF_HOST_MEMORY;
+    }
+
+    if ((vr = VK_CALL(vkCreateSampler(device->vk_device, key, NULL, &sampler->vk_sampler))) < 0)
+    {
+        WARN("Failed to create Vulkan sampler, vr %d.\n", vr);
+        pthread_mutex_unlock(&cache->mutex);
+        vkd3d_free(sampler);
+        return vr;
+    }
+
+    sampler->key = *key;
+    sampler->refcount = 1;
+    rb_put(&cache->samplers, &sampler->key, &sampler->entry);
+    rb_put(&cache->handles, &sampler->vk_sampler, &sampler->handle_entry);
+    ++cache->sampler_count;
+
+    *vk_sampler = sampler->vk_sampler;
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return VK_SUCCESS;
+}
+
+void vkd3d_sampler_cache_release(struct vkd3d_sampler_cache *cache,
+        struct d3d12_device *device, VkSampler vk_sampler)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    struct vkd3d_sampler_entry *sampler;
+    struct rb_entry *entry;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    if (!(entry = rb_get(&cache->handles, &vk_sampler)))
+    {
+        ERR("Sampler not found in cache.\n");
+        pthread_mutex_unlock(&cache->mutex);
+        return;
+    }
+
+    sampler = RB_ENTRY_VALUE(entry, struct vkd3d_sampler_entry, handle_entry);
+    if (!--sampler->refcount)
+    {
+        rb_remove(&cache->samplers, &sampler->entry);
+        rb_remove(&cache->handles, &sampler->handle_entry);
+        --cache->sampler_count;
+
+        VK_CALL(vkDestroySampler(device->vk_device, sampler->vk_sampler, NULL));
+        vkd3d_free(sampler);
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+void vkd3d_sampler_cache_get_statistics(struct vkd3d_sampler_cache *cache,
+        struct vkd3d_sampler_cache_statistics *statistics)
+{
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        memset(statistics, 0, sizeof(*statistics));
+        return;
+    }
+
+    statistics->sampler_count = cache->sampler_count;
+    statistics->hit_count = cache->hit_count;
+    statistics->miss_count = cache->miss_count;
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
 static VkResult d3d12_create_sampler(struct d3d12_device *device, D3D12_FILTER filter,
         D3D12_TEXTURE_ADDRESS_MODE address_u, D3D12_TEXTURE_ADDRESS_MODE address_v,
         D3D12_TEXTURE_ADDRESS_MODE address_w, float mip_lod_bias, unsigned int max_anisotropy,
         D3D12_COMPARISON_FUNC comparison_func, float min_lod, float max_lod,
         VkSampler *vk_sampler)
 {
-    const struct vkd3d_vk_device_procs *vk_procs;
     struct VkSamplerCreateInfo sampler_desc;
-    VkResult vr;
-
-    vk_procs = &device->vk_procs;
 
     if (D3D12_DECODE_FILTER_REDUCTION(filter) == D3D12_FILTER_REDUCTION_TYPE_MINIMUM
             || D3D12_DECODE_FILTER_REDUCTION(filter) == D3D12_FILTER_REDUCTION_TYPE_MAXIMUM)
         FIXME("Min/max reduction mode not supported.\n");
 
+    /* The create info is the sampler cache key. */
+    memset(&sampler_desc, 0, sizeof(sampler_desc));
     sampler_desc.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
     sampler_desc.pNext = NULL;
     sampler_desc.flags = 0;
@@ -3106,17 +5386,16 @@ static VkResult d3d12_create_sampler(struct d3d12_device *device, D3D12_FILTER f
     sampler_desc.addressModeW = vk_address_mode_from_d3d12(address_w);
     sampler_desc.mipLodBias = mip_lod_bias;
     sampler_desc.anisotropyEnable = D3D12_DECODE_IS_ANISOTROPIC_FILTER(filter);
-    sampler_desc.maxAnisotropy = max_anisotropy;
+    /* maxAnisotropy is ignored unless anisotropy is enabled. */
+    sampler_desc.maxAnisotropy = sampler_desc.anisotropyEnable ? max_anisotropy : 0.0f;
     sampler_desc.compareEnable = D3D12_DECODE_IS_COMPARISON_FILTER(filter);
     sampler_desc.compareOp = sampler_desc.compareEnable ? vk_compare_op_from_d3d12(comparison_func) : 0;
     sampler_desc.minLod = min_lod;
     sampler_desc.maxLod = max_lod;
     sampler_desc.borderColor = VK_BORDER_COLOR_FLOAT_TRANSPARENT_BLACK;
     sampler_desc.unnormalizedCoordinates = VK_FALSE;
-    if ((vr = VK_CALL(vkCreateSampler(device->vk_device, &sampler_desc, NULL, vk_sampler))) < 0)
-        WARN("Failed to create Vulkan sampler, vr %d.\n", vr);
 
-    return vr;
+    return vkd3d_sampler_cache_get(&device->sampler_cache, device, &sampler_desc, vk_sampler);
 }
 
 void d3d12_desc_create_sampler(struct d3d12_desc *sampler,
@@ -3136,20 +5415,18 @@ void d3d12_desc_create_sampler(struct d3d12_desc *sampler,
         FIXME("Ignoring border color {%.8e, %.8e, %.8e, %.8e}.\n",
                 desc->BorderColor[0], desc->BorderColor[1], desc->BorderColor[2], desc->BorderColor[3]);
 
-    if (!(view = vkd3d_view_create()))
+    if (!(view = vkd3d_view_create(device, VKD3D_VIEW_TYPE_SAMPLER)))
         return;
 
     if (d3d12_create_sampler(device, desc->Filter, desc->AddressU,
             desc->AddressV, desc->AddressW, desc->MipLODBias, desc->MaxAnisotropy,
             desc->ComparisonFunc, desc->MinLOD, desc->MaxLOD, &view->u.vk_sampler) < 0)
     {
-        vkd3d_free(view);
+        vkd3d_object_pool_free(&device->view_pool, view);
         return;
     }
 
-    sampler->magic = VKD3D_DESCRIPTOR_MAGIC_SAMPLER;
-    sampler->vk_descriptor_type = VK_DESCRIPTOR_TYPE_SAMPLER;
-    sampler->u.view = view;
+    d3d12_desc_set_view(sampler, view, VKD3D_DESCRIPTOR_TAG_SAMPLER);
 }
 
 HRESULT vkd3d_create_static_sampler(struct d3d12_device *device,
@@ -3245,7 +5522,8 @@ void d3d12_rtv_desc_create_rtv(struct d3d12_rtv_desc *rtv_desc, struct d3d12_dev
 
     assert(d3d12_resource_is_texture(resource));
 
-    if (!vkd3d_create_texture_view(device, resource->u.vk_image, &vkd3d_desc, &view))
+    if (!vkd3d_create_texture_view(device, &resource->view_cache, VKD3D_DESCRIPTOR_MAGIC_RTV,
+            resource->u.vk_image, &vkd3d_desc, &view))
         return;
 
     rtv_desc->magic = VKD3D_DESCRIPTOR_MAGIC_RTV;
@@ -3328,7 +5606,8 @@ void d3d12_dsv_desc_create_dsv(struct d3d12_dsv_desc *dsv_desc, struct d3d12_dev
 
     assert(d3d12_resource_is_texture(resource));
 
-    if (!vkd3d_create_texture_view(device, resource->u.vk_image, &vkd3d_desc, &view))
+    if (!vkd3d_create_texture_view(device, &resource->view_cache, VKD3D_DESCRIPTOR_MAGIC_DSV,
+            resource->u.vk_image, &vkd3d_desc, &view))
         return;
 
     dsv_desc->magic = VKD3D_DESCRIPTOR_MAGIC_DSV;
@@ -3379,6 +5658,77 @@ static ULONG STDMETHODCALLTYPE d3d12_descriptor_heap_AddRef(ID3D12DescriptorHeap
     return refcount;
 }
 
+static void d3d12_descriptor_heap_release_views(struct d3d12_descriptor_heap *heap,
+        unsigned int start, unsigned int end)
+{
+    const struct d3d12_desc *descriptors = (const struct d3d12_desc *)heap->descriptors;
+    struct vkd3d_view *view;
+    unsigned int i;
+
+    for (i = start; i < end; ++i)
+    {
+        if ((view = d3d12_desc_get_view(&descriptors[i])))
+            vkd3d_view_decref(view, heap->device);
+    }
+}
+
+static void d3d12_descriptor_heap_release_used_pages(struct d3d12_descriptor_heap *heap)
+{
+    const unsigned int page_descriptor_count = (1u << VKD3D_DESCRIPTOR_HEAP_PAGE_SHIFT) / sizeof(struct d3d12_desc);
+    unsigned int page, page_count;
+
+    page_count = (heap->desc.NumDescriptors + page_descriptor_count - 1) / page_descriptor_count;
+    for (page = 0; page < page_count; ++page)
+    {
+        if (heap->used_pages[page / 32] & (1u << (page % 32)))
+            d3d12_descriptor_heap_release_views(heap, page * page_descriptor_count,
+                    min((page + 1) * page_descriptor_count, heap->desc.NumDescriptors));
+    }
+}
+
+static void *vkd3d_map_descriptor_memory(size_t size)
+{
+    BYTE *ptr, *aligned_ptr;
+#ifdef _WIN32
+    unsigned int i;
+
+    /* Another thread may take the address range between the two calls. */
+    for (i = 0; i < 4; ++i)
+    {
+        if (!(ptr = VirtualAlloc(NULL, size + VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE, MEM_RESERVE, PAGE_NOACCESS)))
+            return NULL;
+        VirtualFree(ptr, 0, MEM_RELEASE);
+
+        aligned_ptr = (BYTE *)align((uintptr_t)ptr, VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE);
+        if ((ptr = VirtualAlloc(aligned_ptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE)))
+            return ptr;
+    }
+
+    return NULL;
+#else
+    if ((ptr = mmap(NULL, size + VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)) == MAP_FAILED)
+        return NULL;
+
+    aligned_ptr = (BYTE *)align((uintptr_t)ptr, VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE);
+    if (aligned_ptr != ptr)
+        munmap(ptr, aligned_ptr - ptr);
+    if (aligned_ptr != ptr + VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE)
+        munmap(aligned_ptr + size, ptr + VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE - aligned_ptr);
+
+    return aligned_ptr;
+#endif
+}
+
+static void vkd3d_unmap_descriptor_memory(void *ptr, size_t size)
+{
+#ifdef _WIN32
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+    munmap(ptr, size);
+#endif
+}
+
 static ULONG STDMETHODCALLTYPE d3d12_descriptor_heap_Release(ID3D12DescriptorHeap *iface)
 {
     struct d3d12_descriptor_heap *heap = impl_from_ID3D12DescriptorHeap(iface);
@@ -3397,15 +5747,11 @@ static ULONG STDMETHODCALLTYPE d3d12_descriptor_heap_Release(ID3D12DescriptorHea
         {
             case D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV:
             case D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER:
-            {
-                struct d3d12_desc *descriptors = (struct d3d12_desc *)heap->descriptors;
-
-                for (i = 0; i < heap->desc.NumDescriptors; ++i)
-                {
-                    d3d12_desc_destroy(&descriptors[i], device);
-                }
+                if (heap->used_pages)
+                    d3d12_descriptor_heap_release_used_pages(heap);
+                else
+                    d3d12_descriptor_heap_release_views(heap, 0, heap->desc.NumDescriptors);
                 break;
-            }
 
             case D3D12_DESCRIPTOR_HEAP_TYPE_RTV:
             {
@@ -3433,6 +5779,7 @@ static ULONG STDMETHODCALLTYPE d3d12_descriptor_heap_Release(ID3D12DescriptorHea
                 break;
         }
 
+        d3d12_descriptor_heap_free_descriptors(heap);
         vkd3d_free(heap);
 
         d3d12_device_release(device);
@@ -3543,8 +5890,52 @@ static const struct ID3D12DescriptorHeapVtbl d3d12_descriptor_heap_vtbl =
     d3d12_descriptor_heap_GetGPUDescriptorHandleForHeapStart,
 };
 
+/* Pages of mapped heaps are only committed when they are first written.
+ * Small heaps are allocated from the C heap. */
+static HRESULT d3d12_descriptor_heap_allocate_descriptors(struct d3d12_descriptor_heap *heap, size_t size)
+{
+    struct d3d12_device *device = heap->device;
+
+    if (heap->desc.Type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV && size >= VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE)
+    {
+        heap->mapping_size = align(size, VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE);
+
+        if ((heap->descriptors = vkd3d_map_descriptor_memory(heap->mapping_size)))
+        {
+            if ((heap->used_pages = vkd3d_calloc(heap->mapping_size >> (VKD3D_DESCRIPTOR_HEAP_PAGE_SHIFT + 5),
+                    sizeof(*heap->used_pages)))
+                    && vkd3d_descriptor_heap_map_insert(&device->descriptor_heap_map, heap))
+                return S_OK;
+
+            WARN("Failed to track descriptor heap pages.\n");
+            vkd3d_free(heap->used_pages);
+            heap->used_pages = NULL;
+            vkd3d_unmap_descriptor_memory(heap->descriptors, heap->mapping_size);
+        }
+        heap->mapping_size = 0;
+    }
+
+    if (!(heap->descriptors = vkd3d_calloc(1, size)))
+        return E_OUTOFMEMORY;
+
+    return S_OK;
+}
+
+static void d3d12_descriptor_heap_free_descriptors(struct d3d12_descriptor_heap *heap)
+{
+    if (heap->used_pages)
+    {
+        vkd3d_descriptor_heap_map_remove(&heap->device->descriptor_heap_map, heap);
+        vkd3d_free(heap->used_pages);
+        vkd3d_unmap_descriptor_memory(heap->descriptors, heap->mapping_size);
+        return;
+    }
+
+    vkd3d_free(heap->descriptors);
+}
+
 static HRESULT d3d12_descriptor_heap_init(struct d3d12_descriptor_heap *descriptor_heap,
-        struct d3d12_device *device, const D3D12_DESCRIPTOR_HEAP_DESC *desc)
+        struct d3d12_device *device, const D3D12_DESCRIPTOR_HEAP_DESC *desc, size_t descriptor_size)
 {
     HRESULT hr;
 
@@ -3552,11 +5943,19 @@ static HRESULT d3d12_descriptor_heap_init(struct d3d12_descriptor_heap *descript
     descriptor_heap->refcount = 1;
 
     descriptor_heap->desc = *desc;
+    descriptor_heap->device = device;
+
+    if (FAILED(hr = d3d12_descriptor_heap_allocate_descriptors(descriptor_heap,
+            descriptor_size * desc->NumDescriptors)))
+        return hr;
 
     if (FAILED(hr = vkd3d_private_store_init(&descriptor_heap->private_store)))
+    {
+        d3d12_descriptor_heap_free_descriptors(descriptor_heap);
         return hr;
+    }
 
-    d3d12_device_add_ref(descriptor_heap->device = device);
+    d3d12_device_add_ref(device);
 
     return S_OK;
 }
@@ -3581,25 +5980,22 @@ HRESULT d3d12_descriptor_heap_create(struct d3d12_device *device,
         return E_INVALIDARG;
     }
 
-    max_descriptor_count = (~(size_t)0 - sizeof(*object)) / descriptor_size;
+    max_descriptor_count = (~(size_t)0 - VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE) / descriptor_size;
     if (desc->NumDescriptors > max_descriptor_count)
     {
         WARN("Invalid descriptor count %u (max %zu).\n", desc->NumDescriptors, max_descriptor_count);
         return E_OUTOFMEMORY;
     }
 
-    if (!(object = vkd3d_malloc(offsetof(struct d3d12_descriptor_heap,
-            descriptors[descriptor_size * desc->NumDescriptors]))))
+    if (!(object = vkd3d_calloc(1, sizeof(*object))))
         return E_OUTOFMEMORY;
 
-    if (FAILED(hr = d3d12_descriptor_heap_init(object, device, desc)))
+    if (FAILED(hr = d3d12_descriptor_heap_init(object, device, desc, descriptor_size)))
     {
         vkd3d_free(object);
         return hr;
     }
 
-    memset(object->descriptors, 0, descriptor_size * desc->NumDescriptors);
-
     TRACE("Created descriptor heap %p.\n", object);
 
     *descriptor_heap = object;
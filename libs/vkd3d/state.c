@@ -70,14 +70,9 @@ static void d3d12_root_signature_cleanup(struct d3d12_root_signature *root_signa
         VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, root_signature->vk_push_set_layout, NULL));
 
     if (root_signature->parameters)
-    {
-        for (i = 0; i < root_signature->parameter_count; ++i)
-        {
-            if (root_signature->parameters[i].parameter_type == D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
-                vkd3d_free(root_signature->parameters[i].u.descriptor_table.ranges);
-        }
         vkd3d_free(root_signature->parameters);
-    }
+    if (root_signature->binding_ops)
+        vkd3d_free(root_signature->binding_ops);
 
     if (root_signature->descriptor_mapping)
         vkd3d_free(root_signature->descriptor_mapping);
@@ -87,12 +82,17 @@ static void d3d12_root_signature_cleanup(struct d3d12_root_signature *root_signa
     for (i = 0; i < root_signature->static_sampler_count; ++i)
     {
         if (root_signature->static_samplers[i])
-            VK_CALL(vkDestroySampler(device->vk_device, root_signature->static_samplers[i], NULL));
+            vkd3d_sampler_cache_release(&device->sampler_cache, device, root_signature->static_samplers[i]);
     }
     if (root_signature->static_samplers)
         vkd3d_free(root_signature->static_samplers);
+
+    vkd3d_free(root_signature->bytecode);
 }
 
+static void vkd3d_root_signature_cache_remove(struct vkd3d_root_signature_cache *cache,
+        struct d3d12_root_signature *root_signature);
+
 static ULONG STDMETHODCALLTYPE d3d12_root_signature_Release(ID3D12RootSignature *iface)
 {
     struct d3d12_root_signature *root_signature = impl_from_ID3D12RootSignature(iface);
@@ -103,6 +103,7 @@ static ULONG STDMETHODCALLTYPE d3d12_root_signature_Release(ID3D12RootSignature
     if (!refcount)
     {
         struct d3d12_device *device = root_signature->device;
+        vkd3d_root_signature_cache_remove(&device->root_signature_cache, root_signature);
         vkd3d_private_store_destroy(&root_signature->private_store);
         d3d12_root_signature_cleanup(root_signature, device);
         vkd3d_free(root_signature);
@@ -300,7 +301,7 @@ static enum vkd3d_shader_descriptor_type vkd3d_descriptor_type_from_d3d12_root_p
 }
 
 static bool vk_binding_from_d3d12_descriptor_range(struct VkDescriptorSetLayoutBinding *binding_desc,
-        const D3D12_DESCRIPTOR_RANGE *descriptor_range, D3D12_SHADER_VISIBILITY shader_visibility,
+        const D3D12_DESCRIPTOR_RANGE1 *descriptor_range, D3D12_SHADER_VISIBILITY shader_visibility,
         bool is_buffer, uint32_t vk_binding)
 {
     binding_desc->binding = vk_binding;
@@ -330,6 +331,7 @@ struct d3d12_root_signature_info
     size_t sampler_count;
 
     size_t descriptor_count;
+    size_t descriptor_range_count;
 
     size_t root_constant_count;
     size_t root_descriptor_count;
@@ -338,7 +340,7 @@ struct d3d12_root_signature_info
 };
 
 static HRESULT d3d12_root_signature_info_count_descriptors(struct d3d12_root_signature_info *info,
-        const D3D12_DESCRIPTOR_RANGE *range)
+        const D3D12_DESCRIPTOR_RANGE1 *range)
 {
     if (range->NumDescriptors == 0xffffffff)
     {
@@ -371,7 +373,7 @@ static HRESULT d3d12_root_signature_info_count_descriptors(struct d3d12_root_sig
 }
 
 static HRESULT d3d12_root_signature_info_from_desc(struct d3d12_root_signature_info *info,
-        const D3D12_ROOT_SIGNATURE_DESC *desc)
+        const D3D12_ROOT_SIGNATURE_DESC1 *desc)
 {
     unsigned int i, j;
     HRESULT hr;
@@ -380,7 +382,7 @@ static HRESULT d3d12_root_signature_info_from_desc(struct d3d12_root_signature_i
 
     for (i = 0; i < desc->NumParameters; ++i)
     {
-        const D3D12_ROOT_PARAMETER *p = &desc->pParameters[i];
+        const D3D12_ROOT_PARAMETER1 *p = &desc->pParameters[i];
 
         switch (p->ParameterType)
         {
@@ -389,6 +391,7 @@ static HRESULT d3d12_root_signature_info_from_desc(struct d3d12_root_signature_i
                     if (FAILED(hr = d3d12_root_signature_info_count_descriptors(info,
                             &p->u.DescriptorTable.pDescriptorRanges[j])))
                         return hr;
+                info->descriptor_range_count += p->u.DescriptorTable.NumDescriptorRanges;
                 ++info->cost;
                 break;
 
@@ -429,7 +432,7 @@ static HRESULT d3d12_root_signature_info_from_desc(struct d3d12_root_signature_i
 }
 
 static HRESULT d3d12_root_signature_init_push_constants(struct d3d12_root_signature *root_signature,
-        const D3D12_ROOT_SIGNATURE_DESC *desc, const struct d3d12_root_signature_info *info,
+        const D3D12_ROOT_SIGNATURE_DESC1 *desc, const struct d3d12_root_signature_info *info,
         struct VkPushConstantRange push_constants[D3D12_SHADER_VISIBILITY_PIXEL + 1],
         uint32_t *push_constant_range_count)
 {
@@ -441,7 +444,7 @@ static HRESULT d3d12_root_signature_init_push_constants(struct d3d12_root_signat
     memset(push_constants_offset, 0, sizeof(push_constants_offset));
     for (i = 0; i < desc->NumParameters; ++i)
     {
-        const D3D12_ROOT_PARAMETER *p = &desc->pParameters[i];
+        const D3D12_ROOT_PARAMETER1 *p = &desc->pParameters[i];
         if (p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
             continue;
 
@@ -488,7 +491,7 @@ static HRESULT d3d12_root_signature_init_push_constants(struct d3d12_root_signat
     for (i = 0, j = 0; i < desc->NumParameters; ++i)
     {
         struct d3d12_root_constant *root_constant = &root_signature->parameters[i].u.constant;
-        const D3D12_ROOT_PARAMETER *p = &desc->pParameters[i];
+        const D3D12_ROOT_PARAMETER1 *p = &desc->pParameters[i];
         unsigned int idx;
 
         if (p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS)
@@ -592,36 +595,41 @@ static uint32_t vkd3d_descriptor_magic_from_d3d12(D3D12_DESCRIPTOR_RANGE_TYPE ty
 }
 
 static HRESULT d3d12_root_signature_init_root_descriptor_tables(struct d3d12_root_signature *root_signature,
-        const D3D12_ROOT_SIGNATURE_DESC *desc, struct vkd3d_descriptor_set_context *context)
+        const D3D12_ROOT_SIGNATURE_DESC1 *desc, struct vkd3d_descriptor_set_context *context)
 {
     VkDescriptorSetLayoutBinding *cur_binding = context->current_binding;
+    struct vkd3d_descriptor_binding_op *op;
     struct d3d12_root_descriptor_table *table;
-    const D3D12_DESCRIPTOR_RANGE *range;
-    unsigned int i, j, k, range_count;
+    unsigned int i, j, k, heap_offset;
+    const D3D12_DESCRIPTOR_RANGE1 *range;
     uint32_t vk_binding;
 
     root_signature->descriptor_table_mask = 0;
+    root_signature->static_descriptor_table_mask = 0;
+    root_signature->binding_op_count = 0;
 
     for (i = 0; i < desc->NumParameters; ++i)
     {
-        const D3D12_ROOT_PARAMETER *p = &desc->pParameters[i];
+        const D3D12_ROOT_PARAMETER1 *p = &desc->pParameters[i];
         if (p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE)
             continue;
 
         root_signature->descriptor_table_mask |= 1ull << i;
+        root_signature->static_descriptor_table_mask |= 1ull << i;
 
         table = &root_signature->parameters[i].u.descriptor_table;
-        range_count = p->u.DescriptorTable.NumDescriptorRanges;
 
         root_signature->parameters[i].parameter_type = p->ParameterType;
-        table->range_count = range_count;
-        if (!(table->ranges = vkd3d_calloc(table->range_count, sizeof(*table->ranges))))
-            return E_OUTOFMEMORY;
+        table->first_op = root_signature->binding_op_count;
+        table->op_count = p->u.DescriptorTable.NumDescriptorRanges;
 
-        for (j = 0; j < range_count; ++j)
+        for (j = 0, heap_offset = 0; j < table->op_count; ++j)
         {
             range = &p->u.DescriptorTable.pDescriptorRanges[j];
 
+            if (range->Flags & D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE)
+                root_signature->static_descriptor_table_mask &= ~(1ull << i);
+
             vk_binding = d3d12_root_signature_assign_vk_bindings(root_signature,
                     vkd3d_descriptor_type_from_d3d12_range_type(range->RangeType),
                     range->BaseShaderRegister, range->NumDescriptors, false, true,
@@ -652,11 +660,22 @@ static HRESULT d3d12_root_signature_init_root_descriptor_tables(struct d3d12_roo
                 ++cur_binding;
             }
 
-            table->ranges[j].offset = range->OffsetInDescriptorsFromTableStart;
-            table->ranges[j].descriptor_count = range->NumDescriptors;
-            table->ranges[j].binding = vk_binding;
-            table->ranges[j].descriptor_magic = vkd3d_descriptor_magic_from_d3d12(range->RangeType);
-            table->ranges[j].base_register_idx = range->BaseShaderRegister;
+            if (range->OffsetInDescriptorsFromTableStart != D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND)
+                heap_offset = range->OffsetInDescriptorsFromTableStart;
+
+            op = &root_signature->binding_ops[root_signature->binding_op_count++];
+            op->heap_offset = heap_offset;
+            op->descriptor_count = range->NumDescriptors;
+            op->binding = vk_binding;
+            op->descriptor_magic = vkd3d_descriptor_magic_from_d3d12(range->RangeType);
+            op->base_register_idx = range->BaseShaderRegister;
+            op->uav_counter_count = 0;
+            if (range->RangeType == D3D12_DESCRIPTOR_RANGE_TYPE_UAV
+                    && range->BaseShaderRegister < VKD3D_SHADER_MAX_UNORDERED_ACCESS_VIEWS)
+                op->uav_counter_count = min(range->NumDescriptors,
+                        VKD3D_SHADER_MAX_UNORDERED_ACCESS_VIEWS - range->BaseShaderRegister);
+
+            heap_offset += range->NumDescriptors;
         }
     }
 
@@ -665,7 +684,7 @@ static HRESULT d3d12_root_signature_init_root_descriptor_tables(struct d3d12_roo
 }
 
 static HRESULT d3d12_root_signature_init_root_descriptors(struct d3d12_root_signature *root_signature,
-        const D3D12_ROOT_SIGNATURE_DESC *desc, struct vkd3d_descriptor_set_context *context)
+        const D3D12_ROOT_SIGNATURE_DESC1 *desc, struct vkd3d_descriptor_set_context *context)
 {
     VkDescriptorSetLayoutBinding *cur_binding = context->current_binding;
     unsigned int i;
@@ -674,7 +693,7 @@ static HRESULT d3d12_root_signature_init_root_descriptors(struct d3d12_root_sign
 
     for (i = 0; i < desc->NumParameters; ++i)
     {
-        const D3D12_ROOT_PARAMETER *p = &desc->pParameters[i];
+        const D3D12_ROOT_PARAMETER1 *p = &desc->pParameters[i];
         if (p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_CBV
                 && p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_SRV
                 && p->ParameterType != D3D12_ROOT_PARAMETER_TYPE_UAV)
@@ -708,7 +727,7 @@ static HRESULT d3d12_root_signature_init_root_descriptors(struct d3d12_root_sign
 }
 
 static HRESULT d3d12_root_signature_init_static_samplers(struct d3d12_root_signature *root_signature,
-        struct d3d12_device *device, const D3D12_ROOT_SIGNATURE_DESC *desc,
+        struct d3d12_device *device, const D3D12_ROOT_SIGNATURE_DESC1 *desc,
         struct vkd3d_descriptor_set_context *context)
 {
     VkDescriptorSetLayoutBinding *cur_binding = context->current_binding;
@@ -790,7 +809,7 @@ static HRESULT vkd3d_create_pipeline_layout(struct d3d12_device *device,
 }
 
 static HRESULT d3d12_root_signature_init(struct d3d12_root_signature *root_signature,
-        struct d3d12_device *device, const D3D12_ROOT_SIGNATURE_DESC *desc)
+        struct d3d12_device *device, const D3D12_ROOT_SIGNATURE_DESC1 *desc)
 {
     const struct vkd3d_vulkan_info *vk_info = &device->vk_info;
     struct vkd3d_descriptor_set_context context;
@@ -805,12 +824,19 @@ static HRESULT d3d12_root_signature_init(struct d3d12_root_signature *root_signa
     root_signature->ID3D12RootSignature_iface.lpVtbl = &d3d12_root_signature_vtbl;
     root_signature->refcount = 1;
 
+    root_signature->cached = false;
+    root_signature->bytecode = NULL;
+    root_signature->bytecode_length = 0;
+
     root_signature->vk_pipeline_layout = VK_NULL_HANDLE;
     root_signature->vk_push_set_layout = VK_NULL_HANDLE;
     root_signature->vk_set_layout = VK_NULL_HANDLE;
     root_signature->parameters = NULL;
+    root_signature->binding_ops = NULL;
+    root_signature->binding_op_count = 0;
     root_signature->flags = desc->Flags;
     root_signature->descriptor_mapping = NULL;
+    root_signature->root_constants = NULL;
     root_signature->static_sampler_count = 0;
     root_signature->static_samplers = NULL;
 
@@ -844,6 +870,9 @@ static HRESULT d3d12_root_signature_init(struct d3d12_root_signature *root_signa
     if (!(root_signature->descriptor_mapping = vkd3d_calloc(root_signature->descriptor_count,
             sizeof(*root_signature->descriptor_mapping))))
         goto fail;
+    if (!(root_signature->binding_ops = vkd3d_calloc(info.descriptor_range_count,
+            sizeof(*root_signature->binding_ops))))
+        goto fail;
     root_signature->root_constant_count = info.root_constant_count;
     if (!(root_signature->root_constants = vkd3d_calloc(root_signature->root_constant_count,
             sizeof(*root_signature->root_constants))))
@@ -910,7 +939,7 @@ fail:
     return hr;
 }
 
-HRESULT d3d12_root_signature_create(struct d3d12_device *device,
+static HRESULT d3d12_root_signature_create_from_bytecode(struct d3d12_device *device,
         const void *bytecode, size_t bytecode_length, struct d3d12_root_signature **root_signature)
 {
     const struct vkd3d_shader_code dxbc = {bytecode, bytecode_length};
@@ -923,7 +952,7 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
     HRESULT hr;
     int ret;
 
-    if ((ret = vkd3d_parse_root_signature_v_1_0(&dxbc, &root_signature_desc.vkd3d)) < 0)
+    if ((ret = vkd3d_parse_root_signature_v_1_1(&dxbc, &root_signature_desc.vkd3d)) < 0)
     {
         WARN("Failed to parse root signature, vkd3d result %d.\n", ret);
         return hresult_from_vkd3d_result(ret);
@@ -935,7 +964,7 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
         return E_OUTOFMEMORY;
     }
 
-    hr = d3d12_root_signature_init(object, device, &root_signature_desc.d3d12.u.Desc_1_0);
+    hr = d3d12_root_signature_init(object, device, &root_signature_desc.d3d12.u.Desc_1_1);
     vkd3d_shader_free_root_signature(&root_signature_desc.vkd3d);
     if (FAILED(hr))
     {
@@ -950,6 +979,203 @@ HRESULT d3d12_root_signature_create(struct d3d12_device *device,
     return S_OK;
 }
 
+/* vkd3d_root_signature_cache */
+struct vkd3d_root_signature_key
+{
+    uint32_t hash;
+    size_t bytecode_length;
+    const void *bytecode;
+};
+
+/* FNV-1a. */
+static uint32_t vkd3d_root_signature_hash(const void *bytecode, size_t bytecode_length)
+{
+    const uint8_t *data = bytecode;
+    uint32_t hash = 0x811c9dc5u;
+    size_t i;
+
+    for (i = 0; i < bytecode_length; ++i)
+    {
+        hash ^= data[i];
+        hash *= 0x01000193u;
+    }
+
+    return hash;
+}
+
+static int vkd3d_root_signature_compare(const void *key, const struct rb_entry *entry)
+{
+    const struct d3d12_root_signature *root_signature
+            = RB_ENTRY_VALUE(entry, const struct d3d12_root_signature, cache_entry);
+    const struct vkd3d_root_signature_key *k = key;
+
+    if (k->hash != root_signature->hash)
+        return k->hash < root_signature->hash ? -1 : 1;
+    if (k->bytecode_length != root_signature->bytecode_length)
+        return k->bytecode_length < root_signature->bytecode_length ? -1 : 1;
+    return memcmp(k->bytecode, root_signature->bytecode, k->bytecode_length);
+}
+
+HRESULT vkd3d_root_signature_cache_init(struct vkd3d_root_signature_cache *cache)
+{
+    int rc;
+
+    memset(cache, 0, sizeof(*cache));
+
+    if ((rc = pthread_mutex_init(&cache->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    rb_init(&cache->root_signatures, vkd3d_root_signature_compare);
+
+    return S_OK;
+}
+
+void vkd3d_root_signature_cache_cleanup(struct vkd3d_root_signature_cache *cache)
+{
+    TRACE("Root signature cache hits %"PRIu64", misses %"PRIu64".\n", cache->hit_count, cache->miss_count);
+
+    /* Root signatures hold a device reference, so the cache is empty here. */
+    pthread_mutex_destroy(&cache->mutex);
+}
+
+static void vkd3d_root_signature_cache_remove(struct vkd3d_root_signature_cache *cache,
+        struct d3d12_root_signature *root_signature)
+{
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    if (root_signature->cached)
+    {
+        rb_remove(&cache->root_signatures, &root_signature->cache_entry);
+        root_signature->cached = false;
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+/* A cached root signature may be released concurrently, so only take a
+ * reference if it is still alive. */
+static bool d3d12_root_signature_try_add_ref(struct d3d12_root_signature *root_signature)
+{
+    LONG refcount;
+
+    do
+    {
+        if ((refcount = *(const LONG volatile *)&root_signature->refcount) <= 0)
+            return false;
+    }
+    while (InterlockedCompareExchange(&root_signature->refcount, refcount + 1, refcount) != refcount);
+
+    return true;
+}
+
+/* Returns a referenced root signature for "key", or NULL. Entries of root
+ * signatures which are being destroyed are removed. */
+static struct d3d12_root_signature *vkd3d_root_signature_cache_find_locked(
+        struct vkd3d_root_signature_cache *cache, const struct vkd3d_root_signature_key *key)
+{
+    struct d3d12_root_signature *object;
+    struct rb_entry *entry;
+
+    if (!(entry = rb_get(&cache->root_signatures, key)))
+        return NULL;
+
+    object = RB_ENTRY_VALUE(entry, struct d3d12_root_signature, cache_entry);
+    if (d3d12_root_signature_try_add_ref(object))
+        return object;
+
+    rb_remove(&cache->root_signatures, entry);
+    object->cached = false;
+
+    return NULL;
+}
+
+HRESULT d3d12_root_signature_create(struct d3d12_device *device,
+        const void *bytecode, size_t bytecode_length, struct d3d12_root_signature **root_signature)
+{
+    struct vkd3d_root_signature_cache *cache = &device->root_signature_cache;
+    struct d3d12_root_signature *object, *cached;
+    struct vkd3d_root_signature_key key;
+    HRESULT hr;
+    int rc;
+
+    key.hash = vkd3d_root_signature_hash(bytecode, bytecode_length);
+    key.bytecode_length = bytecode_length;
+    key.bytecode = bytecode;
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    if ((cached = vkd3d_root_signature_cache_find_locked(cache, &key)))
+        ++cache->hit_count;
+    else
+        ++cache->miss_count;
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (cached)
+    {
+        TRACE("Reusing root signature %p.\n", cached);
+        *root_signature = cached;
+        return S_OK;
+    }
+
+    /* Parsing the blob and creating the Vulkan layouts is the expensive
+     * part, so it is done without holding the cache mutex. */
+    if (FAILED(hr = d3d12_root_signature_create_from_bytecode(device, bytecode, bytecode_length, &object)))
+        return hr;
+
+    /* Failing to cache the root signature is not fatal. */
+    if (!(object->bytecode = vkd3d_malloc(bytecode_length)))
+    {
+        *root_signature = object;
+        return S_OK;
+    }
+    memcpy(object->bytecode, bytecode, bytecode_length);
+    object->bytecode_length = bytecode_length;
+    object->hash = key.hash;
+
+    if ((rc = pthread_mutex_lock(&cache->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        *root_signature = object;
+        return S_OK;
+    }
+
+    /* Another thread may have created the same root signature meanwhile. */
+    if (!(cached = vkd3d_root_signature_cache_find_locked(cache, &key)))
+    {
+        if (rb_put(&cache->root_signatures, &key, &object->cache_entry) == -1)
+            ERR("Failed to insert root signature %p.\n", object);
+        else
+            object->cached = true;
+    }
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    if (cached)
+    {
+        TRACE("Root signature %p was created concurrently, reusing it.\n", cached);
+        ID3D12RootSignature_Release(&object->ID3D12RootSignature_iface);
+        object = cached;
+    }
+
+    *root_signature = object;
+
+    return S_OK;
+}
+
 /* vkd3d_render_pass_cache */
 struct vkd3d_render_pass_entry
 {
@@ -1147,6 +1373,165 @@ void vkd3d_render_pass_cache_cleanup(struct vkd3d_render_pass_cache *cache,
     cache->render_passes = NULL;
 }
 
+/* Predicate resolve pipeline, used when VK_EXT_conditional_rendering is not available. */
+static const uint32_t vkd3d_predicate_resolve_cs_code[] =
+{
+#if 0
+    #version 450
+    layout(local_size_x = 1) in;
+
+    /* Bound to the 64-bit D3D12 predicate value. */
+    layout(binding = 0) uniform usamplerBuffer predicate;
+    /* [0] predicate element, [1] invert, [2-4] input arguments, [8-10] output arguments. */
+    layout(binding = 1, r32ui) uniform uimageBuffer args;
+
+    void main()
+    {
+        uint src_index = imageLoad(args, 0).x;
+        uint invert = imageLoad(args, 1).x;
+        uint value = texelFetch(predicate, int(src_index)).x | texelFetch(predicate, int(src_index + 1)).x;
+        uint mask = (value != 0) != (invert != 0) ? 1 : 0;
+
+        for (int i = 0; i < 3; ++i)
+            imageStore(args, 8 + i, uvec4(imageLoad(args, 2 + i).x * mask));
+    }
+    0x07230203, 0x00010000, 0x00000000, 0x00000035, 0x00000000, 0x00020011,
+    0x00000001, 0x00020011, 0x0000002e, 0x00020011, 0x0000002f, 0x0003000e,
+    0x00000000, 0x00000001, 0x0005000f, 0x00000005, 0x00000001, 0x6e69616d,
+    0x00000000, 0x00060010, 0x00000001, 0x00000011, 0x00000001, 0x00000001,
+    0x00000001, 0x00040047, 0x00000002, 0x00000022, 0x00000000, 0x00040047,
+    0x00000002, 0x00000021, 0x00000000, 0x00040047, 0x00000003, 0x00000022,
+    0x00000000, 0x00040047, 0x00000003, 0x00000021, 0x00000001, 0x00020013,
+    0x00000004, 0x00030021, 0x00000005, 0x00000004, 0x00040015, 0x00000006,
+    0x00000020, 0x00000000, 0x00040017, 0x00000007, 0x00000006, 0x00000004,
+    0x00020014, 0x00000008, 0x00090019, 0x00000009, 0x00000006, 0x00000005,
+    0x00000000, 0x00000000, 0x00000000, 0x00000001, 0x00000000, 0x00040020,
+    0x0000000a, 0x00000000, 0x00000009, 0x00090019, 0x0000000b, 0x00000006,
+    0x00000005, 0x00000000, 0x00000000, 0x00000000, 0x00000002, 0x00000021,
+    0x00040020, 0x0000000c, 0x00000000, 0x0000000b, 0x0004002b, 0x00000006,
+    0x0000000d, 0x00000000, 0x0004002b, 0x00000006, 0x0000000e, 0x00000001,
+    0x0004002b, 0x00000006, 0x0000000f, 0x00000002, 0x0004002b, 0x00000006,
+    0x00000010, 0x00000003, 0x0004002b, 0x00000006, 0x00000011, 0x00000004,
+    0x0004002b, 0x00000006, 0x00000012, 0x00000005, 0x0004002b, 0x00000006,
+    0x00000013, 0x00000006, 0x0004002b, 0x00000006, 0x00000014, 0x00000007,
+    0x0004002b, 0x00000006, 0x00000015, 0x00000008, 0x0004002b, 0x00000006,
+    0x00000016, 0x00000009, 0x0004002b, 0x00000006, 0x00000017, 0x0000000a,
+    0x0004003b, 0x0000000a, 0x00000002, 0x00000000, 0x0004003b, 0x0000000c,
+    0x00000003, 0x00000000, 0x00050036, 0x00000004, 0x00000001, 0x00000000,
+    0x00000005, 0x000200f8, 0x00000018, 0x0004003d, 0x00000009, 0x00000019,
+    0x00000002, 0x0004003d, 0x0000000b, 0x0000001a, 0x00000003, 0x00050062,
+    0x00000007, 0x0000001b, 0x0000001a, 0x0000000d, 0x00050051, 0x00000006,
+    0x0000001c, 0x0000001b, 0x00000000, 0x00050062, 0x00000007, 0x0000001d,
+    0x0000001a, 0x0000000e, 0x00050051, 0x00000006, 0x0000001e, 0x0000001d,
+    0x00000000, 0x0005005f, 0x00000007, 0x0000001f, 0x00000019, 0x0000001c,
+    0x00050051, 0x00000006, 0x00000020, 0x0000001f, 0x00000000, 0x00050080,
+    0x00000006, 0x00000021, 0x0000001c, 0x0000000e, 0x0005005f, 0x00000007,
+    0x00000022, 0x00000019, 0x00000021, 0x00050051, 0x00000006, 0x00000023,
+    0x00000022, 0x00000000, 0x000500c5, 0x00000006, 0x00000024, 0x00000020,
+    0x00000023, 0x000500ab, 0x00000008, 0x00000025, 0x00000024, 0x0000000d,
+    0x000500ab, 0x00000008, 0x00000026, 0x0000001e, 0x0000000d, 0x000500a5,
+    0x00000008, 0x00000027, 0x00000025, 0x00000026, 0x000600a9, 0x00000006,
+    0x00000028, 0x00000027, 0x0000000e, 0x0000000d, 0x00050062, 0x00000007,
+    0x00000029, 0x0000001a, 0x0000000f, 0x00050051, 0x00000006, 0x0000002a,
+    0x00000029, 0x00000000, 0x00050084, 0x00000006, 0x0000002b, 0x0000002a,
+    0x00000028, 0x00070050, 0x00000007, 0x0000002c, 0x0000002b, 0x0000002b,
+    0x0000002b, 0x0000002b, 0x00040063, 0x0000001a, 0x00000015, 0x0000002c,
+    0x00050062, 0x00000007, 0x0000002d, 0x0000001a, 0x00000010, 0x00050051,
+    0x00000006, 0x0000002e, 0x0000002d, 0x00000000, 0x00050084, 0x00000006,
+    0x0000002f, 0x0000002e, 0x00000028, 0x00070050, 0x00000007, 0x00000030,
+    0x0000002f, 0x0000002f, 0x0000002f, 0x0000002f, 0x00040063, 0x0000001a,
+    0x00000016, 0x00000030, 0x00050062, 0x00000007, 0x00000031, 0x0000001a,
+    0x00000011, 0x00050051, 0x00000006, 0x00000032, 0x00000031, 0x00000000,
+    0x00050084, 0x00000006, 0x00000033, 0x00000032, 0x00000028, 0x00070050,
+    0x00000007, 0x00000034, 0x00000033, 0x00000033, 0x00000033, 0x00000033,
+    0x00040063, 0x0000001a, 0x00000017, 0x00000034, 0x000100fd, 0x00010038,
+};
+
+HRESULT vkd3d_predicate_ops_init(struct vkd3d_predicate_ops *ops, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+    VkDescriptorSetLayoutBinding bindings[2];
+    VkComputePipelineCreateInfo pipeline_info;
+    VkShaderModuleCreateInfo shader_desc;
+    VkResult vr;
+    HRESULT hr;
+
+    memset(ops, 0, sizeof(*ops));
+
+    if (device->vk_info.EXT_conditional_rendering)
+        return S_OK;
+
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[0].pImmutableSamplers = NULL;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].pImmutableSamplers = NULL;
+
+    if (FAILED(hr = vkd3d_create_descriptor_set_layout(device, 0,
+            ARRAY_SIZE(bindings), bindings, &ops->vk_set_layout)))
+        return hr;
+
+    if (FAILED(hr = vkd3d_create_pipeline_layout(device, 1, &ops->vk_set_layout,
+            0, NULL, &ops->vk_pipeline_layout)))
+        goto fail;
+
+    shader_desc.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    shader_desc.pNext = NULL;
+    shader_desc.flags = 0;
+    shader_desc.codeSize = sizeof(vkd3d_predicate_resolve_cs_code);
+    shader_desc.pCode = vkd3d_predicate_resolve_cs_code;
+
+    pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipeline_info.pNext = NULL;
+    pipeline_info.flags = 0;
+    pipeline_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipeline_info.stage.pNext = NULL;
+    pipeline_info.stage.flags = 0;
+    pipeline_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipeline_info.stage.pName = "main";
+    pipeline_info.stage.pSpecializationInfo = NULL;
+    pipeline_info.layout = ops->vk_pipeline_layout;
+    pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+    pipeline_info.basePipelineIndex = -1;
+
+    if ((vr = VK_CALL(vkCreateShaderModule(device->vk_device, &shader_desc, NULL, &pipeline_info.stage.module))) < 0)
+    {
+        WARN("Failed to create Vulkan shader module, vr %d.\n", vr);
+        hr = hresult_from_vk_result(vr);
+        goto fail;
+    }
+
+    vr = VK_CALL(vkCreateComputePipelines(device->vk_device, device->vk_pipeline_cache,
+            1, &pipeline_info, NULL, &ops->vk_resolve_pipeline));
+    VK_CALL(vkDestroyShaderModule(device->vk_device, pipeline_info.stage.module, NULL));
+    if (vr < 0)
+    {
+        WARN("Failed to create Vulkan compute pipeline, vr %d.\n", vr);
+        hr = hresult_from_vk_result(vr);
+        goto fail;
+    }
+
+    return S_OK;
+
+fail:
+    vkd3d_predicate_ops_cleanup(ops, device);
+    return hr;
+}
+
+void vkd3d_predicate_ops_cleanup(struct vkd3d_predicate_ops *ops, struct d3d12_device *device)
+{
+    const struct vkd3d_vk_device_procs *vk_procs = &device->vk_procs;
+
+    VK_CALL(vkDestroyPipeline(device->vk_device, ops->vk_resolve_pipeline, NULL));
+    VK_CALL(vkDestroyPipelineLayout(device->vk_device, ops->vk_pipeline_layout, NULL));
+    VK_CALL(vkDestroyDescriptorSetLayout(device->vk_device, ops->vk_set_layout, NULL));
+}
+
 struct vkd3d_pipeline_key
 {
     D3D12_PRIMITIVE_TOPOLOGY topology;
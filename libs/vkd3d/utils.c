@@ -19,6 +19,9 @@
 #include "vkd3d_private.h"
 
 #include <errno.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #define COLOR         (VK_IMAGE_ASPECT_COLOR_BIT)
 #define DEPTH         (VK_IMAGE_ASPECT_DEPTH_BIT)
@@ -451,28 +454,129 @@ const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
     return NULL;
 }
 
+/* Copies into mapped device memory larger than this are unlikely to be read
+ * back by the CPU, so they bypass the CPU caches. */
+#define VKD3D_STREAMING_COPY_THRESHOLD 0x100000
+
+static void vkd3d_memcpy_streaming(uint8_t *dst, const uint8_t *src, size_t size)
+{
+#ifdef __SSE2__
+    size_t head;
+
+    if ((head = -(uintptr_t)dst & 15) > size)
+        head = size;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    for (; size >= 64; size -= 64, src += 64, dst += 64)
+    {
+        _mm_stream_si128((__m128i *)dst + 0, _mm_loadu_si128((const __m128i *)src + 0));
+        _mm_stream_si128((__m128i *)dst + 1, _mm_loadu_si128((const __m128i *)src + 1));
+        _mm_stream_si128((__m128i *)dst + 2, _mm_loadu_si128((const __m128i *)src + 2));
+        _mm_stream_si128((__m128i *)dst + 3, _mm_loadu_si128((const __m128i *)src + 3));
+    }
+    for (; size >= 16; size -= 16, src += 16, dst += 16)
+        _mm_stream_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+#endif
+
+    memcpy(dst, src, size);
+}
+
+/* Inlined with constant row sizes for the common small texel sizes, so that
+ * the per-row copy becomes a single load and store. */
+static inline void vkd3d_copy_rows(uint8_t *dst, unsigned int dst_row_pitch,
+        const uint8_t *src, unsigned int src_row_pitch, unsigned int row_size, unsigned int row_count,
+        bool streaming)
+{
+    unsigned int row;
+
+    for (row = 0; row < row_count; ++row)
+    {
+        if (streaming)
+            vkd3d_memcpy_streaming(&dst[(size_t)row * dst_row_pitch], &src[(size_t)row * src_row_pitch], row_size);
+        else
+            memcpy(&dst[(size_t)row * dst_row_pitch], &src[(size_t)row * src_row_pitch], row_size);
+    }
+}
+
+static void vkd3d_copy_slice(uint8_t *dst, unsigned int dst_row_pitch,
+        const uint8_t *src, unsigned int src_row_pitch, unsigned int row_size, unsigned int row_count,
+        bool streaming)
+{
+    if (src_row_pitch == row_size && dst_row_pitch == row_size)
+    {
+        if (streaming)
+            vkd3d_memcpy_streaming(dst, src, (size_t)row_size * row_count);
+        else
+            memcpy(dst, src, (size_t)row_size * row_count);
+        return;
+    }
+
+    if (streaming)
+    {
+        vkd3d_copy_rows(dst, dst_row_pitch, src, src_row_pitch, row_size, row_count, true);
+        return;
+    }
+
+    switch (row_size)
+    {
+        case 4:
+            vkd3d_copy_rows(dst, dst_row_pitch, src, src_row_pitch, 4, row_count, false);
+            break;
+        case 8:
+            vkd3d_copy_rows(dst, dst_row_pitch, src, src_row_pitch, 8, row_count, false);
+            break;
+        case 16:
+            vkd3d_copy_rows(dst, dst_row_pitch, src, src_row_pitch, 16, row_count, false);
+            break;
+        default:
+            vkd3d_copy_rows(dst, dst_row_pitch, src, src_row_pitch, row_size, row_count, false);
+            break;
+    }
+}
+
 void vkd3d_format_copy_data(const struct vkd3d_format *format, const uint8_t *src,
         unsigned int src_row_pitch, unsigned int src_slice_pitch, uint8_t *dst, unsigned int dst_row_pitch,
-        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d)
+        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d, bool dst_is_mapped)
 {
-    unsigned int row_block_count, row_count, row_size, slice, row;
+    unsigned int row_block_count, row_count, row_size, slice;
     unsigned int slice_count = d;
-    const uint8_t *src_row;
-    uint8_t *dst_row;
+    size_t slice_size;
+    bool streaming;
 
     row_block_count = (w + format->block_width - 1) / format->block_width;
     row_count = (h + format->block_height - 1) / format->block_height;
     row_size = row_block_count * format->byte_count * format->block_byte_count;
+    slice_size = (size_t)row_size * row_count;
+
+    if (!slice_size || !slice_count)
+        return;
+
+    /* Data copied into application memory is likely to be used right away,
+     * so keep it in the caches. */
+    streaming = dst_is_mapped && slice_size * slice_count >= VKD3D_STREAMING_COPY_THRESHOLD;
+
+    /* Tightly packed data is copied as a single block. */
+    if (src_row_pitch == row_size && dst_row_pitch == row_size
+            && (slice_count == 1 || (src_slice_pitch == slice_size && dst_slice_pitch == slice_size)))
+    {
+        row_count *= slice_count;
+        slice_count = 1;
+    }
 
     for (slice = 0; slice < slice_count; ++slice)
     {
-        for (row = 0; row < row_count; ++row)
-        {
-            src_row = &src[slice * src_slice_pitch + row * src_row_pitch];
-            dst_row = &dst[slice * dst_slice_pitch + row * dst_row_pitch];
-            memcpy(dst_row, src_row, row_size);
-        }
+        vkd3d_copy_slice(&dst[(size_t)slice * dst_slice_pitch], dst_row_pitch,
+                &src[(size_t)slice * src_slice_pitch], src_row_pitch, row_size, row_count, streaming);
     }
+
+#ifdef __SSE2__
+    /* Streaming stores are weakly ordered. */
+    if (streaming)
+        _mm_sfence();
+#endif
 }
 
 VkFormat vkd3d_get_vk_format(DXGI_FORMAT format)
@@ -1046,3 +1150,141 @@ HRESULT vkd3d_set_vk_object_name(struct d3d12_device *device, uint64_t vk_object
 
     return hresult_from_vk_result(vr);
 }
+
+/* Object pools
+ *
+ * Small fixed size objects which are created and destroyed at a high rate
+ * are carved out of slabs, and freed objects are kept on a free list for
+ * reuse. Each pool has its own lock, so churn doesn't contend on the
+ * global heap. Slabs are only released when the pool is destroyed.
+ * Objects are cache line aligned, so that an object which fits in a cache
+ * line never straddles two. */
+#define VKD3D_OBJECT_POOL_SLAB_SIZE        0x10000
+#define VKD3D_OBJECT_POOL_OBJECT_ALIGNMENT 64
+
+struct vkd3d_object_pool_entry
+{
+    struct vkd3d_object_pool_entry *next;
+};
+
+HRESULT vkd3d_object_pool_init(struct vkd3d_object_pool *pool, size_t object_size)
+{
+    int rc;
+
+    memset(pool, 0, sizeof(*pool));
+
+    if ((rc = pthread_mutex_init(&pool->mutex, NULL)))
+    {
+        ERR("Failed to initialize mutex, error %d.\n", rc);
+        return hresult_from_errno(rc);
+    }
+
+    object_size = max(object_size, sizeof(struct vkd3d_object_pool_entry));
+    pool->object_size = align(object_size, VKD3D_OBJECT_POOL_OBJECT_ALIGNMENT);
+    pool->slab_object_count = max(VKD3D_OBJECT_POOL_SLAB_SIZE / pool->object_size, 1);
+
+    return S_OK;
+}
+
+void vkd3d_object_pool_cleanup(struct vkd3d_object_pool *pool)
+{
+    size_t i;
+
+    if (pool->allocated_count)
+        ERR("Pool %p still has %zu objects.\n", pool, pool->allocated_count);
+
+    for (i = 0; i < pool->slab_count; ++i)
+        vkd3d_free(pool->slabs[i]);
+    vkd3d_free(pool->slabs);
+
+    pthread_mutex_destroy(&pool->mutex);
+}
+
+void *vkd3d_object_pool_alloc(struct vkd3d_object_pool *pool)
+{
+    struct vkd3d_object_pool_entry *entry;
+    uint8_t *slab;
+    size_t i;
+    int rc;
+
+    if ((rc = pthread_mutex_lock(&pool->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return NULL;
+    }
+
+    if (!pool->free_list)
+    {
+        if (!vkd3d_array_reserve((void **)&pool->slabs, &pool->slabs_size,
+                pool->slab_count + 1, sizeof(*pool->slabs))
+                || !(slab = vkd3d_malloc(pool->slab_object_count * pool->object_size
+                + VKD3D_OBJECT_POOL_OBJECT_ALIGNMENT - 1)))
+        {
+            pthread_mutex_unlock(&pool->mutex);
+            return NULL;
+        }
+        pool->slabs[pool->slab_count++] = slab;
+        slab += align((uintptr_t)slab, VKD3D_OBJECT_POOL_OBJECT_ALIGNMENT) - (uintptr_t)slab;
+
+        /* Push in reverse, so that objects are handed out in address order. */
+        for (i = pool->slab_object_count; i--;)
+        {
+            entry = (struct vkd3d_object_pool_entry *)&slab[i * pool->object_size];
+            entry->next = pool->free_list;
+            pool->free_list = entry;
+        }
+        pool->free_count += pool->slab_object_count;
+    }
+
+    entry = pool->free_list;
+    pool->free_list = entry->next;
+    --pool->free_count;
+    ++pool->allocated_count;
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return entry;
+}
+
+void vkd3d_object_pool_free(struct vkd3d_object_pool *pool, void *object)
+{
+    struct vkd3d_object_pool_entry *entry = object;
+    int rc;
+
+    if (!object)
+        return;
+
+    if ((rc = pthread_mutex_lock(&pool->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    entry->next = pool->free_list;
+    pool->free_list = entry;
+    ++pool->free_count;
+    --pool->allocated_count;
+
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+void vkd3d_object_pool_get_statistics(struct vkd3d_object_pool *pool,
+        struct vkd3d_object_pool_statistics *statistics)
+{
+    int rc;
+
+    memset(statistics, 0, sizeof(*statistics));
+
+    if ((rc = pthread_mutex_lock(&pool->mutex)))
+    {
+        ERR("Failed to lock mutex, error %d.\n", rc);
+        return;
+    }
+
+    statistics->object_size = pool->object_size;
+    statistics->slab_count = pool->slab_count;
+    statistics->allocated_count = pool->allocated_count;
+    statistics->free_count = pool->free_count;
+
+    pthread_mutex_unlock(&pool->mutex);
+}
@@ -93,6 +93,7 @@ struct d3d12_root_signature_deserializer
 };
 
 STATIC_ASSERT(sizeof(D3D12_ROOT_SIGNATURE_DESC) == sizeof(struct vkd3d_root_signature_desc));
+STATIC_ASSERT(sizeof(D3D12_ROOT_SIGNATURE_DESC1) == sizeof(struct vkd3d_root_signature_desc1));
 
 static struct d3d12_root_signature_deserializer *impl_from_ID3D12RootSignatureDeserializer(
         ID3D12RootSignatureDeserializer *iface)
@@ -168,8 +169,9 @@ static const struct ID3D12RootSignatureDeserializerVtbl d3d12_root_signature_des
     d3d12_root_signature_deserializer_GetRootSignatureDesc,
 };
 
-int vkd3d_parse_root_signature_v_1_0(const struct vkd3d_shader_code *dxbc,
-        struct vkd3d_versioned_root_signature_desc *out_desc)
+static int vkd3d_parse_root_signature_for_version(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_versioned_root_signature_desc *out_desc,
+        enum vkd3d_root_signature_version target_version)
 {
     struct vkd3d_versioned_root_signature_desc desc, converted_desc;
     int ret;
@@ -180,7 +182,7 @@ int vkd3d_parse_root_signature_v_1_0(const struct vkd3d_shader_code *dxbc,
         return ret;
     }
 
-    if (desc.version == VKD3D_ROOT_SIGNATURE_VERSION_1_0)
+    if (desc.version == target_version)
     {
         *out_desc = desc;
     }
@@ -188,7 +190,7 @@ int vkd3d_parse_root_signature_v_1_0(const struct vkd3d_shader_code *dxbc,
     {
         enum vkd3d_root_signature_version version = desc.version;
 
-        ret = vkd3d_shader_convert_root_signature(&converted_desc, VKD3D_ROOT_SIGNATURE_VERSION_1_0, &desc);
+        ret = vkd3d_shader_convert_root_signature(&converted_desc, target_version, &desc);
         vkd3d_shader_free_root_signature(&desc);
         if (ret < 0)
         {
@@ -202,6 +204,18 @@ int vkd3d_parse_root_signature_v_1_0(const struct vkd3d_shader_code *dxbc,
     return ret;
 }
 
+int vkd3d_parse_root_signature_v_1_0(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_versioned_root_signature_desc *out_desc)
+{
+    return vkd3d_parse_root_signature_for_version(dxbc, out_desc, VKD3D_ROOT_SIGNATURE_VERSION_1_0);
+}
+
+int vkd3d_parse_root_signature_v_1_1(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_versioned_root_signature_desc *out_desc)
+{
+    return vkd3d_parse_root_signature_for_version(dxbc, out_desc, VKD3D_ROOT_SIGNATURE_VERSION_1_1);
+}
+
 static HRESULT d3d12_root_signature_deserializer_init(struct d3d12_root_signature_deserializer *deserializer,
         const struct vkd3d_shader_code *dxbc)
 {
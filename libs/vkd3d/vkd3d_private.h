@@ -37,6 +37,7 @@
 #include <limits.h>
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdio.h>
 
 #define VK_CALL(f) (vk_procs->f)
 
@@ -101,10 +102,14 @@ struct vkd3d_vulkan_info
     bool KHR_maintenance3;
     bool KHR_push_descriptor;
     /* EXT device extensions */
+    bool EXT_calibrated_timestamps;
     bool EXT_conditional_rendering;
     bool EXT_debug_marker;
     bool EXT_depth_clip_enable;
     bool EXT_descriptor_indexing;
+    bool EXT_memory_budget;
+    bool EXT_memory_priority;
+    bool EXT_pageable_device_local_memory;
     bool EXT_shader_demote_to_helper_invocation;
     bool EXT_texel_buffer_alignment;
     bool EXT_transform_feedback;
@@ -130,6 +135,7 @@ struct vkd3d_vulkan_info
 enum vkd3d_config_flags
 {
     VKD3D_CONFIG_FLAG_VULKAN_DEBUG = 0x00000001,
+    VKD3D_CONFIG_FLAG_QUEUE_PROFILING = 0x00000002,
 };
 
 struct vkd3d_instance
@@ -215,13 +221,25 @@ struct vkd3d_gpu_va_slab
     void *ptr;
 };
 
+/* Fallback allocation arrays are only freed when the allocator is destroyed,
+ * so that lock-less readers never access freed memory. */
+struct vkd3d_gpu_va_fallback_array
+{
+    struct vkd3d_gpu_va_fallback_array *previous;
+    size_t size;
+    struct vkd3d_gpu_va_allocation allocations[];
+};
+
 struct vkd3d_gpu_va_allocator
 {
+    /* Only taken by writers. */
     pthread_mutex_t mutex;
 
+    /* Odd while the fallback allocations are being modified. Readers retry
+     * if the sequence changes while they look up an address. */
+    uint64_t fallback_sequence;
     D3D12_GPU_VIRTUAL_ADDRESS fallback_floor;
-    struct vkd3d_gpu_va_allocation *fallback_allocations;
-    size_t fallback_allocations_size;
+    struct vkd3d_gpu_va_fallback_array *fallback_allocations;
     size_t fallback_allocation_count;
 
     struct vkd3d_gpu_va_slab *slabs;
@@ -235,6 +253,71 @@ void *vkd3d_gpu_va_allocator_dereference(struct vkd3d_gpu_va_allocator *allocato
 void vkd3d_gpu_va_allocator_free(struct vkd3d_gpu_va_allocator *allocator,
         D3D12_GPU_VIRTUAL_ADDRESS address) DECLSPEC_HIDDEN;
 
+struct vkd3d_memory_chunk;
+
+struct vkd3d_memory_allocation
+{
+    VkDeviceMemory vk_memory;
+    uint32_t vk_memory_type;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    unsigned int order;
+    /* NULL when the allocation owns its VkDeviceMemory. */
+    struct vkd3d_memory_chunk *chunk;
+};
+
+/* Serves small committed resources from large VkDeviceMemory chunks. */
+struct vkd3d_memory_allocator
+{
+    pthread_mutex_t mutex;
+
+    struct list chunks[VK_MAX_MEMORY_TYPES];
+
+    size_t chunk_count;
+    size_t suballocation_count;
+    uint64_t suballocated_size;
+    uint64_t requested_size;
+    size_t dedicated_allocation_count;
+    uint64_t dedicated_allocation_size;
+};
+
+HRESULT vkd3d_memory_allocator_init(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_memory_allocator_cleanup(struct vkd3d_memory_allocator *allocator,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_memory_allocator_get_statistics(struct vkd3d_memory_allocator *allocator,
+        struct vkd3d_memory_statistics *statistics) DECLSPEC_HIDDEN;
+
+struct vkd3d_residency_manager
+{
+    pthread_mutex_t mutex;
+
+    /* Per Vulkan memory heap. The allocated size counts device memory
+     * objects, i.e. allocator chunks and dedicated allocations. */
+    uint64_t allocated_size[VK_MAX_MEMORY_HEAPS];
+    uint64_t evicted_size[VK_MAX_MEMORY_HEAPS];
+
+    /* VK_EXT_memory_budget values are queried every
+     * VKD3D_RESIDENCY_BUDGET_UPDATE_INTERVAL budget checks. Memory allocated
+     * since is added to the usage. */
+    LONG budget_check_count;
+    VkDeviceSize heap_budget[VK_MAX_MEMORY_HEAPS];
+    VkDeviceSize heap_usage[VK_MAX_MEMORY_HEAPS];
+    uint64_t budget_allocated_size[VK_MAX_MEMORY_HEAPS];
+};
+
+HRESULT vkd3d_residency_manager_init(struct vkd3d_residency_manager *manager) DECLSPEC_HIDDEN;
+void vkd3d_residency_manager_cleanup(struct vkd3d_residency_manager *manager) DECLSPEC_HIDDEN;
+HRESULT vkd3d_residency_manager_make_resident(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, unsigned int object_count, ID3D12Pageable * const *objects) DECLSPEC_HIDDEN;
+HRESULT vkd3d_residency_manager_evict(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, unsigned int object_count, ID3D12Pageable * const *objects) DECLSPEC_HIDDEN;
+bool vkd3d_residency_manager_is_over_budget(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, uint32_t vk_memory_type, VkDeviceSize size) DECLSPEC_HIDDEN;
+void vkd3d_residency_manager_get_video_memory_info(struct vkd3d_residency_manager *manager,
+        struct d3d12_device *device, enum vkd3d_memory_segment_group segment_group,
+        struct vkd3d_video_memory_info *info) DECLSPEC_HIDDEN;
+
 struct vkd3d_render_pass_key
 {
     unsigned int attachment_count;
@@ -262,6 +345,17 @@ HRESULT vkd3d_render_pass_cache_find(struct vkd3d_render_pass_cache *cache,
         VkRenderPass *vk_render_pass) DECLSPEC_HIDDEN;
 void vkd3d_render_pass_cache_init(struct vkd3d_render_pass_cache *cache) DECLSPEC_HIDDEN;
 
+/* Resolves D3D12 predicates when VK_EXT_conditional_rendering is not available. */
+struct vkd3d_predicate_ops
+{
+    VkDescriptorSetLayout vk_set_layout;
+    VkPipelineLayout vk_pipeline_layout;
+    VkPipeline vk_resolve_pipeline;
+};
+
+HRESULT vkd3d_predicate_ops_init(struct vkd3d_predicate_ops *ops, struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_predicate_ops_cleanup(struct vkd3d_predicate_ops *ops, struct d3d12_device *device) DECLSPEC_HIDDEN;
+
 struct vkd3d_private_store
 {
     pthread_mutex_t mutex;
@@ -283,6 +377,51 @@ struct vkd3d_private_data
     } u;
 };
 
+struct vkd3d_object_pool
+{
+    pthread_mutex_t mutex;
+
+    size_t object_size;
+    size_t slab_object_count;
+
+    uint8_t **slabs;
+    size_t slabs_size;
+    size_t slab_count;
+
+    void *free_list;
+    size_t free_count;
+    size_t allocated_count;
+};
+
+HRESULT vkd3d_object_pool_init(struct vkd3d_object_pool *pool, size_t object_size) DECLSPEC_HIDDEN;
+void vkd3d_object_pool_cleanup(struct vkd3d_object_pool *pool) DECLSPEC_HIDDEN;
+void *vkd3d_object_pool_alloc(struct vkd3d_object_pool *pool) DECLSPEC_HIDDEN;
+void vkd3d_object_pool_free(struct vkd3d_object_pool *pool, void *object) DECLSPEC_HIDDEN;
+void vkd3d_object_pool_get_statistics(struct vkd3d_object_pool *pool,
+        struct vkd3d_object_pool_statistics *statistics) DECLSPEC_HIDDEN;
+
+/* Shares Vulkan samplers between sampler descriptors and static samplers. */
+struct vkd3d_sampler_cache
+{
+    pthread_mutex_t mutex;
+
+    /* Entries keyed by VkSamplerCreateInfo, and by VkSampler. */
+    struct rb_tree samplers;
+    struct rb_tree handles;
+    size_t sampler_count;
+
+    uint64_t hit_count;
+    uint64_t miss_count;
+};
+
+HRESULT vkd3d_sampler_cache_init(struct vkd3d_sampler_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_sampler_cache_cleanup(struct vkd3d_sampler_cache *cache,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_sampler_cache_release(struct vkd3d_sampler_cache *cache,
+        struct d3d12_device *device, VkSampler vk_sampler) DECLSPEC_HIDDEN;
+void vkd3d_sampler_cache_get_statistics(struct vkd3d_sampler_cache *cache,
+        struct vkd3d_sampler_cache_statistics *statistics) DECLSPEC_HIDDEN;
+
 static inline void vkd3d_private_data_destroy(struct vkd3d_private_data *data)
 {
     if (data->is_object)
@@ -337,9 +476,18 @@ struct d3d12_fence
     ID3D12Fence ID3D12Fence_iface;
     LONG refcount;
 
+    /* Written under "mutex", read without locking. */
     uint64_t value;
     pthread_mutex_t mutex;
 
+    /* CPU waiters sleeping in d3d12_fence_wait_for_value(). */
+    LONG cpu_waiter_count;
+#ifdef HAVE_LINUX_FUTEX_H
+    LONG futex_sequence;
+#else
+    pthread_cond_t cond;
+#endif
+
     struct vkd3d_waiting_event
     {
         uint64_t value;
@@ -362,6 +510,8 @@ struct d3d12_fence
 
 HRESULT d3d12_fence_create(struct d3d12_device *device,
         uint64_t initial_value, D3D12_FENCE_FLAGS flags, struct d3d12_fence **fence) DECLSPEC_HIDDEN;
+HRESULT d3d12_fence_wait_for_value(struct d3d12_fence *fence, uint64_t value,
+        uint64_t timeout_ns) DECLSPEC_HIDDEN;
 
 /* ID3D12Heap */
 struct d3d12_heap
@@ -375,9 +525,14 @@ struct d3d12_heap
     pthread_mutex_t mutex;
 
     VkDeviceMemory vk_memory;
+    /* Set once, and left mapped until the heap is destroyed. */
     void *map_ptr;
-    unsigned int map_count;
     uint32_t vk_memory_type;
+    /* Only used by private heaps. */
+    struct vkd3d_memory_allocation allocation;
+
+    /* Protected by the residency manager mutex. */
+    unsigned int residency_count;
 
     struct d3d12_resource *buffer_resource;
     struct d3d12_device *device;
@@ -395,8 +550,71 @@ struct d3d12_heap *unsafe_impl_from_ID3D12Heap(ID3D12Heap *iface) DECLSPEC_HIDDE
 #define VKD3D_RESOURCE_DEDICATED_HEAP 0x00000008
 #define VKD3D_RESOURCE_LINEAR_TILING  0x00000010
 #define VKD3D_RESOURCE_PLACED_BUFFER  0x00000020
+#define VKD3D_RESOURCE_SPARSE         0x00000040
+
+struct d3d12_sparse_buffer_region
+{
+    VkDeviceSize offset;
+    VkDeviceSize length;
+};
+
+struct d3d12_sparse_image_region
+{
+    VkImageSubresource subresource;
+    VkOffset3D offset;
+    VkExtent3D extent;
+};
+
+/* Buffer tiles and packed mip tiles are bound as opaque memory ranges. */
+struct d3d12_sparse_tile
+{
+    bool opaque;
+    union
+    {
+        struct d3d12_sparse_buffer_region buffer;
+        struct d3d12_sparse_image_region image;
+    } u;
+
+    /* Current mapping, VK_NULL_HANDLE for unmapped tiles. */
+    VkDeviceMemory vk_memory;
+    VkDeviceSize vk_offset;
+};
+
+struct d3d12_sparse_info
+{
+    uint32_t tile_count;
+    uint32_t tiling_count;
+    struct d3d12_sparse_tile *tiles;
+    D3D12_SUBRESOURCE_TILING *tilings;
+
+    D3D12_PACKED_MIP_INFO packed_mips;
+    /* Distance between the packed mips of consecutive layers, or 0 if all
+     * layers share a single mip tail. */
+    uint32_t packed_mip_layer_stride;
+    D3D12_TILE_SHAPE tile_shape;
+
+    uint32_t vk_memory_type_bits;
+    VkDeviceMemory vk_metadata_memory;
+};
 
 /* ID3D12Resource */
+struct vkd3d_view_cache_entry;
+
+/* Views of a resource, shared between descriptors with identical view
+ * descs. Each cached view holds a reference owned by the cache. */
+struct vkd3d_view_cache
+{
+    pthread_mutex_t mutex;
+
+    struct vkd3d_view_cache_entry *entries;
+    size_t entries_size;
+    size_t entry_count;
+
+    uint64_t hit_count;
+    uint64_t miss_count;
+    uint64_t purged_count;
+};
+
 struct d3d12_resource
 {
     ID3D12Resource ID3D12Resource_iface;
@@ -413,7 +631,7 @@ struct d3d12_resource
     } u;
     unsigned int flags;
 
-    unsigned int map_count;
+    LONG map_count;
 
     struct d3d12_heap *heap;
     uint64_t heap_offset;
@@ -421,8 +639,13 @@ struct d3d12_resource
     D3D12_RESOURCE_STATES initial_state;
     D3D12_RESOURCE_STATES present_state;
 
+    /* Only used by reserved resources. */
+    struct d3d12_sparse_info sparse;
+
     struct d3d12_device *device;
 
+    struct vkd3d_view_cache view_cache;
+
     struct vkd3d_private_store private_store;
 };
 
@@ -437,6 +660,8 @@ static inline bool d3d12_resource_is_texture(const struct d3d12_resource *resour
 }
 
 bool d3d12_resource_is_cpu_accessible(const struct d3d12_resource *resource) DECLSPEC_HIDDEN;
+bool d3d12_resource_get_tile_index(const struct d3d12_resource *resource,
+        const D3D12_TILED_RESOURCE_COORDINATE *coordinate, uint32_t *tile_index) DECLSPEC_HIDDEN;
 HRESULT d3d12_resource_validate_desc(const D3D12_RESOURCE_DESC *desc) DECLSPEC_HIDDEN;
 
 HRESULT d3d12_committed_resource_create(struct d3d12_device *device,
@@ -454,37 +679,48 @@ struct d3d12_resource *unsafe_impl_from_ID3D12Resource(ID3D12Resource *iface) DE
 HRESULT vkd3d_allocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_buffer,
         const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
         VkDeviceMemory *vk_memory, uint32_t *vk_memory_type, VkDeviceSize *vk_memory_size) DECLSPEC_HIDDEN;
+HRESULT vkd3d_suballocate_buffer_memory(struct d3d12_device *device, VkBuffer vk_buffer,
+        const D3D12_HEAP_PROPERTIES *heap_properties, struct vkd3d_memory_allocation *allocation,
+        void **data) DECLSPEC_HIDDEN;
+void vkd3d_free_memory(struct d3d12_device *device,
+        const struct vkd3d_memory_allocation *allocation) DECLSPEC_HIDDEN;
 HRESULT vkd3d_create_buffer(struct d3d12_device *device,
         const D3D12_HEAP_PROPERTIES *heap_properties, D3D12_HEAP_FLAGS heap_flags,
         const D3D12_RESOURCE_DESC *desc, VkBuffer *vk_buffer) DECLSPEC_HIDDEN;
 HRESULT vkd3d_get_image_allocation_info(struct d3d12_device *device,
         const D3D12_RESOURCE_DESC *desc, D3D12_RESOURCE_ALLOCATION_INFO *allocation_info) DECLSPEC_HIDDEN;
 
-struct vkd3d_view
+enum vkd3d_view_type
 {
-    LONG refcount;
-    union
-    {
-        VkBufferView vk_buffer_view;
-        VkImageView vk_image_view;
-        VkSampler vk_sampler;
-    } u;
-    VkBufferView vk_counter_view;
+    VKD3D_VIEW_TYPE_BUFFER,
+    VKD3D_VIEW_TYPE_IMAGE,
+    VKD3D_VIEW_TYPE_SAMPLER,
 };
 
-void vkd3d_view_decref(struct vkd3d_view *view, struct d3d12_device *device) DECLSPEC_HIDDEN;
-void vkd3d_view_incref(struct vkd3d_view *view) DECLSPEC_HIDDEN;
+/* Views are allocated from the device view pool and are never returned to
+ * the system while the device is alive, which allows d3d12_desc_copy() to
+ * read the refcount of a view that was concurrently freed. The pool links
+ * freed views through their first bytes, so "refcount" must not be the
+ * first member.
+ *
+ * Pool objects are cache line aligned. The first VKD3D_VIEW_HOT_SIZE bytes
+ * hold everything descriptor table updates and copies read; UAV counter
+ * and clear data follows. */
+#define VKD3D_VIEW_HOT_SIZE 32
 
-struct d3d12_desc
+struct vkd3d_view
 {
-    uint32_t magic;
-    VkDescriptorType vk_descriptor_type;
     union
     {
-        VkDescriptorBufferInfo vk_cbv_info;
-        struct vkd3d_view *view;
+        VkBufferView vk_buffer_view;
+        VkImageView vk_image_view;
+        VkSampler vk_sampler;
     } u;
+    LONG refcount;
+    enum vkd3d_view_type type;
 
+    VkBufferView vk_counter_view;
+    /* Used by UAV clears. */
     union
     {
         struct
@@ -499,9 +735,75 @@ struct d3d12_desc
             unsigned int layer_idx;
             unsigned int layer_count;
         } texture;
-    } uav;
+    } info;
+};
+
+void vkd3d_view_decref(struct vkd3d_view *view, struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_view_incref(struct vkd3d_view *view) DECLSPEC_HIDDEN;
+
+/* The descriptor type of a CBV, SRV, UAV or sampler descriptor, stored in
+ * the low bits of the view pointer. Views are at least 16 bytes aligned. */
+enum vkd3d_descriptor_tag
+{
+    VKD3D_DESCRIPTOR_TAG_CBV     = 0x0,
+    VKD3D_DESCRIPTOR_TAG_SRV     = 0x1,
+    VKD3D_DESCRIPTOR_TAG_UAV     = 0x2,
+    VKD3D_DESCRIPTOR_TAG_SAMPLER = 0x3,
 };
 
+#define VKD3D_DESCRIPTOR_TAG_MASK 0x3u
+#define VKD3D_DESCRIPTOR_VIEW_MASK (~(uintptr_t)0xf)
+
+/* Constant buffer views don't have a view object. Their tagged view is this
+ * value, and the buffer range is stored in the descriptor itself. */
+#define VKD3D_DESCRIPTOR_INLINE_CBV (0x4u | VKD3D_DESCRIPTOR_TAG_CBV)
+
+/* A descriptor is a single tagged view pointer, which allows descriptors to
+ * be written and copied without locking, and allows descriptor table
+ * updates to skip empty and mismatched descriptors without reading the
+ * view. A zero value is an empty descriptor. The CBV buffer range is only
+ * valid for VKD3D_DESCRIPTOR_INLINE_CBV, and is written before the tagged
+ * view is published. */
+struct d3d12_desc
+{
+    uintptr_t tagged_view;
+    VkDescriptorBufferInfo vk_cbv_info;
+};
+
+static inline struct vkd3d_view *vkd3d_view_from_tagged_view(uintptr_t tagged_view)
+{
+    return (struct vkd3d_view *)(tagged_view & VKD3D_DESCRIPTOR_VIEW_MASK);
+}
+
+static inline uint32_t vkd3d_descriptor_magic_from_tagged_view(uintptr_t tagged_view)
+{
+    static const uint32_t magics[] =
+    {
+        VKD3D_DESCRIPTOR_MAGIC_CBV,
+        VKD3D_DESCRIPTOR_MAGIC_SRV,
+        VKD3D_DESCRIPTOR_MAGIC_UAV,
+        VKD3D_DESCRIPTOR_MAGIC_SAMPLER,
+    };
+
+    return tagged_view ? magics[tagged_view & VKD3D_DESCRIPTOR_TAG_MASK] : VKD3D_DESCRIPTOR_MAGIC_FREE;
+}
+
+static inline struct vkd3d_view *d3d12_desc_get_view(const struct d3d12_desc *descriptor)
+{
+    return vkd3d_view_from_tagged_view(descriptor->tagged_view);
+}
+
+static inline uint32_t d3d12_desc_get_magic(const struct d3d12_desc *descriptor)
+{
+    return vkd3d_descriptor_magic_from_tagged_view(descriptor->tagged_view);
+}
+
+static inline void d3d12_desc_set_view(struct d3d12_desc *descriptor,
+        struct vkd3d_view *view, enum vkd3d_descriptor_tag tag)
+{
+    descriptor->tagged_view = (uintptr_t)view | tag;
+}
+
 static inline struct d3d12_desc *d3d12_desc_from_cpu_handle(D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle)
 {
     return (struct d3d12_desc *)cpu_handle.ptr;
@@ -514,6 +816,8 @@ static inline struct d3d12_desc *d3d12_desc_from_gpu_handle(D3D12_GPU_DESCRIPTOR
 
 void d3d12_desc_copy(struct d3d12_desc *dst, const struct d3d12_desc *src,
         struct d3d12_device *device) DECLSPEC_HIDDEN;
+void d3d12_desc_copy_range(struct d3d12_desc *dst, const struct d3d12_desc *src,
+        unsigned int count, struct d3d12_device *device) DECLSPEC_HIDDEN;
 void d3d12_desc_create_cbv(struct d3d12_desc *descriptor,
         struct d3d12_device *device, const D3D12_CONSTANT_BUFFER_VIEW_DESC *desc) DECLSPEC_HIDDEN;
 void d3d12_desc_create_srv(struct d3d12_desc *descriptor,
@@ -529,6 +833,8 @@ void d3d12_desc_write_atomic(struct d3d12_desc *dst, const struct d3d12_desc *sr
 
 bool vkd3d_create_raw_buffer_view(struct d3d12_device *device,
         D3D12_GPU_VIRTUAL_ADDRESS gpu_address, VkBufferView *vk_buffer_view) DECLSPEC_HIDDEN;
+bool vkd3d_create_raw_vk_buffer_view(struct d3d12_device *device, VkBuffer vk_buffer,
+        VkDeviceSize offset, VkDeviceSize range, VkBufferView *vk_buffer_view) DECLSPEC_HIDDEN;
 HRESULT vkd3d_create_static_sampler(struct d3d12_device *device,
         const D3D12_STATIC_SAMPLER_DESC *desc, VkSampler *vk_sampler) DECLSPEC_HIDDEN;
 
@@ -584,12 +890,37 @@ struct d3d12_descriptor_heap
 
     struct vkd3d_private_store private_store;
 
-    BYTE descriptors[];
+    /* Set for heaps in the device descriptor heap map. */
+    size_t mapping_size;
+    LONG *used_pages;
+
+    BYTE *descriptors;
 };
 
 HRESULT d3d12_descriptor_heap_create(struct d3d12_device *device,
         const D3D12_DESCRIPTOR_HEAP_DESC *desc, struct d3d12_descriptor_heap **descriptor_heap) DECLSPEC_HIDDEN;
 
+/* Large CBV/SRV/UAV heaps are mapped at granule aligned addresses, and each
+ * granule is registered in a two-level map, which allows descriptor writes
+ * to find their heap without a lock. Writes mark the touched pages in the
+ * heap "used_pages" bitmap, and only those pages are visited when the heap
+ * is destroyed. */
+#define VKD3D_DESCRIPTOR_HEAP_GRANULE_SHIFT 21
+#define VKD3D_DESCRIPTOR_HEAP_GRANULE_SIZE ((size_t)1 << VKD3D_DESCRIPTOR_HEAP_GRANULE_SHIFT)
+#define VKD3D_DESCRIPTOR_HEAP_PAGE_SHIFT 12
+#define VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT 14
+#define VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SIZE (1u << VKD3D_DESCRIPTOR_HEAP_MAP_LEAF_SHIFT)
+#define VKD3D_DESCRIPTOR_HEAP_MAP_ROOT_SIZE 4096
+
+struct vkd3d_descriptor_heap_map
+{
+    pthread_mutex_t mutex;
+    struct d3d12_descriptor_heap **leaves[VKD3D_DESCRIPTOR_HEAP_MAP_ROOT_SIZE];
+};
+
+HRESULT vkd3d_descriptor_heap_map_init(struct vkd3d_descriptor_heap_map *map) DECLSPEC_HIDDEN;
+void vkd3d_descriptor_heap_map_cleanup(struct vkd3d_descriptor_heap_map *map) DECLSPEC_HIDDEN;
+
 /* ID3D12QueryHeap */
 struct d3d12_query_heap
 {
@@ -628,20 +959,28 @@ static inline void d3d12_query_heap_mark_result_as_available(struct d3d12_query_
     heap->availability_mask[index] |= (uint64_t)1 << shift;
 }
 
-struct d3d12_root_descriptor_table_range
+/* A descriptor range of a descriptor table, as written to the descriptor set
+ * at draw time. Range offsets are resolved when the root signature is created,
+ * including D3D12_DESCRIPTOR_RANGE_OFFSET_APPEND. */
+struct vkd3d_descriptor_binding_op
 {
-    unsigned int offset;
+    unsigned int heap_offset;
     unsigned int descriptor_count;
     uint32_t binding;
 
     uint32_t descriptor_magic;
     unsigned int base_register_idx;
+    /* The number of descriptors with a tracked UAV counter, 0 for other
+     * descriptor types. */
+    unsigned int uav_counter_count;
 };
 
+/* Descriptor tables refer to consecutive ops in the binding plan of the root
+ * signature. */
 struct d3d12_root_descriptor_table
 {
-    unsigned int range_count;
-    struct d3d12_root_descriptor_table_range *ranges;
+    unsigned int first_op;
+    unsigned int op_count;
 };
 
 struct d3d12_root_constant
@@ -667,11 +1006,33 @@ struct d3d12_root_parameter
 };
 
 /* ID3D12RootSignature */
+/* Identical root signature blobs are mapped to the same root signature
+ * object, like on Windows. Root signatures remove themselves from the cache
+ * when they are destroyed. */
+struct vkd3d_root_signature_cache
+{
+    pthread_mutex_t mutex;
+    struct rb_tree root_signatures;
+
+    uint64_t hit_count;
+    uint64_t miss_count;
+};
+
+HRESULT vkd3d_root_signature_cache_init(struct vkd3d_root_signature_cache *cache) DECLSPEC_HIDDEN;
+void vkd3d_root_signature_cache_cleanup(struct vkd3d_root_signature_cache *cache) DECLSPEC_HIDDEN;
+
 struct d3d12_root_signature
 {
     ID3D12RootSignature ID3D12RootSignature_iface;
     LONG refcount;
 
+    /* Protected by the root signature cache mutex. */
+    struct rb_entry cache_entry;
+    bool cached;
+    uint32_t hash;
+    void *bytecode;
+    size_t bytecode_length;
+
     VkPipelineLayout vk_pipeline_layout;
     VkDescriptorSetLayout vk_push_set_layout;
     VkDescriptorSetLayout vk_set_layout;
@@ -680,7 +1041,13 @@ struct d3d12_root_signature
     unsigned int parameter_count;
     uint32_t main_set;
 
+    struct vkd3d_descriptor_binding_op *binding_ops;
+    unsigned int binding_op_count;
+
     uint64_t descriptor_table_mask;
+    /* Descriptor tables without D3D12_DESCRIPTOR_RANGE_FLAG_DESCRIPTORS_VOLATILE
+     * ranges. Their descriptors may not change while the table is set. */
+    uint64_t static_descriptor_table_mask;
     uint32_t push_descriptor_mask;
 
     D3D12_ROOT_SIGNATURE_FLAGS flags;
@@ -711,6 +1078,8 @@ struct d3d12_root_signature *unsafe_impl_from_ID3D12RootSignature(ID3D12RootSign
 
 int vkd3d_parse_root_signature_v_1_0(const struct vkd3d_shader_code *dxbc,
         struct vkd3d_versioned_root_signature_desc *desc) DECLSPEC_HIDDEN;
+int vkd3d_parse_root_signature_v_1_1(const struct vkd3d_shader_code *dxbc,
+        struct vkd3d_versioned_root_signature_desc *desc) DECLSPEC_HIDDEN;
 
 struct d3d12_graphics_pipeline_state
 {
@@ -818,6 +1187,106 @@ struct vkd3d_buffer
     VkDeviceMemory vk_memory;
 };
 
+/* Command allocator scratch memory, suballocated from device memory chunks. */
+struct vkd3d_scratch_buffer
+{
+    VkBuffer vk_buffer;
+    struct vkd3d_memory_allocation allocation;
+};
+
+struct vkd3d_staging_region
+{
+    VkDeviceSize offset;
+    VkDeviceSize end;
+    /* The serial of the last submission using the region, or 0. */
+    uint64_t serial;
+    /* Set once the command list owning the region is reset or destroyed. */
+    bool released;
+};
+
+struct vkd3d_staging_submission
+{
+    VkFence vk_fence;
+    uint64_t serial;
+};
+
+/* Device wide ring of transfer memory for temporary copies. Each submission
+ * of command lists using the ring signals a fence, and the regions of those
+ * command lists are tagged with the serial of the submission. The tail moves
+ * past the oldest regions once their command list is released and all
+ * submissions up to their serial are complete. */
+struct vkd3d_staging_ring
+{
+    pthread_mutex_t mutex;
+
+    struct vkd3d_buffer buffer;
+    VkDeviceSize size;
+    VkDeviceSize head;
+    VkDeviceSize tail;
+
+    /* Live regions, oldest first. "first_id" is the id of regions[region_start]. */
+    struct vkd3d_staging_region *regions;
+    size_t regions_size;
+    size_t region_start;
+    size_t region_count;
+    uint64_t first_id;
+
+    /* Submissions which may still be in flight. */
+    struct vkd3d_staging_submission *submissions;
+    size_t submissions_size;
+    size_t submission_count;
+    uint64_t next_serial;
+
+    VkFence *free_fences;
+    size_t free_fences_size;
+    size_t free_fence_count;
+};
+
+HRESULT vkd3d_staging_ring_init(struct vkd3d_staging_ring *ring) DECLSPEC_HIDDEN;
+void vkd3d_staging_ring_cleanup(struct vkd3d_staging_ring *ring, struct d3d12_device *device) DECLSPEC_HIDDEN;
+
+#define VKD3D_TRANSFER_SLOT_COUNT 2
+
+struct vkd3d_transfer_slot
+{
+    VkCommandBuffer vk_command_buffer;
+    VkFence vk_fence;
+    bool pending;
+
+    /* Destination of a pending read, copied out once the fence is signaled. */
+    uint8_t *dst_data;
+    unsigned int dst_row_pitch;
+    unsigned int dst_slice_pitch;
+    unsigned int row_pitch;
+    unsigned int slice_pitch;
+    unsigned int width;
+    unsigned int height;
+    unsigned int depth;
+};
+
+/* Host visible staging memory and an internal queue submission context used
+ * for CPU access to optimally tiled textures. The staging buffer is split in
+ * slots which are used round-robin, so that the CPU copy for one chunk
+ * overlaps with the GPU copy of the previous one. */
+struct vkd3d_transfer_context
+{
+    pthread_mutex_t mutex;
+
+    struct vkd3d_queue *queue;
+    VkCommandPool vk_command_pool;
+    VkBuffer vk_buffer;
+    VkDeviceMemory vk_memory;
+    uint8_t *mapped;
+
+    struct vkd3d_transfer_slot slots[VKD3D_TRANSFER_SLOT_COUNT];
+    unsigned int next_slot;
+};
+
+HRESULT vkd3d_transfer_context_init(struct vkd3d_transfer_context *context,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+void vkd3d_transfer_context_cleanup(struct vkd3d_transfer_context *context,
+        struct d3d12_device *device) DECLSPEC_HIDDEN;
+
 /* ID3D12CommandAllocator */
 struct d3d12_command_allocator
 {
@@ -859,6 +1328,10 @@ struct d3d12_command_allocator
     size_t transfer_buffers_size;
     size_t transfer_buffer_count;
 
+    struct vkd3d_scratch_buffer *scratch_buffers;
+    size_t scratch_buffers_size;
+    size_t scratch_buffer_count;
+
     VkCommandBuffer *command_buffers;
     size_t command_buffers_size;
     size_t command_buffer_count;
@@ -881,6 +1354,7 @@ struct vkd3d_push_descriptor
         {
             VkBuffer vk_buffer;
             VkDeviceSize offset;
+            VkDeviceSize range;
         } cbv;
     } u;
 };
@@ -899,10 +1373,39 @@ struct vkd3d_pipeline_bindings
     VkBufferView vk_uav_counter_views[VKD3D_SHADER_MAX_UNORDERED_ACCESS_VIEWS];
     uint8_t uav_counter_dirty_mask;
 
-    /* Needed when VK_KHR_push_descriptor is not available. */
+    /* Root descriptors and root constants are recorded here, and flushed
+     * when the next draw or dispatch is recorded. */
     struct vkd3d_push_descriptor push_descriptors[D3D12_MAX_ROOT_COST / 2];
     uint32_t push_descriptor_dirty_mask;
     uint32_t push_descriptor_active_mask;
+
+    uint32_t root_constants[D3D12_MAX_ROOT_COST];
+    /* Dirty byte range of "root_constants", in push constant offsets. */
+    uint32_t root_constant_dirty_begin;
+    uint32_t root_constant_dirty_end;
+};
+
+struct vkd3d_predicate
+{
+    /* Consumed by VK_EXT_conditional_rendering. */
+    VkBuffer vk_buffer;
+    VkDeviceSize offset;
+    VkConditionalRenderingFlagsEXT flags;
+    bool is_latched;
+
+    /* The resolved draw count, when VK_EXT_conditional_rendering is not available. */
+    VkBuffer vk_count_buffer;
+    VkDeviceSize count_offset;
+};
+
+/* Scratch memory for predicate values and for the arguments of emulated
+ * predicated commands. The buffers are owned by the command allocator. */
+struct vkd3d_predicate_buffer
+{
+    VkBuffer vk_buffer;
+    uint8_t *data;
+    VkDeviceSize offset;
+    VkDeviceSize size;
 };
 
 /* ID3D12CommandList */
@@ -933,6 +1436,9 @@ struct d3d12_command_list
     bool xfb_enabled;
 
     bool is_predicated;
+    struct vkd3d_predicate predicate;
+    struct vkd3d_predicate_buffer predicate_latches;
+    struct vkd3d_predicate_buffer predicate_args;
 
     VkFramebuffer current_framebuffer;
     VkPipeline current_pipeline;
@@ -948,6 +1454,11 @@ struct d3d12_command_list
     VkBuffer so_counter_buffers[D3D12_SO_BUFFER_SLOT_COUNT];
     VkDeviceSize so_counter_buffer_offsets[D3D12_SO_BUFFER_SLOT_COUNT];
 
+    /* Ids of the staging ring regions used by the recorded commands. */
+    uint64_t *staging_regions;
+    size_t staging_regions_size;
+    size_t staging_region_count;
+
     struct vkd3d_private_store private_store;
 };
 
@@ -988,6 +1499,94 @@ void vkd3d_queue_destroy(struct vkd3d_queue *queue, struct d3d12_device *device)
 void vkd3d_queue_release(struct vkd3d_queue *queue) DECLSPEC_HIDDEN;
 
 /* ID3D12CommandQueue */
+#define VKD3D_QUEUE_PROFILER_SLOT_COUNT 128
+
+struct vkd3d_queue_profiler_slot
+{
+    /* Writes the begin and the end timestamp of a batch. */
+    VkCommandBuffer vk_command_buffers[2];
+    VkFence vk_fence;
+
+    struct vkd3d_queue_timestamp timestamp;
+    bool ready;
+
+    /* The calibration in effect when the batch was submitted. */
+    uint64_t calibration_gpu_timestamp;
+    uint64_t calibration_cpu_timestamp;
+};
+
+/* Ring of timestamped ExecuteCommandLists() batches, enabled by
+ * VKD3D_CONFIG=queue_profiling. */
+struct vkd3d_queue_profiler
+{
+    pthread_mutex_t mutex;
+
+    unsigned int id;
+
+    VkCommandPool vk_command_pool;
+    VkQueryPool vk_query_pool;
+
+    struct vkd3d_queue_profiler_slot slots[VKD3D_QUEUE_PROFILER_SLOT_COUNT];
+    unsigned int first_slot;
+    unsigned int slot_count;
+
+    uint64_t submission_count;
+    uint64_t dropped_count;
+
+    uint64_t timestamp_mask;
+    double timestamp_period;
+
+    /* GPU and CPU clocks drift apart, so the calibration is refreshed
+     * periodically while batches are submitted. */
+    bool calibrated;
+    uint64_t calibration_gpu_timestamp;
+    uint64_t calibration_cpu_timestamp;
+};
+
+/* Chrome trace output for queue profiling, enabled by VKD3D_PROFILE_TRACE. */
+struct vkd3d_profile_trace
+{
+    pthread_mutex_t mutex;
+    FILE *file;
+    bool empty;
+};
+
+void vkd3d_profile_trace_init(struct vkd3d_profile_trace *trace, const struct vkd3d_instance *instance) DECLSPEC_HIDDEN;
+void vkd3d_profile_trace_cleanup(struct vkd3d_profile_trace *trace) DECLSPEC_HIDDEN;
+
+struct vkd3d_upload_fence
+{
+    struct d3d12_fence *fence;
+    uint64_t value;
+};
+
+/* Upload heap buffer handing out linear allocations. A block can be reused
+ * once all the fences it references reach their values. */
+struct vkd3d_upload_block
+{
+    struct list entry;
+
+    struct d3d12_resource *resource;
+    D3D12_GPU_VIRTUAL_ADDRESS gpu_address;
+    uint8_t *cpu_address;
+    uint64_t size;
+    uint64_t offset;
+
+    struct vkd3d_upload_fence *fences;
+    size_t fences_size;
+    size_t fence_count;
+};
+
+/* Transient upload memory handed out by vkd3d_allocate_upload_memory(). */
+struct vkd3d_upload_ring
+{
+    pthread_mutex_t mutex;
+
+    struct vkd3d_upload_block *current_block;
+    struct list pending_blocks;
+    struct list free_blocks;
+};
+
 struct d3d12_command_queue
 {
     ID3D12CommandQueue ID3D12CommandQueue_iface;
@@ -996,10 +1595,20 @@ struct d3d12_command_queue
     D3D12_COMMAND_QUEUE_DESC desc;
 
     struct vkd3d_queue *vkd3d_queue;
+    struct vkd3d_queue_profiler *profiler;
+    struct vkd3d_upload_ring upload_ring;
 
     const struct d3d12_fence *last_waited_fence;
     uint64_t last_waited_fence_value;
 
+    /* Sparse binding isn't implicitly ordered with other queue operations.
+     * Binds wait for an empty batch which signals the begin semaphore, and
+     * the next batch waits for the end semaphore. Only accessed while the
+     * Vulkan queue is acquired. */
+    VkSemaphore vk_sparse_begin_semaphore;
+    VkSemaphore vk_sparse_end_semaphore;
+    bool sparse_end_pending;
+
     struct d3d12_device *device;
 
     struct vkd3d_private_store private_store;
@@ -1066,10 +1675,19 @@ struct d3d12_device
     size_t wchar_size;
 
     struct vkd3d_gpu_va_allocator gpu_va_allocator;
+    struct vkd3d_memory_allocator memory_allocator;
+    struct vkd3d_residency_manager residency_manager;
+    struct vkd3d_object_pool resource_pool;
+    struct vkd3d_object_pool view_pool;
+    struct vkd3d_sampler_cache sampler_cache;
+    struct vkd3d_root_signature_cache root_signature_cache;
+    struct vkd3d_staging_ring staging_ring;
+    struct vkd3d_transfer_context transfer_context;
+    struct vkd3d_descriptor_heap_map descriptor_heap_map;
     struct vkd3d_fence_worker fence_worker;
+    struct vkd3d_profile_trace profile_trace;
 
     pthread_mutex_t mutex;
-    pthread_mutex_t desc_mutex[8];
     struct vkd3d_render_pass_cache render_pass_cache;
     VkPipelineCache vk_pipeline_cache;
 
@@ -1098,6 +1716,7 @@ struct d3d12_device
     unsigned int format_compatibility_list_count;
     const struct vkd3d_format_compatibility_list *format_compatibility_lists;
     struct vkd3d_null_resources null_resources;
+    struct vkd3d_predicate_ops predicate_ops;
 };
 
 HRESULT d3d12_device_create(struct vkd3d_instance *instance,
@@ -1129,17 +1748,83 @@ static inline unsigned int d3d12_device_get_descriptor_handle_increment_size(str
     return ID3D12Device_GetDescriptorHandleIncrementSize(&device->ID3D12Device_iface, descriptor_type);
 }
 
-static inline pthread_mutex_t *d3d12_device_get_descriptor_mutex(struct d3d12_device *device,
-        const struct d3d12_desc *descriptor)
+static inline uint64_t vkd3d_atomic_uint64_load(uint64_t *value)
 {
-    STATIC_ASSERT(!(ARRAY_SIZE(device->desc_mutex) & (ARRAY_SIZE(device->desc_mutex) - 1)));
-    uintptr_t idx = (uintptr_t)descriptor;
+#if HAVE_ATOMIC_LOAD_N
+    return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#else
+    return __sync_val_compare_and_swap(value, 0, 0);
+#endif
+}
+
+static inline void vkd3d_atomic_uint64_store(uint64_t *value, uint64_t new_value)
+{
+#if HAVE_ATOMIC_LOAD_N
+    __atomic_store_n(value, new_value, __ATOMIC_SEQ_CST);
+#else
+    uint64_t old_value;
 
-    idx ^= idx >> 12;
-    idx ^= idx >> 6;
-    idx ^= idx >> 3;
+    do
+    {
+        old_value = *value;
+    } while (__sync_val_compare_and_swap(value, old_value, new_value) != old_value);
+#endif
+}
+
+static inline size_t vkd3d_atomic_size_load(size_t *value)
+{
+#if HAVE_ATOMIC_LOAD_N
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#else
+    return __sync_val_compare_and_swap(value, 0, 0);
+#endif
+}
+
+static inline void vkd3d_atomic_size_store(size_t *value, size_t new_value)
+{
+#if HAVE_ATOMIC_LOAD_N
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#else
+    size_t old_value;
 
-    return &device->desc_mutex[idx & (ARRAY_SIZE(device->desc_mutex) - 1)];
+    do
+    {
+        old_value = *value;
+    } while (__sync_val_compare_and_swap(value, old_value, new_value) != old_value);
+#endif
+}
+
+/* Returns the previous value. */
+static inline unsigned int vkd3d_atomic_uint_clear_bits(unsigned int *value, unsigned int bits)
+{
+#if HAVE_ATOMIC_LOAD_N
+    return __atomic_fetch_and(value, ~bits, __ATOMIC_ACQ_REL);
+#else
+    return __sync_fetch_and_and(value, ~bits);
+#endif
+}
+
+static inline void *vkd3d_atomic_ptr_load(void **value)
+{
+#if HAVE_ATOMIC_LOAD_N
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+#else
+    return __sync_val_compare_and_swap(value, NULL, NULL);
+#endif
+}
+
+static inline void vkd3d_atomic_ptr_store(void **value, void *new_value)
+{
+#if HAVE_ATOMIC_LOAD_N
+    __atomic_store_n(value, new_value, __ATOMIC_RELEASE);
+#else
+    void *old_value;
+
+    do
+    {
+        old_value = *value;
+    } while (__sync_val_compare_and_swap(value, old_value, new_value) != old_value);
+#endif
 }
 
 /* utils */
@@ -1181,7 +1866,8 @@ static inline bool vkd3d_format_is_compressed(const struct vkd3d_format *format)
 
 void vkd3d_format_copy_data(const struct vkd3d_format *format, const uint8_t *src,
         unsigned int src_row_pitch, unsigned int src_slice_pitch, uint8_t *dst, unsigned int dst_row_pitch,
-        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d) DECLSPEC_HIDDEN;
+        unsigned int dst_slice_pitch, unsigned int w, unsigned int h, unsigned int d,
+        bool dst_is_mapped) DECLSPEC_HIDDEN;
 
 const struct vkd3d_format *vkd3d_get_format(const struct d3d12_device *device,
         DXGI_FORMAT dxgi_format, bool depth_stencil) DECLSPEC_HIDDEN;
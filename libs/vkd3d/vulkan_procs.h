@@ -49,12 +49,16 @@ VK_INSTANCE_PFN(vkGetPhysicalDeviceSparseImageFormatProperties)
 
 /* VK_KHR_get_physical_device_properties2 */
 VK_INSTANCE_EXT_PFN(vkGetPhysicalDeviceFeatures2KHR)
+VK_INSTANCE_EXT_PFN(vkGetPhysicalDeviceMemoryProperties2KHR)
 VK_INSTANCE_EXT_PFN(vkGetPhysicalDeviceProperties2KHR)
 
 /* VK_EXT_debug_report */
 VK_INSTANCE_EXT_PFN(vkCreateDebugReportCallbackEXT)
 VK_INSTANCE_EXT_PFN(vkDestroyDebugReportCallbackEXT)
 
+/* VK_EXT_calibrated_timestamps */
+VK_INSTANCE_EXT_PFN(vkGetPhysicalDeviceCalibrateableTimeDomainsEXT)
+
 /* Device functions (obtained by vkGetDeviceProcAddr). */
 VK_DEVICE_PFN(vkDestroyDevice) /* Load vkDestroyDevice() first. */
 VK_DEVICE_PFN(vkAllocateCommandBuffers)
@@ -192,6 +196,9 @@ VK_DEVICE_EXT_PFN(vkGetDescriptorSetLayoutSupportKHR)
 /* VK_KHR_push_descriptor */
 VK_DEVICE_EXT_PFN(vkCmdPushDescriptorSetKHR)
 
+/* VK_EXT_calibrated_timestamps */
+VK_DEVICE_EXT_PFN(vkGetCalibratedTimestampsEXT)
+
 /* VK_EXT_conditional_rendering */
 VK_DEVICE_EXT_PFN(vkCmdBeginConditionalRenderingEXT)
 VK_DEVICE_EXT_PFN(vkCmdEndConditionalRenderingEXT)
@@ -199,6 +206,9 @@ VK_DEVICE_EXT_PFN(vkCmdEndConditionalRenderingEXT)
 /* VK_EXT_debug_marker */
 VK_DEVICE_EXT_PFN(vkDebugMarkerSetObjectNameEXT)
 
+/* VK_EXT_pageable_device_local_memory */
+VK_DEVICE_EXT_PFN(vkSetDeviceMemoryPriorityEXT)
+
 /* VK_EXT_transform_feedback */
 VK_DEVICE_EXT_PFN(vkCmdBeginQueryIndexedEXT)
 VK_DEVICE_EXT_PFN(vkCmdBeginTransformFeedbackEXT)
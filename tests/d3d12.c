@@ -175,17 +175,6 @@ static void check_alignment_(unsigned int line, uint64_t size, uint64_t alignmen
             size, aligned_size);
 }
 
-static void uav_barrier(ID3D12GraphicsCommandList *list, ID3D12Resource *resource)
-{
-    D3D12_RESOURCE_BARRIER barrier;
-
-    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
-    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
-    barrier.UAV.pResource = resource;
-
-    ID3D12GraphicsCommandList_ResourceBarrier(list, 1, &barrier);
-}
-
 static void copy_sub_resource_data(const D3D12_MEMCPY_DEST *dst, const D3D12_SUBRESOURCE_DATA *src,
         unsigned int row_count, unsigned int slice_count, size_t row_size)
 {
@@ -2441,10 +2430,362 @@ done:
     ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
 }
 
+static void test_get_resource_tiling(void)
+{
+    D3D12_SUBRESOURCE_TILING tiling;
+    D3D12_PACKED_MIP_INFO packed_mip_info;
+    D3D12_RESOURCE_DESC resource_desc;
+    UINT tile_count, tiling_count;
+    D3D12_TILE_SHAPE tile_shape;
+    ID3D12Resource *resource;
+    ID3D12Device *device;
+    ULONG refcount;
+    HRESULT hr;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    if (get_tiled_resources_tier(device) == D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED)
+    {
+        skip("Tiled resources are not supported.\n");
+        goto done;
+    }
+
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    resource_desc.Alignment = 0;
+    resource_desc.Width = 2 * 65536 + 1;
+    resource_desc.Height = 1;
+    resource_desc.DepthOrArraySize = 1;
+    resource_desc.MipLevels = 1;
+    resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+    resource_desc.SampleDesc.Count = 1;
+    resource_desc.SampleDesc.Quality = 0;
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    resource_desc.Flags = 0;
+
+    hr = ID3D12Device_CreateReservedResource(device,
+            &resource_desc, D3D12_RESOURCE_STATE_COMMON, NULL,
+            &IID_ID3D12Resource, (void **)&resource);
+    ok(hr == S_OK, "Failed to create reserved resource, hr %#x.\n", hr);
+
+    tile_count = 0xdeadbeef;
+    tiling_count = 1;
+    memset(&packed_mip_info, 0xaa, sizeof(packed_mip_info));
+    memset(&tile_shape, 0xaa, sizeof(tile_shape));
+    memset(&tiling, 0xaa, sizeof(tiling));
+    ID3D12Device_GetResourceTiling(device, resource, &tile_count, &packed_mip_info,
+            &tile_shape, &tiling_count, 0, &tiling);
+    ok(tile_count == 3, "Got unexpected tile count %u.\n", tile_count);
+    ok(!packed_mip_info.NumStandardMips && !packed_mip_info.NumPackedMips,
+            "Got unexpected packed mip info %u, %u.\n",
+            packed_mip_info.NumStandardMips, packed_mip_info.NumPackedMips);
+    ok(tile_shape.WidthInTexels == 65536 && tile_shape.HeightInTexels == 1 && tile_shape.DepthInTexels == 1,
+            "Got unexpected tile shape %ux%ux%u.\n",
+            tile_shape.WidthInTexels, tile_shape.HeightInTexels, tile_shape.DepthInTexels);
+    ok(tiling_count == 1, "Got unexpected subresource tiling count %u.\n", tiling_count);
+    ok(tiling.WidthInTiles == 3 && tiling.HeightInTiles == 1 && tiling.DepthInTiles == 1,
+            "Got unexpected subresource tiling %ux%ux%u.\n",
+            tiling.WidthInTiles, tiling.HeightInTiles, tiling.DepthInTiles);
+    ok(!tiling.StartTileIndexInOverallResource, "Got unexpected start tile index %u.\n",
+            tiling.StartTileIndexInOverallResource);
+
+    refcount = ID3D12Resource_Release(resource);
+    ok(!refcount, "ID3D12Resource has %u references left.\n", (unsigned int)refcount);
+
+done:
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
+#define check_buffer_tile(a, b, c) check_buffer_tile_(__LINE__, a, b, c)
+static void check_buffer_tile_(unsigned int line, struct resource_readback *rb,
+        unsigned int tile_idx, unsigned int expected_tag)
+{
+    unsigned int tile_size = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES / sizeof(uint32_t);
+    unsigned int i, value = 0, expected = 0;
+
+    for (i = 0; i < tile_size; ++i)
+    {
+        value = get_readback_uint(rb, tile_idx * tile_size + i, 0, 0);
+        expected = expected_tag ? expected_tag << 16 | i : 0;
+        if (value != expected)
+            break;
+    }
+    ok_(line)(i == tile_size, "Got 0x%08x, expected 0x%08x at %u in tile %u.\n",
+            value, expected, i, tile_idx);
+}
+
+static void get_reserved_buffer_readback(ID3D12Resource *buffer, ID3D12Resource *readback_buffer,
+        struct resource_readback *rb, ID3D12CommandQueue *queue, ID3D12GraphicsCommandList *command_list)
+{
+    D3D12_RESOURCE_DESC resource_desc;
+
+    resource_desc = ID3D12Resource_GetDesc(buffer);
+    /* Reserved resources have no heap properties, so they are copied to
+     * the readback buffer explicitly. */
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, readback_buffer, 0,
+            buffer, 0, resource_desc.Width);
+    get_buffer_readback_with_command_list(readback_buffer, DXGI_FORMAT_R32_UINT, rb, queue, command_list);
+}
+
+static void test_update_tile_mappings(void)
+{
+    ID3D12Resource *resource, *aliased_resource, *upload_buffer, *tile_buffer, *readback_buffer, *texture;
+    UINT heap_range_offsets[3], range_tile_counts[3];
+    D3D12_TILED_RESOURCE_COORDINATE region_start;
+    ID3D12GraphicsCommandList *command_list;
+    D3D12_TILED_RESOURCES_TIER tier;
+    D3D12_RESOURCE_DESC resource_desc;
+    D3D12_TILE_RANGE_FLAGS range_flag;
+    D3D12_TILE_REGION_SIZE region_size;
+    struct test_context_desc desc;
+    struct test_context context;
+    struct resource_readback rb;
+    D3D12_HEAP_DESC heap_desc;
+    ID3D12CommandQueue *queue;
+    unsigned int i, tile_size;
+    ID3D12Device *device;
+    ID3D12Heap *heap, *texture_heap;
+    uint32_t *data;
+    HRESULT hr;
+
+    static const unsigned int tile_count = 4;
+
+    memset(&desc, 0, sizeof(desc));
+    desc.no_render_target = true;
+    if (!init_test_context(&context, &desc))
+        return;
+    device = context.device;
+    command_list = context.list;
+    queue = context.queue;
+
+    if ((tier = get_tiled_resources_tier(device)) == D3D12_TILED_RESOURCES_TIER_NOT_SUPPORTED)
+    {
+        skip("Tiled resources are not supported.\n");
+        destroy_test_context(&context);
+        return;
+    }
+
+    tile_size = D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES / sizeof(*data);
+
+    heap_desc.SizeInBytes = tile_count * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    memset(&heap_desc.Properties, 0, sizeof(heap_desc.Properties));
+    heap_desc.Properties.Type = D3D12_HEAP_TYPE_DEFAULT;
+    heap_desc.Alignment = 0;
+    heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS;
+    hr = ID3D12Device_CreateHeap(device, &heap_desc, &IID_ID3D12Heap, (void **)&heap);
+    ok(hr == S_OK, "Failed to create heap, hr %#x.\n", hr);
+
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_BUFFER;
+    resource_desc.Alignment = 0;
+    resource_desc.Width = tile_count * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES;
+    resource_desc.Height = 1;
+    resource_desc.DepthOrArraySize = 1;
+    resource_desc.MipLevels = 1;
+    resource_desc.Format = DXGI_FORMAT_UNKNOWN;
+    resource_desc.SampleDesc.Count = 1;
+    resource_desc.SampleDesc.Quality = 0;
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_ROW_MAJOR;
+    resource_desc.Flags = 0;
+    hr = ID3D12Device_CreateReservedResource(device, &resource_desc, D3D12_RESOURCE_STATE_COMMON,
+            NULL, &IID_ID3D12Resource, (void **)&resource);
+    ok(hr == S_OK, "Failed to create reserved resource, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateReservedResource(device, &resource_desc, D3D12_RESOURCE_STATE_COMMON,
+            NULL, &IID_ID3D12Resource, (void **)&aliased_resource);
+    ok(hr == S_OK, "Failed to create reserved resource, hr %#x.\n", hr);
+
+    /* Each 32-bit value holds the tag of its tile in the upper half and its
+     * index within the tile in the lower half. */
+    data = malloc(resource_desc.Width);
+    ok(!!data, "Failed to allocate memory.\n");
+    for (i = 0; i < tile_count * tile_size; ++i)
+        data[i] = (i / tile_size + 1) << 16 | i % tile_size;
+    upload_buffer = create_upload_buffer(device, resource_desc.Width, data);
+    free(data);
+
+    tile_buffer = create_default_buffer(device, 2 * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+    readback_buffer = create_readback_buffer(device, resource_desc.Width);
+
+    /* Map all tiles in order. */
+    memset(&region_start, 0, sizeof(region_start));
+    memset(&region_size, 0, sizeof(region_size));
+    region_size.NumTiles = tile_count;
+    heap_range_offsets[0] = 0;
+    range_tile_counts[0] = tile_count;
+    ID3D12CommandQueue_UpdateTileMappings(queue, resource, 1, &region_start, &region_size,
+            heap, 1, NULL, heap_range_offsets, range_tile_counts, D3D12_TILE_MAPPING_FLAG_NONE);
+
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, resource, 0,
+            upload_buffer, 0, resource_desc.Width);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(queue, command_list);
+    wait_queue_idle(device, queue);
+    reset_command_list(command_list, context.allocator);
+
+    get_reserved_buffer_readback(resource, readback_buffer, &rb, queue, command_list);
+    for (i = 0; i < tile_count; ++i)
+        check_buffer_tile(&rb, i, i + 1);
+    release_resource_readback(&rb);
+    reset_command_list(command_list, context.allocator);
+
+    /* Swap the heap tiles of the first and the third tile. */
+    region_size.NumTiles = 3;
+    heap_range_offsets[0] = 2;
+    heap_range_offsets[1] = 1;
+    heap_range_offsets[2] = 0;
+    range_tile_counts[0] = range_tile_counts[1] = range_tile_counts[2] = 1;
+    ID3D12CommandQueue_UpdateTileMappings(queue, resource, 1, &region_start, &region_size,
+            heap, 3, NULL, heap_range_offsets, range_tile_counts, D3D12_TILE_MAPPING_FLAG_NONE);
+
+    get_reserved_buffer_readback(resource, readback_buffer, &rb, queue, command_list);
+    check_buffer_tile(&rb, 0, 3);
+    check_buffer_tile(&rb, 1, 2);
+    check_buffer_tile(&rb, 2, 1);
+    check_buffer_tile(&rb, 3, 4);
+    release_resource_readback(&rb);
+    reset_command_list(command_list, context.allocator);
+
+    /* Writes to unmapped tiles are discarded, and the heap keeps its contents. */
+    region_start.X = 3;
+    region_size.NumTiles = 1;
+    range_flag = D3D12_TILE_RANGE_FLAG_NULL;
+    ID3D12CommandQueue_UpdateTileMappings(queue, resource, 1, &region_start, &region_size,
+            NULL, 1, &range_flag, NULL, NULL, D3D12_TILE_MAPPING_FLAG_NONE);
+
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, resource, 3 * D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES,
+            upload_buffer, 0, D3D12_TILED_RESOURCE_TILE_SIZE_IN_BYTES);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(queue, command_list);
+    wait_queue_idle(device, queue);
+    reset_command_list(command_list, context.allocator);
+
+    get_reserved_buffer_readback(resource, readback_buffer, &rb, queue, command_list);
+    check_buffer_tile(&rb, 0, 3);
+    /* Reads from unmapped tiles are undefined with tier 1. */
+    if (tier >= D3D12_TILED_RESOURCES_TIER_2)
+        check_buffer_tile(&rb, 3, 0);
+    release_resource_readback(&rb);
+    reset_command_list(command_list, context.allocator);
+
+    heap_range_offsets[0] = 3;
+    range_tile_counts[0] = 1;
+    ID3D12CommandQueue_UpdateTileMappings(queue, resource, 1, &region_start, &region_size,
+            heap, 1, NULL, heap_range_offsets, range_tile_counts, D3D12_TILE_MAPPING_FLAG_NONE);
+
+    get_reserved_buffer_readback(resource, readback_buffer, &rb, queue, command_list);
+    check_buffer_tile(&rb, 3, 4);
+    release_resource_readback(&rb);
+    reset_command_list(command_list, context.allocator);
+
+    /* Mappings copied to another resource alias the same heap tiles. */
+    region_start.X = 0;
+    region_size.NumTiles = tile_count;
+    ID3D12CommandQueue_CopyTileMappings(queue, aliased_resource, &region_start,
+            resource, &region_start, &region_size, D3D12_TILE_MAPPING_FLAG_NONE);
+
+    get_reserved_buffer_readback(aliased_resource, readback_buffer, &rb, queue, command_list);
+    check_buffer_tile(&rb, 0, 3);
+    check_buffer_tile(&rb, 1, 2);
+    check_buffer_tile(&rb, 2, 1);
+    check_buffer_tile(&rb, 3, 4);
+    release_resource_readback(&rb);
+    reset_command_list(command_list, context.allocator);
+
+    /* Copy tiles to a linear buffer and back. */
+    region_start.X = 1;
+    region_size.NumTiles = 2;
+    ID3D12GraphicsCommandList_CopyTiles(command_list, resource, &region_start, &region_size,
+            tile_buffer, 0, D3D12_TILE_COPY_FLAG_SWIZZLED_TILED_RESOURCE_TO_LINEAR_BUFFER);
+    transition_resource_state(command_list, tile_buffer,
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    get_buffer_readback_with_command_list(tile_buffer, DXGI_FORMAT_R32_UINT, &rb, queue, command_list);
+    check_buffer_tile(&rb, 0, 2);
+    check_buffer_tile(&rb, 1, 1);
+    release_resource_readback(&rb);
+    reset_command_list(command_list, context.allocator);
+
+    region_start.X = 3;
+    region_size.NumTiles = 1;
+    ID3D12GraphicsCommandList_CopyTiles(command_list, resource, &region_start, &region_size,
+            upload_buffer, 0, D3D12_TILE_COPY_FLAG_LINEAR_BUFFER_TO_SWIZZLED_TILED_RESOURCE);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(queue, command_list);
+    wait_queue_idle(device, queue);
+    reset_command_list(command_list, context.allocator);
+
+    get_reserved_buffer_readback(aliased_resource, readback_buffer, &rb, queue, command_list);
+    check_buffer_tile(&rb, 2, 1);
+    check_buffer_tile(&rb, 3, 1);
+    release_resource_readback(&rb);
+    reset_command_list(command_list, context.allocator);
+
+    /* Reserved textures. With 32-bit texels, a tile is 128x128 texels, so the
+     * texture is 2x2 tiles. */
+    heap_desc.Flags = D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES;
+    hr = ID3D12Device_CreateHeap(device, &heap_desc, &IID_ID3D12Heap, (void **)&texture_heap);
+    ok(hr == S_OK, "Failed to create heap, hr %#x.\n", hr);
+
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    resource_desc.Width = 256;
+    resource_desc.Height = 256;
+    resource_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_64KB_UNDEFINED_SWIZZLE;
+    hr = ID3D12Device_CreateReservedResource(device, &resource_desc, D3D12_RESOURCE_STATE_COPY_DEST,
+            NULL, &IID_ID3D12Resource, (void **)&texture);
+    ok(hr == S_OK, "Failed to create reserved texture, hr %#x.\n", hr);
+
+    region_start.X = 0;
+    region_size.NumTiles = tile_count;
+    heap_range_offsets[0] = 0;
+    range_tile_counts[0] = tile_count;
+    ID3D12CommandQueue_UpdateTileMappings(queue, texture, 1, &region_start, &region_size,
+            texture_heap, 1, NULL, heap_range_offsets, range_tile_counts, D3D12_TILE_MAPPING_FLAG_NONE);
+
+    ID3D12GraphicsCommandList_CopyTiles(command_list, texture, &region_start, &region_size,
+            upload_buffer, 0, D3D12_TILE_COPY_FLAG_LINEAR_BUFFER_TO_SWIZZLED_TILED_RESOURCE);
+    transition_resource_state(command_list, texture,
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    transition_resource_state(command_list, tile_buffer,
+            D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_COPY_DEST);
+
+    /* Tiles are copied in row-major order within the region. */
+    region_start.X = 1;
+    region_size.NumTiles = 2;
+    ID3D12GraphicsCommandList_CopyTiles(command_list, texture, &region_start, &region_size,
+            tile_buffer, 0, D3D12_TILE_COPY_FLAG_SWIZZLED_TILED_RESOURCE_TO_LINEAR_BUFFER);
+    transition_resource_state(command_list, tile_buffer,
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    get_buffer_readback_with_command_list(tile_buffer, DXGI_FORMAT_R32_UINT, &rb, queue, command_list);
+    check_buffer_tile(&rb, 0, 2);
+    check_buffer_tile(&rb, 1, 3);
+    release_resource_readback(&rb);
+
+    ID3D12Resource_Release(texture);
+    ID3D12Heap_Release(texture_heap);
+    ID3D12Resource_Release(readback_buffer);
+    ID3D12Resource_Release(tile_buffer);
+    ID3D12Resource_Release(upload_buffer);
+    ID3D12Resource_Release(aliased_resource);
+    ID3D12Resource_Release(resource);
+    ID3D12Heap_Release(heap);
+    destroy_test_context(&context);
+}
+
 static void test_create_descriptor_heap(void)
 {
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle, dst_handle;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
     D3D12_DESCRIPTOR_HEAP_DESC heap_desc;
     ID3D12Device *device, *tmp_device;
+    unsigned int descriptor_size;
+    double start_time, end_time;
     ID3D12DescriptorHeap *heap;
     ULONG refcount;
     HRESULT hr;
@@ -2486,6 +2827,32 @@ static void test_create_descriptor_heap(void)
     refcount = ID3D12DescriptorHeap_Release(heap);
     ok(!refcount, "ID3D12DescriptorHeap has %u references left.\n", (unsigned int)refcount);
 
+    /* Large, sparsely used heap. Creation and destruction should not depend
+     * on the heap size. */
+    heap_desc.NumDescriptors = 1000000;
+    start_time = get_time_ms();
+    hr = ID3D12Device_CreateDescriptorHeap(device, &heap_desc, &IID_ID3D12DescriptorHeap, (void **)&heap);
+    ok(hr == S_OK, "Failed to create descriptor heap, hr %#x.\n", hr);
+    descriptor_size = ID3D12Device_GetDescriptorHandleIncrementSize(device, heap_desc.Type);
+    memset(&srv_desc, 0, sizeof(srv_desc));
+    srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Texture2D.MipLevels = 1;
+    cpu_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    ID3D12Device_CreateShaderResourceView(device, NULL, &srv_desc, cpu_handle);
+    cpu_handle.ptr += (heap_desc.NumDescriptors - 1) * descriptor_size;
+    ID3D12Device_CreateShaderResourceView(device, NULL, &srv_desc, cpu_handle);
+    dst_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    dst_handle.ptr += (heap_desc.NumDescriptors / 2) * descriptor_size;
+    ID3D12Device_CopyDescriptorsSimple(device, 1, dst_handle, cpu_handle, heap_desc.Type);
+    refcount = ID3D12DescriptorHeap_Release(heap);
+    ok(!refcount, "ID3D12DescriptorHeap has %u references left.\n", (unsigned int)refcount);
+    end_time = get_time_ms();
+    trace("Created, used and destroyed a %u descriptor heap in %.3f ms.\n",
+            heap_desc.NumDescriptors, end_time - start_time);
+    heap_desc.NumDescriptors = 16;
+
     heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER;
     heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
     hr = ID3D12Device_CreateDescriptorHeap(device, &heap_desc, &IID_ID3D12DescriptorHeap, (void **)&heap);
@@ -3531,6 +3898,229 @@ static void test_multithread_private_data(void)
     ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
 }
 
+struct map_thread_data
+{
+    ID3D12Resource *resource;
+    unsigned int index;
+};
+
+static void map_thread_main(void *untyped_data)
+{
+    struct map_thread_data *data = untyped_data;
+    uint32_t *ptr;
+    unsigned int i;
+    HRESULT hr;
+
+    for (i = 0; i < 100000; ++i)
+    {
+        hr = ID3D12Resource_Map(data->resource, 0, NULL, (void **)&ptr);
+        ok(hr == S_OK, "Failed to map resource, hr %#x.\n", hr);
+        ptr[data->index] = i;
+        ID3D12Resource_Unmap(data->resource, 0, NULL);
+    }
+}
+
+static void test_multithread_map(void)
+{
+    struct map_thread_data thread_data[4];
+    ID3D12Resource *resource;
+    ID3D12Device *device;
+    HANDLE threads[4];
+    uint32_t *ptr;
+    unsigned int i;
+    ULONG refcount;
+    HRESULT hr;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    resource = create_upload_buffer(device, ARRAY_SIZE(threads) * sizeof(*ptr), NULL);
+
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        thread_data[i].resource = resource;
+        thread_data[i].index = i;
+        threads[i] = create_thread(map_thread_main, &thread_data[i]);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+        ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+
+    hr = ID3D12Resource_Map(resource, 0, NULL, (void **)&ptr);
+    ok(hr == S_OK, "Failed to map resource, hr %#x.\n", hr);
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+        ok(ptr[i] == 99999, "Got unexpected value %u for thread %u.\n", ptr[i], i);
+    ID3D12Resource_Unmap(resource, 0, NULL);
+
+    ID3D12Resource_Release(resource);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
+struct descriptor_thread_data
+{
+    ID3D12Device *device;
+    ID3D12Resource *resources[2];
+    D3D12_CPU_DESCRIPTOR_HANDLE src_handle;
+    D3D12_CPU_DESCRIPTOR_HANDLE dst_handle;
+    bool copy;
+};
+
+static void descriptor_thread_main(void *untyped_data)
+{
+    struct descriptor_thread_data *data = untyped_data;
+    unsigned int i;
+
+    for (i = 0; i < 100000; ++i)
+    {
+        if (data->copy)
+            ID3D12Device_CopyDescriptorsSimple(data->device, 1, data->dst_handle, data->src_handle,
+                    D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+        else
+            ID3D12Device_CreateShaderResourceView(data->device, data->resources[i & 1], NULL, data->src_handle);
+    }
+}
+
+static void test_multithread_descriptor_copies(void)
+{
+    struct descriptor_thread_data thread_data[4];
+    ID3D12DescriptorHeap *heap;
+    ID3D12Resource *textures[2];
+    unsigned int i, size;
+    ID3D12Device *device;
+    HANDLE threads[4];
+    ULONG refcount;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    heap = create_cpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, ARRAY_SIZE(threads) + 1);
+    size = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    for (i = 0; i < ARRAY_SIZE(textures); ++i)
+        textures[i] = create_default_texture(device, 4, 4, DXGI_FORMAT_R8G8B8A8_UNORM,
+                0, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+
+    /* Rewrite a descriptor in one thread while copying it in the others. */
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        thread_data[i].device = device;
+        thread_data[i].resources[0] = textures[0];
+        thread_data[i].resources[1] = textures[1];
+        thread_data[i].src_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+        thread_data[i].dst_handle = thread_data[i].src_handle;
+        thread_data[i].dst_handle.ptr += (i + 1) * size;
+        thread_data[i].copy = !!i;
+        threads[i] = create_thread(descriptor_thread_main, &thread_data[i]);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+        ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+
+    ID3D12DescriptorHeap_Release(heap);
+    for (i = 0; i < ARRAY_SIZE(textures); ++i)
+        ID3D12Resource_Release(textures[i]);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
+struct recording_thread_data
+{
+    ID3D12Device *device;
+    ID3D12Resource *buffers[4];
+    bool create;
+};
+
+static void recording_thread_main(void *untyped_data)
+{
+    struct recording_thread_data *data = untyped_data;
+    ID3D12CommandAllocator *allocator;
+    ID3D12GraphicsCommandList *list;
+    D3D12_VERTEX_BUFFER_VIEW vbv;
+    ID3D12Resource *buffer;
+    unsigned int i;
+    HRESULT hr;
+
+    if (data->create)
+    {
+        /* Keep the allocator's writers busy while the other threads look
+         * up addresses. */
+        for (i = 0; i < 1000; ++i)
+        {
+            buffer = create_upload_buffer(data->device, 0x1000, NULL);
+            ID3D12Resource_Release(buffer);
+        }
+        return;
+    }
+
+    hr = ID3D12Device_CreateCommandAllocator(data->device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&allocator);
+    ok(hr == S_OK, "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(data->device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+
+    vbv.SizeInBytes = 0x1000;
+    vbv.StrideInBytes = 16;
+    for (i = 0; i < 100000; ++i)
+    {
+        vbv.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(data->buffers[i % ARRAY_SIZE(data->buffers)]);
+        ID3D12GraphicsCommandList_IASetVertexBuffers(list, 0, 1, &vbv);
+    }
+
+    hr = ID3D12GraphicsCommandList_Close(list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    ID3D12GraphicsCommandList_Release(list);
+    ID3D12CommandAllocator_Release(allocator);
+}
+
+static void test_multithread_recording(void)
+{
+    struct recording_thread_data thread_data[4];
+    double start_time, elapsed_time;
+    ID3D12Resource *buffers[4];
+    ID3D12Device *device;
+    HANDLE threads[4];
+    unsigned int i, j;
+    ULONG refcount;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+        buffers[i] = create_upload_buffer(device, 0x1000, NULL);
+
+    /* Every vertex buffer binding looks up its GPU virtual address. */
+    start_time = get_time_ms();
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+    {
+        thread_data[i].device = device;
+        for (j = 0; j < ARRAY_SIZE(buffers); ++j)
+            thread_data[i].buffers[j] = buffers[j];
+        thread_data[i].create = !i;
+        threads[i] = create_thread(recording_thread_main, &thread_data[i]);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(threads); ++i)
+        ok(join_thread(threads[i]), "Failed to join thread %u.\n", i);
+    elapsed_time = get_time_ms() - start_time;
+    trace("Recorded %u vertex buffer bindings on %u threads in %.3f ms.\n",
+            (unsigned int)(100000 * (ARRAY_SIZE(threads) - 1)), (unsigned int)ARRAY_SIZE(threads) - 1, elapsed_time);
+
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+        ID3D12Resource_Release(buffers[i]);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
 static void test_reset_command_allocator(void)
 {
     ID3D12CommandAllocator *command_allocator, *command_allocator2;
@@ -3900,6 +4490,26 @@ static void test_cpu_signal_fence(void)
     ret = wait_event(event2, 0);
     ok(ret == WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
 
+    /* Attach an event to many values in non-monotonic order. */
+    hr = ID3D12Fence_Signal(fence, 0);
+    ok(SUCCEEDED(hr), "Failed to signal fence, hr %#x.\n", hr);
+    for (i = 0; i < 64; ++i)
+    {
+        hr = ID3D12Fence_SetEventOnCompletion(fence, (i * 37) % 64 + 1, event1);
+        ok(SUCCEEDED(hr), "Failed to set event on completion, hr %#x.\n", hr);
+    }
+    ret = wait_event(event1, 0);
+    ok(ret == WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
+    for (i = 1; i <= 64; ++i)
+    {
+        hr = ID3D12Fence_Signal(fence, i);
+        ok(SUCCEEDED(hr), "Failed to signal fence, hr %#x.\n", hr);
+        ret = wait_event(event1, 0);
+        ok(ret == WAIT_OBJECT_0, "Got unexpected return value %#x for %u.\n", ret, i);
+        ret = wait_event(event1, 0);
+        ok(ret == WAIT_TIMEOUT, "Got unexpected return value %#x for %u.\n", ret, i);
+    }
+
     /* Test passing signaled event. */
     hr = ID3D12Fence_Signal(fence, 20);
     ok(SUCCEEDED(hr), "Failed to signal fence, hr %#x.\n", hr);
@@ -4268,6 +4878,63 @@ static void test_multithread_fence_wait(void)
     ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
 }
 
+static void test_fence_event_throughput(void)
+{
+    double start_time, register_time, signal_time;
+    ID3D12Device *device;
+    unsigned int i, ret;
+    ID3D12Fence *fence;
+    HANDLE events[4];
+    ULONG refcount;
+    HRESULT hr;
+
+    static const unsigned int event_count = 4096;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE,
+            &IID_ID3D12Fence, (void **)&fence);
+    ok(hr == S_OK, "Failed to create fence, hr %#x.\n", hr);
+    for (i = 0; i < ARRAY_SIZE(events); ++i)
+    {
+        events[i] = create_event();
+        ok(events[i], "Failed to create event.\n");
+    }
+
+    /* Register the values out of order. */
+    start_time = get_time_ms();
+    for (i = 0; i < event_count; ++i)
+    {
+        hr = ID3D12Fence_SetEventOnCompletion(fence, (i * 769) % event_count + 1, events[i % ARRAY_SIZE(events)]);
+        ok(hr == S_OK, "Failed to set event on completion, hr %#x.\n", hr);
+    }
+    register_time = get_time_ms() - start_time;
+
+    start_time = get_time_ms();
+    for (i = 1; i <= event_count; ++i)
+    {
+        hr = ID3D12Fence_Signal(fence, i);
+        ok(hr == S_OK, "Failed to signal fence, hr %#x.\n", hr);
+    }
+    signal_time = get_time_ms() - start_time;
+
+    trace("%u events: registered in %.3f ms, signaled in %.3f ms.\n", event_count, register_time, signal_time);
+
+    for (i = 0; i < ARRAY_SIZE(events); ++i)
+    {
+        ret = wait_event(events[i], 0);
+        ok(ret == WAIT_OBJECT_0, "Got unexpected return value %#x for event %u.\n", ret, i);
+        destroy_event(events[i]);
+    }
+    ID3D12Fence_Release(fence);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
 static void test_fence_values(void)
 {
     uint64_t value, next_value;
@@ -6815,6 +7482,48 @@ static void test_map_resource(void)
     ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
 }
 
+static void test_map_unmap_throughput(void)
+{
+    double start_time, elapsed_time;
+    ID3D12Resource *resources[2];
+    ID3D12Device *device;
+    unsigned int i, j;
+    ULONG refcount;
+    uint32_t *ptr;
+    HRESULT hr;
+
+    static const char *names[] = {"upload", "readback"};
+    static const unsigned int iteration_count = 1000000;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    resources[0] = create_upload_buffer(device, 0x1000, NULL);
+    resources[1] = create_readback_buffer(device, 0x1000);
+
+    for (i = 0; i < ARRAY_SIZE(resources); ++i)
+    {
+        start_time = get_time_ms();
+        for (j = 0; j < iteration_count; ++j)
+        {
+            hr = ID3D12Resource_Map(resources[i], 0, NULL, (void **)&ptr);
+            ok(hr == S_OK, "Failed to map %s buffer, hr %#x.\n", names[i], hr);
+            ID3D12Resource_Unmap(resources[i], 0, NULL);
+        }
+        elapsed_time = get_time_ms() - start_time;
+        trace("%s buffer: %.3f ns per Map() and Unmap() pair.\n",
+                names[i], elapsed_time * 1000000.0 / iteration_count);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(resources); ++i)
+        ID3D12Resource_Release(resources[i]);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
 static void test_map_placed_resources(void)
 {
     D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
@@ -12110,6 +12819,31 @@ static void test_root_constants(void)
 
     reset_command_list(command_list, context.allocator);
 
+    /* Only the last value written to each constant before a draw is used. */
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+    ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstants(command_list, 0,
+            ARRAY_SIZE(constants), constants, 0);
+    ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstant(command_list, 0, 3, 0);
+    ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstants(command_list, 0, 2, &constants[2], 1);
+    ID3D12GraphicsCommandList_SetGraphicsRoot32BitConstant(command_list, 0, 4, 2);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &context.viewport);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    expected_result = (struct vec4){3.0f, 0.0f, 4.0f, 2.0f};
+    check_sub_resource_vec4(context.render_target, 0, queue, command_list, &expected_result, 0);
+
+    reset_command_list(command_list, context.allocator);
+
     ID3D12PipelineState_Release(context.pipeline_state);
     ID3D12RootSignature_Release(context.root_signature);
 
@@ -17141,8 +17875,10 @@ static void test_copy_descriptors(void)
 
 static void test_copy_descriptors_range_sizes(void)
 {
+    D3D12_CPU_DESCRIPTOR_HANDLE dst_multi_handles[2], src_multi_handles[3];
     D3D12_CPU_DESCRIPTOR_HANDLE dst_handles[1], src_handles[1];
     D3D12_CPU_DESCRIPTOR_HANDLE green_handle, blue_handle;
+    UINT dst_multi_range_sizes[2], src_multi_range_sizes[3];
     ID3D12Resource *green_texture, *blue_texture;
     UINT dst_range_sizes[1], src_range_sizes[1];
     ID3D12GraphicsCommandList *command_list;
@@ -17296,6 +18032,64 @@ static void test_copy_descriptors_range_sizes(void)
     }
     release_resource_readback(&rb);
 
+    /* Source and destination ranges split at different offsets. */
+    for (i = 0; i < desc.rt_width; ++i)
+    {
+        ID3D12Device_CopyDescriptorsSimple(device, 1, get_cpu_descriptor_handle(&context, cpu_heap, 2 + i),
+                i % 2 ? green_handle : blue_handle, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    }
+
+    dst_multi_handles[0] = get_cpu_descriptor_handle(&context, heap, 0);
+    dst_multi_handles[1] = get_cpu_descriptor_handle(&context, heap, 4);
+    dst_multi_range_sizes[0] = 4;
+    dst_multi_range_sizes[1] = 2;
+    src_multi_handles[0] = get_cpu_descriptor_handle(&context, cpu_heap, 2);
+    src_multi_handles[1] = get_cpu_descriptor_handle(&context, cpu_heap, 3);
+    src_multi_handles[2] = get_cpu_descriptor_handle(&context, cpu_heap, 6);
+    src_multi_range_sizes[0] = 1;
+    src_multi_range_sizes[1] = 3;
+    src_multi_range_sizes[2] = 2;
+    ID3D12Device_CopyDescriptors(device, ARRAY_SIZE(dst_multi_handles), dst_multi_handles, dst_multi_range_sizes,
+            ARRAY_SIZE(src_multi_handles), src_multi_handles, src_multi_range_sizes,
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    /* Copying the same descriptors again must not change anything. */
+    ID3D12Device_CopyDescriptors(device, ARRAY_SIZE(dst_multi_handles), dst_multi_handles, dst_multi_range_sizes,
+            ARRAY_SIZE(src_multi_handles), src_multi_handles, src_multi_range_sizes,
+            D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+
+    reset_command_list(command_list, context.allocator);
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_SetDescriptorHeaps(command_list, 1, &heap);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+
+    for (i = 0; i < desc.rt_width; ++i)
+    {
+        ID3D12GraphicsCommandList_SetGraphicsRootDescriptorTable(command_list, 0,
+                get_gpu_descriptor_handle(&context, heap, i));
+        set_viewport(&context.viewport, i, 0.0f, 1.0f, desc.rt_height, 0.0f, 1.0f);
+        ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &context.viewport);
+        ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    }
+
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    get_texture_readback_with_command_list(context.render_target, 0, &rb, queue, command_list);
+    for (i = 0; i < desc.rt_width; ++i)
+    {
+        set_box(&box, i, 0, 0, i + 1, desc.rt_height, 1);
+        check_readback_data_uint(&rb, &box, i % 2 ? 0xff00ff00 : 0xffff0000, 0);
+    }
+    release_resource_readback(&rb);
+
     ID3D12DescriptorHeap_Release(cpu_heap);
     ID3D12DescriptorHeap_Release(heap);
     ID3D12Resource_Release(blue_texture);
@@ -17303,6 +18097,518 @@ static void test_copy_descriptors_range_sizes(void)
     destroy_test_context(&context);
 }
 
+static void test_copy_descriptors_throughput(void)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE src_handle, dst_handle, handle;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
+    D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc;
+    D3D12_DESCRIPTOR_HEAP_DESC heap_desc;
+    ID3D12DescriptorHeap *cpu_heap, *heap;
+    unsigned int descriptor_size, i, j;
+    double start_time, elapsed_time;
+    ID3D12Resource *buffers[2];
+    ID3D12Device *device;
+    ULONG refcount;
+    HRESULT hr;
+
+    static const unsigned int descriptor_count = 4096;
+    static const unsigned int iteration_count = 256;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+        buffers[i] = create_default_buffer(device, 0x10000,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    /* Two source ranges with different contents, so that consecutive copies
+     * always replace the destination descriptors. */
+    heap_desc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
+    heap_desc.NumDescriptors = 2 * descriptor_count;
+    heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heap_desc.NodeMask = 0;
+    hr = ID3D12Device_CreateDescriptorHeap(device, &heap_desc, &IID_ID3D12DescriptorHeap, (void **)&cpu_heap);
+    ok(hr == S_OK, "Failed to create descriptor heap, hr %#x.\n", hr);
+    heap_desc.NumDescriptors = descriptor_count;
+    heap_desc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
+    hr = ID3D12Device_CreateDescriptorHeap(device, &heap_desc, &IID_ID3D12DescriptorHeap, (void **)&heap);
+    ok(hr == S_OK, "Failed to create descriptor heap, hr %#x.\n", hr);
+    descriptor_size = ID3D12Device_GetDescriptorHandleIncrementSize(device, heap_desc.Type);
+
+    memset(&srv_desc, 0, sizeof(srv_desc));
+    srv_desc.Format = DXGI_FORMAT_R32_UINT;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Buffer.NumElements = 0x10000 / sizeof(uint32_t);
+    handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cpu_heap);
+    for (i = 0; i < 2 * descriptor_count; ++i)
+    {
+        /* A table mixing SRVs and CBVs. */
+        if (i % 4)
+        {
+            srv_desc.Buffer.FirstElement = i % 16;
+            ID3D12Device_CreateShaderResourceView(device, buffers[i / descriptor_count], &srv_desc, handle);
+        }
+        else
+        {
+            cbv_desc.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(buffers[i / descriptor_count]);
+            cbv_desc.SizeInBytes = 256;
+            ID3D12Device_CreateConstantBufferView(device, &cbv_desc, handle);
+        }
+        handle.ptr += descriptor_size;
+    }
+
+    dst_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    start_time = get_time_ms();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        src_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cpu_heap);
+        src_handle.ptr += (i % 2) * descriptor_count * descriptor_size;
+        ID3D12Device_CopyDescriptorsSimple(device, descriptor_count, dst_handle, src_handle, heap_desc.Type);
+    }
+    elapsed_time = get_time_ms() - start_time;
+    trace("Copied %u descriptors in %.3f ms, %.1f million descriptors/s.\n",
+            descriptor_count * iteration_count, elapsed_time,
+            elapsed_time ? descriptor_count * iteration_count / (elapsed_time * 1000.0) : 0.0);
+
+    /* The same copy through CopyDescriptors(), one descriptor per range. */
+    start_time = get_time_ms();
+    for (i = 0; i < iteration_count / 16; ++i)
+    {
+        src_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(cpu_heap);
+        src_handle.ptr += (i % 2) * descriptor_count * descriptor_size;
+        handle = dst_handle;
+        for (j = 0; j < descriptor_count; ++j)
+        {
+            ID3D12Device_CopyDescriptors(device, 1, &handle, NULL, 1, &src_handle, NULL, heap_desc.Type);
+            handle.ptr += descriptor_size;
+            src_handle.ptr += descriptor_size;
+        }
+    }
+    elapsed_time = get_time_ms() - start_time;
+    trace("Copied %u single descriptors in %.3f ms, %.1f million descriptors/s.\n",
+            descriptor_count * (iteration_count / 16), elapsed_time,
+            elapsed_time ? descriptor_count * (iteration_count / 16) / (elapsed_time * 1000.0) : 0.0);
+
+    ID3D12DescriptorHeap_Release(cpu_heap);
+    ID3D12DescriptorHeap_Release(heap);
+    for (i = 0; i < ARRAY_SIZE(buffers); ++i)
+        ID3D12Resource_Release(buffers[i]);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
+static void test_descriptor_table_update_throughput(void)
+{
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
+    D3D12_GPU_DESCRIPTOR_HANDLE gpu_handle;
+    D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
+    D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc;
+    D3D12_DESCRIPTOR_RANGE descriptor_ranges[2];
+    ID3D12GraphicsCommandList *command_list;
+    D3D12_ROOT_PARAMETER root_parameter;
+    unsigned int descriptor_size, i, j;
+    double start_time, elapsed_time;
+    ID3D12PipelineState *pipeline_state;
+    ID3D12RootSignature *root_signature;
+    struct test_context context;
+    ID3D12DescriptorHeap *heap;
+    ID3D12Resource *buffer;
+    ID3D12Device *device;
+    HRESULT hr;
+
+    static const DWORD cs_code[] =
+    {
+#if 0
+        [numthreads(1, 1, 1)]
+        void main() { }
+#endif
+        0x43425844, 0x1acc3ad0, 0x71c7b057, 0xc72c4306, 0xf432cb57, 0x00000001, 0x00000074, 0x00000003,
+        0x0000002c, 0x0000003c, 0x0000004c, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x00000008, 0x00000000, 0x00000008, 0x58454853, 0x00000020, 0x00050050, 0x00000008, 0x0100086a,
+        0x0400009b, 0x00000001, 0x00000001, 0x00000001, 0x0100003e,
+    };
+    static const unsigned int srv_count = 128, cbv_count = 64;
+    static const unsigned int heap_size = 65536;
+    static const unsigned int round_count = 4;
+
+    if (!init_compute_test_context(&context))
+        return;
+    device = context.device;
+    command_list = context.list;
+
+    descriptor_ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    descriptor_ranges[0].NumDescriptors = srv_count;
+    descriptor_ranges[0].BaseShaderRegister = 0;
+    descriptor_ranges[0].RegisterSpace = 0;
+    descriptor_ranges[0].OffsetInDescriptorsFromTableStart = 0;
+    descriptor_ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+    descriptor_ranges[1].NumDescriptors = cbv_count;
+    descriptor_ranges[1].BaseShaderRegister = 0;
+    descriptor_ranges[1].RegisterSpace = 0;
+    descriptor_ranges[1].OffsetInDescriptorsFromTableStart = srv_count;
+    root_parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    root_parameter.DescriptorTable.NumDescriptorRanges = ARRAY_SIZE(descriptor_ranges);
+    root_parameter.DescriptorTable.pDescriptorRanges = descriptor_ranges;
+    root_parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    memset(&root_signature_desc, 0, sizeof(root_signature_desc));
+    root_signature_desc.NumParameters = 1;
+    root_signature_desc.pParameters = &root_parameter;
+    hr = create_root_signature(device, &root_signature_desc, &root_signature);
+    ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+    pipeline_state = create_compute_pipeline_state(device, root_signature,
+            shader_bytecode(cs_code, sizeof(cs_code)));
+
+    buffer = create_default_buffer(device, 0x10000, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    /* A large, fully populated heap, walked one table at a time. */
+    heap = create_gpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, heap_size);
+    descriptor_size = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    memset(&srv_desc, 0, sizeof(srv_desc));
+    srv_desc.Format = DXGI_FORMAT_R32_UINT;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Buffer.NumElements = 64;
+    cbv_desc.SizeInBytes = 256;
+    cpu_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    for (i = 0; i < heap_size; ++i)
+    {
+        if (i % (srv_count + cbv_count) < srv_count)
+        {
+            srv_desc.Buffer.FirstElement = 64 * (i % 256);
+            ID3D12Device_CreateShaderResourceView(device, buffer, &srv_desc, cpu_handle);
+        }
+        else
+        {
+            cbv_desc.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(buffer) + 256 * (i % 256);
+            ID3D12Device_CreateConstantBufferView(device, &cbv_desc, cpu_handle);
+        }
+        cpu_handle.ptr += descriptor_size;
+    }
+
+    ID3D12GraphicsCommandList_SetDescriptorHeaps(command_list, 1, &heap);
+    ID3D12GraphicsCommandList_SetComputeRootSignature(command_list, root_signature);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, pipeline_state);
+
+    start_time = get_time_ms();
+    for (i = 0; i < round_count; ++i)
+    {
+        gpu_handle = ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(heap);
+        for (j = 0; j + srv_count + cbv_count <= heap_size; j += srv_count + cbv_count)
+        {
+            ID3D12GraphicsCommandList_SetComputeRootDescriptorTable(command_list, 0, gpu_handle);
+            ID3D12GraphicsCommandList_Dispatch(command_list, 1, 1, 1);
+            gpu_handle.ptr += (srv_count + cbv_count) * descriptor_size;
+        }
+    }
+    elapsed_time = get_time_ms() - start_time;
+    j = round_count * (heap_size / (srv_count + cbv_count));
+    trace("Updated %u descriptor tables of %u descriptors in %.3f ms, %.3f us per table.\n",
+            j, srv_count + cbv_count, elapsed_time, j ? elapsed_time * 1000.0 / j : 0.0);
+
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(context.queue, command_list);
+    wait_queue_idle(device, context.queue);
+
+    ID3D12DescriptorHeap_Release(heap);
+    ID3D12Resource_Release(buffer);
+    ID3D12PipelineState_Release(pipeline_state);
+    ID3D12RootSignature_Release(root_signature);
+    destroy_test_context(&context);
+}
+
+static void test_draw_descriptor_table_cpu_overhead(void)
+{
+    D3D12_GPU_DESCRIPTOR_HANDLE gpu_handles[2];
+    D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
+    D3D12_CONSTANT_BUFFER_VIEW_DESC cbv_desc;
+    D3D12_DESCRIPTOR_RANGE descriptor_ranges[3];
+    D3D12_ROOT_PARAMETER root_parameters[2];
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
+    ID3D12GraphicsCommandList *command_list;
+    struct test_context_desc desc;
+    double start_time, elapsed_time;
+    unsigned int descriptor_size, i;
+    struct test_context context;
+    ID3D12DescriptorHeap *heap;
+    ID3D12Resource *buffer;
+    ID3D12Device *device;
+    HRESULT hr;
+
+    static const unsigned int table_size = 16, table_count = 64;
+    static const unsigned int draw_count = 20000;
+
+    memset(&desc, 0, sizeof(desc));
+    desc.no_root_signature = true;
+    if (!init_test_context(&context, &desc))
+        return;
+    device = context.device;
+    command_list = context.list;
+
+    descriptor_ranges[0].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    descriptor_ranges[0].NumDescriptors = 8;
+    descriptor_ranges[0].BaseShaderRegister = 0;
+    descriptor_ranges[0].RegisterSpace = 0;
+    descriptor_ranges[0].OffsetInDescriptorsFromTableStart = 0;
+    descriptor_ranges[1].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_CBV;
+    descriptor_ranges[1].NumDescriptors = 4;
+    descriptor_ranges[1].BaseShaderRegister = 0;
+    descriptor_ranges[1].RegisterSpace = 0;
+    descriptor_ranges[1].OffsetInDescriptorsFromTableStart = 8;
+    descriptor_ranges[2].RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    descriptor_ranges[2].NumDescriptors = 4;
+    descriptor_ranges[2].BaseShaderRegister = 8;
+    descriptor_ranges[2].RegisterSpace = 0;
+    descriptor_ranges[2].OffsetInDescriptorsFromTableStart = 12;
+    root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    root_parameters[0].DescriptorTable.NumDescriptorRanges = 2;
+    root_parameters[0].DescriptorTable.pDescriptorRanges = &descriptor_ranges[0];
+    root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+    root_parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    root_parameters[1].DescriptorTable.NumDescriptorRanges = 1;
+    root_parameters[1].DescriptorTable.pDescriptorRanges = &descriptor_ranges[2];
+    root_parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    memset(&root_signature_desc, 0, sizeof(root_signature_desc));
+    root_signature_desc.NumParameters = ARRAY_SIZE(root_parameters);
+    root_signature_desc.pParameters = root_parameters;
+    hr = create_root_signature(device, &root_signature_desc, &context.root_signature);
+    ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+    context.pipeline_state = create_pipeline_state(device, context.root_signature,
+            context.render_target_desc.Format, NULL, NULL, NULL);
+
+    buffer = create_default_buffer(device, 0x10000, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    heap = create_gpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, table_size * table_count);
+    descriptor_size = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    memset(&srv_desc, 0, sizeof(srv_desc));
+    srv_desc.Format = DXGI_FORMAT_R32_UINT;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Buffer.NumElements = 64;
+    cbv_desc.SizeInBytes = 256;
+    cpu_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    for (i = 0; i < table_size * table_count; ++i)
+    {
+        if (i % table_size >= 8 && i % table_size < 12)
+        {
+            cbv_desc.BufferLocation = ID3D12Resource_GetGPUVirtualAddress(buffer) + 256 * (i % 256);
+            ID3D12Device_CreateConstantBufferView(device, &cbv_desc, cpu_handle);
+        }
+        else
+        {
+            srv_desc.Buffer.FirstElement = 64 * (i % 256);
+            ID3D12Device_CreateShaderResourceView(device, buffer, &srv_desc, cpu_handle);
+        }
+        cpu_handle.ptr += descriptor_size;
+    }
+
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetDescriptorHeaps(command_list, 1, &heap);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+    ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &context.viewport);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+
+    /* Rebind both tables before every draw, so that each draw goes through
+     * the descriptor update path. */
+    start_time = get_time_ms();
+    for (i = 0; i < draw_count; ++i)
+    {
+        gpu_handles[0] = ID3D12DescriptorHeap_GetGPUDescriptorHandleForHeapStart(heap);
+        gpu_handles[0].ptr += (i % table_count) * table_size * descriptor_size;
+        gpu_handles[1] = gpu_handles[0];
+        gpu_handles[1].ptr += 12 * descriptor_size;
+        ID3D12GraphicsCommandList_SetGraphicsRootDescriptorTable(command_list, 0, gpu_handles[0]);
+        ID3D12GraphicsCommandList_SetGraphicsRootDescriptorTable(command_list, 1, gpu_handles[1]);
+        ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    }
+    elapsed_time = get_time_ms() - start_time;
+    trace("Recorded %u draws in %.3f ms, %.3f us per draw.\n",
+            draw_count, elapsed_time, elapsed_time * 1000.0 / draw_count);
+
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(context.queue, command_list);
+    wait_queue_idle(device, context.queue);
+
+    ID3D12DescriptorHeap_Release(heap);
+    ID3D12Resource_Release(buffer);
+    destroy_test_context(&context);
+}
+
+static void test_static_descriptor_tables(void)
+{
+    D3D12_VERSIONED_ROOT_SIGNATURE_DESC root_signature_desc;
+    D3D12_CPU_DESCRIPTOR_HANDLE green_handle, blue_handle;
+    ID3D12Resource *green_texture, *blue_texture;
+    D3D12_STATIC_SAMPLER_DESC static_sampler;
+    ID3D12GraphicsCommandList *command_list;
+    D3D12_DESCRIPTOR_RANGE1 descriptor_range;
+    D3D12_ROOT_PARAMETER1 root_parameter;
+    ID3DBlob *blob, *error_blob;
+    struct test_context_desc desc;
+    D3D12_SUBRESOURCE_DATA data;
+    struct resource_readback rb;
+    struct test_context context;
+    ID3D12DescriptorHeap *heap;
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    unsigned int i;
+    D3D12_BOX box;
+    HRESULT hr;
+
+    static const DWORD ps_code[] =
+    {
+#if 0
+        Texture2D t;
+        SamplerState s;
+
+        float4 main(float4 position : SV_POSITION) : SV_Target
+        {
+            float2 p;
+
+            p.x = position.x / 32.0f;
+            p.y = position.y / 32.0f;
+            return t.Sample(s, p);
+        }
+#endif
+        0x43425844, 0x7a0c3929, 0x75ff3ca4, 0xccb318b2, 0xe6965b4c, 0x00000001, 0x00000140, 0x00000003,
+        0x0000002c, 0x00000060, 0x00000094, 0x4e475349, 0x0000002c, 0x00000001, 0x00000008, 0x00000020,
+        0x00000000, 0x00000001, 0x00000003, 0x00000000, 0x0000030f, 0x505f5653, 0x5449534f, 0x004e4f49,
+        0x4e47534f, 0x0000002c, 0x00000001, 0x00000008, 0x00000020, 0x00000000, 0x00000000, 0x00000003,
+        0x00000000, 0x0000000f, 0x545f5653, 0x65677261, 0xabab0074, 0x58454853, 0x000000a4, 0x00000050,
+        0x00000029, 0x0100086a, 0x0300005a, 0x00106000, 0x00000000, 0x04001858, 0x00107000, 0x00000000,
+        0x00005555, 0x04002064, 0x00101032, 0x00000000, 0x00000001, 0x03000065, 0x001020f2, 0x00000000,
+        0x02000068, 0x00000001, 0x0a000038, 0x00100032, 0x00000000, 0x00101046, 0x00000000, 0x00004002,
+        0x3d000000, 0x3d000000, 0x00000000, 0x00000000, 0x8b000045, 0x800000c2, 0x00155543, 0x001020f2,
+        0x00000000, 0x00100046, 0x00000000, 0x00107e46, 0x00000000, 0x00106000, 0x00000000, 0x0100003e,
+    };
+    static const D3D12_SHADER_BYTECODE ps = {ps_code, sizeof(ps_code)};
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    static const struct vec4 green = {0.0f, 1.0f, 0.0f, 1.0f};
+    static const struct vec4 blue = {0.0f, 0.0f, 1.0f, 1.0f};
+
+    if (!pfn_D3D12SerializeVersionedRootSignature)
+    {
+        skip("D3D12SerializeVersionedRootSignature is not available.\n");
+        return;
+    }
+
+    memset(&desc, 0, sizeof(desc));
+    desc.rt_width = 4;
+    desc.rt_height = 4;
+    desc.no_root_signature = true;
+    if (!init_test_context(&context, &desc))
+        return;
+    device = context.device;
+    command_list = context.list;
+    queue = context.queue;
+
+    memset(&static_sampler, 0, sizeof(static_sampler));
+    static_sampler.Filter = D3D12_FILTER_MIN_MAG_MIP_POINT;
+    static_sampler.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    static_sampler.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    static_sampler.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    static_sampler.MaxLOD = D3D12_FLOAT32_MAX;
+    static_sampler.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+    descriptor_range.RangeType = D3D12_DESCRIPTOR_RANGE_TYPE_SRV;
+    descriptor_range.NumDescriptors = 1;
+    descriptor_range.BaseShaderRegister = 0;
+    descriptor_range.RegisterSpace = 0;
+    descriptor_range.Flags = D3D12_DESCRIPTOR_RANGE_FLAG_DATA_STATIC;
+    descriptor_range.OffsetInDescriptorsFromTableStart = 0;
+    root_parameter.ParameterType = D3D12_ROOT_PARAMETER_TYPE_DESCRIPTOR_TABLE;
+    root_parameter.DescriptorTable.NumDescriptorRanges = 1;
+    root_parameter.DescriptorTable.pDescriptorRanges = &descriptor_range;
+    root_parameter.ShaderVisibility = D3D12_SHADER_VISIBILITY_PIXEL;
+
+    memset(&root_signature_desc, 0, sizeof(root_signature_desc));
+    root_signature_desc.Version = D3D_ROOT_SIGNATURE_VERSION_1_1;
+    root_signature_desc.Desc_1_1.NumParameters = 1;
+    root_signature_desc.Desc_1_1.pParameters = &root_parameter;
+    root_signature_desc.Desc_1_1.NumStaticSamplers = 1;
+    root_signature_desc.Desc_1_1.pStaticSamplers = &static_sampler;
+
+    hr = pfn_D3D12SerializeVersionedRootSignature(&root_signature_desc, &blob, &error_blob);
+    ok(hr == S_OK, "Failed to serialize root signature, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateRootSignature(device, 0, ID3D10Blob_GetBufferPointer(blob),
+            ID3D10Blob_GetBufferSize(blob), &IID_ID3D12RootSignature, (void **)&context.root_signature);
+    ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+    ID3D10Blob_Release(blob);
+
+    context.pipeline_state = create_pipeline_state(context.device,
+            context.root_signature, context.render_target_desc.Format, NULL, &ps, NULL);
+
+    heap = create_gpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, 2);
+    green_handle = get_cpu_descriptor_handle(&context, heap, 0);
+    blue_handle = get_cpu_descriptor_handle(&context, heap, 1);
+
+    green_texture = create_default_texture(context.device,
+            1, 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_RESOURCE_STATE_COPY_DEST);
+    data.pData = &green;
+    data.RowPitch = sizeof(green);
+    data.SlicePitch = data.RowPitch;
+    upload_texture_data(green_texture, &data, 1, queue, command_list);
+    reset_command_list(command_list, context.allocator);
+    transition_resource_state(command_list, green_texture,
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    ID3D12Device_CreateShaderResourceView(device, green_texture, NULL, green_handle);
+
+    blue_texture = create_default_texture(context.device,
+            1, 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, D3D12_RESOURCE_STATE_COPY_DEST);
+    data.pData = &blue;
+    data.RowPitch = sizeof(blue);
+    data.SlicePitch = data.RowPitch;
+    upload_texture_data(blue_texture, &data, 1, queue, command_list);
+    reset_command_list(command_list, context.allocator);
+    transition_resource_state(command_list, blue_texture,
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE);
+    ID3D12Device_CreateShaderResourceView(device, blue_texture, NULL, blue_handle);
+
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_SetDescriptorHeaps(command_list, 1, &heap);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+
+    /* Each table is set twice in a row. */
+    for (i = 0; i < desc.rt_width; ++i)
+    {
+        ID3D12GraphicsCommandList_SetGraphicsRootDescriptorTable(command_list, 0,
+                get_gpu_descriptor_handle(&context, heap, i / 2));
+        set_viewport(&context.viewport, i, 0.0f, 1.0f, desc.rt_height, 0.0f, 1.0f);
+        ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &context.viewport);
+        ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    }
+
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    get_texture_readback_with_command_list(context.render_target, 0, &rb, queue, command_list);
+    for (i = 0; i < desc.rt_width; ++i)
+    {
+        set_box(&box, i, 0, 0, i + 1, desc.rt_height, 1);
+        check_readback_data_uint(&rb, &box, i < 2 ? 0xff00ff00 : 0xffff0000, 0);
+    }
+    release_resource_readback(&rb);
+
+    ID3D12DescriptorHeap_Release(heap);
+    ID3D12Resource_Release(blue_texture);
+    ID3D12Resource_Release(green_texture);
+    destroy_test_context(&context);
+}
+
 static void test_descriptors_visibility(void)
 {
     ID3D12Resource *vs_raw_buffer, *ps_raw_buffer;
@@ -30678,7 +31984,6 @@ static void test_read_write_subresource(void)
     ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
 
     hr = ID3D12Resource_ReadFromSubresource(src_texture, dst_buffer, row_pitch, slice_pitch, 0, NULL);
-    todo_if(is_nvidia_device(device))
     ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
 
     /* Empty box */
@@ -30749,14 +32054,12 @@ static void test_read_write_subresource(void)
         /* Read region 1 */
         set_box(&box, 0, 0, 0, 2, 2, 2);
         hr = ID3D12Resource_ReadFromSubresource(src_texture, dst_buffer, row_pitch, slice_pitch, 0, &box);
-        todo_if(is_nvidia_device(device))
         ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
 
         /* Read region 2 */
         set_box(&box, 2, 2, 2, 11, 13, 17);
         hr = ID3D12Resource_ReadFromSubresource(src_texture, &dst_buffer[2 * 128 * 100 + 2 * 128 + 2], row_pitch,
                 slice_pitch, 0, &box);
-        todo_if(is_nvidia_device(device))
         ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
 
         for (z = 0; z < 64; ++z)
@@ -30782,7 +32085,6 @@ static void test_read_write_subresource(void)
             if (got != expected)
                 break;
         }
-        todo_if(is_nvidia_device(device))
         ok(got == expected, "Got unexpected value 0x%08x at (%u, %u, %u), expected 0x%08x.\n", got, x, y, z, expected);
     }
     vkd3d_test_set_context(NULL);
@@ -30889,6 +32191,200 @@ done:
     destroy_test_context(&context);
 }
 
+static void test_read_write_subresource_large(void)
+{
+    unsigned int row_pitch, slice_pitch, x, y, z;
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_RESOURCE_DESC resource_desc;
+    uint32_t *src_data, *dst_data;
+    uint32_t got, expected;
+    ID3D12Resource *texture;
+    ID3D12Device *device;
+    ULONG refcount;
+    D3D12_BOX box;
+    HRESULT hr;
+
+    /* Each slice is 2 MiB, which is larger than a staging slot of the
+     * transfer path used for optimally tiled textures. */
+    static const unsigned int width = 1024, height = 512, depth = 4;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE3D;
+    resource_desc.Alignment = 0;
+    resource_desc.Width = width;
+    resource_desc.Height = height;
+    resource_desc.DepthOrArraySize = depth;
+    resource_desc.MipLevels = 1;
+    resource_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    resource_desc.SampleDesc.Count = 1;
+    resource_desc.SampleDesc.Quality = 0;
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    resource_desc.Flags = 0;
+
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = D3D12_HEAP_TYPE_CUSTOM;
+    heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK;
+    heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
+    hr = ID3D12Device_CreateCommittedResource(device, &heap_properties, D3D12_HEAP_FLAG_NONE,
+            &resource_desc, D3D12_RESOURCE_STATE_COMMON, NULL, &IID_ID3D12Resource, (void **)&texture);
+    if (FAILED(hr))
+    {
+        skip("Failed to create texture on custom heap.\n");
+        ID3D12Device_Release(device);
+        return;
+    }
+
+    row_pitch = width * sizeof(*src_data);
+    slice_pitch = row_pitch * height;
+    src_data = malloc(slice_pitch * depth);
+    ok(src_data, "Failed to allocate memory.\n");
+    dst_data = calloc(1, slice_pitch * depth);
+    ok(dst_data, "Failed to allocate memory.\n");
+    for (z = 0; z < depth; ++z)
+    {
+        for (y = 0; y < height; ++y)
+        {
+            for (x = 0; x < width; ++x)
+                src_data[(z * height + y) * width + x] = z << 19 | y << 10 | x;
+        }
+    }
+
+    hr = ID3D12Resource_WriteToSubresource(texture, 0, NULL, src_data, row_pitch, slice_pitch);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    hr = ID3D12Resource_ReadFromSubresource(texture, dst_data, row_pitch, slice_pitch, 0, NULL);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    ok(!memcmp(src_data, dst_data, slice_pitch * depth), "Got unexpected data.\n");
+
+    /* A box which is not aligned to the chunks. */
+    memset(dst_data, 0, slice_pitch * depth);
+    set_box(&box, 3, 5, 1, width - 7, height - 3, depth);
+    hr = ID3D12Resource_ReadFromSubresource(texture, &dst_data[(box.front * height + box.top) * width + box.left],
+            row_pitch, slice_pitch, 0, &box);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    got = expected = 0;
+    for (z = 0; z < depth; ++z)
+    {
+        for (y = 0; y < height; ++y)
+        {
+            for (x = 0; x < width; ++x)
+            {
+                got = dst_data[(z * height + y) * width + x];
+                expected = 0;
+                if (x >= box.left && x < box.right && y >= box.top && y < box.bottom && z >= box.front)
+                    expected = src_data[(z * height + y) * width + x];
+                if (got != expected)
+                    break;
+            }
+            if (got != expected)
+                break;
+        }
+        if (got != expected)
+            break;
+    }
+    ok(got == expected, "Got unexpected value 0x%08x at (%u, %u, %u), expected 0x%08x.\n", got, x, y, z, expected);
+
+    free(dst_data);
+    free(src_data);
+    ID3D12Resource_Release(texture);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
+static void test_read_write_subresource_throughput(void)
+{
+    D3D12_HEAP_PROPERTIES heap_properties;
+    D3D12_RESOURCE_DESC resource_desc;
+    double start_time, elapsed_time;
+    uint32_t *src_data, *dst_data;
+    unsigned int row_pitch, i, j;
+    ID3D12Resource *texture;
+    ID3D12Device *device;
+    uint32_t checksum;
+    ULONG refcount;
+    HRESULT hr;
+
+    static const unsigned int width = 2048, height = 2048, iteration_count = 8;
+
+    if (!(device = create_device()))
+    {
+        skip("Failed to create device.\n");
+        return;
+    }
+
+    resource_desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    resource_desc.Alignment = 0;
+    resource_desc.Width = width;
+    resource_desc.Height = height;
+    resource_desc.DepthOrArraySize = 1;
+    resource_desc.MipLevels = 1;
+    resource_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    resource_desc.SampleDesc.Count = 1;
+    resource_desc.SampleDesc.Quality = 0;
+    resource_desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    resource_desc.Flags = 0;
+
+    memset(&heap_properties, 0, sizeof(heap_properties));
+    heap_properties.Type = D3D12_HEAP_TYPE_CUSTOM;
+    heap_properties.CPUPageProperty = D3D12_CPU_PAGE_PROPERTY_WRITE_BACK;
+    heap_properties.MemoryPoolPreference = D3D12_MEMORY_POOL_L0;
+    hr = ID3D12Device_CreateCommittedResource(device, &heap_properties, D3D12_HEAP_FLAG_NONE,
+            &resource_desc, D3D12_RESOURCE_STATE_COMMON, NULL, &IID_ID3D12Resource, (void **)&texture);
+    if (FAILED(hr))
+    {
+        skip("Failed to create texture on custom heap.\n");
+        ID3D12Device_Release(device);
+        return;
+    }
+
+    row_pitch = width * sizeof(*src_data);
+    src_data = malloc(row_pitch * height);
+    ok(src_data, "Failed to allocate memory.\n");
+    dst_data = malloc(row_pitch * height);
+    ok(dst_data, "Failed to allocate memory.\n");
+    for (i = 0; i < width * height; ++i)
+        src_data[i] = i;
+
+    start_time = get_time_ms();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        hr = ID3D12Resource_WriteToSubresource(texture, 0, NULL, src_data, row_pitch, row_pitch * height);
+        ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    }
+    elapsed_time = get_time_ms() - start_time;
+    trace("WriteToSubresource: %.3f MiB/s.\n",
+            iteration_count * (row_pitch * height / 1048576.0) / (elapsed_time / 1000.0));
+
+    /* Consume the data straight away, as applications reading back data
+     * typically do. */
+    checksum = 0;
+    start_time = get_time_ms();
+    for (i = 0; i < iteration_count; ++i)
+    {
+        hr = ID3D12Resource_ReadFromSubresource(texture, dst_data, row_pitch, row_pitch * height, 0, NULL);
+        ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+        for (j = 0; j < width * height; ++j)
+            checksum += dst_data[j];
+    }
+    elapsed_time = get_time_ms() - start_time;
+    trace("ReadFromSubresource: %.3f MiB/s.\n",
+            iteration_count * (row_pitch * height / 1048576.0) / (elapsed_time / 1000.0));
+
+    ok(!memcmp(src_data, dst_data, row_pitch * height), "Got unexpected data.\n");
+    ok(checksum == iteration_count * (uint32_t)((width * height / 2) * (width * height - 1)),
+            "Got unexpected checksum %#x.\n", checksum);
+
+    free(dst_data);
+    free(src_data);
+    ID3D12Resource_Release(texture);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "ID3D12Device has %u references left.\n", (unsigned int)refcount);
+}
+
 static void test_queue_wait(void)
 {
     D3D12_TEXTURE_COPY_LOCATION dst_location, src_location;
@@ -31506,10 +33002,13 @@ static void test_conditional_rendering(void)
     D3D12_RESOURCE_DESC resource_desc;
     struct test_context context;
     ID3D12Resource *buffer, *cb;
+    unsigned int width, height;
     struct resource_readback rb;
     ID3D12CommandQueue *queue;
+    RECT scissor_rect;
     unsigned int i;
     uint32_t value;
+    D3D12_BOX box;
     HRESULT hr;
 
     static const uint64_t predicate_args[] = {0, 1, (uint64_t)1 << 32};
@@ -31658,6 +33157,36 @@ static void test_conditional_rendering(void)
 
     check_sub_resource_uint(context.render_target, 0, queue, command_list, 0xff00ff00, 0);
 
+    reset_command_list(command_list, context.allocator);
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    /* SetPredication() while a render pass is active. */
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+    prepare_instanced_draw(&context);
+    width = context.render_target_desc.Width;
+    height = context.render_target_desc.Height;
+    set_rect(&scissor_rect, 0, 0, width / 2, height);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &scissor_rect);
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions,
+            sizeof(uint64_t), D3D12_PREDICATION_OP_EQUAL_ZERO);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    /* Skip. */
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions, 0, D3D12_PREDICATION_OP_EQUAL_ZERO);
+    set_rect(&scissor_rect, width / 2, 0, width, height);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &scissor_rect);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    ID3D12GraphicsCommandList_SetPredication(command_list, NULL, 0, 0);
+
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+
+    get_texture_readback_with_command_list(context.render_target, 0, &rb, queue, command_list);
+    set_box(&box, 0, 0, 0, width / 2, height, 1);
+    check_readback_data_uint(&rb, &box, 0xff00ff00, 0);
+    set_box(&box, width / 2, 0, 0, width, height, 1);
+    check_readback_data_uint(&rb, &box, 0xffffffff, 0);
+    release_resource_readback(&rb);
     reset_command_list(command_list, context.allocator);
     transition_resource_state(command_list, context.render_target,
             D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
@@ -31930,6 +33459,48 @@ static void test_conditional_rendering(void)
                 D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
     }
 
+    ID3D12PipelineState_Release(pipeline_state);
+    ID3D12RootSignature_Release(root_signature);
+
+    /* Root constants set before a predicated Dispatch(). */
+    root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    root_parameters[0].Constants.ShaderRegister = 0;
+    root_parameters[0].Constants.RegisterSpace = 0;
+    root_parameters[0].Constants.Num32BitValues = 2;
+    root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    hr = create_root_signature(context.device, &root_signature_desc, &root_signature);
+    ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+
+    pipeline_state = create_compute_pipeline_state(context.device, root_signature,
+            shader_bytecode(cs_code, sizeof(cs_code)));
+
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, pipeline_state);
+    ID3D12GraphicsCommandList_SetComputeRootSignature(command_list, root_signature);
+    ID3D12GraphicsCommandList_SetComputeRootUnorderedAccessView(command_list,
+            1, ID3D12Resource_GetGPUVirtualAddress(buffer));
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 2, 0);
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 7, 1);
+    ID3D12GraphicsCommandList_Dispatch(command_list, 1, 1, 1);
+    uav_barrier(command_list, buffer);
+    /* Only the value is updated. The offset was consumed by the previous
+     * dispatch, and must still be used after the predicate is set. */
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 9, 1);
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions, 0, D3D12_PREDICATION_OP_EQUAL_ZERO);
+    ID3D12GraphicsCommandList_Dispatch(command_list, 1, 1, 1);
+    uav_barrier(command_list, buffer);
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 11, 1);
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions,
+            sizeof(uint64_t), D3D12_PREDICATION_OP_EQUAL_ZERO);
+    ID3D12GraphicsCommandList_Dispatch(command_list, 1, 1, 1);
+    ID3D12GraphicsCommandList_SetPredication(command_list, NULL, 0, 0);
+
+    transition_sub_resource_state(command_list, buffer, 0,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    get_buffer_readback_with_command_list(buffer, DXGI_FORMAT_R32_UINT, &rb, queue, command_list);
+    value = get_readback_uint(&rb, 2, 0, 0);
+    ok(value == 9, "Got %#x, expected %#x.\n", value, 9);
+    release_resource_readback(&rb);
+
     ID3D12Resource_Release(texture);
     ID3D12Resource_Release(texture_copy);
     ID3D12Resource_Release(conditions);
@@ -32328,6 +33899,8 @@ START_TEST(d3d12)
     run_test(test_create_heap);
     run_test(test_create_placed_resource);
     run_test(test_create_reserved_resource);
+    run_test(test_get_resource_tiling);
+    run_test(test_update_tile_mappings);
     run_test(test_create_descriptor_heap);
     run_test(test_create_sampler);
     run_test(test_create_unordered_access_view);
@@ -32338,11 +33911,15 @@ START_TEST(d3d12)
     run_test(test_create_fence);
     run_test(test_object_interface);
     run_test(test_multithread_private_data);
+    run_test(test_multithread_map);
+    run_test(test_multithread_descriptor_copies);
+    run_test(test_multithread_recording);
     run_test(test_reset_command_allocator);
     run_test(test_cpu_signal_fence);
     run_test(test_gpu_signal_fence);
     run_test(test_multithread_fence_wait);
     run_test(test_fence_values);
+    run_test(test_fence_event_throughput);
     run_test(test_clear_depth_stencil_view);
     run_test(test_clear_render_target_view);
     run_test(test_clear_unordered_access_view);
@@ -32364,6 +33941,7 @@ START_TEST(d3d12)
     run_test(test_texture_resource_barriers);
     run_test(test_device_removed_reason);
     run_test(test_map_resource);
+    run_test(test_map_unmap_throughput);
     run_test(test_map_placed_resources);
     run_test(test_bundle_state_inheritance);
     run_test(test_shader_instructions);
@@ -32394,6 +33972,10 @@ START_TEST(d3d12)
     run_test(test_update_descriptor_tables_after_root_signature_change);
     run_test(test_copy_descriptors);
     run_test(test_copy_descriptors_range_sizes);
+    run_test(test_copy_descriptors_throughput);
+    run_test(test_descriptor_table_update_throughput);
+    run_test(test_draw_descriptor_table_cpu_overhead);
+    run_test(test_static_descriptor_tables);
     run_test(test_descriptors_visibility);
     run_test(test_create_null_descriptors);
     run_test(test_null_cbv);
@@ -32463,6 +34045,8 @@ START_TEST(d3d12)
     run_test(test_primitive_restart);
     run_test(test_vertex_shader_stream_output);
     run_test(test_read_write_subresource);
+    run_test(test_read_write_subresource_large);
+    run_test(test_read_write_subresource_throughput);
     run_test(test_queue_wait);
     run_test(test_graphics_compute_queue_synchronization);
     run_test(test_early_depth_stencil_tests);
@@ -88,6 +88,15 @@ static inline void *get_d3d12_pfn_(const char *name)
 {
     return GetProcAddress(GetModuleHandleA("d3d12.dll"), name);
 }
+
+static inline double get_time_ms(void)
+{
+    LARGE_INTEGER counter, frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return counter.QuadPart * 1000.0 / frequency.QuadPart;
+}
 #else
 #define INFINITE VKD3D_INFINITE
 #define WAIT_OBJECT_0 VKD3D_WAIT_OBJECT_0
@@ -114,6 +123,14 @@ static inline void destroy_event(HANDLE event)
 }
 
 #define get_d3d12_pfn(name) (name)
+
+static inline double get_time_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
 #endif
 
 typedef void (*thread_main_pfn)(void *data);
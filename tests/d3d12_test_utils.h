@@ -284,6 +284,17 @@ static void transition_resource_state(ID3D12GraphicsCommandList *list, ID3D12Res
             state_before, state_after);
 }
 
+static inline void uav_barrier(ID3D12GraphicsCommandList *list, ID3D12Resource *resource)
+{
+    D3D12_RESOURCE_BARRIER barrier;
+
+    barrier.Type = D3D12_RESOURCE_BARRIER_TYPE_UAV;
+    barrier.Flags = D3D12_RESOURCE_BARRIER_FLAG_NONE;
+    barrier.UAV.pResource = resource;
+
+    ID3D12GraphicsCommandList_ResourceBarrier(list, 1, &barrier);
+}
+
 static unsigned int format_size(DXGI_FORMAT format)
 {
     switch (format)
@@ -21,6 +21,8 @@
 #define WIDL_C_INLINE_WRAPPERS
 #include "vkd3d_test.h"
 #include <vkd3d.h>
+#include <vkd3d_utils.h>
+#include <poll.h>
 
 #include "d3d12_test_utils.h"
 
@@ -713,6 +715,193 @@ static void test_vkd3d_queue(void)
     ok(!refcount, "Device has %u references left.\n", refcount);
 }
 
+static void test_fence_wait_for_value(void)
+{
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    ID3D12Fence *fence;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE,
+            &IID_ID3D12Fence, (void **)&fence);
+    ok(hr == S_OK, "Failed to create fence, hr %#x.\n", hr);
+
+    hr = vkd3d_wait_for_fence_value(fence, 0, 0);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    hr = vkd3d_wait_for_fence_value(fence, 1, 0);
+    ok(hr == S_FALSE, "Got unexpected hr %#x.\n", hr);
+    hr = vkd3d_wait_for_fence_value(fence, 1, 1000000);
+    ok(hr == S_FALSE, "Got unexpected hr %#x.\n", hr);
+
+    hr = ID3D12Fence_Signal(fence, 5);
+    ok(hr == S_OK, "Failed to signal fence, hr %#x.\n", hr);
+    hr = vkd3d_wait_for_fence_value(fence, 5, 0);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    hr = vkd3d_wait_for_fence_value(fence, 6, 1000000);
+    ok(hr == S_FALSE, "Got unexpected hr %#x.\n", hr);
+
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+    hr = ID3D12CommandQueue_Signal(queue, fence, 10);
+    ok(hr == S_OK, "Failed to signal fence, hr %#x.\n", hr);
+    hr = vkd3d_wait_for_fence_value(fence, 10, ~(uint64_t)0);
+    ok(hr == S_OK, "Got unexpected hr %#x.\n", hr);
+    ok(ID3D12Fence_GetCompletedValue(fence) == 10, "Got unexpected value %"PRIu64".\n",
+            ID3D12Fence_GetCompletedValue(fence));
+
+    ID3D12CommandQueue_Release(queue);
+    ID3D12Fence_Release(fence);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+static void test_upload_memory(void)
+{
+    struct vkd3d_upload_allocation allocations[5], allocation, allocation2;
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    ID3D12Fence *fence;
+    unsigned int i;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    hr = ID3D12Device_CreateFence(device, 0, D3D12_FENCE_FLAG_NONE,
+            &IID_ID3D12Fence, (void **)&fence);
+    ok(hr == S_OK, "Failed to create fence, hr %#x.\n", hr);
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+
+    hr = vkd3d_allocate_upload_memory(queue, 0, 0, fence, 1, &allocation);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+    hr = vkd3d_allocate_upload_memory(queue, 16, 3, fence, 1, &allocation);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+    hr = vkd3d_allocate_upload_memory(queue, 16, 0, NULL, 1, &allocation);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    /* Memory is not reused before the fence reaches the value. */
+    for (i = 0; i < ARRAY_SIZE(allocations); ++i)
+    {
+        hr = vkd3d_allocate_upload_memory(queue, 0x100000, 0, fence, 1, &allocations[i]);
+        ok(hr == S_OK, "Failed to allocate upload memory, hr %#x.\n", hr);
+        ok(allocations[i].cpu_address, "Got NULL CPU address.\n");
+        memset(allocations[i].cpu_address, i, 0x100000);
+    }
+    ok(allocations[4].gpu_address != allocations[0].gpu_address, "Got reused address %#"PRIx64".\n",
+            allocations[4].gpu_address);
+
+    hr = ID3D12Fence_Signal(fence, 1);
+    ok(hr == S_OK, "Failed to signal fence, hr %#x.\n", hr);
+    for (i = 0; i < 4; ++i)
+    {
+        hr = vkd3d_allocate_upload_memory(queue, 0x100000, 0, fence, 2, &allocation);
+        ok(hr == S_OK, "Failed to allocate upload memory, hr %#x.\n", hr);
+    }
+    ok(allocation.gpu_address == allocations[0].gpu_address, "Got address %#"PRIx64", expected %#"PRIx64".\n",
+            allocation.gpu_address, allocations[0].gpu_address);
+
+    hr = vkd3d_allocate_upload_memory(queue, 16, 0, fence, 2, &allocation);
+    ok(hr == S_OK, "Failed to allocate upload memory, hr %#x.\n", hr);
+    hr = vkd3d_allocate_upload_memory(queue, 16, 0, fence, 2, &allocation2);
+    ok(hr == S_OK, "Failed to allocate upload memory, hr %#x.\n", hr);
+    ok(!(allocation.gpu_address % 256), "Got unaligned address %#"PRIx64".\n", allocation.gpu_address);
+    ok(allocation2.gpu_address == allocation.gpu_address + 256,
+            "Got addresses %#"PRIx64", %#"PRIx64".\n", allocation.gpu_address, allocation2.gpu_address);
+    ok((char *)allocation2.cpu_address == (char *)allocation.cpu_address + 256,
+            "Got pointers %p, %p.\n", allocation.cpu_address, allocation2.cpu_address);
+
+    ID3D12CommandQueue_Release(queue);
+    ID3D12Fence_Release(fence);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+static void test_queue_timestamps(void)
+{
+    struct vkd3d_queue_timestamp timestamps[8];
+    uint64_t gpu_timestamp, cpu_timestamp;
+    ID3D12GraphicsCommandList *command_list;
+    ID3D12CommandAllocator *allocator;
+    char *old_config = NULL;
+    ID3D12CommandQueue *queue;
+    ID3D12Device *device;
+    const char *config;
+    unsigned int i, count;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+    count = vkd3d_drain_queue_timestamps(queue, timestamps, ARRAY_SIZE(timestamps));
+    ok(!count, "Got unexpected count %u.\n", count);
+    ID3D12CommandQueue_Release(queue);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+
+    if ((config = getenv("VKD3D_CONFIG")))
+        old_config = strdup(config);
+    setenv("VKD3D_CONFIG", "queue_profiling", 1);
+    device = create_device();
+    if (old_config)
+        setenv("VKD3D_CONFIG", old_config, 1);
+    else
+        unsetenv("VKD3D_CONFIG");
+    free(old_config);
+    ok(device, "Failed to create device.\n");
+
+    queue = create_command_queue(device, D3D12_COMMAND_LIST_TYPE_DIRECT, D3D12_COMMAND_QUEUE_PRIORITY_NORMAL);
+
+    hr = ID3D12CommandQueue_GetClockCalibration(queue, &gpu_timestamp, &cpu_timestamp);
+    ok(hr == S_OK || hr == E_NOTIMPL, "Got unexpected hr %#x.\n", hr);
+    if (hr == S_OK)
+        trace("GPU timestamp %"PRIu64", CPU timestamp %"PRIu64".\n", gpu_timestamp, cpu_timestamp);
+
+    hr = ID3D12Device_CreateCommandAllocator(device, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            &IID_ID3D12CommandAllocator, (void **)&allocator);
+    ok(hr == S_OK, "Failed to create command allocator, hr %#x.\n", hr);
+    hr = ID3D12Device_CreateCommandList(device, 0, D3D12_COMMAND_LIST_TYPE_DIRECT,
+            allocator, NULL, &IID_ID3D12GraphicsCommandList, (void **)&command_list);
+    ok(hr == S_OK, "Failed to create command list, hr %#x.\n", hr);
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+
+    for (i = 0; i < 3; ++i)
+        ID3D12CommandQueue_ExecuteCommandLists(queue, 1, (ID3D12CommandList **)&command_list);
+    wait_queue_idle(device, queue);
+
+    count = vkd3d_drain_queue_timestamps(queue, timestamps, 2);
+    ok(count == 2, "Got unexpected count %u.\n", count);
+    count += vkd3d_drain_queue_timestamps(queue, &timestamps[count], ARRAY_SIZE(timestamps) - count);
+    ok(count == 3, "Got unexpected count %u.\n", count);
+    for (i = 0; i < count; ++i)
+    {
+        ok(timestamps[i].submission_index == i, "Got unexpected submission index %"PRIu64".\n",
+                timestamps[i].submission_index);
+        ok(timestamps[i].command_list_count == 1, "Got unexpected command list count %u.\n",
+                timestamps[i].command_list_count);
+        ok(timestamps[i].gpu_begin_time <= timestamps[i].gpu_end_time,
+                "Got begin time %"PRIu64" > end time %"PRIu64".\n",
+                timestamps[i].gpu_begin_time, timestamps[i].gpu_end_time);
+        if (i)
+            ok(timestamps[i - 1].cpu_submit_time <= timestamps[i].cpu_submit_time,
+                    "Expected submit times to monotonically increase.\n");
+    }
+
+    count = vkd3d_drain_queue_timestamps(queue, timestamps, ARRAY_SIZE(timestamps));
+    ok(!count, "Got unexpected count %u.\n", count);
+
+    ID3D12GraphicsCommandList_Release(command_list);
+    ID3D12CommandAllocator_Release(allocator);
+    ID3D12CommandQueue_Release(queue);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
 static void test_resource_internal_refcount(void)
 {
     ID3D12Resource *resource;
@@ -752,6 +941,393 @@ static void test_resource_internal_refcount(void)
     ok(!refcount, "Device has %u references left.\n", refcount);
 }
 
+static void test_memory_statistics(void)
+{
+    struct vkd3d_memory_statistics statistics, base_statistics;
+    ID3D12Resource *resources[8];
+    uint32_t *data[8];
+    ID3D12Device *device;
+    unsigned int i, j;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    vkd3d_get_memory_statistics(device, &base_statistics);
+    ok(base_statistics.chunk_size, "Got zero chunk size.\n");
+    ok(base_statistics.suballocated_size >= base_statistics.requested_size,
+            "Got suballocated size %#"PRIx64", requested size %#"PRIx64".\n",
+            base_statistics.suballocated_size, base_statistics.requested_size);
+
+    for (i = 0; i < ARRAY_SIZE(resources); ++i)
+    {
+        resources[i] = create_buffer(device, D3D12_HEAP_TYPE_UPLOAD, 256,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_GENERIC_READ);
+        hr = ID3D12Resource_Map(resources[i], 0, NULL, (void **)&data[i]);
+        ok(hr == S_OK, "Failed to map buffer %u, hr %#x.\n", i, hr);
+        for (j = 0; j < 256 / sizeof(*data[i]); ++j)
+            data[i][j] = i;
+    }
+
+    vkd3d_get_memory_statistics(device, &statistics);
+    ok(statistics.suballocation_count + statistics.dedicated_allocation_count
+            == base_statistics.suballocation_count + base_statistics.dedicated_allocation_count + ARRAY_SIZE(resources),
+            "Got %"PRIu64" suballocations and %"PRIu64" dedicated allocations.\n",
+            statistics.suballocation_count, statistics.dedicated_allocation_count);
+    ok(statistics.suballocated_size >= statistics.requested_size,
+            "Got suballocated size %#"PRIx64", requested size %#"PRIx64".\n",
+            statistics.suballocated_size, statistics.requested_size);
+    if (statistics.suballocation_count > base_statistics.suballocation_count)
+    {
+        ok(statistics.chunk_count, "Got zero chunks.\n");
+        ok(statistics.largest_free_block_size < statistics.chunk_size,
+                "Got largest free block size %#"PRIx64".\n", statistics.largest_free_block_size);
+    }
+
+    /* Suballocations must not overlap. */
+    for (i = 0; i < ARRAY_SIZE(resources); ++i)
+    {
+        for (j = 0; j < 256 / sizeof(*data[i]); ++j)
+        {
+            if (data[i][j] != i)
+                break;
+        }
+        ok(j == 256 / sizeof(*data[i]), "Got unexpected value at %u for buffer %u.\n", j, i);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(resources); ++i)
+    {
+        ID3D12Resource_Unmap(resources[i], 0, NULL);
+        ID3D12Resource_Release(resources[i]);
+    }
+
+    vkd3d_get_memory_statistics(device, &statistics);
+    ok(statistics.suballocation_count == base_statistics.suballocation_count,
+            "Got %"PRIu64" suballocations, expected %"PRIu64".\n",
+            statistics.suballocation_count, base_statistics.suballocation_count);
+    ok(statistics.dedicated_allocation_count == base_statistics.dedicated_allocation_count,
+            "Got %"PRIu64" dedicated allocations, expected %"PRIu64".\n",
+            statistics.dedicated_allocation_count, base_statistics.dedicated_allocation_count);
+    ok(statistics.requested_size == base_statistics.requested_size,
+            "Got requested size %#"PRIx64", expected %#"PRIx64".\n",
+            statistics.requested_size, base_statistics.requested_size);
+
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+static void test_object_pool_statistics(void)
+{
+    struct vkd3d_object_pool_statistics statistics, base_statistics;
+    ID3D12Resource *resources[4];
+    ID3D12Device *device;
+    unsigned int i;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    hr = vkd3d_get_object_pool_statistics(device, VKD3D_OBJECT_POOL_RESOURCE, &base_statistics);
+    ok(hr == S_OK, "Failed to get pool statistics, hr %#x.\n", hr);
+    ok(base_statistics.object_size, "Got zero object size.\n");
+
+    for (i = 0; i < ARRAY_SIZE(resources); ++i)
+    {
+        resources[i] = create_buffer(device, D3D12_HEAP_TYPE_DEFAULT, 256,
+                D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+    }
+
+    hr = vkd3d_get_object_pool_statistics(device, VKD3D_OBJECT_POOL_RESOURCE, &statistics);
+    ok(hr == S_OK, "Failed to get pool statistics, hr %#x.\n", hr);
+    ok(statistics.allocated_count >= base_statistics.allocated_count + ARRAY_SIZE(resources),
+            "Got %"PRIu64" allocated objects, expected at least %"PRIu64".\n",
+            statistics.allocated_count, base_statistics.allocated_count + ARRAY_SIZE(resources));
+    ok(statistics.slab_count, "Got zero slabs.\n");
+
+    for (i = 0; i < ARRAY_SIZE(resources); ++i)
+        ID3D12Resource_Release(resources[i]);
+
+    hr = vkd3d_get_object_pool_statistics(device, VKD3D_OBJECT_POOL_RESOURCE, &statistics);
+    ok(hr == S_OK, "Failed to get pool statistics, hr %#x.\n", hr);
+    ok(statistics.allocated_count == base_statistics.allocated_count,
+            "Got %"PRIu64" allocated objects, expected %"PRIu64".\n",
+            statistics.allocated_count, base_statistics.allocated_count);
+    ok(statistics.free_count >= ARRAY_SIZE(resources), "Got %"PRIu64" free objects.\n", statistics.free_count);
+
+    hr = vkd3d_get_object_pool_statistics(device, VKD3D_OBJECT_POOL_VIEW, &statistics);
+    ok(hr == S_OK, "Failed to get pool statistics, hr %#x.\n", hr);
+    hr = vkd3d_get_object_pool_statistics(device, 0xdeadbeef, &statistics);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+static void test_sampler_cache(void)
+{
+    struct vkd3d_sampler_cache_statistics statistics, base_statistics;
+    D3D12_CPU_DESCRIPTOR_HANDLE cpu_handle;
+    ID3D12DescriptorHeap *heap;
+    D3D12_SAMPLER_DESC desc;
+    unsigned int i, size;
+    ID3D12Device *device;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    hr = vkd3d_get_sampler_cache_statistics(device, &base_statistics);
+    ok(hr == S_OK, "Failed to get sampler cache statistics, hr %#x.\n", hr);
+
+    heap = create_cpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER, 4);
+    size = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+    cpu_handle = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+
+    memset(&desc, 0, sizeof(desc));
+    desc.Filter = D3D12_FILTER_MIN_MAG_MIP_LINEAR;
+    desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    desc.AddressV = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    desc.AddressW = D3D12_TEXTURE_ADDRESS_MODE_CLAMP;
+    desc.MaxLOD = D3D12_FLOAT32_MAX;
+    for (i = 0; i < 3; ++i)
+    {
+        ID3D12Device_CreateSampler(device, &desc, cpu_handle);
+        cpu_handle.ptr += size;
+    }
+    desc.AddressU = D3D12_TEXTURE_ADDRESS_MODE_WRAP;
+    ID3D12Device_CreateSampler(device, &desc, cpu_handle);
+
+    hr = vkd3d_get_sampler_cache_statistics(device, &statistics);
+    ok(hr == S_OK, "Failed to get sampler cache statistics, hr %#x.\n", hr);
+    ok(statistics.sampler_count == base_statistics.sampler_count + 2,
+            "Got %"PRIu64" samplers, expected %"PRIu64".\n",
+            statistics.sampler_count, base_statistics.sampler_count + 2);
+    ok(statistics.miss_count == base_statistics.miss_count + 2,
+            "Got %"PRIu64" misses, expected %"PRIu64".\n",
+            statistics.miss_count, base_statistics.miss_count + 2);
+    ok(statistics.hit_count == base_statistics.hit_count + 2,
+            "Got %"PRIu64" hits, expected %"PRIu64".\n",
+            statistics.hit_count, base_statistics.hit_count + 2);
+
+    ID3D12DescriptorHeap_Release(heap);
+
+    hr = vkd3d_get_sampler_cache_statistics(device, &statistics);
+    ok(hr == S_OK, "Failed to get sampler cache statistics, hr %#x.\n", hr);
+    ok(statistics.sampler_count == base_statistics.sampler_count,
+            "Got %"PRIu64" samplers, expected %"PRIu64".\n",
+            statistics.sampler_count, base_statistics.sampler_count);
+
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
+#define check_view_cache_statistics(a, b, c, d, e) check_view_cache_statistics_(__LINE__, a, b, c, d, e)
+static void check_view_cache_statistics_(unsigned int line, ID3D12Resource *resource,
+        uint64_t view_count, uint64_t hit_count, uint64_t miss_count, uint64_t purged_count)
+{
+    struct vkd3d_view_cache_statistics statistics;
+    HRESULT hr;
+
+    hr = vkd3d_get_view_cache_statistics(resource, &statistics);
+    ok_(line)(hr == S_OK, "Failed to get view cache statistics, hr %#x.\n", hr);
+    ok_(line)(statistics.view_count == view_count, "Got %"PRIu64" views, expected %"PRIu64".\n",
+            statistics.view_count, view_count);
+    ok_(line)(statistics.hit_count == hit_count, "Got %"PRIu64" hits, expected %"PRIu64".\n",
+            statistics.hit_count, hit_count);
+    ok_(line)(statistics.miss_count == miss_count, "Got %"PRIu64" misses, expected %"PRIu64".\n",
+            statistics.miss_count, miss_count);
+    ok_(line)(statistics.purged_count == purged_count, "Got %"PRIu64" purged views, expected %"PRIu64".\n",
+            statistics.purged_count, purged_count);
+}
+
+static void test_view_cache(void)
+{
+    D3D12_SHADER_RESOURCE_VIEW_DESC srv_desc;
+    D3D12_CPU_DESCRIPTOR_HANDLE handles[65];
+    ID3D12Resource *texture, *buffer;
+    ID3D12DescriptorHeap *heap;
+    unsigned int i, size;
+    ID3D12Device *device;
+    ULONG refcount;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    heap = create_cpu_descriptor_heap(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV, ARRAY_SIZE(handles));
+    size = ID3D12Device_GetDescriptorHandleIncrementSize(device, D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV);
+    handles[0] = ID3D12DescriptorHeap_GetCPUDescriptorHandleForHeapStart(heap);
+    for (i = 1; i < ARRAY_SIZE(handles); ++i)
+    {
+        handles[i] = handles[i - 1];
+        handles[i].ptr += size;
+    }
+
+    texture = create_default_texture(device, 4, 4, DXGI_FORMAT_R8G8B8A8_UNORM,
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COMMON);
+    check_view_cache_statistics(texture, 0, 0, 0, 0);
+
+    /* Identical descriptors share a view. */
+    ID3D12Device_CreateShaderResourceView(device, texture, NULL, handles[0]);
+    ID3D12Device_CreateShaderResourceView(device, texture, NULL, handles[1]);
+    check_view_cache_statistics(texture, 1, 1, 1, 0);
+    ID3D12Device_CreateUnorderedAccessView(device, texture, NULL, NULL, handles[2]);
+    ID3D12Device_CreateUnorderedAccessView(device, texture, NULL, NULL, handles[3]);
+    check_view_cache_statistics(texture, 2, 2, 2, 0);
+
+    /* A different swizzle needs a different view. */
+    memset(&srv_desc, 0, sizeof(srv_desc));
+    srv_desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_TEXTURE2D;
+    srv_desc.Shader4ComponentMapping = D3D12_ENCODE_SHADER_4_COMPONENT_MAPPING(
+            D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_2,
+            D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_1,
+            D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_0,
+            D3D12_SHADER_COMPONENT_MAPPING_FROM_MEMORY_COMPONENT_3);
+    srv_desc.Texture2D.MipLevels = 1;
+    ID3D12Device_CreateShaderResourceView(device, texture, &srv_desc, handles[4]);
+    check_view_cache_statistics(texture, 3, 2, 3, 0);
+
+    /* Fill the cache, and drop all descriptors referencing its views. */
+    buffer = create_default_buffer(device, 0x1000, D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COMMON);
+    memset(&srv_desc, 0, sizeof(srv_desc));
+    srv_desc.Format = DXGI_FORMAT_R32_UINT;
+    srv_desc.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+    srv_desc.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+    srv_desc.Buffer.NumElements = 1;
+    for (i = 0; i < ARRAY_SIZE(handles) - 1; ++i)
+    {
+        srv_desc.Buffer.FirstElement = i;
+        ID3D12Device_CreateShaderResourceView(device, buffer, &srv_desc, handles[i]);
+    }
+    check_view_cache_statistics(buffer, 64, 0, 64, 0);
+    for (i = 0; i < ARRAY_SIZE(handles) - 1; ++i)
+        ID3D12Device_CreateShaderResourceView(device, texture, NULL, handles[i]);
+    check_view_cache_statistics(buffer, 64, 0, 64, 0);
+
+    /* Unreferenced views are purged once the cache is full. */
+    srv_desc.Buffer.FirstElement = ARRAY_SIZE(handles) - 1;
+    ID3D12Device_CreateShaderResourceView(device, buffer, &srv_desc, handles[ARRAY_SIZE(handles) - 1]);
+    check_view_cache_statistics(buffer, 1, 0, 65, 64);
+
+    /* Purged views are recreated on demand. */
+    srv_desc.Buffer.FirstElement = 0;
+    ID3D12Device_CreateShaderResourceView(device, buffer, &srv_desc, handles[0]);
+    check_view_cache_statistics(buffer, 2, 0, 66, 64);
+    ID3D12Device_CreateShaderResourceView(device, buffer, &srv_desc, handles[1]);
+    check_view_cache_statistics(buffer, 2, 1, 66, 64);
+
+    ID3D12DescriptorHeap_Release(heap);
+    ID3D12Resource_Release(buffer);
+    ID3D12Resource_Release(texture);
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", (unsigned int)refcount);
+}
+
+static void get_evicted_size(ID3D12Device *device, uint64_t *evicted_size)
+{
+    struct vkd3d_video_memory_info info;
+    HRESULT hr;
+
+    hr = vkd3d_query_video_memory_info(device, VKD3D_MEMORY_SEGMENT_GROUP_LOCAL, &info);
+    ok(hr == S_OK, "Failed to query local memory info, hr %#x.\n", hr);
+    *evicted_size = info.evicted_size;
+    hr = vkd3d_query_video_memory_info(device, VKD3D_MEMORY_SEGMENT_GROUP_NON_LOCAL, &info);
+    ok(hr == S_OK, "Failed to query non-local memory info, hr %#x.\n", hr);
+    *evicted_size += info.evicted_size;
+}
+
+static void test_root_signature_cache(void)
+{
+    ID3D12RootSignature *root_signature1, *root_signature2, *root_signature3;
+    ID3D12Device *device;
+    ULONG refcount;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    root_signature1 = create_empty_root_signature(device, 0);
+    root_signature2 = create_empty_root_signature(device, 0);
+    ok(root_signature1 == root_signature2, "Got different root signatures %p, %p.\n",
+            root_signature1, root_signature2);
+    root_signature3 = create_empty_root_signature(device,
+            D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+    ok(root_signature3 != root_signature1, "Got the same root signature %p.\n", root_signature3);
+
+    refcount = ID3D12RootSignature_Release(root_signature2);
+    ok(refcount == 1, "Got unexpected refcount %u.\n", (unsigned int)refcount);
+    refcount = ID3D12RootSignature_Release(root_signature1);
+    ok(!refcount, "ID3D12RootSignature has %u references left.\n", (unsigned int)refcount);
+    refcount = ID3D12RootSignature_Release(root_signature3);
+    ok(!refcount, "ID3D12RootSignature has %u references left.\n", (unsigned int)refcount);
+
+    /* Destroyed root signatures are removed from the cache. */
+    root_signature1 = create_empty_root_signature(device, 0);
+    refcount = ID3D12RootSignature_Release(root_signature1);
+    ok(!refcount, "ID3D12RootSignature has %u references left.\n", (unsigned int)refcount);
+
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", (unsigned int)refcount);
+}
+
+static void test_residency(void)
+{
+    struct vkd3d_video_memory_info info;
+    ID3D12Pageable *pageable;
+    ID3D12Resource *resource;
+    uint64_t evicted_size;
+    ID3D12Device *device;
+    ULONG refcount;
+    HRESULT hr;
+
+    device = create_device();
+    ok(device, "Failed to create device.\n");
+
+    hr = vkd3d_query_video_memory_info(device, VKD3D_MEMORY_SEGMENT_GROUP_LOCAL, &info);
+    ok(hr == S_OK, "Failed to query local memory info, hr %#x.\n", hr);
+    ok(info.budget, "Got zero budget.\n");
+    hr = vkd3d_query_video_memory_info(device, 2, &info);
+    ok(hr == E_INVALIDARG, "Got unexpected hr %#x.\n", hr);
+
+    get_evicted_size(device, &evicted_size);
+    ok(!evicted_size, "Got evicted size %#"PRIx64".\n", evicted_size);
+
+    resource = create_buffer(device, D3D12_HEAP_TYPE_DEFAULT, 0x100000,
+            D3D12_RESOURCE_FLAG_NONE, D3D12_RESOURCE_STATE_COPY_DEST);
+    hr = ID3D12Resource_QueryInterface(resource, &IID_ID3D12Pageable, (void **)&pageable);
+    ok(hr == S_OK, "Failed to query ID3D12Pageable, hr %#x.\n", hr);
+
+    hr = ID3D12Device_Evict(device, 1, &pageable);
+    ok(hr == S_OK, "Failed to evict resource, hr %#x.\n", hr);
+    get_evicted_size(device, &evicted_size);
+    ok(evicted_size >= 0x100000, "Got evicted size %#"PRIx64".\n", evicted_size);
+
+    /* Residency is reference counted. */
+    hr = ID3D12Device_MakeResident(device, 1, &pageable);
+    ok(hr == S_OK, "Failed to make resource resident, hr %#x.\n", hr);
+    hr = ID3D12Device_MakeResident(device, 1, &pageable);
+    ok(hr == S_OK, "Failed to make resource resident, hr %#x.\n", hr);
+    get_evicted_size(device, &evicted_size);
+    ok(!evicted_size, "Got evicted size %#"PRIx64".\n", evicted_size);
+    hr = ID3D12Device_Evict(device, 1, &pageable);
+    ok(hr == S_OK, "Failed to evict resource, hr %#x.\n", hr);
+    get_evicted_size(device, &evicted_size);
+    ok(!evicted_size, "Got evicted size %#"PRIx64".\n", evicted_size);
+
+    /* Destroying an evicted resource releases its evicted memory. */
+    hr = ID3D12Device_Evict(device, 1, &pageable);
+    ok(hr == S_OK, "Failed to evict resource, hr %#x.\n", hr);
+    ID3D12Pageable_Release(pageable);
+    ID3D12Resource_Release(resource);
+    get_evicted_size(device, &evicted_size);
+    ok(!evicted_size, "Got evicted size %#"PRIx64".\n", evicted_size);
+
+    refcount = ID3D12Device_Release(device);
+    ok(!refcount, "Device has %u references left.\n", refcount);
+}
+
 static VkImage create_vulkan_image(ID3D12Device *device,
         unsigned int width, unsigned int height, VkFormat vk_format, VkImageUsageFlags usage)
 {
@@ -989,6 +1565,256 @@ static void test_external_resource_present_state(void)
     destroy_test_context(&context);
 }
 
+static void test_predicated_dispatch_emulation(void)
+{
+    static const uint64_t predicate_args[] = {0, 1};
+    static const uint32_t zero_data[4] = {0};
+    static const DWORD cs_code[] =
+    {
+#if 0
+        cbuffer cb
+        {
+            unsigned int offset;
+            unsigned int value;
+        };
+
+        RWByteAddressBuffer b;
+
+        [numthreads(1, 1, 1)]
+        void main()
+        {
+            b.Store(4 * offset, value);
+        }
+#endif
+        0x43425844, 0xaadc5460, 0x88c27e90, 0x2acacf4e, 0x4e06019a, 0x00000001, 0x000000d8, 0x00000003,
+        0x0000002c, 0x0000003c, 0x0000004c, 0x4e475349, 0x00000008, 0x00000000, 0x00000008, 0x4e47534f,
+        0x00000008, 0x00000000, 0x00000008, 0x58454853, 0x00000084, 0x00050050, 0x00000021, 0x0100086a,
+        0x04000059, 0x00208e46, 0x00000000, 0x00000001, 0x0300009d, 0x0011e000, 0x00000000, 0x02000068,
+        0x00000001, 0x0400009b, 0x00000001, 0x00000001, 0x00000001, 0x08000029, 0x00100012, 0x00000000,
+        0x0020800a, 0x00000000, 0x00000000, 0x00004001, 0x00000002, 0x080000a6, 0x0011e012, 0x00000000,
+        0x0010000a, 0x00000000, 0x0020801a, 0x00000000, 0x00000000, 0x0100003e,
+    };
+
+    ID3D12Resource *conditions, *buffer, *upload_buffer, *readback_buffer;
+    D3D12_COMPUTE_PIPELINE_STATE_DESC pipeline_desc;
+    D3D12_ROOT_SIGNATURE_DESC root_signature_desc;
+    ID3D12GraphicsCommandList *command_list;
+    D3D12_ROOT_PARAMETER root_parameters[2];
+    ID3D12PipelineState *pipeline_state;
+    ID3D12RootSignature *root_signature;
+    struct test_context_desc desc;
+    struct test_context context;
+    char *old_extensions = NULL;
+    ID3D12CommandQueue *queue;
+    const char *extensions;
+    D3D12_RANGE read_range;
+    uint32_t *data;
+    HRESULT hr;
+    bool ret;
+
+    /* Without VK_EXT_conditional_rendering, predicates are resolved with a
+     * compute dispatch, which disturbs the compute bindings. */
+    if ((extensions = getenv("VKD3D_DISABLE_EXTENSIONS")))
+        old_extensions = strdup(extensions);
+    setenv("VKD3D_DISABLE_EXTENSIONS", "VK_EXT_conditional_rendering", 1);
+    memset(&desc, 0, sizeof(desc));
+    desc.no_render_target = true;
+    ret = init_test_context(&context, &desc);
+    if (old_extensions)
+        setenv("VKD3D_DISABLE_EXTENSIONS", old_extensions, 1);
+    else
+        unsetenv("VKD3D_DISABLE_EXTENSIONS");
+    free(old_extensions);
+    if (!ret)
+        return;
+    command_list = context.list;
+    queue = context.queue;
+
+    conditions = create_upload_buffer(context.device, sizeof(predicate_args), predicate_args);
+    upload_buffer = create_upload_buffer(context.device, sizeof(zero_data), zero_data);
+    readback_buffer = create_readback_buffer(context.device, sizeof(zero_data));
+    buffer = create_default_buffer(context.device, sizeof(zero_data),
+            D3D12_RESOURCE_FLAG_ALLOW_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_DEST);
+
+    root_parameters[0].ParameterType = D3D12_ROOT_PARAMETER_TYPE_32BIT_CONSTANTS;
+    root_parameters[0].Constants.ShaderRegister = 0;
+    root_parameters[0].Constants.RegisterSpace = 0;
+    root_parameters[0].Constants.Num32BitValues = 2;
+    root_parameters[0].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    root_parameters[1].ParameterType = D3D12_ROOT_PARAMETER_TYPE_UAV;
+    root_parameters[1].Descriptor.ShaderRegister = 0;
+    root_parameters[1].Descriptor.RegisterSpace = 0;
+    root_parameters[1].ShaderVisibility = D3D12_SHADER_VISIBILITY_ALL;
+    memset(&root_signature_desc, 0, sizeof(root_signature_desc));
+    root_signature_desc.NumParameters = 2;
+    root_signature_desc.pParameters = root_parameters;
+    hr = create_root_signature(context.device, &root_signature_desc, &root_signature);
+    ok(hr == S_OK, "Failed to create root signature, hr %#x.\n", hr);
+
+    memset(&pipeline_desc, 0, sizeof(pipeline_desc));
+    pipeline_desc.pRootSignature = root_signature;
+    pipeline_desc.CS = shader_bytecode(cs_code, sizeof(cs_code));
+    hr = ID3D12Device_CreateComputePipelineState(context.device, &pipeline_desc,
+            &IID_ID3D12PipelineState, (void **)&pipeline_state);
+    ok(hr == S_OK, "Failed to create compute pipeline, hr %#x.\n", hr);
+
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, buffer, 0, upload_buffer, 0, sizeof(zero_data));
+    transition_resource_state(command_list, buffer,
+            D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_UNORDERED_ACCESS);
+
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, pipeline_state);
+    ID3D12GraphicsCommandList_SetComputeRootSignature(command_list, root_signature);
+    ID3D12GraphicsCommandList_SetComputeRootUnorderedAccessView(command_list,
+            1, ID3D12Resource_GetGPUVirtualAddress(buffer));
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 1, 0);
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 0xcafe, 1);
+    ID3D12GraphicsCommandList_Dispatch(command_list, 1, 1, 1);
+    uav_barrier(command_list, buffer);
+
+    /* The root constants and the root UAV were consumed by the previous
+     * dispatch, and are not set again. */
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions, 0, D3D12_PREDICATION_OP_EQUAL_ZERO);
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 2, 0);
+    ID3D12GraphicsCommandList_Dispatch(command_list, 1, 1, 1);
+    uav_barrier(command_list, buffer);
+    ID3D12GraphicsCommandList_SetComputeRoot32BitConstant(command_list, 0, 3, 0);
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions,
+            sizeof(uint64_t), D3D12_PREDICATION_OP_EQUAL_ZERO);
+    ID3D12GraphicsCommandList_Dispatch(command_list, 1, 1, 1);
+    ID3D12GraphicsCommandList_SetPredication(command_list, NULL, 0, 0);
+
+    transition_resource_state(command_list, buffer,
+            D3D12_RESOURCE_STATE_UNORDERED_ACCESS, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    ID3D12GraphicsCommandList_CopyBufferRegion(command_list, readback_buffer, 0, buffer, 0, sizeof(zero_data));
+    hr = ID3D12GraphicsCommandList_Close(command_list);
+    ok(hr == S_OK, "Failed to close command list, hr %#x.\n", hr);
+    exec_command_list(queue, command_list);
+    wait_queue_idle(context.device, queue);
+
+    read_range.Begin = 0;
+    read_range.End = sizeof(zero_data);
+    hr = ID3D12Resource_Map(readback_buffer, 0, &read_range, (void **)&data);
+    ok(hr == S_OK, "Failed to map readback buffer, hr %#x.\n", hr);
+    ok(!data[0], "Got unexpected value %#x.\n", data[0]);
+    ok(data[1] == 0xcafe, "Got unexpected value %#x.\n", data[1]);
+    ok(data[2] == 0xcafe, "Got unexpected value %#x.\n", data[2]);
+    ok(!data[3], "Got unexpected value %#x.\n", data[3]);
+    ID3D12Resource_Unmap(readback_buffer, 0, NULL);
+
+    ID3D12PipelineState_Release(pipeline_state);
+    ID3D12RootSignature_Release(root_signature);
+    ID3D12Resource_Release(readback_buffer);
+    ID3D12Resource_Release(upload_buffer);
+    ID3D12Resource_Release(conditions);
+    ID3D12Resource_Release(buffer);
+    destroy_test_context(&context);
+}
+
+static void test_predicated_draw_emulation(void)
+{
+    static const uint64_t predicate_args[] = {0, 1};
+    static const D3D12_DRAW_ARGUMENTS draw_args = {3, 1, 0, 0};
+    static const float white[] = {1.0f, 1.0f, 1.0f, 1.0f};
+    ID3D12Resource *conditions, *argument_buffer;
+    D3D12_COMMAND_SIGNATURE_DESC signature_desc;
+    ID3D12CommandSignature *command_signature;
+    D3D12_INDIRECT_ARGUMENT_DESC argument_desc;
+    ID3D12GraphicsCommandList *command_list;
+    unsigned int width, height;
+    struct resource_readback rb;
+    struct test_context context;
+    char *old_extensions = NULL;
+    ID3D12CommandQueue *queue;
+    const char *extensions;
+    RECT scissor_rect;
+    D3D12_BOX box;
+    HRESULT hr;
+    bool ret;
+
+    /* Without VK_EXT_conditional_rendering, draws are turned into indirect
+     * draws with a draw count resolved from the predicate. */
+    if ((extensions = getenv("VKD3D_DISABLE_EXTENSIONS")))
+        old_extensions = strdup(extensions);
+    setenv("VKD3D_DISABLE_EXTENSIONS", "VK_EXT_conditional_rendering", 1);
+    ret = init_test_context(&context, NULL);
+    if (old_extensions)
+        setenv("VKD3D_DISABLE_EXTENSIONS", old_extensions, 1);
+    else
+        unsetenv("VKD3D_DISABLE_EXTENSIONS");
+    free(old_extensions);
+    if (!ret)
+        return;
+    command_list = context.list;
+    queue = context.queue;
+    width = context.render_target_desc.Width;
+    height = context.render_target_desc.Height;
+
+    conditions = create_upload_buffer(context.device, sizeof(predicate_args), predicate_args);
+    argument_buffer = create_upload_buffer(context.device, sizeof(draw_args), &draw_args);
+
+    argument_desc.Type = D3D12_INDIRECT_ARGUMENT_TYPE_DRAW;
+    signature_desc.ByteStride = sizeof(draw_args);
+    signature_desc.NumArgumentDescs = 1;
+    signature_desc.pArgumentDescs = &argument_desc;
+    signature_desc.NodeMask = 0;
+    hr = ID3D12Device_CreateCommandSignature(context.device, &signature_desc,
+            NULL, &IID_ID3D12CommandSignature, (void **)&command_signature);
+    ok(hr == S_OK, "Failed to create command signature, hr %#x.\n", hr);
+
+    /* Skip direct and indirect draws on zero. */
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &context.viewport);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &context.scissor_rect);
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions, 0, D3D12_PREDICATION_OP_EQUAL_ZERO);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    ID3D12GraphicsCommandList_ExecuteIndirect(command_list, command_signature, 1, argument_buffer, 0, NULL, 0);
+    ID3D12GraphicsCommandList_SetPredication(command_list, NULL, 0, 0);
+
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    check_sub_resource_uint(context.render_target, 0, queue, command_list, 0xffffffff, 0);
+
+    reset_command_list(command_list, context.allocator);
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_COPY_SOURCE, D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+    /* Draw on non-zero, with a direct draw to the left half and an indirect
+     * draw to the right half. */
+    ID3D12GraphicsCommandList_ClearRenderTargetView(command_list, context.rtv, white, 0, NULL);
+    ID3D12GraphicsCommandList_OMSetRenderTargets(command_list, 1, &context.rtv, false, NULL);
+    ID3D12GraphicsCommandList_SetGraphicsRootSignature(command_list, context.root_signature);
+    ID3D12GraphicsCommandList_SetPipelineState(command_list, context.pipeline_state);
+    ID3D12GraphicsCommandList_IASetPrimitiveTopology(command_list, D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    ID3D12GraphicsCommandList_RSSetViewports(command_list, 1, &context.viewport);
+    ID3D12GraphicsCommandList_SetPredication(command_list, conditions,
+            sizeof(uint64_t), D3D12_PREDICATION_OP_EQUAL_ZERO);
+    set_rect(&scissor_rect, 0, 0, width / 2, height);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &scissor_rect);
+    ID3D12GraphicsCommandList_DrawInstanced(command_list, 3, 1, 0, 0);
+    set_rect(&scissor_rect, width / 2, 0, width, height);
+    ID3D12GraphicsCommandList_RSSetScissorRects(command_list, 1, &scissor_rect);
+    ID3D12GraphicsCommandList_ExecuteIndirect(command_list, command_signature, 1, argument_buffer, 0, NULL, 0);
+    ID3D12GraphicsCommandList_SetPredication(command_list, NULL, 0, 0);
+
+    transition_resource_state(command_list, context.render_target,
+            D3D12_RESOURCE_STATE_RENDER_TARGET, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    get_texture_readback_with_command_list(context.render_target, 0, &rb, queue, command_list);
+    set_box(&box, 0, 0, 0, width / 2, height, 1);
+    check_readback_data_uint(&rb, &box, 0xff00ff00, 0);
+    set_box(&box, width / 2, 0, 0, width, height, 1);
+    check_readback_data_uint(&rb, &box, 0xff00ff00, 0);
+    release_resource_readback(&rb);
+
+    ID3D12CommandSignature_Release(command_signature);
+    ID3D12Resource_Release(argument_buffer);
+    ID3D12Resource_Release(conditions);
+    destroy_test_context(&context);
+}
+
 static void test_formats(void)
 {
     DXGI_FORMAT dxgi_format, format;
@@ -1095,6 +1921,70 @@ static void test_application_info(void)
     ok(!refcount, "Instance has %u references left.\n", refcount);
 }
 
+static void test_event_waits(void)
+{
+    unsigned int ret, index;
+    struct pollfd poll_fd;
+    HANDLE events[3];
+    int fd;
+
+    events[0] = vkd3d_create_event();
+    ok(events[0], "Failed to create event.\n");
+    events[1] = vkd3d_create_event();
+    ok(events[1], "Failed to create event.\n");
+    events[2] = vkd3d_create_pollable_event();
+    ok(events[2], "Failed to create pollable event.\n");
+
+    ret = vkd3d_wait_event(events[0], 10);
+    ok(ret == VKD3D_WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
+    vkd3d_signal_event(events[0]);
+    ret = vkd3d_wait_event(events[0], 10);
+    ok(ret == VKD3D_WAIT_OBJECT_0, "Got unexpected return value %#x.\n", ret);
+    ret = vkd3d_wait_event(events[0], 0);
+    ok(ret == VKD3D_WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
+
+    ret = vkd3d_wait_events(ARRAY_SIZE(events), events, FALSE, 10, &index);
+    ok(ret == VKD3D_WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
+    vkd3d_signal_event(events[1]);
+    index = ~0u;
+    ret = vkd3d_wait_events(ARRAY_SIZE(events), events, FALSE, VKD3D_INFINITE, &index);
+    ok(ret == VKD3D_WAIT_OBJECT_0, "Got unexpected return value %#x.\n", ret);
+    ok(index == 1, "Got unexpected index %u.\n", index);
+    ret = vkd3d_wait_event(events[1], 0);
+    ok(ret == VKD3D_WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
+
+    vkd3d_signal_event(events[0]);
+    vkd3d_signal_event(events[2]);
+    ret = vkd3d_wait_events(ARRAY_SIZE(events), events, TRUE, 10, NULL);
+    ok(ret == VKD3D_WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
+    vkd3d_signal_event(events[1]);
+    ret = vkd3d_wait_events(ARRAY_SIZE(events), events, TRUE, 0, NULL);
+    ok(ret == VKD3D_WAIT_OBJECT_0, "Got unexpected return value %#x.\n", ret);
+    ret = vkd3d_wait_events(ARRAY_SIZE(events), events, FALSE, 0, &index);
+    ok(ret == VKD3D_WAIT_TIMEOUT, "Got unexpected return value %#x.\n", ret);
+
+    fd = vkd3d_get_event_fd(events[0]);
+    ok(fd == -1, "Got unexpected fd %d.\n", fd);
+    if ((fd = vkd3d_get_event_fd(events[2])) != -1)
+    {
+        poll_fd.fd = fd;
+        poll_fd.events = POLLIN;
+        ret = poll(&poll_fd, 1, 0);
+        ok(!ret, "Got unexpected return value %d.\n", ret);
+        vkd3d_signal_event(events[2]);
+        ret = poll(&poll_fd, 1, 0);
+        ok(ret == 1, "Got unexpected return value %d.\n", ret);
+        ret = vkd3d_wait_event(events[2], 0);
+        ok(ret == VKD3D_WAIT_OBJECT_0, "Got unexpected return value %#x.\n", ret);
+        ret = poll(&poll_fd, 1, 0);
+        ok(!ret, "Got unexpected return value %d.\n", ret);
+    }
+
+    vkd3d_destroy_event(events[0]);
+    vkd3d_destroy_event(events[1]);
+    vkd3d_destroy_event(events[2]);
+}
+
 static bool have_d3d12_device(void)
 {
     ID3D12Device *device;
@@ -1122,9 +2012,21 @@ START_TEST(vkd3d_api)
     run_test(test_adapter_luid);
     run_test(test_device_parent);
     run_test(test_vkd3d_queue);
+    run_test(test_fence_wait_for_value);
+    run_test(test_upload_memory);
+    run_test(test_queue_timestamps);
     run_test(test_resource_internal_refcount);
+    run_test(test_memory_statistics);
+    run_test(test_object_pool_statistics);
+    run_test(test_sampler_cache);
+    run_test(test_view_cache);
+    run_test(test_root_signature_cache);
+    run_test(test_residency);
     run_test(test_external_resource_map);
     run_test(test_external_resource_present_state);
     run_test(test_formats);
     run_test(test_application_info);
+    run_test(test_event_waits);
+    run_test(test_predicated_dispatch_emulation);
+    run_test(test_predicated_draw_emulation);
 }